@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Animation.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Animations per job when sampling in parallel
+	const unsigned int AnimationChunkSize = 256;
+
+	// --------------------------------------------------------
+	// Finds the key a segment starts at (the last one at or
+	// before the time).  Playback usually moves forward a bit
+	// each frame, so the cursor's key and the next few are
+	// tried first; only a jump (or a loop back to the start)
+	// needs a binary search.
+	// --------------------------------------------------------
+	unsigned int FindKey(const std::vector<float>& times, float time, unsigned int cursor)
+	{
+		unsigned int last = (unsigned int)times.size() - 1;
+		if (cursor <= last && times[cursor] <= time)
+		{
+			for (int step = 0; step < 4; step++, cursor++)
+				if (cursor == last || time < times[cursor + 1])
+					return cursor;
+		}
+
+		size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+		return next == 0 ? 0 : (unsigned int)next - 1;
+	}
+
+	// Flips a quaternion to the same side as another, if need be
+	XMVECTOR AlignQuaternion(FXMVECTOR q, FXMVECTOR reference)
+	{
+		return XMVectorGetX(XMVector4Dot(q, reference)) < 0 ? XMVectorNegate(q) : q;
+	}
+}
+
+
+AnimationClip::AnimationClip(AnimationInterpolation interpolation, bool looping) :
+	interpolation(interpolation),
+	looping(looping),
+	duration(0)
+{
+}
+
+void AnimationClip::AddPositionKey(float time, DirectX::XMFLOAT3 position)
+{
+	AddKey(AnimationTarget::Position, time, XMFLOAT4(position.x, position.y, position.z, 0));
+}
+
+void AnimationClip::AddRotationKey(float time, DirectX::XMFLOAT4 quaternion)
+{
+	XMFLOAT4 normalized;
+	XMStoreFloat4(&normalized, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	AddKey(AnimationTarget::Rotation, time, normalized);
+}
+
+void AnimationClip::AddScaleKey(float time, DirectX::XMFLOAT3 scale)
+{
+	AddKey(AnimationTarget::Scale, time, XMFLOAT4(scale.x, scale.y, scale.z, 0));
+}
+
+// --------------------------------------------------------
+// Samples each part the clip has.  Rotations are blended
+// like everything else, then normalized (an nlerp, or its
+// curved equivalent), which is much cheaper than a slerp
+// and close enough between keys.
+// --------------------------------------------------------
+void AnimationClip::Sample(float time, AnimationCursor& cursor, AnimationPose& pose) const
+{
+	time = WrapTime(time);
+	if (!keyTimes[0].empty())
+		XMStoreFloat3(&pose.Position, SampleTarget(0, time, cursor.Keys[0]));
+	if (!keyTimes[1].empty())
+		XMStoreFloat4(&pose.Rotation, XMQuaternionNormalize(SampleTarget(1, time, cursor.Keys[1])));
+	if (!keyTimes[2].empty())
+		XMStoreFloat3(&pose.Scale, SampleTarget(2, time, cursor.Keys[2]));
+}
+
+float AnimationClip::WrapTime(float time) const
+{
+	if (duration <= 0)
+		return 0;
+	if (!looping)
+		return std::max(0.0f, std::min(duration, time));
+
+	// Usually still inside the clip (playback only just crossed the end, if not)
+	if (time >= 0 && time < duration)
+		return time;
+	time = fmodf(time, duration);
+	return time < 0 ? time + duration : time;
+}
+
+AnimationInterpolation AnimationClip::GetInterpolation() const { return interpolation; }
+bool AnimationClip::IsLooping() const { return looping; }
+float AnimationClip::GetDuration() const { return duration; }
+bool AnimationClip::HasTarget(AnimationTarget target) const { return !keyTimes[(int)target].empty(); }
+const std::vector<float>& AnimationClip::GetKeyTimes(AnimationTarget target) const { return keyTimes[(int)target]; }
+const std::vector<DirectX::XMFLOAT4>& AnimationClip::GetKeyValues(AnimationTarget target) const { return keyValues[(int)target]; }
+
+// --------------------------------------------------------
+// Inserts a key in time order.  Each rotation from there on
+// is flipped to the side of the one before it, if need be
+// (q and -q are the same rotation, but blending them isn't).
+// --------------------------------------------------------
+void AnimationClip::AddKey(AnimationTarget target, float time, DirectX::XMFLOAT4 value)
+{
+	std::vector<float>& times = keyTimes[(int)target];
+	std::vector<XMFLOAT4>& values = keyValues[(int)target];
+	size_t index = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+	times.insert(times.begin() + index, time);
+	values.insert(values.begin() + index, value);
+	duration = std::max(duration, time);
+
+	if (target == AnimationTarget::Rotation)
+	{
+		for (size_t i = std::max<size_t>(index, 1); i < values.size(); i++)
+			XMStoreFloat4(&values[i], AlignQuaternion(XMLoadFloat4(&values[i]), XMLoadFloat4(&values[i - 1])));
+	}
+}
+
+// --------------------------------------------------------
+// Blends the keys around the time.  Straight lines only use
+// the segment's two ends; curves use the keys on either side
+// too (wrapping around, if the clip loops, or repeating the
+// end keys otherwise).
+// --------------------------------------------------------
+DirectX::XMVECTOR AnimationClip::SampleTarget(int target, float time, unsigned int& cursor) const
+{
+	const std::vector<float>& times = keyTimes[target];
+	const XMFLOAT4* values = keyValues[target].data();
+	unsigned int last = (unsigned int)times.size() - 1;
+	unsigned int key = cursor = FindKey(times, time, cursor);
+
+	// Before the first key, or after the last, hold it
+	if (key == last || time <= times[key])
+		return XMLoadFloat4(&values[key]);
+
+	float u = (time - times[key]) / (times[key + 1] - times[key]);
+	XMVECTOR a = XMLoadFloat4(&values[key]);
+	XMVECTOR b = XMLoadFloat4(&values[key + 1]);
+	if (interpolation == AnimationInterpolation::Linear)
+		return XMVectorMultiplyAdd(b, XMVectorReplicate(u), XMVectorScale(a, 1.0f - u));
+
+	// Catmull-Rom weights of the keys before, at the ends of, and after the segment
+	float u2 = u * u;
+	float u3 = u2 * u;
+	float weights[4] =
+	{
+		0.5f * (-u3 + 2 * u2 - u),
+		0.5f * (3 * u3 - 5 * u2 + 2),
+		0.5f * (-3 * u3 + 4 * u2 + u),
+		0.5f * (u3 - u2)
+	};
+
+	bool wrapped = looping && (key == 0 || key + 1 == last);
+	unsigned int before = key > 0 ? key - 1 : (looping ? last - 1 : 0);
+	unsigned int after = key + 1 < last ? key + 2 : (looping ? 1 : last);
+	XMVECTOR beforeValue = XMLoadFloat4(&values[before]);
+	XMVECTOR afterValue = XMLoadFloat4(&values[after]);
+
+	// Neighbors from the other end of the clip weren't lined up with these ones
+	if (wrapped && target == (int)AnimationTarget::Rotation)
+	{
+		beforeValue = AlignQuaternion(beforeValue, a);
+		afterValue = AlignQuaternion(afterValue, b);
+	}
+
+	XMVECTOR result = XMVectorScale(beforeValue, weights[0]);
+	result = XMVectorMultiplyAdd(a, XMVectorReplicate(weights[1]), result);
+	result = XMVectorMultiplyAdd(b, XMVectorReplicate(weights[2]), result);
+	return XMVectorMultiplyAdd(afterValue, XMVectorReplicate(weights[3]), result);
+}
+
+
+AnimationSystem::AnimationSystem(TransformSystem& transforms) :
+	transforms(transforms)
+{
+}
+
+unsigned int AnimationSystem::Play(std::shared_ptr<AnimationClip> clip, unsigned int transformHandle, float speed, float startTime)
+{
+	unsigned int id;
+	if (!freeIDs.empty())
+	{
+		id = freeIDs.back();
+		freeIDs.pop_back();
+	}
+	else
+	{
+		id = (unsigned int)indices.size();
+		indices.push_back(0);
+	}
+	indices[id] = (unsigned int)clips.size();
+
+	times.push_back(clip->WrapTime(startTime));
+	clips.push_back(clip);
+	transformHandles.push_back(transformHandle);
+	speeds.push_back(speed);
+	cursors.push_back(AnimationCursor());
+	poses.push_back(AnimationPose());
+	ids.push_back(id);
+	return id;
+}
+
+// --------------------------------------------------------
+// Stops an animation (leaving its transform where it is) by
+// moving the last one into its place
+// --------------------------------------------------------
+void AnimationSystem::Stop(unsigned int id)
+{
+	unsigned int index = indices[id];
+	unsigned int last = (unsigned int)clips.size() - 1;
+	if (index != last)
+	{
+		clips[index] = clips[last];
+		transformHandles[index] = transformHandles[last];
+		times[index] = times[last];
+		speeds[index] = speeds[last];
+		cursors[index] = cursors[last];
+		poses[index] = poses[last];
+		ids[index] = ids[last];
+		indices[ids[index]] = index;
+	}
+
+	clips.pop_back();
+	transformHandles.pop_back();
+	times.pop_back();
+	speeds.pop_back();
+	cursors.pop_back();
+	poses.pop_back();
+	ids.pop_back();
+	freeIDs.push_back(id);
+}
+
+float AnimationSystem::GetTime(unsigned int id) const { return times[indices[id]]; }
+void AnimationSystem::SetTime(unsigned int id, float time) { times[indices[id]] = clips[indices[id]]->WrapTime(time); }
+void AnimationSystem::SetSpeed(unsigned int id, float speed) { speeds[indices[id]] = speed; }
+
+// --------------------------------------------------------
+// Samples in chunks across the thread pool.  Each chunk only
+// writes to its own animations, and only reads from the
+// transforms (the parts a clip doesn't have are left as they
+// are).  Writing the poses, which bumps the transforms'
+// versions, happens back on this thread afterwards.
+// --------------------------------------------------------
+void AnimationSystem::Update(float deltaTime)
+{
+	size_t count = clips.size();
+	size_t chunkCount = (count + AnimationChunkSize - 1) / AnimationChunkSize;
+	ThreadPool::Shared().ParallelFor(chunkCount, [&](size_t chunk)
+		{
+			size_t end = std::min(count, (chunk + 1) * AnimationChunkSize);
+			for (size_t i = chunk * AnimationChunkSize; i < end; i++)
+			{
+				const AnimationClip& clip = *clips[i];
+				times[i] = clip.WrapTime(times[i] + deltaTime * speeds[i]);
+
+				AnimationPose& pose = poses[i];
+				if (!clip.HasTarget(AnimationTarget::Position))
+					pose.Position = transforms.GetPosition(transformHandles[i]);
+				if (!clip.HasTarget(AnimationTarget::Rotation))
+					pose.Rotation = transforms.GetRotation(transformHandles[i]);
+				if (!clip.HasTarget(AnimationTarget::Scale))
+					pose.Scale = transforms.GetScale(transformHandles[i]);
+				clip.Sample(times[i], cursors[i], pose);
+			}
+		});
+
+	for (size_t i = 0; i < count; i++)
+		transforms.SetLocal(transformHandles[i], poses[i].Position, poses[i].Rotation, poses[i].Scale);
+}
+
+unsigned int AnimationSystem::GetCount() const { return (unsigned int)clips.size(); }
+
+AnimationSystem& AnimationSystem::Shared()
+{
+	static AnimationSystem system(TransformSystem::Shared());
+	return system;
+}
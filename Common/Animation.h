@@ -0,0 +1,144 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "TransformSystem.h"
+
+// How a clip gets from one key to the next
+enum class AnimationInterpolation
+{
+	Linear,		// Straight lines (quaternions are nlerped)
+	Cubic		// Catmull-Rom curves through the keys (nlerped too)
+};
+
+// The parts of a transform a clip can drive
+enum class AnimationTarget
+{
+	Position,
+	Rotation,
+	Scale
+};
+
+// A transform's local data, as sampled from a clip
+struct AnimationPose
+{
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT4 Rotation;
+	DirectX::XMFLOAT3 Scale;
+};
+
+// Where the last sample of a clip was (the key each part's
+// segment started at), so the next one can start looking there
+struct AnimationCursor
+{
+	unsigned int Keys[3] = {};
+};
+
+// --------------------------------------------------------
+// Keyframes for a transform's position, rotation and scale
+// (any of which can be left out).  Each part is a list of
+// times, and a value (xyz, or a quaternion's xyzw) for each,
+// tightly packed.
+//
+// Sampling blends the (up to) four keys around the time with
+// weights worked out once, which is the same for straight
+// lines and curves, and for every part, so each part is one
+// multiply-add per key on a whole vector.
+// --------------------------------------------------------
+class AnimationClip
+{
+public:
+	// Looping clips wrap around, so their last keys should
+	// match their first; others hold their ends
+	AnimationClip(AnimationInterpolation interpolation = AnimationInterpolation::Linear, bool looping = false);
+
+	// Keys can be added in any order.  Rotations are normalized,
+	// and flipped to the same side as their neighbors if need be,
+	// so blending them always takes the short way around.
+	void AddPositionKey(float time, DirectX::XMFLOAT3 position);
+	void AddRotationKey(float time, DirectX::XMFLOAT4 quaternion);
+	void AddScaleKey(float time, DirectX::XMFLOAT3 scale);
+
+	// Fills in the parts of the pose this clip has (leaving the
+	// others alone), starting from the cursor's keys
+	void Sample(float time, AnimationCursor& cursor, AnimationPose& pose) const;
+
+	// Where a time falls in the clip: wrapped around if it loops,
+	// and clamped to it otherwise
+	float WrapTime(float time) const;
+
+	// Getters
+	AnimationInterpolation GetInterpolation() const;
+	bool IsLooping() const;
+	float GetDuration() const;		// Time of the last key
+	bool HasTarget(AnimationTarget target) const;
+	const std::vector<float>& GetKeyTimes(AnimationTarget target) const;
+	const std::vector<DirectX::XMFLOAT4>& GetKeyValues(AnimationTarget target) const;
+
+private:
+	AnimationInterpolation interpolation;
+	bool looping;
+	float duration;
+
+	// Keys of each part, by AnimationTarget
+	std::vector<float> keyTimes[3];
+	std::vector<DirectX::XMFLOAT4> keyValues[3];
+
+	void AddKey(AnimationTarget target, float time, DirectX::XMFLOAT4 value);
+	DirectX::XMVECTOR SampleTarget(int target, float time, unsigned int& cursor) const;
+};
+
+// --------------------------------------------------------
+// Plays clips on transforms, all of them at once: Update()
+// moves every animation along and samples it (spread over
+// the shared ThreadPool, since they're independent), then
+// writes the poses into the TransformSystem in one pass.
+//
+// Animations are referred to by IDs, which never change.
+// Stop an animation before destroying its transform.
+// --------------------------------------------------------
+class AnimationSystem
+{
+public:
+	AnimationSystem(TransformSystem& transforms);
+	AnimationSystem(const AnimationSystem&) = delete; // Remove copy constructor
+	AnimationSystem& operator=(const AnimationSystem&) = delete; // Remove copy-assignment operator
+
+	// Starts playing a clip on a transform (by handle), returning
+	// the animation's ID.  Speed scales time (negative plays it
+	// backwards).
+	unsigned int Play(std::shared_ptr<AnimationClip> clip, unsigned int transformHandle, float speed = 1.0f, float startTime = 0.0f);
+	void Stop(unsigned int id);
+
+	float GetTime(unsigned int id) const;
+	void SetTime(unsigned int id, float time);
+	void SetSpeed(unsigned int id, float speed);
+
+	// Moves every animation along and poses its transform.  Must
+	// not be called from inside a ThreadPool job.
+	void Update(float deltaTime);
+
+	unsigned int GetCount() const;
+
+	// Plays on TransformSystem::Shared()
+	static AnimationSystem& Shared();
+
+private:
+	TransformSystem& transforms;
+
+	// Per-animation data, packed (stopping one moves the last
+	// one into its place)
+	std::vector<std::shared_ptr<AnimationClip>> clips;
+	std::vector<unsigned int> transformHandles;
+	std::vector<float> times;
+	std::vector<float> speeds;
+	std::vector<AnimationCursor> cursors;
+	std::vector<AnimationPose> poses;		// Sampled in parallel, then written
+	std::vector<unsigned int> ids;			// ID of each animation
+
+	// Index of each ID, and IDs free for reuse
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> freeIDs;
+};
@@ -172,12 +172,16 @@ void FPSCamera::Update(float dt)
 		// Calculate cursor change
 		float xDiff = mouseLookSpeed * Input::GetMouseXDelta();
 		float yDiff = mouseLookSpeed * Input::GetMouseYDelta();
-		transform->Rotate(yDiff, xDiff, 0);
 
-		// Clamp the X rotation
+		// Turn by angles (pitch around our right, yaw around the
+		// world's up), and clamp the X rotation just short of
+		// straight up or down, where the yaw would be lost when
+		// the angles are worked back out of the rotation
 		XMFLOAT3 rot = transform->GetPitchYawRoll();
-		if (rot.x > XM_PIDIV2) rot.x = XM_PIDIV2;
-		if (rot.x < -XM_PIDIV2) rot.x = -XM_PIDIV2;
+		rot.x += yDiff;
+		rot.y += xDiff;
+		if (rot.x > XM_PIDIV2 * 0.999f) rot.x = XM_PIDIV2 * 0.999f;
+		if (rot.x < -XM_PIDIV2 * 0.999f) rot.x = -XM_PIDIV2 * 0.999f;
 		transform->SetRotation(rot);
 	}
 
@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------------
+// Opens and maps the given file for reading.  Check IsOpen()
+// afterwards, as a missing or inaccessible file does not throw.
+//
+// path - Full path to the file to map
+// --------------------------------------------------------
+MappedFile::MappedFile(const std::wstring& path) :
+	fileHandle(0),
+	mappingHandle(0),
+	fileDescriptor(-1),
+	data(0),
+	size(0),
+	isOpen(false)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize))
+		return;
+	size = (size_t)fileSize.QuadPart;
+
+	// Zero-length files can't be mapped, but are still "open"
+	isOpen = true;
+	if (size == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		isOpen = false;
+		return;
+	}
+	mappingHandle = mapping;
+
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+		isOpen = false;
+#else
+	fileDescriptor = open(std::filesystem::path(path).string().c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+
+	struct stat info = {};
+	if (fstat(fileDescriptor, &info) != 0)
+		return;
+	size = (size_t)info.st_size;
+
+	// Zero-length files can't be mapped, but are still "open"
+	isOpen = true;
+	if (size == 0)
+		return;
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		isOpen = false;
+		return;
+	}
+	madvise(view, size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+#endif
+}
+
+// --------------------------------------------------------
+// Unmaps the view and closes the underlying handles
+// --------------------------------------------------------
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+#endif
+}
+
+bool MappedFile::IsOpen() { return isOpen; }
+const char* MappedFile::GetData() { return data; }
+size_t MappedFile::GetSize() { return size; }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// The file's bytes are accessed directly from the OS page
+// cache, so no intermediate copy is made and no per-line
+// buffering is necessary.  The mapping is released when
+// this object is destroyed.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const std::wstring& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete; // Remove copy constructor
+	MappedFile& operator=(const MappedFile&) = delete; // Remove copy-assignment operator
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	// Platform handles (HANDLEs on Windows, a descriptor elsewhere)
+	void* fileHandle;
+	void* mappingHandle;
+	int fileDescriptor;
+
+	// The mapped bytes
+	const char* data;
+	size_t size;
+	bool isOpen;
+};
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(unsigned int capacity) :
+	capacity(0),
+	used(0)
+{
+	Grow(capacity);
+}
+
+
+// --------------------------------------------------------
+// Getters for private variables
+// --------------------------------------------------------
+unsigned int RangeAllocator::GetCapacity() { return capacity; }
+unsigned int RangeAllocator::GetUsed() { return used; }
+unsigned int RangeAllocator::GetAllocationCount() { return (unsigned int)allocations.size(); }
+
+unsigned int RangeAllocator::GetLargestFreeRange()
+{
+	unsigned int largest = 0;
+	for (auto& range : freeRanges)
+		largest = std::max(largest, range.second);
+	return largest;
+}
+
+
+// --------------------------------------------------------
+// Takes the lowest free range that's big enough, so
+// allocations pack towards the start of the space.  Zero
+// sized requests still get a (one unit) range, so every
+// allocation has a unique offset to free.
+// --------------------------------------------------------
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	size = std::max(size, 1u);
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); it++)
+	{
+		if (it->second < size)
+			continue;
+
+		unsigned int offset = it->first;
+		unsigned int remaining = it->second - size;
+		freeRanges.erase(it);
+		if (remaining > 0)
+			freeRanges[offset + size] = remaining;
+
+		allocations[offset] = size;
+		used += size;
+		return offset;
+	}
+	return InvalidOffset;
+}
+
+
+// --------------------------------------------------------
+// Frees an allocation, merging it with any free ranges
+// directly before or after it
+// --------------------------------------------------------
+void RangeAllocator::Free(unsigned int offset)
+{
+	auto allocation = allocations.find(offset);
+	if (allocation == allocations.end())
+		throw std::invalid_argument("Error freeing range: Offset was not allocated");
+
+	unsigned int size = allocation->second;
+	allocations.erase(allocation);
+	used -= size;
+	AddFreeRange(offset, size);
+}
+
+
+// --------------------------------------------------------
+// Extends the space, adding the new units to the end (and
+// merging them with a free range that ends there)
+// --------------------------------------------------------
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	AddFreeRange(capacity, newCapacity - capacity);
+	capacity = newCapacity;
+}
+
+
+// --------------------------------------------------------
+// Helper for adding a free range, merged with its neighbors
+// --------------------------------------------------------
+void RangeAllocator::AddFreeRange(unsigned int offset, unsigned int size)
+{
+	auto next = freeRanges.lower_bound(offset);
+	if (next != freeRanges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+	freeRanges[offset] = size;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+
+// --------------------------------------------------------
+// Hands out ranges of a larger space (like elements of a
+// buffer) with first-fit allocation.  Freed ranges merge
+// with their free neighbors, so space doesn't fragment into
+// pieces that are too small to reuse.
+//
+// Only tracks numbers - it never touches the memory itself,
+// so it works the same for CPU arrays and GPU buffers.
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	// Returned by Allocate() when no free range is big enough
+	static const unsigned int InvalidOffset = 0xFFFFFFFF;
+
+	RangeAllocator(unsigned int capacity = 0);
+
+	// Reserves size units, returning the offset of the first
+	// one (or InvalidOffset if there isn't room)
+	unsigned int Allocate(unsigned int size);
+
+	// Returns a range from Allocate() (throws if it wasn't one)
+	void Free(unsigned int offset);
+
+	// Adds space at the end (capacity can only grow)
+	void Grow(unsigned int newCapacity);
+
+	unsigned int GetCapacity();
+	unsigned int GetUsed();
+	unsigned int GetLargestFreeRange();
+	unsigned int GetAllocationCount();
+
+private:
+	unsigned int capacity;
+	unsigned int used;
+
+	// Offset -> size of every free range, and of every allocation
+	std::map<unsigned int, unsigned int> freeRanges;
+	std::map<unsigned int, unsigned int> allocations;
+
+	void AddFreeRange(unsigned int offset, unsigned int size);
+};
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// Creates the given number of worker threads.  The thread
+// calling ParallelFor() always helps, so zero workers is
+// valid (every job simply runs on the caller).
+// --------------------------------------------------------
+ThreadPool::ThreadPool(unsigned int workerCount) :
+	job(0),
+	jobCount(0),
+	nextIndex(0),
+	generation(0),
+	busyWorkers(0),
+	stopping(false)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+// --------------------------------------------------------
+// Signals all workers to exit and waits for them
+// --------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& t : workers)
+		t.join();
+}
+
+unsigned int ThreadPool::GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+// --------------------------------------------------------
+// Runs func(i) for every i in [0, count) across all threads
+// and returns once they have all completed.  Iterations are
+// handed out dynamically, so uneven workloads balance out.
+// --------------------------------------------------------
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	// Not worth waking anyone up?
+	if (count == 0) return;
+	if (count == 1 || workers.empty())
+	{
+		for (size_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	// Only one job can be in flight at a time
+	std::lock_guard<std::mutex> jobLock(jobMutex);
+
+	// Publish the job and wake the workers
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &func;
+		jobCount = count;
+		nextIndex = 0;
+		busyWorkers = (unsigned int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	// Help out, then wait for the stragglers
+	RunJob();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busyWorkers == 0; });
+	job = 0;
+}
+
+// --------------------------------------------------------
+// Gets the shared, process-wide pool (created on first use)
+// --------------------------------------------------------
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+	return pool;
+}
+
+// --------------------------------------------------------
+// Each worker sleeps until a new job is published, helps
+// complete it, then reports back
+// --------------------------------------------------------
+void ThreadPool::WorkerLoop()
+{
+	unsigned long long lastGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != lastGeneration; });
+			if (stopping)
+				return;
+			lastGeneration = generation;
+		}
+
+		RunJob();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+		}
+		done.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// Grabs and runs loop iterations until none are left
+// --------------------------------------------------------
+void ThreadPool::RunJob()
+{
+	while (true)
+	{
+		size_t i = nextIndex.fetch_add(1);
+		if (i >= jobCount)
+			return;
+
+		(*job)(i);
+	}
+}
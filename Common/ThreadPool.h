@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A small pool of persistent worker threads for data-parallel
+// loops.  ParallelFor() hands out loop iterations to the
+// workers AND the calling thread, then blocks until every
+// iteration has finished.
+//
+// Note: Jobs run one at a time, so ParallelFor() must not be
+//       called from inside another ParallelFor() job.
+// --------------------------------------------------------
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int workerCount);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete; // Remove copy constructor
+	ThreadPool& operator=(const ThreadPool&) = delete; // Remove copy-assignment operator
+
+	// Total threads that take part in a job (workers + caller)
+	unsigned int GetThreadCount();
+
+	// Runs func(i) for every i in [0, count)
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	// A process-wide pool sized to the machine's core count
+	static ThreadPool& Shared();
+
+private:
+	std::vector<std::thread> workers;
+
+	// Current job
+	std::mutex jobMutex;
+	const std::function<void(size_t)>* job;
+	size_t jobCount;
+	std::atomic<size_t> nextIndex;
+
+	// Worker signaling
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation;
+	unsigned int busyWorkers;
+	bool stopping;
+
+	void WorkerLoop();
+	void RunJob();
+};
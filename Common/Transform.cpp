@@ -1,56 +1,52 @@
+#include <algorithm>
+
 #include "Transform.h"
 
 using namespace DirectX;
 
 
 Transform::Transform() :
-	position(0, 0, 0),
-	pitchYawRoll(0, 0, 0),
-	scale(1, 1, 1),
-	up(0, 1, 0),
-	right(1, 0, 0),
-	forward(0, 0, 1),
-	matricesDirty(false),
-	vectorsDirty(false),
+	handle(TransformSystem::Shared().Create()),
 	parent(0)
 {
-	// Start with an identity matrix and basic transform data
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+}
+
+Transform::~Transform()
+{
+	// Leave the hierarchy without leaving pointers to this behind
+	for (Transform* c : children)
+	{
+		c->parent = 0;
+		TransformSystem::Shared().SetParent(c->handle, TRANSFORM_NO_PARENT);
+	}
+	if (parent)
+		parent->children.erase(std::find(parent->children.begin(), parent->children.end(), this));
+
+	TransformSystem::Shared().Destroy(handle);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	TransformSystem& system = TransformSystem::Shared();
+	XMFLOAT3 position = system.GetPosition(handle);
 	position.x += x;
 	position.y += y;
 	position.z += z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	system.SetPosition(handle, position);
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
 {
-	position.x += offset.x;
-	position.y += offset.y;
-	position.z += offset.z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	MoveAbsolute(offset.x, offset.y, offset.z);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	// Create a direction vector from the params
-	// and a rotation quaternion
-	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-
-	// Rotate the movement by the quaternion
-	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
+	// Rotate the movement by our rotation
+	XMFLOAT3 dir = RotateVector(x, y, z);
 
-	// Add and store, and invalidate the matrices
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	// Add and store
+	MoveAbsolute(dir);
 }
 
 void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
@@ -61,108 +57,86 @@ void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
 
 void Transform::Rotate(float p, float y, float r)
 {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
-	matricesDirty = true;
-	vectorsDirty = true;
-	MarkChildTransformsDirty();
+	Rotate(EulerToQuaternion(p, y, r));
 }
 
 void Transform::Rotate(DirectX::XMFLOAT3 pitchYawRoll)
 {
-	this->pitchYawRoll.x += pitchYawRoll.x;
-	this->pitchYawRoll.y += pitchYawRoll.y;
-	this->pitchYawRoll.z += pitchYawRoll.z;
-	matricesDirty = true;
-	vectorsDirty = true;
-	MarkChildTransformsDirty();
+	Rotate(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+}
+
+void Transform::Rotate(DirectX::XMFLOAT4 quaternion)
+{
+	// The new rotation happens first, in our own (local) space,
+	// then the existing one; renormalized so error can't build up
+	TransformSystem& system = TransformSystem::Shared();
+	XMFLOAT4 current = system.GetRotation(handle);
+	XMFLOAT4 rotated;
+	XMStoreFloat4(&rotated, XMQuaternionNormalize(
+		XMQuaternionMultiply(XMLoadFloat4(&quaternion), XMLoadFloat4(&current))));
+	system.SetRotation(handle, rotated);
 }
 
 void Transform::Scale(float uniformScale)
 {
-	scale.x *= uniformScale;
-	scale.y *= uniformScale;
-	scale.z *= uniformScale;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	Scale(uniformScale, uniformScale, uniformScale);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
+	TransformSystem& system = TransformSystem::Shared();
+	XMFLOAT3 scale = system.GetScale(handle);
 	scale.x *= x;
 	scale.y *= y;
 	scale.z *= z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	system.SetScale(handle, scale);
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 scale)
 {
-	this->scale.x *= scale.x;
-	this->scale.y *= scale.y;
-	this->scale.z *= scale.z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	Scale(scale.x, scale.y, scale.z);
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetPosition(handle, XMFLOAT3(x, y, z));
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 position)
 {
-	this->position = position;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetPosition(handle, position);
 }
 
 void Transform::SetRotation(float p, float y, float r)
 {
-	pitchYawRoll.x = p;
-	pitchYawRoll.y = y;
-	pitchYawRoll.z = r;
-	matricesDirty = true;
-	vectorsDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetRotation(handle, EulerToQuaternion(p, y, r));
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 pitchYawRoll)
 {
-	this->pitchYawRoll = pitchYawRoll;
-	matricesDirty = true;
-	vectorsDirty = true;
-	MarkChildTransformsDirty();
+	SetRotation(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion)
+{
+	XMFLOAT4 normalized;
+	XMStoreFloat4(&normalized, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	TransformSystem::Shared().SetRotation(handle, normalized);
 }
 
 void Transform::SetScale(float uniformScale)
 {
-	scale.x = uniformScale;
-	scale.y = uniformScale;
-	scale.z = uniformScale;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetScale(handle, XMFLOAT3(uniformScale, uniformScale, uniformScale));
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetScale(handle, XMFLOAT3(x, y, z));
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 scale)
 {
-	this->scale = scale;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	TransformSystem::Shared().SetScale(handle, scale);
 }
 
 void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
@@ -173,19 +147,19 @@ void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
 	XMVECTOR localScale;
 	XMMatrixDecompose(&localScale, &localRotQuat, &localPos, XMLoadFloat4x4(&worldMatrix));
 
-	// Get the euler angles from the quaternion and store as our 
+	// Store the quaternion as our rotation, as is
 	XMFLOAT4 quat;
 	XMStoreFloat4(&quat, localRotQuat);
-	pitchYawRoll = QuaternionToEuler(quat);
+	TransformSystem& system = TransformSystem::Shared();
+	system.SetRotation(handle, quat);
 
 	// Overwrite the child's other transform data
+	XMFLOAT3 position;
+	XMFLOAT3 scale;
 	XMStoreFloat3(&position, localPos);
 	XMStoreFloat3(&scale, localScale);
-
-	// Things have changed
-	matricesDirty = true;
-	vectorsDirty = true;
-	MarkChildTransformsDirty();
+	system.SetPosition(handle, position);
+	system.SetScale(handle, scale);
 }
 
 void Transform::AddChild(Transform* child, bool makeChildRelative)
@@ -201,11 +175,13 @@ void Transform::AddChild(Transform* child, bool makeChildRelative)
 	// so that it stays in place?
 	if (makeChildRelative)
 	{
-		// Get matrices
-		XMFLOAT4X4 parentWorld = GetWorldMatrix();
+		// Get matrices (as they are now, which may be ahead of
+		// the last resolve)
+		TransformSystem& system = TransformSystem::Shared();
+		XMFLOAT4X4 parentWorld = system.ComputeWorldMatrix(handle);
 		XMMATRIX pWorld = XMLoadFloat4x4(&parentWorld);
 
-		XMFLOAT4X4 childWorld = child->GetWorldMatrix();
+		XMFLOAT4X4 childWorld = system.ComputeWorldMatrix(child->handle);
 		XMMATRIX cWorld = XMLoadFloat4x4(&childWorld);
 
 		// Invert the parent
@@ -225,8 +201,7 @@ void Transform::AddChild(Transform* child, bool makeChildRelative)
 	child->parent = this;
 
 	// This child transform is now out of date
-	child->matricesDirty = true;
-	child->MarkChildTransformsDirty();
+	TransformSystem::Shared().SetParent(child->handle, handle);
 }
 
 void Transform::RemoveChild(Transform* child, bool applyParentTransform)
@@ -244,7 +219,7 @@ void Transform::RemoveChild(Transform* child, bool applyParentTransform)
 	{
 		// Grab the child's transform and matrix
 		Transform* child = *it;
-		XMFLOAT4X4 childWorld = child->GetWorldMatrix();
+		XMFLOAT4X4 childWorld = TransformSystem::Shared().ComputeWorldMatrix(child->handle);
 
 		// Set the child's transform data using its final matrix
 		child->SetTransformsFromMatrix(childWorld);
@@ -255,8 +230,7 @@ void Transform::RemoveChild(Transform* child, bool applyParentTransform)
 	child->parent = 0;
 
 	// This child transform is now out of date
-	child->matricesDirty = true;
-	child->MarkChildTransformsDirty();
+	TransformSystem::Shared().SetParent(child->handle, TRANSFORM_NO_PARENT);
 }
 
 void Transform::SetParent(Transform* newParent, bool makeChildRelative)
@@ -277,16 +251,16 @@ void Transform::SetParent(Transform* newParent, bool makeChildRelative)
 	}
 }
 
-Transform* Transform::GetParent() { return parent; }
+Transform* Transform::GetParent() const { return parent; }
 
-Transform* Transform::GetChild(unsigned int index)
+Transform* Transform::GetChild(unsigned int index) const
 {
 	if (index >= children.size()) return 0;
 
 	return children[index];
 }
 
-int Transform::IndexOfChild(Transform* child)
+int Transform::IndexOfChild(Transform* child) const
 {
 	// Verify pointer
 	if (!child) return -1;
@@ -300,118 +274,71 @@ int Transform::IndexOfChild(Transform* child)
 	return -1;
 }
 
-unsigned int Transform::GetChildCount()
+unsigned int Transform::GetChildCount() const
 {
 	return (unsigned int)children.size();
 }
 
-DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
-DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
+DirectX::XMFLOAT3 Transform::GetPosition() const { return TransformSystem::Shared().GetPosition(handle); }
+DirectX::XMFLOAT4 Transform::GetRotation() const { return TransformSystem::Shared().GetRotation(handle); }
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll() const { return QuaternionToEuler(GetRotation()); }
+DirectX::XMFLOAT3 Transform::GetScale() const { return TransformSystem::Shared().GetScale(handle); }
 
-DirectX::XMFLOAT3 Transform::GetUp()
-{
-	UpdateVectors();
-	return up;
-}
+DirectX::XMFLOAT3 Transform::GetUp() const { return RotateVector(0, 1, 0); }
+DirectX::XMFLOAT3 Transform::GetRight() const { return RotateVector(1, 0, 0); }
+DirectX::XMFLOAT3 Transform::GetForward() const { return RotateVector(0, 0, 1); }
 
-DirectX::XMFLOAT3 Transform::GetRight()
-{
-	UpdateVectors();
-	return right;
-}
 
-DirectX::XMFLOAT3 Transform::GetForward()
+DirectX::XMFLOAT4X4 Transform::GetWorldMatrix() const
 {
-	UpdateVectors();
-	return forward;
+	// Just a lookup: matrices are only rebuilt by the resolve
+	return TransformSystem::Shared().GetWorldMatrix(handle);
 }
 
-
-DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
+DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() const
 {
-	UpdateMatrices();
-	return worldMatrix;
+	return TransformSystem::Shared().GetWorldInverseTransposeMatrix(handle);
 }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
-{
-	UpdateMatrices();
-	return worldInverseTransposeMatrix;
-}
+unsigned int Transform::GetHandle() const { return handle; }
 
-void Transform::UpdateMatrices()
+DirectX::XMFLOAT3 Transform::RotateVector(float x, float y, float z) const
 {
-	// Anything to update?
-	if (!matricesDirty)
-		return;
-
-	// Create the three transformation pieces
-	XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-	XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-	// Combine and store the world
-	XMMATRIX wm = sc * rot * trans;
-
-	// Is there a parent?
-	if (parent)
-	{
-		XMFLOAT4X4 parentWorld = parent->GetWorldMatrix();
-		wm *= XMLoadFloat4x4(&parentWorld);
-	}
-
-	// Store both versions
-	XMStoreFloat4x4(&worldMatrix, wm);
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
-
-	// Matrices are up to date
-	matricesDirty = false;
-}
-
-void Transform::UpdateVectors()
-{
-	// Do we need to update?
-	if (!vectorsDirty)
-		return;
-
-	// Update all three vectors
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-	XMStoreFloat3(&up, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), rotationQuat));
-	XMStoreFloat3(&right, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), rotationQuat));
-	XMStoreFloat3(&forward, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotationQuat));
+	XMFLOAT4 rotation = TransformSystem::Shared().GetRotation(handle);
 
-	// Vectors are up to date
-	vectorsDirty = false;
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Rotate(XMVectorSet(x, y, z, 0), XMLoadFloat4(&rotation)));
+	return result;
 }
 
-void Transform::MarkChildTransformsDirty()
-{
-	// Recursively set children as dirty, too
-	for (auto c : children)
-	{
-		c->matricesDirty = true;
-		c->MarkChildTransformsDirty();
-	}
-}
-
-DirectX::XMFLOAT3 Transform::QuaternionToEuler(DirectX::XMFLOAT4 quaternion)
+DirectX::XMFLOAT3 Transform::QuaternionToEuler(DirectX::XMFLOAT4 quaternion) const
 {
 	// Convert quaternion to euler angles
 	// Note: This will give a set of euler angles, but not necessarily
 	// the same angles that were used to create the quaternion
-	
-	// Step 1: Quaternion to rotation matrix
-	XMMATRIX rMat = XMMatrixRotationQuaternion(XMLoadFloat4(&quaternion));
 
-	// Step 2: Extract each piece
+	// The rotation matrix elements the angles come from, straight
+	// from the quaternion (see XMMatrixRotationQuaternion)
 	// From: https://stackoverflow.com/questions/60350349/directx-get-pitch-yaw-roll-from-xmmatrix
-	XMFLOAT4X4 rotationMatrix;
-	XMStoreFloat4x4(&rotationMatrix, rMat);
-	float pitch = (float)asin(-rotationMatrix._32);
-	float yaw = (float)atan2(rotationMatrix._31, rotationMatrix._33);
-	float roll = (float)atan2(rotationMatrix._12, rotationMatrix._22);
+	float x = quaternion.x, y = quaternion.y, z = quaternion.z, w = quaternion.w;
+	float m12 = 2 * (x * y + z * w);
+	float m22 = 1 - 2 * (x * x + z * z);
+	float m31 = 2 * (x * z + y * w);
+	float m32 = 2 * (y * z - x * w);
+	float m33 = 1 - 2 * (x * x + y * y);
+
+	// Rounding can push the sine just past one
+	float pitch = (float)asin(std::max(-1.0f, std::min(1.0f, -m32)));
+	float yaw = (float)atan2(m31, m33);
+	float roll = (float)atan2(m12, m22);
 
 	// Return the euler values as a vector
 	return XMFLOAT3(pitch, yaw, roll);
 }
+
+DirectX::XMFLOAT4 Transform::EulerToQuaternion(float p, float y, float r) const
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(p, y, r));
+	return quaternion;
+}
@@ -3,10 +3,21 @@
 #include <DirectXMath.h>
 #include <vector>
 
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// A handle to one transform's data in the shared
+// TransformSystem, which is where the data actually lives
+// (and where world matrices are rebuilt, all at once).  The
+// hierarchy is also kept here as pointers, for the API.
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	~Transform();
+	Transform(const Transform&) = delete; // Remove copy constructor (the handle can only be freed once)
+	Transform& operator=(const Transform&) = delete; // Remove copy-assignment operator
 
 	// Transformers
 	void MoveAbsolute(float x, float y, float z);
@@ -15,6 +26,7 @@ public:
 	void MoveRelative(DirectX::XMFLOAT3 offset);
 	void Rotate(float p, float y, float r);
 	void Rotate(DirectX::XMFLOAT3 pitchYawRoll);
+	void Rotate(DirectX::XMFLOAT4 quaternion);
 	void Scale(float uniformScale);
 	void Scale(float x, float y, float z);
 	void Scale(DirectX::XMFLOAT3 scale);
@@ -24,6 +36,7 @@ public:
 	void SetPosition(DirectX::XMFLOAT3 position);
 	void SetRotation(float p, float y, float r);
 	void SetRotation(DirectX::XMFLOAT3 pitchYawRoll);
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 	void SetScale(float uniformScale);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 scale);
@@ -34,52 +47,46 @@ public:
 	void AddChild(Transform* child, bool makeChildRelative = true);
 	void RemoveChild(Transform* child, bool applyParentTransform = true);
 	void SetParent(Transform* newParent, bool makeChildRelative = true);
-	Transform* GetParent();
-	Transform* GetChild(unsigned int index);
-	int IndexOfChild(Transform* child);
-	unsigned int GetChildCount();
+	Transform* GetParent() const;
+	Transform* GetChild(unsigned int index) const;
+	int IndexOfChild(Transform* child) const;
+	unsigned int GetChildCount() const;
 
-	// Getters
-	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetPitchYawRoll();
-	DirectX::XMFLOAT3 GetScale();
+	// Getters (rotation is kept as a quaternion; the
+	// angles are worked out from it, for display).  None of
+	// them change anything, so they're safe to call from
+	// several threads at once.
+	DirectX::XMFLOAT3 GetPosition() const;
+	DirectX::XMFLOAT4 GetRotation() const;
+	DirectX::XMFLOAT3 GetPitchYawRoll() const;
+	DirectX::XMFLOAT3 GetScale() const;
 
 	// Local direction vector getters
-	DirectX::XMFLOAT3 GetUp();
-	DirectX::XMFLOAT3 GetRight();
-	DirectX::XMFLOAT3 GetForward();
+	DirectX::XMFLOAT3 GetUp() const;
+	DirectX::XMFLOAT3 GetRight() const;
+	DirectX::XMFLOAT3 GetForward() const;
+
+	// Matrix getters, as of the last resolve (see
+	// TransformSystem::UpdateWorldMatrices())
+	DirectX::XMFLOAT4X4 GetWorldMatrix() const;
+	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix() const;
 
-	// Matrix getters
-	DirectX::XMFLOAT4X4 GetWorldMatrix();
-	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	// This transform's handle in TransformSystem::Shared()
+	unsigned int GetHandle() const;
 
 private:
+	// Where the data lives
+	unsigned int handle;
+
 	// Hierarchy
 	Transform* parent;
 	std::vector<Transform*> children;
-	
-	// Raw transformation data
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT3 scale;
-
-	// Local orientation vectors
-	bool vectorsDirty;
-	DirectX::XMFLOAT3 up;
-	DirectX::XMFLOAT3 right;
-	DirectX::XMFLOAT3 forward;
-
-	// World matrix and inverse transpose of the world matrix
-	bool matricesDirty;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
-
-	// Helper to update both matrices if necessary
-	void UpdateMatrices();
-	void UpdateVectors();
-	void MarkChildTransformsDirty();
+
+	// Helper for the direction vectors
+	DirectX::XMFLOAT3 RotateVector(float x, float y, float z) const;
 
 	// Helpers for conversion
-	DirectX::XMFLOAT3 QuaternionToEuler(DirectX::XMFLOAT4 quaternion);
+	DirectX::XMFLOAT3 QuaternionToEuler(DirectX::XMFLOAT4 quaternion) const;
+	DirectX::XMFLOAT4 EulerToQuaternion(float p, float y, float r) const;
 };
 
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "TransformBatch.h"
+
+// (After DirectXMath, which decides whether intrinsics are used)
+#if defined(_XM_SSE_INTRINSICS_)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// One transform with DirectXMath, exactly as matrices were
+	// built before there were batches
+	// --------------------------------------------------------
+	void ComputeScalar(const TransformBatchData& data, unsigned int slot)
+	{
+		XMFLOAT3 scale = data.Scales[slot];
+		bool uniform = scale.x == scale.y && scale.y == scale.z;
+
+		XMMATRIX world =
+			XMMatrixScalingFromVector(XMLoadFloat3(&scale)) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&data.Rotations[slot])) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&data.Positions[slot]));
+
+		unsigned int parent = data.Parents[slot];
+		if (parent != TRANSFORM_NO_PARENT)
+		{
+			world *= XMLoadFloat4x4(&data.WorldMatrices[parent]);
+			uniform = uniform && data.UniformScales[parent];
+		}
+
+		data.UniformScales[slot] = uniform;
+		XMStoreFloat4x4(&data.WorldMatrices[slot], world);
+		XMStoreFloat4x4(&data.WorldInverseTransposes[slot], XMMatrixInverse(0, XMMatrixTranspose(world)));
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// The parent of lanes without one
+	const float identity[16] =
+	{
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	};
+
+	// --------------------------------------------------------
+	// The operations the batch kernel needs, four lanes wide
+	// --------------------------------------------------------
+	struct SSEOps
+	{
+		typedef __m128 Float;
+		static constexpr unsigned int Width = 4;
+
+		static Float Set(float f) { return _mm_set1_ps(f); }
+		static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+		static Float MulAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+		static Float Xor(Float a, Float b) { return _mm_xor_ps(a, b); }
+
+		// One float (at an offset) from each lane's pointer
+		static Float Gather(const float* const* p, int offset)
+		{
+			return _mm_setr_ps(p[0][offset], p[1][offset], p[2][offset], p[3][offset]);
+		}
+
+		// Gathers a row from each lane's matrix, as x, y, z & w vectors
+		static void LoadRow(const float* const* matrices, int row, Float& x, Float& y, Float& z, Float& w)
+		{
+			x = _mm_loadu_ps(matrices[0] + row * 4);
+			y = _mm_loadu_ps(matrices[1] + row * 4);
+			z = _mm_loadu_ps(matrices[2] + row * 4);
+			w = _mm_loadu_ps(matrices[3] + row * 4);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+		}
+
+		// Scatters x, y, z & w vectors back to a row of each lane's matrix
+		static void StoreRow(float* const* matrices, int row, Float x, Float y, Float z, Float w)
+		{
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(matrices[0] + row * 4, x);
+			_mm_storeu_ps(matrices[1] + row * 4, y);
+			_mm_storeu_ps(matrices[2] + row * 4, z);
+			_mm_storeu_ps(matrices[3] + row * 4, w);
+		}
+	};
+
+	// --------------------------------------------------------
+	// The same, eight lanes wide.  Rows are moved four lanes
+	// per 128-bit half (lanes 0-3 low, 4-7 high), since AVX
+	// shuffles don't cross halves.
+	// --------------------------------------------------------
+	struct AVX2Ops
+	{
+		typedef __m256 Float;
+		static constexpr unsigned int Width = 8;
+
+		static Float Set(float f) { return _mm256_set1_ps(f); }
+		static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+		static Float MulAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+		static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+		static Float Xor(Float a, Float b) { return _mm256_xor_ps(a, b); }
+
+		static Float Gather(const float* const* p, int offset)
+		{
+			return _mm256_setr_ps(
+				p[0][offset], p[1][offset], p[2][offset], p[3][offset],
+				p[4][offset], p[5][offset], p[6][offset], p[7][offset]);
+		}
+
+		static void Transpose(Float& a, Float& b, Float& c, Float& d)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(a, b);
+			__m256 t1 = _mm256_unpacklo_ps(c, d);
+			__m256 t2 = _mm256_unpackhi_ps(a, b);
+			__m256 t3 = _mm256_unpackhi_ps(c, d);
+			a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		static Float LoadPair(const float* low, const float* high)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+		}
+
+		static void StorePair(float* low, float* high, Float v)
+		{
+			_mm_storeu_ps(low, _mm256_castps256_ps128(v));
+			_mm_storeu_ps(high, _mm256_extractf128_ps(v, 1));
+		}
+
+		static void LoadRow(const float* const* matrices, int row, Float& x, Float& y, Float& z, Float& w)
+		{
+			x = LoadPair(matrices[0] + row * 4, matrices[4] + row * 4);
+			y = LoadPair(matrices[1] + row * 4, matrices[5] + row * 4);
+			z = LoadPair(matrices[2] + row * 4, matrices[6] + row * 4);
+			w = LoadPair(matrices[3] + row * 4, matrices[7] + row * 4);
+			Transpose(x, y, z, w);
+		}
+
+		static void StoreRow(float* const* matrices, int row, Float x, Float y, Float z, Float w)
+		{
+			Transpose(x, y, z, w);
+			StorePair(matrices[0] + row * 4, matrices[4] + row * 4, x);
+			StorePair(matrices[1] + row * 4, matrices[5] + row * 4, y);
+			StorePair(matrices[2] + row * 4, matrices[6] + row * 4, z);
+			StorePair(matrices[3] + row * 4, matrices[7] + row * 4, w);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Up to one batch (O::Width) of transforms.  Inputs are
+	// gathered lane by lane straight into registers, every matrix is built
+	// component-wise across the lanes, and the rows are then
+	// transposed back out into each lane's matrices.
+	// --------------------------------------------------------
+	template<typename O>
+	void ComputeBatch(const TransformBatchData& data, const unsigned int* slots, unsigned int count)
+	{
+		typedef typename O::Float F;
+		const unsigned int W = O::Width;
+
+		const float* positions[W];
+		const float* scales[W];
+		const float* rotations[W];
+		const float* parentMatrices[W];
+		float* worldMatrices[W];
+		float* inverseMatrices[W];
+		XMFLOAT4X4 discardedMatrix;		// Where spare lanes write (batches can run on several threads at once)
+		bool anyParent = false;
+		bool allUniform = true;
+
+		for (unsigned int l = 0; l < W; l++)
+		{
+			unsigned int slot = slots[l < count ? l : 0];
+			const XMFLOAT3& p = data.Positions[slot];
+			const XMFLOAT3& s = data.Scales[slot];
+			positions[l] = &p.x;
+			scales[l] = &s.x;
+			rotations[l] = &data.Rotations[slot].x;
+
+			bool uniform = s.x == s.y && s.y == s.z;
+			unsigned int parent = data.Parents[slot];
+			parentMatrices[l] = parent == TRANSFORM_NO_PARENT ? identity : &data.WorldMatrices[parent]._11;
+			if (parent != TRANSFORM_NO_PARENT)
+			{
+				anyParent = true;
+				uniform = uniform && data.UniformScales[parent];
+			}
+
+			// Spare lanes repeat the first transform, and throw it away
+			worldMatrices[l] = l < count ? &data.WorldMatrices[slot]._11 : &discardedMatrix._11;
+			inverseMatrices[l] = l < count ? &data.WorldInverseTransposes[slot]._11 : &discardedMatrix._11;
+			if (l < count)
+				data.UniformScales[slot] = uniform;
+			allUniform = allUniform && uniform;
+		}
+
+		// Rotation straight from the quaternion (no trigonometry),
+		// each row then times its scale, and then the position
+		F qx, qy, qz, qw;
+		O::LoadRow(rotations, 0, qx, qy, qz, qw);
+		F two = O::Set(2.0f);
+		F x2 = O::Mul(qx, two), y2 = O::Mul(qy, two), z2 = O::Mul(qz, two);
+		F xx = O::Mul(qx, x2), yy = O::Mul(qy, y2), zz = O::Mul(qz, z2);
+		F xy = O::Mul(qx, y2), xz = O::Mul(qx, z2), yz = O::Mul(qy, z2);
+		F wx = O::Mul(qw, x2), wy = O::Mul(qw, y2), wz = O::Mul(qw, z2);
+		F one = O::Set(1.0f);
+
+		F scaleX = O::Gather(scales, 0);
+		F scaleY = O::Gather(scales, 1);
+		F scaleZ = O::Gather(scales, 2);
+		F local[4][3] =
+		{
+			{
+				O::Mul(scaleX, O::Sub(one, O::Add(yy, zz))),
+				O::Mul(scaleX, O::Add(xy, wz)),
+				O::Mul(scaleX, O::Sub(xz, wy))
+			},
+			{
+				O::Mul(scaleY, O::Sub(xy, wz)),
+				O::Mul(scaleY, O::Sub(one, O::Add(xx, zz))),
+				O::Mul(scaleY, O::Add(yz, wx))
+			},
+			{
+				O::Mul(scaleZ, O::Add(xz, wy)),
+				O::Mul(scaleZ, O::Sub(yz, wx)),
+				O::Mul(scaleZ, O::Sub(one, O::Add(xx, yy)))
+			},
+			{ O::Gather(positions, 0), O::Gather(positions, 1), O::Gather(positions, 2) }
+		};
+
+		// World = local * parent world (both affine)
+		F w[4][3];
+		if (anyParent)
+		{
+			F p[4][4];
+			for (int row = 0; row < 4; row++)
+				O::LoadRow(parentMatrices, row, p[row][0], p[row][1], p[row][2], p[row][3]);
+
+			for (int row = 0; row < 4; row++)
+			{
+				for (int col = 0; col < 3; col++)
+				{
+					F v = O::MulAdd(local[row][0], p[0][col], O::MulAdd(local[row][1], p[1][col], O::Mul(local[row][2], p[2][col])));
+					w[row][col] = row == 3 ? O::Add(v, p[3][col]) : v;
+				}
+			}
+		}
+		else
+		{
+			for (int row = 0; row < 4; row++)
+				for (int col = 0; col < 3; col++)
+					w[row][col] = local[row][col];
+		}
+
+		// Inverse transpose of the 3x3 part: the cofactors over the
+		// determinant, or for uniform scale just the rows over the
+		// squared scale
+		F it[3][3];
+		if (allUniform)
+		{
+			F scaleSq = O::MulAdd(w[0][0], w[0][0], O::MulAdd(w[0][1], w[0][1], O::Mul(w[0][2], w[0][2])));
+			F inv = O::Div(O::Set(1.0f), scaleSq);
+			for (int row = 0; row < 3; row++)
+				for (int col = 0; col < 3; col++)
+					it[row][col] = O::Mul(w[row][col], inv);
+		}
+		else
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				const F* a = w[(row + 1) % 3];
+				const F* b = w[(row + 2) % 3];
+				it[row][0] = O::Sub(O::Mul(a[1], b[2]), O::Mul(a[2], b[1]));
+				it[row][1] = O::Sub(O::Mul(a[2], b[0]), O::Mul(a[0], b[2]));
+				it[row][2] = O::Sub(O::Mul(a[0], b[1]), O::Mul(a[1], b[0]));
+			}
+			F det = O::MulAdd(w[0][0], it[0][0], O::MulAdd(w[0][1], it[0][1], O::Mul(w[0][2], it[0][2])));
+			F inv = O::Div(O::Set(1.0f), det);
+			for (int row = 0; row < 3; row++)
+				for (int col = 0; col < 3; col++)
+					it[row][col] = O::Mul(it[row][col], inv);
+		}
+
+		// The translation ends up negated in the last column
+		F zero = O::Set(0.0f);
+		for (int row = 0; row < 3; row++)
+		{
+			F t = O::MulAdd(w[3][0], it[row][0], O::MulAdd(w[3][1], it[row][1], O::Mul(w[3][2], it[row][2])));
+			O::StoreRow(worldMatrices, row, w[row][0], w[row][1], w[row][2], zero);
+			O::StoreRow(inverseMatrices, row, it[row][0], it[row][1], it[row][2], O::Xor(t, O::Set(-0.0f)));
+		}
+		O::StoreRow(worldMatrices, 3, w[3][0], w[3][1], w[3][2], one);
+		O::StoreRow(inverseMatrices, 3, zero, zero, zero, one);
+	}
+
+	template<typename O>
+	void ComputeBatches(const TransformBatchData& data, const unsigned int* slots, size_t count)
+	{
+		for (size_t i = 0; i < count; i += O::Width)
+			ComputeBatch<O>(data, slots + i, (unsigned int)std::min<size_t>(O::Width, count - i));
+	}
+
+	// cpuid for a leaf (and subleaf) into eax, ebx, ecx & edx
+	void CpuId(int info[4], int leaf, int subleaf)
+	{
+#if defined(_MSC_VER)
+		__cpuidex(info, leaf, subleaf);
+#else
+		__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	// --------------------------------------------------------
+	// AVX2 (and FMA) need both the CPU to have them and the OS
+	// to save the wider registers on context switches
+	// --------------------------------------------------------
+	bool CpuHasAVX2()
+	{
+		int info[4];
+		CpuId(info, 0, 0);
+		if (info[0] < 7)
+			return false;
+
+		CpuId(info, 1, 0);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+
+		CpuId(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#endif
+}
+
+
+void ComputeTransformMatrices(const TransformBatchData& data, const unsigned int* slots, size_t count)
+{
+	ComputeTransformMatrices(data, slots, count, GetBestTransformKernel());
+}
+
+void ComputeTransformMatrices(const TransformBatchData& data, const unsigned int* slots, size_t count, TransformKernel kernel)
+{
+	if (count == 0)
+		return;
+
+	switch (kernel)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+	case TransformKernel::AVX2:
+		ComputeBatches<AVX2Ops>(data, slots, count);
+		_mm256_zeroupper();
+		return;
+
+	case TransformKernel::SSE:
+		ComputeBatches<SSEOps>(data, slots, count);
+		return;
+#endif
+
+	default:
+		for (size_t i = 0; i < count; i++)
+			ComputeScalar(data, slots[i]);
+		return;
+	}
+}
+
+// SSE, not AVX2: eight lanes take the full inverse more often
+// (one non-uniform lane is enough) and spill more registers,
+// so the Benchmarks runner has AVX2 slower on every hierarchy
+TransformKernel GetBestTransformKernel()
+{
+#if defined(_XM_SSE_INTRINSICS_)
+	return TransformKernel::SSE;
+#else
+	return TransformKernel::Scalar;
+#endif
+}
+
+bool IsTransformKernelSupported(TransformKernel kernel)
+{
+	switch (kernel)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+	case TransformKernel::AVX2:
+	{
+		static const bool supported = CpuHasAVX2();
+		return supported;
+	}
+
+	case TransformKernel::SSE:
+		return true;
+#endif
+
+	case TransformKernel::Scalar:
+		return true;
+
+	default:
+		return false;
+	}
+}
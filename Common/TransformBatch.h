@@ -0,0 +1,49 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// Ways of building matrices, from one at a time with
+// DirectXMath to eight at a time with AVX2.  AVX2 is only
+// used when asked for: it's slower than SSE for now.
+// --------------------------------------------------------
+enum class TransformKernel
+{
+	Scalar,		// DirectXMath, one transform at a time
+	SSE,		// Four at a time
+	AVX2		// Eight at a time
+};
+
+// Where a batch reads and writes, indexed by slot
+struct TransformBatchData
+{
+	const DirectX::XMFLOAT3* Positions;
+	const DirectX::XMFLOAT4* Rotations;		// Unit quaternions
+	const DirectX::XMFLOAT3* Scales;
+	const unsigned int* Parents;		// Slot, or TRANSFORM_NO_PARENT
+	unsigned char* UniformScales;		// Written: is the world scale the same on every axis?
+	DirectX::XMFLOAT4X4* WorldMatrices;
+	DirectX::XMFLOAT4X4* WorldInverseTransposes;
+};
+
+// --------------------------------------------------------
+// Builds the world and world inverse transpose matrices of
+// the given slots from their local data and their parents'
+// world matrices.  No slot's parent can be among the slots
+// (its matrix has to be final already).  Several threads can
+// build batches at once, as long as their slots differ.
+//
+// Lanes whose world scale is uniform (or one) skip the full
+// inverse: the inverse transpose of a uniformly scaled
+// rotation is the matrix itself over the squared scale.
+// --------------------------------------------------------
+void ComputeTransformMatrices(const TransformBatchData& data, const unsigned int* slots, size_t count);
+void ComputeTransformMatrices(const TransformBatchData& data, const unsigned int* slots, size_t count, TransformKernel kernel);
+
+// The fastest kernel this CPU (and OS) can run
+TransformKernel GetBestTransformKernel();
+
+// Whether this CPU (and OS) can run a kernel at all
+bool IsTransformKernelSupported(TransformKernel kernel);
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Slots per job when a level is resolved in parallel (levels
+	// no bigger than this are just done on the calling thread)
+	const unsigned int ResolveChunkSize = 1024;
+}
+
+
+TransformSystem::TransformSystem() :
+	nextListenerID(0),
+	anyChanged(false),
+	orderDirty(false)
+{
+	levelStarts.push_back(0);
+}
+
+// --------------------------------------------------------
+// Adds a transform at the origin, with no rotation, a scale
+// of one and no parent.  It goes at the end, which is always
+// a valid place for a transform without a parent (though it
+// leaves the levels out of date, if there's more than one),
+// and its identity matrices start out up to date.
+// --------------------------------------------------------
+unsigned int TransformSystem::Create()
+{
+	unsigned int handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = (unsigned int)slots.size();
+		slots.push_back(0);
+	}
+	slots[handle] = (unsigned int)handles.size();
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	positions.push_back(XMFLOAT3(0, 0, 0));
+	rotations.push_back(XMFLOAT4(0, 0, 0, 1));
+	scales.push_back(XMFLOAT3(1, 1, 1));
+	parents.push_back(TRANSFORM_NO_PARENT);
+	childCounts.push_back(0);
+	localVersions.push_back(0);
+	worldVersions.push_back(0);
+	builtLocalVersions.push_back(0);
+	builtParentVersions.push_back(0);
+	uniformScales.push_back(1);
+	worldMatrices.push_back(identity);
+	worldInverseTransposes.push_back(identity);
+	handles.push_back(handle);
+
+	if (levelStarts.size() <= 2)
+		levelStarts = { 0, (unsigned int)handles.size() };
+	else
+		orderDirty = true;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Removes a transform by moving the last slot into its
+// place.  Any children it still has lose their parent.
+// --------------------------------------------------------
+void TransformSystem::Destroy(unsigned int handle)
+{
+	unsigned int slot = slots[handle];
+	unsigned int last = (unsigned int)handles.size() - 1;
+
+	if (childCounts[slot] > 0)
+	{
+		for (unsigned int i = 0; i < handles.size(); i++)
+		{
+			if (parents[i] != slot)
+				continue;
+			parents[i] = TRANSFORM_NO_PARENT;
+			Touch(i);
+		}
+	}
+	if (parents[slot] != TRANSFORM_NO_PARENT)
+		childCounts[parents[slot]]--;
+
+	if (slot != last)
+	{
+		MoveSlot(last, slot);
+		if (childCounts[slot] > 0)
+		{
+			for (unsigned int i = 0; i < handles.size(); i++)
+				if (parents[i] == last)
+					parents[i] = slot;
+		}
+	}
+
+	// With just one level, the last slot moving up can't put
+	// anything out of order; otherwise, it may now be in the
+	// wrong level (as may any children that were orphaned)
+	if (levelStarts.size() <= 2)
+		levelStarts.back()--;
+	else
+		orderDirty = true;
+
+	positions.pop_back();
+	rotations.pop_back();
+	scales.pop_back();
+	parents.pop_back();
+	childCounts.pop_back();
+	localVersions.pop_back();
+	worldVersions.pop_back();
+	builtLocalVersions.pop_back();
+	builtParentVersions.pop_back();
+	uniformScales.pop_back();
+	worldMatrices.pop_back();
+	worldInverseTransposes.pop_back();
+	handles.pop_back();
+	freeHandles.push_back(handle);
+}
+
+// --------------------------------------------------------
+// Reparents a transform.  Its world matrix (and those of
+// its descendants) will be rebuilt on the next update, and
+// the slots are sorted into their new levels then.
+// --------------------------------------------------------
+void TransformSystem::SetParent(unsigned int handle, unsigned int parentHandle)
+{
+	unsigned int slot = slots[handle];
+	unsigned int parentSlot = parentHandle == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : slots[parentHandle];
+	if (parents[slot] == parentSlot)
+		return;
+
+	if (parents[slot] != TRANSFORM_NO_PARENT)
+		childCounts[parents[slot]]--;
+	parents[slot] = parentSlot;
+	if (parentSlot != TRANSFORM_NO_PARENT)
+		childCounts[parentSlot]++;
+
+	// Its depth (and its descendants') may have changed
+	orderDirty = true;
+	Touch(slot);
+}
+
+unsigned int TransformSystem::GetParent(unsigned int handle) const
+{
+	unsigned int parentSlot = parents[slots[handle]];
+	return parentSlot == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : handles[parentSlot];
+}
+
+XMFLOAT3 TransformSystem::GetPosition(unsigned int handle) const { return positions[slots[handle]]; }
+XMFLOAT4 TransformSystem::GetRotation(unsigned int handle) const { return rotations[slots[handle]]; }
+XMFLOAT3 TransformSystem::GetScale(unsigned int handle) const { return scales[slots[handle]]; }
+
+void TransformSystem::SetPosition(unsigned int handle, XMFLOAT3 position)
+{
+	unsigned int slot = slots[handle];
+	positions[slot] = position;
+	Touch(slot);
+}
+
+void TransformSystem::SetRotation(unsigned int handle, XMFLOAT4 quaternion)
+{
+	unsigned int slot = slots[handle];
+	rotations[slot] = quaternion;
+	Touch(slot);
+}
+
+void TransformSystem::SetScale(unsigned int handle, XMFLOAT3 scale)
+{
+	unsigned int slot = slots[handle];
+	scales[slot] = scale;
+	Touch(slot);
+}
+
+void TransformSystem::SetLocal(unsigned int handle, XMFLOAT3 position, XMFLOAT4 quaternion, XMFLOAT3 scale)
+{
+	unsigned int slot = slots[handle];
+	positions[slot] = position;
+	rotations[slot] = quaternion;
+	scales[slot] = scale;
+	Touch(slot);
+}
+
+// --------------------------------------------------------
+// The resolve.  Levels go in order, so every parent is final
+// before its children are checked against it; within a level
+// no slot depends on another, so the level is split into
+// chunks that each check & rebuild their own slots, on
+// whichever thread picks them up.  Each chunk only writes to
+// its own slots, and only reads from the level above.
+// --------------------------------------------------------
+void TransformSystem::UpdateWorldMatrices()
+{
+	if (orderDirty)
+		SortHierarchy();
+
+	if (anyChanged)
+	{
+		ThreadPool& pool = ThreadPool::Shared();
+		for (size_t level = 0; level + 1 < levelStarts.size(); level++)
+		{
+			unsigned int first = levelStarts[level];
+			unsigned int end = levelStarts[level + 1];
+			size_t chunkCount = (end - first + ResolveChunkSize - 1) / ResolveChunkSize;
+			if (chunkSlots.size() < chunkCount)
+				chunkSlots.resize(chunkCount);
+
+			pool.ParallelFor(chunkCount, [&](size_t chunk)
+				{
+					unsigned int chunkFirst = first + (unsigned int)chunk * ResolveChunkSize;
+					ResolveSlots(chunkFirst, std::min(end, chunkFirst + ResolveChunkSize), chunkSlots[chunk]);
+				});
+
+			// Back on this thread, gather what changed
+			for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				if (!listeners.empty())
+					for (unsigned int slot : chunkSlots[chunk])
+						changedHandles.push_back(handles[slot]);
+				chunkSlots[chunk].clear();
+			}
+		}
+		anyChanged = false;
+	}
+
+	// Tell everyone what moved
+	if (!changedHandles.empty())
+	{
+		for (auto& listener : listeners)
+			listener.second(changedHandles);
+		changedHandles.clear();
+	}
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(unsigned int handle) const { return worldMatrices[slots[handle]]; }
+const XMFLOAT4X4& TransformSystem::GetWorldInverseTransposeMatrix(unsigned int handle) const { return worldInverseTransposes[slots[handle]]; }
+
+// --------------------------------------------------------
+// Walks up from the slot to find the highest ancestor whose
+// matrix is stale; everything above it is up to date, so the
+// result is the local matrices up to there, then its parent's
+// stored world matrix.  Nothing is written, so this is as
+// safe to call from several threads as the other getters.
+// --------------------------------------------------------
+XMFLOAT4X4 TransformSystem::ComputeWorldMatrix(unsigned int handle) const
+{
+	unsigned int slot = slots[handle];
+	unsigned int highestStale = TRANSFORM_NO_PARENT;
+	for (unsigned int s = slot; s != TRANSFORM_NO_PARENT; s = parents[s])
+		if (IsStale(s))
+			highestStale = s;
+
+	if (highestStale == TRANSFORM_NO_PARENT)
+		return worldMatrices[slot];
+
+	XMMATRIX world = XMMatrixIdentity();
+	unsigned int s = slot;
+	for (;;)
+	{
+		world *=
+			XMMatrixScalingFromVector(XMLoadFloat3(&scales[s])) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[s])) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&positions[s]));
+		if (s == highestStale)
+			break;
+		s = parents[s];
+	}
+	if (parents[s] != TRANSFORM_NO_PARENT)
+		world *= XMLoadFloat4x4(&worldMatrices[parents[s]]);
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, world);
+	return result;
+}
+
+unsigned int TransformSystem::GetWorldVersion(unsigned int handle) const { return worldVersions[slots[handle]]; }
+
+unsigned int TransformSystem::AddChangeListener(TransformChangeListener listener)
+{
+	listeners.push_back({ nextListenerID, listener });
+	return nextListenerID++;
+}
+
+void TransformSystem::RemoveChangeListener(unsigned int id)
+{
+	listeners.erase(
+		std::remove_if(listeners.begin(), listeners.end(), [id](const auto& l) { return l.first == id; }),
+		listeners.end());
+}
+unsigned int TransformSystem::GetCount() const { return (unsigned int)handles.size(); }
+
+TransformSystem& TransformSystem::Shared()
+{
+	static TransformSystem system;
+	return system;
+}
+
+// --------------------------------------------------------
+// Marks a slot's local data as changed: the version goes
+// up, and that's all (descendants find out when they're
+// checked against it)
+// --------------------------------------------------------
+void TransformSystem::Touch(unsigned int slot)
+{
+	localVersions[slot]++;
+	anyChanged = true;
+}
+
+bool TransformSystem::IsStale(unsigned int slot) const
+{
+	unsigned int parent = parents[slot];
+	return builtLocalVersions[slot] != localVersions[slot] ||
+		(parent != TRANSFORM_NO_PARENT && builtParentVersions[slot] != worldVersions[parent]);
+}
+
+// --------------------------------------------------------
+// Rebuilds the stale slots in [first, end), which must all
+// be in one level, recording what each one was built from
+// and bumping its version (so its children see it changed).
+// The rebuilt slots are left in the given list.
+// --------------------------------------------------------
+void TransformSystem::ResolveSlots(unsigned int first, unsigned int end, std::vector<unsigned int>& rebuilt)
+{
+	for (unsigned int i = first; i < end; i++)
+	{
+		if (!IsStale(i))
+			continue;
+
+		unsigned int parent = parents[i];
+		builtLocalVersions[i] = localVersions[i];
+		builtParentVersions[i] = parent == TRANSFORM_NO_PARENT ? 0 : worldVersions[parent];
+		worldVersions[i]++;
+		rebuilt.push_back(i);
+	}
+
+	TransformBatchData data =
+	{
+		positions.data(),
+		rotations.data(),
+		scales.data(),
+		parents.data(),
+		uniformScales.data(),
+		worldMatrices.data(),
+		worldInverseTransposes.data()
+	};
+	ComputeTransformMatrices(data, rebuilt.data(), rebuilt.size());
+}
+
+// --------------------------------------------------------
+// Reorders the slots by depth in the hierarchy (keeping the
+// current order within each depth), which puts every parent
+// ahead of its children, and each level in one range
+// --------------------------------------------------------
+void TransformSystem::SortHierarchy()
+{
+	size_t count = handles.size();
+
+	// Depth of each slot, filling in whole chains of ancestors at once
+	std::vector<unsigned int> depths(count, UINT_MAX);
+	std::vector<unsigned int> chain;
+	unsigned int maxDepth = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int s = i;
+		while (s != TRANSFORM_NO_PARENT && depths[s] == UINT_MAX)
+		{
+			chain.push_back(s);
+			s = parents[s];
+		}
+
+		unsigned int depth = s == TRANSFORM_NO_PARENT ? 0 : depths[s] + 1;
+		for (size_t c = chain.size(); c-- > 0; depth++)
+			depths[chain[c]] = depth;
+		chain.clear();
+		maxDepth = std::max(maxDepth, depths[i]);
+	}
+
+	// Counting sort: where each depth starts, then each slot's new place
+	std::vector<unsigned int> depthStarts(maxDepth + 2, 0);
+	for (unsigned int d : depths)
+		depthStarts[d + 1]++;
+	for (unsigned int d = 0; d <= maxDepth; d++)
+		depthStarts[d + 1] += depthStarts[d];
+
+	levelStarts.assign(depthStarts.begin(), depthStarts.end() - (count > 0 ? 0 : 1));
+	std::vector<unsigned int> newSlots(count);
+	for (unsigned int i = 0; i < count; i++)
+		newSlots[i] = depthStarts[depths[i]]++;
+
+	// Apply the new order to every array
+	auto reorder = [&](auto& values)
+	{
+		auto sorted = values;
+		for (unsigned int i = 0; i < count; i++)
+			sorted[newSlots[i]] = values[i];
+		values.swap(sorted);
+	};
+	reorder(positions);
+	reorder(rotations);
+	reorder(scales);
+	reorder(parents);
+	reorder(childCounts);
+	reorder(localVersions);
+	reorder(worldVersions);
+	reorder(builtLocalVersions);
+	reorder(builtParentVersions);
+	reorder(uniformScales);
+	reorder(worldMatrices);
+	reorder(worldInverseTransposes);
+	reorder(handles);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (parents[i] != TRANSFORM_NO_PARENT)
+			parents[i] = newSlots[parents[i]];
+		slots[handles[i]] = i;
+	}
+	orderDirty = false;
+}
+
+void TransformSystem::MoveSlot(unsigned int from, unsigned int to)
+{
+	positions[to] = positions[from];
+	rotations[to] = rotations[from];
+	scales[to] = scales[from];
+	parents[to] = parents[from];
+	childCounts[to] = childCounts[from];
+	localVersions[to] = localVersions[from];
+	worldVersions[to] = worldVersions[from];
+	builtLocalVersions[to] = builtLocalVersions[from];
+	builtParentVersions[to] = builtParentVersions[from];
+	uniformScales[to] = uniformScales[from];
+	worldMatrices[to] = worldMatrices[from];
+	worldInverseTransposes[to] = worldInverseTransposes[from];
+	handles[to] = handles[from];
+	slots[handles[to]] = to;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <functional>
+#include <vector>
+
+// Parent of a transform that has none
+#define TRANSFORM_NO_PARENT 0xFFFFFFFF
+
+// Told which transforms' world matrices changed (by handle)
+typedef std::function<void(const std::vector<unsigned int>& handles)> TransformChangeListener;
+
+// --------------------------------------------------------
+// Storage for every transform's data, one array per field
+// (structure of arrays), so updating them all is a walk
+// through contiguous memory rather than a chase through
+// heap objects.
+//
+// Transforms are referred to by handles, which never change.
+// Behind them, slots are kept in hierarchy order (every
+// parent before its children), sorted by depth, so a single
+// pass from front to back can bring every stale world matrix
+// up to date: a parent's matrix is always final by the time
+// its children get to it.
+//
+// Nothing is marked dirty down the hierarchy.  Changing a
+// transform just bumps its local version; a world matrix is
+// stale when it was built from an older local version, or
+// from an older version of its parent's world matrix.
+//
+// World matrices only change in UpdateWorldMatrices(), the
+// once-a-frame resolve, which builds each level of the
+// hierarchy in parallel.  Nothing else writes to them, so
+// between changes, the const getters can be called from any
+// number of threads at once (to cull or submit in parallel).
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	TransformSystem();
+	TransformSystem(const TransformSystem&) = delete; // Remove copy constructor
+	TransformSystem& operator=(const TransformSystem&) = delete; // Remove copy-assignment operator
+
+	// Adds an identity transform, returning its handle
+	unsigned int Create();
+	void Destroy(unsigned int handle);
+
+	// Changes the parent (or TRANSFORM_NO_PARENT), without
+	// touching the local data
+	void SetParent(unsigned int handle, unsigned int parentHandle);
+	unsigned int GetParent(unsigned int handle) const;
+
+	// Local data (setters bump the local version).  Rotations
+	// are unit quaternions, so matrices need no trigonometry.
+	DirectX::XMFLOAT3 GetPosition(unsigned int handle) const;
+	DirectX::XMFLOAT4 GetRotation(unsigned int handle) const;
+	DirectX::XMFLOAT3 GetScale(unsigned int handle) const;
+	void SetPosition(unsigned int handle, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int handle, DirectX::XMFLOAT4 quaternion);
+	void SetScale(unsigned int handle, DirectX::XMFLOAT3 scale);
+
+	// All three at once (one version bump, as animation does)
+	void SetLocal(unsigned int handle, DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 quaternion, DirectX::XMFLOAT3 scale);
+
+	// The resolve: brings every stale world matrix up to date,
+	// one level of the hierarchy at a time, with each level's
+	// batches (see TransformBatch.h) spread over the shared
+	// ThreadPool, then tells the listeners what changed.  Must
+	// not be called from inside a ThreadPool job.
+	void UpdateWorldMatrices();
+
+	// Matrices as of the last UpdateWorldMatrices()
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int handle) const;
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int handle) const;
+
+	// The world matrix as it stands right now, including changes
+	// made since the last update (worked out on the spot from
+	// the stale part of the hierarchy, without storing it)
+	DirectX::XMFLOAT4X4 ComputeWorldMatrix(unsigned int handle) const;
+
+	// Goes up every time the world matrix is rebuilt, so anything
+	// derived from it can tell when it's out of date
+	unsigned int GetWorldVersion(unsigned int handle) const;
+
+	// Listeners hear about every transform whose world matrix
+	// was rebuilt, once per UpdateWorldMatrices() (so culling
+	// structures can refit just what moved)
+	unsigned int AddChangeListener(TransformChangeListener listener);
+	void RemoveChangeListener(unsigned int id);
+
+	unsigned int GetCount() const;
+
+	// The system every Transform lives in
+	static TransformSystem& Shared();
+
+private:
+	// Per-slot data, in hierarchy order
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT4> rotations;		// Quaternions
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<unsigned int> parents;			// Slot of the parent
+	std::vector<unsigned int> childCounts;
+	std::vector<unsigned int> localVersions;		// Bumped by every change
+	std::vector<unsigned int> worldVersions;		// Bumped by every rebuild
+	std::vector<unsigned int> builtLocalVersions;	// What the world matrix was built
+	std::vector<unsigned int> builtParentVersions;	// from (own & parent's versions)
+	std::vector<unsigned char> uniformScales;	// Is the world scale uniform?
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+	std::vector<unsigned int> handles;			// Handle of each slot
+
+	// Slot of each handle, and handles free for reuse
+	std::vector<unsigned int> slots;
+	std::vector<unsigned int> freeHandles;
+
+	// First slot of each level of the hierarchy (depth), and
+	// then the slot count
+	std::vector<unsigned int> levelStarts;
+
+	// Slots each chunk of a level rebuilt, one list per chunk
+	std::vector<std::vector<unsigned int>> chunkSlots;
+
+	// Rebuilt by the current update, for the listeners
+	std::vector<unsigned int> changedHandles;
+	std::vector<std::pair<unsigned int, TransformChangeListener>> listeners;
+	unsigned int nextListenerID;
+
+	// Has anything changed, and are the order & levels out of date?
+	bool anyChanged;
+	bool orderDirty;
+
+	void Touch(unsigned int slot);
+	bool IsStale(unsigned int slot) const;
+	void ResolveSlots(unsigned int first, unsigned int end, std::vector<unsigned int>& rebuilt);
+	void SortHierarchy();
+	void MoveSlot(unsigned int from, unsigned int to);
+};
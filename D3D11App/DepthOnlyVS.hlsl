@@ -0,0 +1,33 @@
+#include "ShaderStructs.hlsli"
+
+
+// Same layout as VertexShader.hlsl, so materials and meshes
+// can fill it in exactly the same way
+cbuffer ExternalData : register(b0)
+{
+	matrix world;
+	matrix worldInvTrans;
+	matrix view;
+	matrix projection;
+#ifdef PACKED_VERTICES
+	float4 positionOffset;
+	float4 positionScale;
+	float4 uvOffsetScale;
+#endif
+}
+
+
+// --------------------------------------------------------
+// Vertex shader for depth-only passes: reads nothing but
+// positions (from a mesh's position-only stream)
+// --------------------------------------------------------
+float4 main(PositionShaderInput input) : SV_POSITION
+{
+#ifdef PACKED_VERTICES
+	float3 localPosition = UnpackPosition(input.localPosition, positionOffset, positionScale);
+#else
+	float3 localPosition = input.localPosition;
+#endif
+
+	return LocalToScreen(localPosition, world, view, projection);
+}
@@ -0,0 +1,3 @@
+// Same as DepthOnlyVS.hlsl, but for meshes with packed vertices
+#define PACKED_VERTICES
+#include "DepthOnlyVS.hlsl"
@@ -13,6 +13,7 @@ Game Implementation
 #include "Window.h"
 #include "UIHelpers.h"
 #include "AssetPath.h"
+#include "StaticBatch.h"
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -21,6 +22,9 @@ Game Implementation
 #include "WICTextureLoader.h"
 
 #include <DirectXMath.h>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -50,6 +54,28 @@ void Game::Initialize()
 	// Seed random
 	srand((unsigned int)time(0));
 
+	// One swing of the point lights: five units out one way and
+	// back, then the other way and back, every two pi seconds
+	lightSwing = std::make_shared<AnimationClip>(AnimationInterpolation::Cubic, true);
+	for (int k = 0; k <= 16; k++)
+		lightSwing->AddPositionKey(k * XM_2PI / 16, XMFLOAT3(sin(k * XM_2PI / 16) * 5, 0, 0));
+
+	// Each light swings under its own anchor (placed along with the
+	// light), turned for odd lights so they swing along z
+	lightsFrozen = false;
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		std::shared_ptr<Transform> anchor = std::make_shared<Transform>();
+		std::shared_ptr<Transform> swing = std::make_shared<Transform>();
+		anchor->AddChild(swing.get());
+		if (i % 2 == 1)
+			anchor->SetRotation(0, -XM_PIDIV2, 0);
+
+		lightAnchors.push_back(anchor);
+		lightSwings.push_back(swing);
+		lightAnimations.push_back(AnimationSystem::Shared().Play(lightSwing, swing->GetHandle(), 1.0f, (float)i));
+	}
+
 	// Set up the scene and create lights
 	LoadAssetsAndCreateEntities();
 	currentScene = &entitiesLineup;
@@ -76,6 +102,51 @@ void Game::Initialize()
 	// Set initial graphics API state
 	Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
+	// After a depth prepass, the full pass needs to accept the
+	// (identical) depths already in the buffer
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = true;
+	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	Graphics::Device->CreateDepthStencilState(&depthDesc, prepassDepthState.GetAddressOf());
+	depthPrepass = false;
+	staticBatching = true;
+	drawListScene = 0;
+	drawListBatched = false;
+	drawListStale = false;
+	pickedDistance = 0.0f;
+	sceneBVHScene = 0;
+
+	// Hear about moved entities, to rebuild any static batch they're
+	// baked into and to refit the picking BVH
+	transformListener = TransformSystem::Shared().AddChangeListener(
+		[this](const std::vector<unsigned int>& handles)
+		{
+			for (unsigned int handle : handles)
+			{
+				if (handle < batchedTransforms.size() && batchedTransforms[handle])
+				{
+					drawListStale = true;
+					break;
+				}
+			}
+
+			if (!sceneBVHScene)
+				return;
+
+			// Past a scene's worth of moves, rebuilding is quicker
+			// (only the scene's own entities count, since the lights'
+			// swings move every frame)
+			for (unsigned int handle : handles)
+				if (handle < sceneBVHInstances.size() && sceneBVHInstances[handle] != UINT_MAX)
+					movedTransforms.push_back(handle);
+			if (movedTransforms.size() > sceneBVHScene->size())
+			{
+				sceneBVHScene = 0;
+				movedTransforms.clear();
+			}
+		});
+
 	// Create the camera
 	camera = std::make_shared<FPSCamera>(
 		XMFLOAT3(0.0f, 0.0f, -15.0f),	// Position
@@ -104,6 +175,27 @@ Game::~Game()
 	
 	// Clean up ssaoOffsets array
 	if(ssaoOffsets) delete[] ssaoOffsets;
+
+	TransformSystem::Shared().RemoveChangeListener(transformListener);
+
+	// Animations have to stop before their transforms go
+	for (unsigned int id : lightAnimations)
+		AnimationSystem::Shared().Stop(id);
+	lightSwings.clear();
+	lightAnchors.clear();
+
+	// Every mesh has to give its space back before the shared
+	// geometry buffers can be released, which has to happen
+	// before the device goes away (the pool itself outlives it)
+	drawList.clear();
+	entitiesRandom.clear();
+	entitiesLineup.clear();
+	entitiesGradient.clear();
+	pickedEntity.reset();
+	sky.reset();
+	pointLightMesh.reset();
+	meshes.clear();
+	GeometryPool::Shared().Release();
 }
 
 
@@ -250,7 +342,7 @@ void Game::LoadAssetsAndCreateEntities()
 
 
 	// Load shaders (some are saved for later)
-	vertexShader = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"VertexShader.cso").c_str());
+	vertexShader = LoadMeshVertexShader(L"VertexShader.cso", L"VertexShaderPacked.cso");
 	pixelShader = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"PixelShader.cso").c_str());
 	pixelShaderPBR = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"PixelShaderPBR.cso").c_str());
 	solidColorPS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"SolidColorPS.cso").c_str());
@@ -258,17 +350,18 @@ void Game::LoadAssetsAndCreateEntities()
 	occlusionPS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"OcclusionPS.cso").c_str());
 	occlusionBlurPS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"OcclusionBlurPS.cso").c_str());
 	occlusionCombinePS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"OcclusionCombinePS.cso").c_str());
-	std::shared_ptr<SimpleVertexShader> skyVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"SkyVS.cso").c_str());
+	std::shared_ptr<SimpleVertexShader> skyVS = LoadMeshVertexShader(L"SkyVS.cso", L"SkyVSPacked.cso");
+	depthOnlyVS = LoadMeshVertexShader(L"DepthOnlyVS.cso", L"DepthOnlyVSPacked.cso", true);
 	std::shared_ptr<SimplePixelShader> skyPS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"SkyPS.cso").c_str());
 
-	// Load 3D models	
-	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>("Cube", FixPath(AssetPath + L"Meshes/cube.obj").c_str());
-	std::shared_ptr<Mesh> cylinderMesh = std::make_shared<Mesh>("Cylinder", FixPath(AssetPath + L"Meshes/cylinder.obj").c_str());
+	// Generate the primitives, and load the rest of the 3D models
+	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>("Cube", PrimitiveShape::Cube, 1);
+	std::shared_ptr<Mesh> cylinderMesh = std::make_shared<Mesh>("Cylinder", PrimitiveShape::Cylinder, 32, MESH_MAX_LODS);
 	std::shared_ptr<Mesh> helixMesh = std::make_shared<Mesh>("Helix", FixPath(AssetPath + L"Meshes/helix.obj").c_str());
-	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>("Sphere", FixPath(AssetPath + L"Meshes/sphere.obj").c_str());
-	std::shared_ptr<Mesh> torusMesh = std::make_shared<Mesh>("Torus", FixPath(AssetPath + L"Meshes/torus.obj").c_str());
-	std::shared_ptr<Mesh> quadMesh = std::make_shared<Mesh>("Quad", FixPath(AssetPath + L"Meshes/quad.obj").c_str());
-	std::shared_ptr<Mesh> quad2sidedMesh = std::make_shared<Mesh>("Double-Sided Quad", FixPath(AssetPath + L"Meshes/quad_double_sided.obj").c_str());
+	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>("Sphere", PrimitiveShape::Sphere, 32, MESH_MAX_LODS);
+	std::shared_ptr<Mesh> torusMesh = std::make_shared<Mesh>("Torus", PrimitiveShape::Torus, 40, MESH_MAX_LODS);
+	std::shared_ptr<Mesh> quadMesh = std::make_shared<Mesh>("Quad", PrimitiveShape::Quad, 1);
+	std::shared_ptr<Mesh> quad2sidedMesh = std::make_shared<Mesh>("Double-Sided Quad", PrimitiveShape::DoubleSidedQuad, 1);
 
 	// Add all meshes to vector
 	meshes.insert(meshes.end(), { cubeMesh, cylinderMesh, helixMesh, sphereMesh, torusMesh, quadMesh, quad2sidedMesh });
@@ -353,6 +446,7 @@ void Game::LoadAssetsAndCreateEntities()
 	std::shared_ptr<GameEntity> floor = std::make_shared<GameEntity>(cubeMesh, cobbleMat4x);
 	floor->GetTransform()->SetScale(25, 25, 25);
 	floor->GetTransform()->SetPosition(0, -27, 0);
+	floor->SetStatic(true);
 	entitiesRandom.push_back(floor);
 
 	for (int i = 0; i < 32; i++)
@@ -369,6 +463,7 @@ void Game::LoadAssetsAndCreateEntities()
 		case 6: whichMat = woodMat; break;
 		}
 
+		// Not static: RandomizeEntities() moves these around
 		std::shared_ptr<GameEntity> sphere = std::make_shared<GameEntity>(sphereMesh, whichMat);
 		entitiesRandom.push_back(sphere);
 	}
@@ -404,6 +499,11 @@ void Game::LoadAssetsAndCreateEntities()
 	entitiesLineup.push_back(roughSphere);
 	entitiesLineup.push_back(woodSphere);
 
+	// These never move, but the sphere has LODs, so they're still
+	// drawn one by one (at their own detail) rather than batched
+	for (auto& e : entitiesLineup)
+		e->SetStatic(true);
+
 
 
 	// === Create a gradient of entities based on roughness & metalness ====
@@ -446,9 +546,42 @@ void Game::LoadAssetsAndCreateEntities()
 		// Move and scale them
 		geMetal->GetTransform()->SetPosition(i * 2.0f - 10.0f, 1, 0);
 		geNonMetal->GetTransform()->SetPosition(i * 2.0f - 10.0f, -1, 0);
+		geMetal->SetStatic(true);
+		geNonMetal->SetStatic(true);
 	}
 }
 
+// --------------------------------------------------------
+// Loads one of two versions of a vertex shader, depending on
+// whether meshes have packed vertices.  The packed version
+// needs its own input layout, since the one SimpleShader
+// builds through reflection only uses 32-bit formats.
+//
+// shaderFile       - Compiled shader for regular vertices
+// packedShaderFile - Compiled shader for packed vertices
+// --------------------------------------------------------
+std::shared_ptr<SimpleVertexShader> Game::LoadMeshVertexShader(const std::wstring& shaderFile, const std::wstring& packedShaderFile, bool positionsOnly)
+{
+#if MESH_PACKED_VERTICES
+	std::wstring path = FixPath(packedShaderFile);
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	if (FAILED(D3DReadFileToBlob(path.c_str(), shaderBlob.GetAddressOf())))
+		throw std::invalid_argument("Error loading packed vertex shader");
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	Graphics::Device->CreateInputLayout(
+		positionsOnly ? PackedPositionInputLayout : PackedVertexInputLayout,
+		positionsOnly ? ARRAYSIZE(PackedPositionInputLayout) : ARRAYSIZE(PackedVertexInputLayout),
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		inputLayout.GetAddressOf());
+
+	return std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, path.c_str(), inputLayout, false);
+#else
+	return std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(shaderFile).c_str());
+#endif
+}
+
 // --------------------------------------------------------
 // Programmatically creates a texture of the given size
 // where all pixels are the specified color
@@ -618,6 +751,16 @@ void Game::GenerateLights()
 
 	// Make sure we're exactly MAX_LIGHTS big
 	lights.resize(MAX_LIGHTS);
+
+	// Anchor each light's swing where the light was put, less the
+	// axis it swings along (the swing sets that outright)
+	for (size_t i = 0; i < lightAnchors.size(); i++)
+	{
+		XMFLOAT3 anchor = lights[i].Position;
+		if (i % 2 == 0) anchor.x = 0;
+		else			anchor.z = 0;
+		lightAnchors[i]->SetPosition(anchor);
+	}
 }
 
 
@@ -641,6 +784,135 @@ void Game::RandomizeEntities()
 	}
 }
 
+
+// --------------------------------------------------------
+// Rebuilds the list of entities to draw for the current
+// scene.  With static batching on, the pieces (submeshes)
+// of static entities are gathered by material and merged
+// into one world space mesh each, drawn by a single entity
+// with an identity transform: one material setup and one
+// draw per material, instead of per entity.  Batches only
+// keep the full detail LOD (they're culled by meshlet), so
+// entities whose meshes have LODs are left out, keeping their
+// own per-entity LOD selection.  Moving a batched entity
+// rebuilds the list (see the transform listener).
+// --------------------------------------------------------
+void Game::RebuildDrawList()
+{
+	// Batches bake in world matrices, which Update() has already
+	// resolved for this frame
+	drawList.clear();
+	drawListScene = currentScene;
+	drawListBatched = staticBatching;
+	drawListStale = false;
+	batchedTransforms.assign(batchedTransforms.size(), false);
+
+	std::vector<std::shared_ptr<Material>> batchMaterials;
+	std::vector<std::vector<StaticBatchInstance>> batchInstances;
+	for (auto& e : *currentScene)
+	{
+		std::shared_ptr<Mesh> mesh = e->GetMesh();
+		if (!staticBatching || !e->IsStatic() || mesh->GetLODCount() > 1)
+		{
+			drawList.push_back(e);
+			continue;
+		}
+
+		unsigned int handle = e->GetTransform()->GetHandle();
+		if (handle >= batchedTransforms.size())
+			batchedTransforms.resize(handle + 1, false);
+		batchedTransforms[handle] = true;
+
+		for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+		{
+			// Find (or start) the batch for this piece's material
+			std::shared_ptr<Material> material = e->GetSubmeshMaterial(i);
+			size_t batch = std::find(batchMaterials.begin(), batchMaterials.end(), material) - batchMaterials.begin();
+			if (batch == batchMaterials.size())
+			{
+				batchMaterials.push_back(material);
+				batchInstances.emplace_back();
+			}
+
+			const MeshSubmesh& submesh = mesh->GetSubmesh(i);
+			StaticBatchInstance instance = {};
+			instance.Vertices = mesh->GetVertices().data();
+			instance.VertexCount = mesh->GetVertices().size();
+			instance.Indices = mesh->GetIndices().data() + submesh.FirstIndex[0];
+			instance.IndexCount = submesh.IndexCount[0];
+			instance.World = e->GetTransform()->GetWorldMatrix();
+			batchInstances[batch].push_back(instance);
+		}
+	}
+
+	for (size_t i = 0; i < batchMaterials.size(); i++)
+	{
+		MeshData merged = MergeStaticGeometry(batchInstances[i].data(), batchInstances[i].size());
+		std::shared_ptr<Mesh> batchMesh = std::make_shared<Mesh>("Static Batch", merged);
+		drawList.push_back(std::make_shared<GameEntity>(batchMesh, batchMaterials[i]));
+	}
+}
+
+// --------------------------------------------------------
+// Selects the closest entity of the current scene under the
+// given pixel.  The scene's top level BVH (one box per
+// entity) is built on the first click in a scene, and after
+// that only the entities that moved are refit; the meshes'
+// own BVHs are built once and kept.  Picking works on the
+// scene's entities rather than the draw list, so statically
+// batched entities can still be selected.
+// --------------------------------------------------------
+void Game::PickEntity(int mouseX, int mouseY)
+{
+	if (sceneBVHScene != currentScene)
+	{
+		std::vector<SceneBVHInstance> instances(currentScene->size());
+		sceneBVHInstances.clear();
+		for (unsigned int i = 0; i < currentScene->size(); i++)
+		{
+			std::shared_ptr<GameEntity> e = (*currentScene)[i];
+			instances[i].BVH = &e->GetMesh()->GetBVH();
+			instances[i].World = e->GetTransform()->GetWorldMatrix();
+
+			unsigned int handle = e->GetTransform()->GetHandle();
+			if (handle >= sceneBVHInstances.size())
+				sceneBVHInstances.resize(handle + 1, UINT_MAX);
+			sceneBVHInstances[handle] = i;
+		}
+
+		sceneBVH.Build(instances.data(), instances.size());
+		sceneBVHScene = currentScene;
+		movedTransforms.clear();
+	}
+	else if (!movedTransforms.empty())
+	{
+		for (unsigned int handle : movedTransforms)
+		{
+			if (handle >= sceneBVHInstances.size() || sceneBVHInstances[handle] == UINT_MAX)
+				continue;
+			unsigned int instance = sceneBVHInstances[handle];
+			sceneBVH.MoveInstance(instance, (*currentScene)[instance]->GetTransform()->GetWorldMatrix());
+		}
+		sceneBVH.Refit();
+		movedTransforms.clear();
+	}
+
+	Ray ray = CreatePickingRay(camera->GetView(), camera->GetProjection(),
+		(float)mouseX, (float)mouseY, (float)Window::Width(), (float)Window::Height());
+	ray.MaxDistance = camera->GetFarClip();
+
+	SceneRayHit hit;
+	if (sceneBVH.Raycast(ray, hit))
+	{
+		pickedEntity = (*currentScene)[hit.Instance];
+		pickedDistance = hit.Hit.Distance;
+	}
+	else
+	{
+		pickedEntity.reset();
+	}
+}
+
 // --------------------------------------------------------
 // Handle resizing to match the new window size
 //  - Eventually, we'll want to update our 3D camera
@@ -682,10 +954,11 @@ void Game::Update(float deltaTime, float totalTime)
 	// this frame's interface.  Note that the building
 	// of the UI could happen at any point during update.
 	UINewFrame(deltaTime);
-	BuildUI(camera, meshes, *currentScene, materials, lights, lightOptions, 
+	BuildUI(camera, meshes, *currentScene, materials, lights, lightOptions, lodSelector,
 		sceneColorsSRV, sceneNormalSRV, 
 		sceneDepthSRV, ambientSRV, ssaoResultSRV, blurSSAOSRV,
-		&ssaoSamples, &ssaoRadius, &ssaoOn, &ssaoOnly);
+		&ssaoSamples, &ssaoRadius, &ssaoOn, &ssaoOnly, &depthPrepass,
+		&staticBatching, (int)drawList.size(), pickedEntity, pickedDistance);
 
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
@@ -694,20 +967,6 @@ void Game::Update(float deltaTime, float totalTime)
 	// Update the camera this frame
 	camera->Update(deltaTime);
 
-	// Move lights
-	for (int i = 0; i < lightOptions.LightCount && !lightOptions.FreezeLightMovement; i++)
-	{
-		// Only adjust point lights
-		if (lights[i].Type == LIGHT_TYPE_POINT)
-		{
-			// Adjust either X or Z
-			float lightAdjust = sin(totalTime + i) * 5;
-
-			if (i % 2 == 0) lights[i].Position.x = lightAdjust;
-			else			lights[i].Position.z = lightAdjust;
-		}
-	}
-
 	// Check for the all On / all Off switch
 	if (Input::KeyPress('O'))
 	{
@@ -764,6 +1023,43 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::KeyDown(VK_UP)) lightOptions.LightCount++;
 	if (Input::KeyDown(VK_DOWN)) lightOptions.LightCount--;
 	lightOptions.LightCount = max(1, min(MAX_LIGHTS, lightOptions.LightCount));
+
+	// Frozen lights keep their place in the swing
+	if (lightsFrozen != lightOptions.FreezeLightMovement)
+	{
+		lightsFrozen = lightOptions.FreezeLightMovement;
+		for (unsigned int id : lightAnimations)
+			AnimationSystem::Shared().SetSpeed(id, lightsFrozen ? 0.0f : 1.0f);
+	}
+
+	// Play any animated transforms, then rebuild the world matrix
+	// of everything moved this frame, a level of the hierarchy at
+	// a time across the thread pool.  This is the frame's only
+	// resolve: picking, the draw list and drawing all just read
+	// the matrices (and the listener hears about the moves here).
+	AnimationSystem::Shared().Update(deltaTime);
+	TransformSystem::Shared().UpdateWorldMatrices();
+
+	// Point lights follow their swings
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Type == LIGHT_TYPE_POINT)
+		{
+			XMFLOAT4X4 world = lightSwings[i]->GetWorldMatrix();
+			lights[i].Position = XMFLOAT3(world._41, world._42, world._43);
+		}
+	}
+
+	// Select whatever's under the cursor
+	if (Input::MouseRightPress())
+		PickEntity(Input::GetMouseX(), Input::GetMouseY());
+
+	// Catch up with scene changes (and moved batched entities)
+	// before drawing
+	if (drawListScene != currentScene)
+		pickedEntity.reset();
+	if (drawListScene != currentScene || drawListBatched != staticBatching || drawListStale)
+		RebuildDrawList();
 }
 
 
@@ -798,16 +1094,47 @@ void Game::Draw(float deltaTime, float totalTime)
 		renderTargets[3] = sceneDepthRTV.Get();
 
 		Graphics::Context->OMSetRenderTargets(4, renderTargets, Graphics::DepthBufferDSV.Get());
+
+		// Other passes (like SSAO) changed the input assembler's
+		// buffers last frame, so the geometry pool rebinds its own
+		GeometryPool::Shared().ForgetBindings();
 	}
 
 	// DRAW geometry
 	// Loop through the game entities and draw each one
 	// - Note: A constant buffer has already been bound to
 	//   the vertex shader stage of the pipeline (see Init above)
-	for (auto& e : *currentScene)
+	// Pick every entity's level of detail up front, since the
+	// depth prepass has to draw the same one
+	lodSelector.BeginFrame(camera, (float)Window::Height());
+	for (auto& e : drawList)
+		e->SetLOD(lodSelector.SelectLOD(e->GetMesh(), e->GetTransform(), e->GetLOD()));
+
+	if (depthPrepass)
+	{
+		// Depth only: no render targets and no pixel shader, and
+		// vertices are fetched from position-only streams
+		Graphics::Context->OMSetRenderTargets(0, 0, Graphics::DepthBufferDSV.Get());
+		Graphics::Context->PSSetShader(0, 0, 0);
+		for (auto& e : drawList)
+			e->DrawDepthOnly(camera, depthOnlyVS);
+
+		// Back to the full pass, which now only passes the nearest surfaces
+		ID3D11RenderTargetView* renderTargets[4] = {};
+		renderTargets[0] = sceneColorsRTV.Get();
+		renderTargets[1] = ambientRTV.Get();
+		renderTargets[2] = sceneNormalRTV.Get();
+		renderTargets[3] = sceneDepthRTV.Get();
+		Graphics::Context->OMSetRenderTargets(4, renderTargets, Graphics::DepthBufferDSV.Get());
+		Graphics::Context->OMSetDepthStencilState(prepassDepthState.Get(), 0);
+	}
+
+	for (auto& e : drawList)
 	{
 		std::shared_ptr<SimplePixelShader> ps = pixelShaderPBR;
 		e->GetMaterial()->SetPixelShader(ps);
+		for (unsigned int i = 0; i < e->GetMesh()->GetSubmeshCount(); i++)
+			e->GetSubmeshMaterial(i)->SetPixelShader(ps);
 
 		// Set total time on this entity's material's pixel shader
 		// Note: If the shader doesn't have this variable, nothing happens
@@ -822,9 +1149,10 @@ void Game::Draw(float deltaTime, float totalTime)
 		ps->SetInt("useRoughnessMap", (int)lightOptions.UseRoughnessMap);
 		ps->SetInt("useBurleyDiffuse", (int)lightOptions.UseBurleyDiffuse);
 	
-		// Draw one entity
+		// Draw one entity, at the level of detail picked above
 		e->Draw(camera);
 	}
+	Graphics::Context->OMSetDepthStencilState(0, 0);
 
 	// Draw the sky after all regular entities
 	if (lightOptions.ShowSkybox) sky->Draw(camera);
@@ -945,11 +1273,6 @@ void Game::Draw(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::DrawLightSources()
 {
-	// Turn on the light mesh
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vb = pointLightMesh->GetVertexBuffer();
-	Microsoft::WRL::ComPtr<ID3D11Buffer> ib = pointLightMesh->GetIndexBuffer();
-	unsigned int indexCount = pointLightMesh->GetIndexCount();
-
 	// Turn on these shaders
 	vertexShader->SetShader();
 	solidColorPS->SetShader();
@@ -957,6 +1280,7 @@ void Game::DrawLightSources()
 	// Set up vertex shader
 	vertexShader->SetMatrix4x4("view", camera->GetView());
 	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	pointLightMesh->SetShaderQuantization(vertexShader);
 
 	for (int i = 0; i < lightOptions.LightCount; i++)
 	{
@@ -966,12 +1290,6 @@ void Game::DrawLightSources()
 		if (light.Type != LIGHT_TYPE_POINT)
 			continue;
 
-		// Set buffers in the input assembler
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		Graphics::Context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
-		Graphics::Context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
-
 		// Calc quick scale based on range
 		float scale = light.Range * light.Range / 200.0f;
 
@@ -997,7 +1315,7 @@ void Game::DrawLightSources()
 		solidColorPS->CopyAllBufferData();
 
 		// Draw
-		Graphics::Context->DrawIndexed(indexCount, 0, 0);
+		pointLightMesh->SetBuffersAndDraw();
 	}
 
 }
@@ -12,6 +12,7 @@ Game Header
 #include <vector>
 #include <memory>
 
+#include "Animation.h"
 #include "Mesh.h"
 #include "GameEntity.h"
 #include "Camera.h"
@@ -19,6 +20,8 @@ Game Header
 #include "SimpleShader.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "LODSelector.h"
+#include "SceneBVH.h"
 
 class Game
 {
@@ -43,12 +46,18 @@ private:
 	// Helper for creating a solid color texture & SRV
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateSolidColorTextureSRV(int width, int height, DirectX::XMFLOAT4 color);
 
+	// Helper for loading a vertex shader that matches the mesh vertex
+	// format (or just its positions, for depth-only shaders)
+	std::shared_ptr<SimpleVertexShader> LoadMeshVertexShader(const std::wstring& shaderFile, const std::wstring& packedShaderFile, bool positionsOnly = false);
+
 	// General helpers for setup and drawing
 	void RandomizeEntities();
 	void GenerateLights();
 	void DrawLightSources();
 	void SetupMRT();
 	void CreateRandom4x4TextureAndOffsetArray();
+	void RebuildDrawList();
+	void PickEntity(int mouseX, int mouseY);
 
 	// Camera for the 3D scene
 	std::shared_ptr<FPSCamera> camera;
@@ -63,8 +72,48 @@ private:
 	std::vector<std::shared_ptr<GameEntity>> entitiesLineup;
 	std::vector<std::shared_ptr<GameEntity>> entitiesGradient;
 	std::vector<std::shared_ptr<GameEntity>>* currentScene;
+
+	// What actually gets drawn: the current scene's moving entities,
+	// plus one merged entity per material for its static ones (when
+	// static batching is on).  Rebuilt whenever the scene or the
+	// option changes, or a batched entity moves (which transforms,
+	// by handle, are baked into batches).
+	std::vector<std::shared_ptr<GameEntity>> drawList;
+	std::vector<std::shared_ptr<GameEntity>>* drawListScene;
+	std::vector<bool> batchedTransforms;
+	bool drawListBatched;
+	bool drawListStale;
+	bool staticBatching;
 	std::vector<Light> lights;
+
+	// The point lights swing back and forth along x or z, each a
+	// second further along one looping clip.  Every light's swing
+	// plays (in the AnimationSystem) on a transform under an anchor
+	// that sits at the light and turns the swing onto its axis; the
+	// lights' positions are read back from the world matrices.
+	std::shared_ptr<AnimationClip> lightSwing;
+	std::vector<std::shared_ptr<Transform>> lightAnchors;
+	std::vector<std::shared_ptr<Transform>> lightSwings;
+	std::vector<unsigned int> lightAnimations;
+	bool lightsFrozen;
 	
+	// The entity last clicked on (right mouse button), found by
+	// raycasting against a BVH over the current scene's entities
+	std::shared_ptr<GameEntity> pickedEntity;
+	float pickedDistance;
+
+	// The BVH picking uses, built on the first pick in a scene and
+	// then refit for just the entities the transform system says
+	// have moved since (by handle, mapped to instances)
+	SceneBVH sceneBVH;
+	std::vector<std::shared_ptr<GameEntity>>* sceneBVHScene;
+	std::vector<unsigned int> sceneBVHInstances;
+	std::vector<unsigned int> movedTransforms;
+	unsigned int transformListener;
+
+	// Picks each entity's level of detail as it's drawn
+	LODSelector lodSelector;
+
 	// Overall lighting options
 	DemoLightingOptions lightOptions;
 	std::shared_ptr<Mesh> pointLightMesh;
@@ -77,6 +126,12 @@ private:
 	std::shared_ptr<SimplePixelShader> solidColorPS;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 
+	// Depth prepass: depth only (from position-only streams), so
+	// the full pass only shades the pixels that end up visible
+	std::shared_ptr<SimpleVertexShader> depthOnlyVS;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> prepassDepthState;
+	bool depthPrepass;
+
 	// --- SSAO Fields ---
 	// Shaders
 	std::shared_ptr<SimplePixelShader> occlusionPS;
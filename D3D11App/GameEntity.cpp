@@ -4,7 +4,9 @@ using namespace DirectX;
 
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) :
 	mesh(mesh),
-	material(material)
+	material(material),
+	lod(0),
+	isStatic(false)
 {
 	transform = std::make_shared<Transform>();
 }
@@ -13,16 +15,90 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat
 std::shared_ptr<Mesh> GameEntity::GetMesh() { return mesh; }
 std::shared_ptr<Material> GameEntity::GetMaterial() { return material; }
 std::shared_ptr<Transform> GameEntity::GetTransform() { return transform; }
+unsigned int GameEntity::GetLOD() { return lod; }
+bool GameEntity::IsStatic() { return isStatic; }
 
 // Setters
-void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh) { this->mesh = mesh; }
+void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh) { this->mesh = mesh; submeshMaterials.clear(); }
 void GameEntity::SetMaterial(std::shared_ptr<Material> material) { this->material = material; }
+void GameEntity::SetLOD(unsigned int lod) { this->lod = lod; }
+void GameEntity::SetStatic(bool isStatic) { this->isStatic = isStatic; }
+
+// Submesh materials
+std::shared_ptr<Material> GameEntity::GetSubmeshMaterial(unsigned int submesh)
+{
+	if (submesh < submeshMaterials.size() && submeshMaterials[submesh])
+		return submeshMaterials[submesh];
+	return material;
+}
+
+void GameEntity::SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> material)
+{
+	if (submesh >= mesh->GetSubmeshCount())
+		return;
+
+	submeshMaterials.resize(mesh->GetSubmeshCount());
+	submeshMaterials[submesh] = material;
+}
+
+// Returns false if the mesh has no submesh with that name
+bool GameEntity::SetSubmeshMaterial(const char* submeshName, std::shared_ptr<Material> material)
+{
+	int submesh = mesh->FindSubmesh(submeshName);
+	if (submesh < 0)
+		return false;
+
+	SetSubmeshMaterial((unsigned int)submesh, material);
+	return true;
+}
 
 void GameEntity::Draw(std::shared_ptr<Camera> camera)
 {
-	// Set up the material (shaders and their data)
-	material->PrepareMaterial(transform, camera);
+	// Every submesh is drawn from the same buffers, so they're set once
+	mesh->SetBuffers();
+
+	bool cullMeshlets = lod == 0 && mesh->GetMeshletCount() > 0;
+	MeshletCullContext cullContext = {};
+	if (cullMeshlets)
+		cullContext = CreateMeshletCullContext(
+			transform->GetWorldMatrix(),
+			camera->GetView(),
+			camera->GetProjection(),
+			camera->GetProjectionType() == CameraProjectionType::Perspective);
+
+	std::shared_ptr<Material> preparedMaterial;
+	for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+	{
+		// Set up the material (shaders and their data), including
+		// anything the vertex shader needs to unpack this mesh,
+		// unless the previous submesh already did
+		std::shared_ptr<Material> submeshMaterial = GetSubmeshMaterial(i);
+		if (submeshMaterial != preparedMaterial)
+		{
+			mesh->SetShaderQuantization(submeshMaterial->GetVertexShader());
+			submeshMaterial->PrepareMaterial(transform, camera);
+			preparedMaterial = submeshMaterial;
+		}
+
+		// Draw the submesh (just the visible parts, when it's split into meshlets)
+		if (cullMeshlets)
+			mesh->DrawVisibleSubmeshMeshlets(i, cullContext);
+		else
+			mesh->DrawSubmesh(i, lod);
+	}
+}
+
+void GameEntity::DrawDepthOnly(std::shared_ptr<Camera> camera, std::shared_ptr<SimpleVertexShader> depthOnlyVS)
+{
+	// Only the vertex shader's data matters (the pixel shader is off)
+	depthOnlyVS->SetShader();
+	depthOnlyVS->SetMatrix4x4("world", transform->GetWorldMatrix());
+	depthOnlyVS->SetMatrix4x4("view", camera->GetView());
+	depthOnlyVS->SetMatrix4x4("projection", camera->GetProjection());
+	mesh->SetShaderQuantization(depthOnlyVS);
+	depthOnlyVS->CopyAllBufferData();
 
-	// Draw the mesh
-	mesh->SetBuffersAndDraw();
+	// Same LOD as the full pass, so the depths match exactly.  (Meshlets
+	// aren't culled here; extra depth-only triangles are cheap.)
+	mesh->SetPositionBuffersAndDraw(lod);
 }
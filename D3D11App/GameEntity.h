@@ -3,6 +3,7 @@
 #include <wrl/client.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 #include "Mesh.h"
 #include "Material.h"
 #include "Transform.h"
@@ -20,12 +21,33 @@ public:
 	void SetMesh(std::shared_ptr<Mesh> mesh);
 	void SetMaterial(std::shared_ptr<Material> material);
 
+	// Materials of individual submeshes (any without one use
+	// the entity's material).  Changing the mesh clears them.
+	std::shared_ptr<Material> GetSubmeshMaterial(unsigned int submesh);
+	void SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> material);
+	bool SetSubmeshMaterial(const char* submeshName, std::shared_ptr<Material> material);
+
+	// Which of the mesh's levels of detail to draw
+	unsigned int GetLOD();
+	void SetLOD(unsigned int lod);
+
+	// Whether the entity never moves, so it can be merged into
+	// a static batch with others that share its materials
+	bool IsStatic();
+	void SetStatic(bool isStatic);
+
 	void Draw(std::shared_ptr<Camera> camera);
 
+	// Draws only depth, with a shader that takes nothing but positions
+	void DrawDepthOnly(std::shared_ptr<Camera> camera, std::shared_ptr<SimpleVertexShader> depthOnlyVS);
+
 private:
 
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	std::vector<std::shared_ptr<Material>> submeshMaterials;
 	std::shared_ptr<Transform> transform;
+	unsigned int lod;
+	bool isStatic;
 };
 
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "GeometryPool.h"
+#include "Graphics.h"
+#include "Vertex.h"
+#include "PackedVertex.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Makes a bigger copy of a buffer (or a new one, if there's
+	// nothing to copy yet).  Contents are copied on the GPU.
+	// --------------------------------------------------------
+	ComPtr<ID3D11Buffer> ResizeBuffer(ComPtr<ID3D11Buffer> buffer, unsigned int oldBytes, unsigned int newBytes, UINT bindFlags)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = newBytes;
+		desc.BindFlags = bindFlags;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		ComPtr<ID3D11Buffer> newBuffer;
+		Graphics::Device->CreateBuffer(&desc, 0, newBuffer.GetAddressOf());
+
+		if (buffer && oldBytes > 0)
+		{
+			D3D11_BOX box = { 0, 0, 0, oldBytes, 1, 1 };
+			Graphics::Context->CopySubresourceRegion(newBuffer.Get(), 0, 0, 0, 0, buffer.Get(), 0, &box);
+		}
+		return newBuffer;
+	}
+
+	// Copies elements from the CPU into part of a buffer
+	void UploadRange(ID3D11Buffer* buffer, unsigned int first, unsigned int count, unsigned int elementSize, const void* data)
+	{
+		D3D11_BOX box = { first * elementSize, 0, 0, (first + count) * elementSize, 1, 1 };
+		Graphics::Context->UpdateSubresource(buffer, 0, &box, data, 0, 0);
+	}
+
+	// How much to grow a buffer that needs room for more elements
+	unsigned int GrownCapacity(unsigned int capacity, unsigned int needed, unsigned int initial)
+	{
+		return std::max({ capacity * 2, capacity + needed, initial });
+	}
+}
+
+
+// --------------------------------------------------------
+// Buffers are created on the first allocation, so the pool
+// can exist before the device does
+// --------------------------------------------------------
+GeometryPool::GeometryPool() :
+	boundVertexBuffer(0),
+	boundIndexBuffer(0),
+	bindCount(0)
+{
+#if MESH_PACKED_VERTICES
+	vertexStride = sizeof(PackedVertex);
+#else
+	vertexStride = sizeof(Vertex);
+#endif
+
+	positionStride = 0;
+#if MESH_POSITION_STREAM
+#if MESH_PACKED_VERTICES
+	positionStride = sizeof(PackedVertex::Position);
+#else
+	positionStride = sizeof(Vertex::Position);
+#endif
+#endif
+
+	shortIndices.IndexSize = sizeof(unsigned short);
+	longIndices.IndexSize = sizeof(unsigned int);
+}
+
+GeometryPool::~GeometryPool() { }
+
+
+// --------------------------------------------------------
+// Getters for private variables
+// --------------------------------------------------------
+unsigned int GeometryPool::GetVertexStride() { return vertexStride; }
+unsigned int GeometryPool::GetPositionStride() { return positionStride; }
+ComPtr<ID3D11Buffer> GeometryPool::GetVertexBuffer() { return vertexBuffer; }
+ComPtr<ID3D11Buffer> GeometryPool::GetPositionBuffer() { return positionBuffer; }
+ComPtr<ID3D11Buffer> GeometryPool::GetIndexBuffer(DXGI_FORMAT indexFormat) { return GetIndices(indexFormat).Buffer; }
+unsigned int GeometryPool::GetRangeCount() { return vertexAllocator.GetAllocationCount(); }
+unsigned int GeometryPool::GetBindCount() { return bindCount; }
+
+unsigned int GeometryPool::GetCapacityBytes()
+{
+	return vertexAllocator.GetCapacity() * (vertexStride + positionStride) +
+		shortIndices.Allocator.GetCapacity() * shortIndices.IndexSize +
+		longIndices.Allocator.GetCapacity() * longIndices.IndexSize;
+}
+
+unsigned int GeometryPool::GetUsedBytes()
+{
+	return vertexAllocator.GetUsed() * (vertexStride + positionStride) +
+		shortIndices.Allocator.GetUsed() * shortIndices.IndexSize +
+		longIndices.Allocator.GetUsed() * longIndices.IndexSize;
+}
+
+
+// --------------------------------------------------------
+// The pool shared by every mesh, created on first use
+// --------------------------------------------------------
+GeometryPool& GeometryPool::Shared()
+{
+	static GeometryPool pool;
+	return pool;
+}
+
+
+// --------------------------------------------------------
+// Copies a mesh's geometry into free space in the pool,
+// growing the buffers first if there isn't enough
+//
+// vertices    - Vertices, GetVertexStride() bytes each
+// positions   - Positions, GetPositionStride() bytes each
+// vertexCount - Number of vertices (and positions)
+// indices     - Indices, relative to the first vertex
+// indexCount  - Number of indices
+// indexFormat - DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+// --------------------------------------------------------
+GeometryRange GeometryPool::Allocate(const void* vertices, const void* positions, unsigned int vertexCount,
+	const void* indices, unsigned int indexCount, DXGI_FORMAT indexFormat)
+{
+	IndexBuffer& indexBuffer = GetIndices(indexFormat);
+
+	GeometryRange range = {};
+	range.VertexCount = vertexCount;
+	range.IndexCount = indexCount;
+	range.IndexFormat = indexFormat;
+
+	range.BaseVertex = vertexAllocator.Allocate(vertexCount);
+	if (range.BaseVertex == RangeAllocator::InvalidOffset)
+	{
+		GrowVertices(GrownCapacity(vertexAllocator.GetCapacity(), vertexCount, GEOMETRY_POOL_INITIAL_VERTICES));
+		range.BaseVertex = vertexAllocator.Allocate(vertexCount);
+	}
+
+	range.FirstIndex = indexBuffer.Allocator.Allocate(indexCount);
+	if (range.FirstIndex == RangeAllocator::InvalidOffset)
+	{
+		GrowIndices(indexBuffer, GrownCapacity(indexBuffer.Allocator.GetCapacity(), indexCount, GEOMETRY_POOL_INITIAL_INDICES));
+		range.FirstIndex = indexBuffer.Allocator.Allocate(indexCount);
+	}
+
+	if (vertexCount > 0)
+	{
+		UploadRange(vertexBuffer.Get(), range.BaseVertex, vertexCount, vertexStride, vertices);
+		if (positionBuffer && positions)
+			UploadRange(positionBuffer.Get(), range.BaseVertex, vertexCount, positionStride, positions);
+	}
+	if (indexCount > 0)
+		UploadRange(indexBuffer.Buffer.Get(), range.FirstIndex, indexCount, indexBuffer.IndexSize, indices);
+
+	return range;
+}
+
+
+// --------------------------------------------------------
+// Returns a range's space to the pool.  Buffers never
+// shrink; the space is simply reused by later allocations.
+// --------------------------------------------------------
+void GeometryPool::Free(const GeometryRange& range)
+{
+	vertexAllocator.Free(range.BaseVertex);
+	GetIndices(range.IndexFormat).Allocator.Free(range.FirstIndex);
+}
+
+
+// --------------------------------------------------------
+// Releases the shared buffers and forgets every range.  The
+// pool outlives everything else (it's a static), so this
+// has to be called explicitly, while the device still exists.
+// --------------------------------------------------------
+void GeometryPool::Release()
+{
+	vertexBuffer.Reset();
+	positionBuffer.Reset();
+	shortIndices.Buffer.Reset();
+	longIndices.Buffer.Reset();
+
+	vertexAllocator = RangeAllocator();
+	shortIndices.Allocator = RangeAllocator();
+	longIndices.Allocator = RangeAllocator();
+	ForgetBindings();
+}
+
+
+// --------------------------------------------------------
+// Binds the shared vertex buffer (or the position-only one)
+// and the index buffer of the given format, skipping any
+// that are already bound
+// --------------------------------------------------------
+void GeometryPool::Bind(DXGI_FORMAT indexFormat, bool positionsOnly)
+{
+	bool usePositions = positionsOnly && positionBuffer;
+	ID3D11Buffer* vb = usePositions ? positionBuffer.Get() : vertexBuffer.Get();
+	if (vb != boundVertexBuffer)
+	{
+		UINT stride = usePositions ? positionStride : vertexStride;
+		UINT offset = 0;
+		Graphics::Context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+		boundVertexBuffer = vb;
+		bindCount++;
+	}
+
+	ID3D11Buffer* ib = GetIndices(indexFormat).Buffer.Get();
+	if (ib != boundIndexBuffer)
+	{
+		Graphics::Context->IASetIndexBuffer(ib, indexFormat, 0);
+		boundIndexBuffer = ib;
+		bindCount++;
+	}
+}
+
+
+// --------------------------------------------------------
+// Assumes nothing is bound, so the next Bind() sets both
+// buffers.  Call whenever other code may have changed the
+// input assembler's buffers.
+// --------------------------------------------------------
+void GeometryPool::ForgetBindings()
+{
+	boundVertexBuffer = 0;
+	boundIndexBuffer = 0;
+	bindCount = 0;
+}
+
+
+// --------------------------------------------------------
+// Helpers for finding & growing buffers
+// --------------------------------------------------------
+GeometryPool::IndexBuffer& GeometryPool::GetIndices(DXGI_FORMAT indexFormat)
+{
+	if (indexFormat == DXGI_FORMAT_R16_UINT) return shortIndices;
+	if (indexFormat == DXGI_FORMAT_R32_UINT) return longIndices;
+	throw std::invalid_argument("Error using geometry pool: Index format must be R16_UINT or R32_UINT");
+}
+
+void GeometryPool::GrowVertices(unsigned int newCapacity)
+{
+	unsigned int oldCapacity = vertexAllocator.GetCapacity();
+	vertexBuffer = ResizeBuffer(vertexBuffer, oldCapacity * vertexStride, newCapacity * vertexStride, D3D11_BIND_VERTEX_BUFFER);
+	if (positionStride > 0)
+		positionBuffer = ResizeBuffer(positionBuffer, oldCapacity * positionStride, newCapacity * positionStride, D3D11_BIND_VERTEX_BUFFER);
+
+	vertexAllocator.Grow(newCapacity);
+	ForgetBindings();
+}
+
+void GeometryPool::GrowIndices(IndexBuffer& indices, unsigned int newCapacity)
+{
+	unsigned int oldCapacity = indices.Allocator.GetCapacity();
+	indices.Buffer = ResizeBuffer(indices.Buffer, oldCapacity * indices.IndexSize, newCapacity * indices.IndexSize, D3D11_BIND_INDEX_BUFFER);
+
+	indices.Allocator.Grow(newCapacity);
+	ForgetBindings();
+}
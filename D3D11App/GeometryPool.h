@@ -0,0 +1,114 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "RangeAllocator.h"
+
+// Starting sizes of the shared buffers (each doubles when full)
+#define GEOMETRY_POOL_INITIAL_VERTICES (1 << 16)
+#define GEOMETRY_POOL_INITIAL_INDICES (1 << 18)
+
+// --------------------------------------------------------
+// Where one mesh's geometry lives inside the pool.  Indices
+// are relative to the mesh's own vertices, so draws pass
+// BaseVertex along to the GPU.
+// --------------------------------------------------------
+struct GeometryRange
+{
+	unsigned int BaseVertex;
+	unsigned int VertexCount;
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+	DXGI_FORMAT IndexFormat;
+};
+
+// --------------------------------------------------------
+// Every mesh's vertices and indices, suballocated out of a
+// few large buffers:
+//  - Full vertices (packed or not, depending on the build)
+//  - Position-only vertices, at the same offsets as the
+//    full ones, when MESH_POSITION_STREAM is on
+//  - 16-bit and 32-bit indices, each in their own buffer
+//
+// Since meshes no longer have buffers of their own, the
+// input assembler only needs rebinding when the index
+// format (or vertex stream) changes, rather than once per
+// draw.  Bind() skips anything that's already bound, as
+// long as ForgetBindings() is called whenever other code
+// may have touched the input assembler (like at the start
+// of each frame).
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	GeometryPool();
+	~GeometryPool();
+	GeometryPool(const GeometryPool&) = delete; // Remove copy constructor
+	GeometryPool& operator=(const GeometryPool&) = delete; // Remove copy-assignment operator
+
+	// Copies geometry into the pool, growing it if necessary.
+	// Vertices must match GetVertexStride(), and positions
+	// GetPositionStride() (they're ignored when that's zero).
+	GeometryRange Allocate(const void* vertices, const void* positions, unsigned int vertexCount,
+		const void* indices, unsigned int indexCount, DXGI_FORMAT indexFormat);
+	void Free(const GeometryRange& range);
+
+	// Drops the buffers (and every range) before the device goes
+	// away; every mesh must be destroyed first.  The pool can still
+	// be used afterwards, starting over from empty buffers.
+	void Release();
+
+	// Binds the buffers needed to draw ranges with the given index format
+	void Bind(DXGI_FORMAT indexFormat, bool positionsOnly = false);
+	void ForgetBindings();
+
+	// Vertex formats of the shared buffers
+	unsigned int GetVertexStride();
+	unsigned int GetPositionStride();
+
+	// The shared buffers themselves
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetPositionBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer(DXGI_FORMAT indexFormat);
+
+	// Sizes (in bytes) of the buffers, and of the parts in use
+	unsigned int GetCapacityBytes();
+	unsigned int GetUsedBytes();
+	unsigned int GetRangeCount();
+
+	// Input assembler changes made by Bind() since ForgetBindings()
+	unsigned int GetBindCount();
+
+	// The pool every mesh shares
+	static GeometryPool& Shared();
+
+private:
+	// One growable buffer, and the allocator for its elements
+	struct IndexBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		RangeAllocator Allocator;
+		unsigned int IndexSize;
+	};
+
+	// Vertices (both streams share one allocator, so their offsets match)
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer;
+	RangeAllocator vertexAllocator;
+	unsigned int vertexStride;
+	unsigned int positionStride;
+
+	// Indices, by format
+	IndexBuffer shortIndices;
+	IndexBuffer longIndices;
+
+	// What's currently bound
+	ID3D11Buffer* boundVertexBuffer;
+	ID3D11Buffer* boundIndexBuffer;
+	unsigned int bindCount;
+
+	IndexBuffer& GetIndices(DXGI_FORMAT indexFormat);
+	void GrowVertices(unsigned int newCapacity);
+	void GrowIndices(IndexBuffer& indices, unsigned int newCapacity);
+};
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "LODSelector.h"
+
+using namespace DirectX;
+
+LODSelector::LODSelector(float maxPixelError, float hysteresis) :
+	enabled(true),
+	maxPixelError(maxPixelError),
+	hysteresis(hysteresis),
+	cameraPosition(0, 0, 0),
+	perspective(true),
+	pixelsPerUnit(1.0f),
+	nearClip(0.01f)
+{
+	memset(&stats, 0, sizeof(LODFrameStats));
+}
+
+// Getters & setters
+bool LODSelector::GetEnabled() { return enabled; }
+void LODSelector::SetEnabled(bool enabled) { this->enabled = enabled; }
+float LODSelector::GetMaxPixelError() { return maxPixelError; }
+void LODSelector::SetMaxPixelError(float pixels) { maxPixelError = std::max(pixels, 0.0f); }
+float LODSelector::GetHysteresis() { return hysteresis; }
+void LODSelector::SetHysteresis(float fraction) { hysteresis = std::clamp(fraction, 0.0f, 1.0f); }
+const LODFrameStats& LODSelector::GetFrameStats() { return stats; }
+
+
+// --------------------------------------------------------
+// Grabs what's needed from the camera to project errors
+// onto the screen, and resets the per-frame stats
+//
+// camera         - The camera about to be drawn with
+// viewportHeight - Height of the render target, in pixels
+// --------------------------------------------------------
+void LODSelector::BeginFrame(std::shared_ptr<Camera> camera, float viewportHeight)
+{
+	cameraPosition = camera->GetTransform()->GetPosition();
+	nearClip = camera->GetNearClip();
+	perspective = camera->GetProjectionType() == CameraProjectionType::Perspective;
+
+	// Perspective: an object one unit away spans this many pixels per unit
+	// Orthographic: the same at any distance
+	if (perspective)
+		pixelsPerUnit = viewportHeight / (2.0f * tanf(camera->GetFieldOfView() * 0.5f));
+	else
+		pixelsPerUnit = viewportHeight / (camera->GetOrthographicWidth() / camera->GetAspectRatio());
+
+	memset(&stats, 0, sizeof(LODFrameStats));
+}
+
+
+// --------------------------------------------------------
+// Size on screen, in pixels, of a world space error at
+// the given distance from the camera
+// --------------------------------------------------------
+float LODSelector::GetPixelError(float worldError, float distance)
+{
+	return perspective ? worldError * pixelsPerUnit / distance : worldError * pixelsPerUnit;
+}
+
+
+// --------------------------------------------------------
+// Picks the cheapest LOD whose error stays under the pixel
+// limit, measured from the nearest point of the entity's
+// world space bounding sphere.  Moving to more detail
+// happens right away, but moving to less detail requires
+// the error to be comfortably (by the hysteresis fraction)
+// under the limit, so LODs don't flicker back and forth.
+//
+// mesh        - The mesh about to be drawn
+// transform   - Where it's being drawn
+// previousLOD - The LOD this draw used last frame
+//
+// Returns the LOD to draw
+// --------------------------------------------------------
+unsigned int LODSelector::SelectLOD(std::shared_ptr<Mesh> mesh, std::shared_ptr<Transform> transform, unsigned int previousLOD)
+{
+	unsigned int lodCount = mesh->GetLODCount();
+	unsigned int lod = 0;
+	if (enabled && lodCount > 1)
+	{
+		// Bounding sphere of the mesh, in world space
+		XMFLOAT4X4 world = transform->GetWorldMatrix();
+		XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+		Bounds bounds = TransformBounds(mesh->GetBounds(), world);
+		XMVECTOR center = XMLoadFloat3(&bounds.Center);
+		float radius = bounds.Radius;
+
+		// Errors grow with the largest scale along any axis
+		float scale = sqrtf(std::max(
+			XMVectorGetX(XMVector3LengthSq(worldMatrix.r[0])), std::max(
+			XMVectorGetX(XMVector3LengthSq(worldMatrix.r[1])),
+			XMVectorGetX(XMVector3LengthSq(worldMatrix.r[2])))));
+
+		XMVECTOR cameraPos = XMLoadFloat3(&cameraPosition);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, cameraPos))) - radius;
+		distance = std::max(distance, nearClip);
+
+		// Errors only grow with each LOD, so find the last one under the limit
+		for (unsigned int i = lodCount - 1; i > 0; i--)
+		{
+			if (GetPixelError(mesh->GetLOD(i).Error * scale, distance) <= maxPixelError)
+			{
+				lod = i;
+				break;
+			}
+		}
+
+		// Only give up detail once it's well within the limit
+		previousLOD = std::min(previousLOD, lodCount - 1);
+		if (lod > previousLOD)
+		{
+			float switchError = maxPixelError * (1.0f - hysteresis);
+			unsigned int coarser = previousLOD;
+			for (unsigned int i = lod; i > previousLOD; i--)
+			{
+				if (GetPixelError(mesh->GetLOD(i).Error * scale, distance) <= switchError)
+				{
+					coarser = i;
+					break;
+				}
+			}
+			lod = coarser;
+		}
+	}
+
+	// Track the savings
+	unsigned int fullTriangles = mesh->GetLOD(0).IndexCount / 3;
+	unsigned int drawnTriangles = mesh->GetLOD(lod).IndexCount / 3;
+	stats.Draws++;
+	stats.FullTriangles += fullTriangles;
+	stats.DrawnTriangles += drawnTriangles;
+	stats.TrianglesSaved += fullTriangles - drawnTriangles;
+	stats.DrawsPerLOD[std::min(lod, (unsigned int)MESH_MAX_LODS - 1)]++;
+	return lod;
+}
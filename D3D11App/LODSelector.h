@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+
+#include "Camera.h"
+#include "Mesh.h"
+#include "Transform.h"
+
+// How far (in pixels) a LOD's surface may appear from the full mesh
+#define LOD_DEFAULT_MAX_PIXEL_ERROR 1.0f
+
+// A coarser LOD is only switched to once its error is this fraction
+// below the limit, so entities near a boundary don't flip every frame
+#define LOD_DEFAULT_HYSTERESIS 0.25f
+
+// --------------------------------------------------------
+// Triangle counts for everything drawn since BeginFrame()
+// --------------------------------------------------------
+struct LODFrameStats
+{
+	unsigned int Draws;
+	unsigned int FullTriangles;		// Had every draw used LOD 0
+	unsigned int DrawnTriangles;	// With the selected LODs
+	unsigned int TrianglesSaved;
+	unsigned int DrawsPerLOD[MESH_MAX_LODS];
+};
+
+// --------------------------------------------------------
+// Picks the cheapest level of detail for each draw whose
+// error, projected onto the screen, stays under a limit
+// --------------------------------------------------------
+class LODSelector
+{
+public:
+	LODSelector(float maxPixelError = LOD_DEFAULT_MAX_PIXEL_ERROR, float hysteresis = LOD_DEFAULT_HYSTERESIS);
+
+	// Captures the camera's projection and clears the stats
+	void BeginFrame(std::shared_ptr<Camera> camera, float viewportHeight);
+
+	// Chooses a LOD given the one drawn last frame, and counts it
+	unsigned int SelectLOD(std::shared_ptr<Mesh> mesh, std::shared_ptr<Transform> transform, unsigned int previousLOD);
+
+	// Getters & setters
+	bool GetEnabled();
+	void SetEnabled(bool enabled);
+	float GetMaxPixelError();
+	void SetMaxPixelError(float pixels);
+	float GetHysteresis();
+	void SetHysteresis(float fraction);
+	const LODFrameStats& GetFrameStats();
+
+private:
+	bool enabled;
+	float maxPixelError;
+	float hysteresis;
+
+	// From the camera, for this frame
+	DirectX::XMFLOAT3 cameraPosition;
+	bool perspective;
+	float pixelsPerUnit;		// Perspective: at a distance of one unit
+	float nearClip;
+
+	LODFrameStats stats;
+
+	float GetPixelError(float worldError, float distance);
+};
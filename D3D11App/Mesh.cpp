@@ -1,9 +1,11 @@
-#include <fstream>
-#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <stdexcept>
 
 #include "Mesh.h"
 #include "Graphics.h"
+#include "MeshCache.h"
 
 using namespace DirectX;
 
@@ -17,376 +19,428 @@ using namespace DirectX;
 // numIndices - The number of indices in the index array
 // --------------------------------------------------------
 Mesh::Mesh(const char* name, Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices) :
-	name(name)
+	bvhBuilt(false),
+	name(name),
+	loadTime(0),
+	loadedFromCache(false),
+	generated(false)
 {
-	CreateBuffers(vertArray, numVerts, indexArray, numIndices);
+	// Not optimized, but still worth knowing about
+	optimizationStats.Before = AnalyzeVertexCache(indexArray, numIndices, numVerts);
+	optimizationStats.After = optimizationStats.Before;
+
+	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	CreateBuffers(vertArray, numVerts, indexArray, numIndices, nullptr, 0);
 }
 
 // --------------------------------------------------------
 // Creates a new mesh by loading vertices from the given .obj file
 // 
+// If a matching .meshbin cache exists next to the file, its
+// final vertex & index arrays are used directly (straight from
+// a memory-mapped view).  Otherwise the .obj is parsed,
+// optimized and simplified into LODs, and the cache is
+// written for next time.
+//
 // objFile  - Path to the .obj 3D model file to load
 // --------------------------------------------------------
 Mesh::Mesh(const char* name, const std::wstring& objFile) :
-	name(name)
+	bvhBuilt(false),
+	name(name),
+	loadTime(0),
+	loadedFromCache(false),
+	generated(false)
 {
-	// Set indicies to 0 in the event the file reading fails
-	numIndices = 0;
-	numVertices = 0;
-
-	// File input object
-	std::ifstream obj(objFile);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
-	// Check for successful open
-	if (!obj.is_open())
+	// Map the source file
+	MappedFile source(objFile);
+	if (!source.IsOpen())
 		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;			// UVs from the file
-	std::vector<Vertex> verts;			// Verts we're assembling
-	std::vector<UINT> indices;			// Indices of these verts
-	unsigned int vertCounter = 0;		// Count of vertices/indices
-	int indexCounter = 0;				// Count of indices
-	char chars[100];					// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// Was the cache built from this exact file?
+	std::wstring cachePath = GetMeshCachePath(objFile);
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	MeshCacheFile cache(cachePath);
+	if (cache.IsValid(source.GetSize(), sourceHash))
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		const MeshCacheHeader* header = cache.GetHeader();
+		CreateBuffers(cache.GetVertices(), header->VertexCount, cache.GetIndices(), header->IndexCount, header->LODs, header->LODCount,
+			cache.GetMeshlets(), header->MeshletCount, cache.GetSubmeshes(), header->SubmeshCount);
+		optimizationStats = header->Optimization;
+		loadedFromCache = true;
+	}
+	else
+	{
+		// Parse the file into CPU-side arrays and finalize them
+		MeshData data = BuildMeshFromOBJ(source.GetData(), source.GetSize(), optimizationStats);
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm{};
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv{};
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos{};
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12]{};
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1{};
-			v1.Position = positions[max(i[0] - 1, 0)];
-			v1.UV = uvs[max(i[1] - 1, 0)];
-			v1.Normal = normals[max(i[2] - 1, 0)];
-
-			Vertex v2{};
-			v2.Position = positions[max(i[3] - 1, 0)];
-			v2.UV = uvs[max(i[4] - 1, 0)];
-			v2.Normal = normals[max(i[5] - 1, 0)];
-
-			Vertex v3{};
-			v3.Position = positions[max(i[6] - 1, 0)];
-			v3.UV = uvs[max(i[7] - 1, 0)];
-			v3.Normal = normals[max(i[8] - 1, 0)];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4{};
-				v4.Position = positions[max(i[9] - 1, 0)];
-				v4.UV = uvs[max(i[10] - 1, 0)];
-				v4.Normal = normals[max(i[11] - 1, 0)];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
+		// Save the results (failure just means we parse again next time)
+		WriteMeshCache(cachePath, data, optimizationStats, source.GetSize(), sourceHash);
+		CreateBuffers(data.Vertices.data(), data.Vertices.size(), data.Indices.data(), data.Indices.size(), data.LODs.data(), data.LODs.size(),
+			data.Meshlets.data(), data.Meshlets.size(), data.Submeshes.data(), data.Submeshes.size());
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+// --------------------------------------------------------
+// Creates a new mesh by generating a primitive shape, with
+// no file involved at all (see Primitives.h)
+//
+// shape    - Which primitive to generate
+// detail   - Segments around round shapes, or subdivisions of flat ones
+// lodCount - Most levels of detail to generate, each with half the detail
+// --------------------------------------------------------
+Mesh::Mesh(const char* name, PrimitiveShape shape, unsigned int detail, unsigned int lodCount) :
+	bvhBuilt(false),
+	name(name),
+	loadTime(0),
+	loadedFromCache(false),
+	generated(true)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	MeshData data = GeneratePrimitive(shape, detail, lodCount);
+	CreateBuffers(data.Vertices.data(), data.Vertices.size(), data.Indices.data(), data.Indices.size(), data.LODs.data(), data.LODs.size(),
+		data.Meshlets.data(), data.Meshlets.size(), data.Submeshes.data(), data.Submeshes.size());
+
+	// Already in an optimized order, so there's no "before"
+	optimizationStats.After = AnalyzeVertexCache(data.Indices.data(), data.LODs[0].IndexCount, data.Vertices.size());
+	optimizationStats.Before = optimizationStats.After;
+
+	loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+// --------------------------------------------------------
+// Creates a new mesh from geometry that has already been
+// finished (tangents calculated, and optimized if need be),
+// like a static batch
+// --------------------------------------------------------
+Mesh::Mesh(const char* name, const MeshData& data) :
+	bvhBuilt(false),
+	name(name),
+	loadTime(0),
+	loadedFromCache(false),
+	generated(true)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	CreateBuffers(data.Vertices.data(), data.Vertices.size(), data.Indices.data(), data.Indices.size(), data.LODs.data(), data.LODs.size(),
+		data.Meshlets.data(), data.Meshlets.size(), data.Submeshes.data(), data.Submeshes.size());
+
+	optimizationStats.After = AnalyzeVertexCache(data.Indices.data(), lods[0].IndexCount, data.Vertices.size());
+	optimizationStats.Before = optimizationStats.After;
+
+	loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
 
 // --------------------------------------------------------
-// Destructor doesn't have much to do since we're using ComPtrs
+// Gives this mesh's space back to the geometry pool
 // --------------------------------------------------------
-Mesh::~Mesh() { }
+Mesh::~Mesh()
+{
+	GeometryPool::Shared().Free(geometry);
+}
 
 
 // --------------------------------------------------------
 // Getters for private variables
 // --------------------------------------------------------
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return vb; }
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return ib; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return GeometryPool::Shared().GetVertexBuffer(); }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return GeometryPool::Shared().GetIndexBuffer(geometry.IndexFormat); }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetPositionBuffer() { return GeometryPool::Shared().GetPositionBuffer(); }
 const char* Mesh::GetName() { return name; }
-unsigned int Mesh::GetIndexCount() { return numIndices; }
-unsigned int Mesh::GetVertexCount() { return numVertices; }
+unsigned int Mesh::GetIndexCount() { return lods[0].IndexCount; }
+unsigned int Mesh::GetVertexCount() { return geometry.VertexCount; }
+float Mesh::GetLoadTime() { return loadTime; }
+bool Mesh::WasLoadedFromCache() { return loadedFromCache; }
+bool Mesh::WasGenerated() { return generated; }
+MeshOptimizationStats Mesh::GetOptimizationStats() { return optimizationStats; }
+unsigned int Mesh::GetVertexStride() { return GeometryPool::Shared().GetVertexStride(); }
+DXGI_FORMAT Mesh::GetIndexFormat() { return geometry.IndexFormat; }
+unsigned int Mesh::GetPositionStride() { return GeometryPool::Shared().GetPositionStride(); }
+unsigned int Mesh::GetBufferBytes() { return geometry.VertexCount * (GetVertexStride() + GetPositionStride()) + geometry.IndexCount * (geometry.IndexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4); }
+const GeometryRange& Mesh::GetGeometryRange() { return geometry; }
+const VertexQuantization& Mesh::GetVertexQuantization() { return quantization; }
+const VertexPackingError& Mesh::GetPackingError() { return packingError; }
+const std::vector<Vertex>& Mesh::GetVertices() { return vertices; }
+const std::vector<unsigned int>& Mesh::GetIndices() { return indices; }
+const Bounds& Mesh::GetBounds() { return bounds; }
+XMFLOAT3 Mesh::GetBoundsMin() { return bounds.Min; }
+XMFLOAT3 Mesh::GetBoundsMax() { return bounds.Max; }
+unsigned int Mesh::GetLODCount() { return (unsigned int)lods.size(); }
+const MeshLOD& Mesh::GetLOD(unsigned int lod) { return lods[std::min(lod, (unsigned int)lods.size() - 1)]; }
+unsigned int Mesh::GetMeshletCount() { return (unsigned int)meshlets.size(); }
+const Meshlet* Mesh::GetMeshlets() { return meshlets.data(); }
+unsigned int Mesh::GetSubmeshCount() { return (unsigned int)submeshes.size(); }
+const MeshSubmesh& Mesh::GetSubmesh(unsigned int submesh) { return submeshes[submesh]; }
 
 
 // --------------------------------------------------------
-// Helper for creating the actually D3D buffers
-// 
-// vertArray  - An array of vertices
-// numVerts   - The number of verts in the array
-// indexArray - An array of indices into the vertex array
-// numIndices - The number of indices in the index array
-// device     - The D3D device to use for buffer creation
+// Builds the raycast hierarchy over the full detail LOD on
+// first use, so meshes that are never picked don't pay for it
 // --------------------------------------------------------
-void Mesh::CreateBuffers(Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices)
+const MeshBVH& Mesh::GetBVH()
 {
-	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	if (!bvhBuilt)
+	{
+		bvh.Build(vertices.data(), vertices.size(), indices.data() + lods[0].FirstIndex, lods[0].IndexCount);
+		bvhBuilt = true;
+	}
+	return bvh;
+}
 
-	// Create the vertex buffer
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * (UINT)numVerts; // Number of vertices
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertArray;
-	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vb.GetAddressOf());
-
-	// Create the index buffer
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * (UINT)numIndices; // Number of indices
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indexArray;
-	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, ib.GetAddressOf());
-
-	// Save the counts
-	this->numIndices = (unsigned int)numIndices;
-	this->numVertices = (unsigned int)numVerts;
+
+// --------------------------------------------------------
+// Finds the submesh with the given material (or group)
+// name, returning -1 if there isn't one
+// --------------------------------------------------------
+int Mesh::FindSubmesh(const char* name)
+{
+	for (size_t i = 0; i < submeshes.size(); i++)
+		if (strncmp(submeshes[i].Name, name, MESH_MAX_SUBMESH_NAME) == 0)
+			return (int)i;
+	return -1;
 }
 
 
 // --------------------------------------------------------
-// Calculates the tangents of the vertices in a mesh
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// Helper for putting the geometry on the GPU, in a range of
+// the shared geometry pool.  Vertices must already be final
+// (tangents included).  They're packed when
+// MESH_PACKED_VERTICES is on, and indices shrink to 16 bits
+// whenever there are few enough vertices.
+// 
+// vertArray    - An array of vertices
+// numVerts     - The number of verts in the array
+// indexArray   - An array of indices into the vertex array
+// numIndices   - The number of indices in the index array
+// lodArray     - Index ranges of each LOD (or null for just one
+//                LOD made of every index)
+// numLODs      - The number of LODs in the LOD array
+// meshletArray - Clusters of LOD 0 (or null for none)
+// numMeshlets  - The number of meshlets in the meshlet array
+// submeshArray - Per-material ranges (or null for a single
+//                submesh covering the whole mesh)
+// numSubmeshes - The number of submeshes in the submesh array
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices)
+void Mesh::CreateBuffers(const Vertex* vertArray, size_t numVerts, const unsigned int* indexArray, size_t numIndices, const MeshLOD* lodArray, size_t numLODs,
+	const Meshlet* meshletArray, size_t numMeshlets, const MeshSubmesh* submeshArray, size_t numSubmeshes)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	GeometryPool& pool = GeometryPool::Shared();
+
+	// Compress the vertices, keeping track of what that cost
+#if MESH_PACKED_VERTICES
+	std::vector<PackedVertex> packedVerts(numVerts);
+	quantization = ComputeVertexQuantization(vertArray, numVerts);
+	PackVertices(vertArray, numVerts, quantization, packedVerts.data());
+	packingError = MeasurePackingError(vertArray, packedVerts.data(), numVerts, quantization);
+	const void* vertexData = packedVerts.data();
+#else
+	quantization = {};
+	packingError = {};
+	const void* vertexData = vertArray;
+#endif
+
+	// Every index fits in 16 bits when there are few enough vertices
+	// (indices are relative to this mesh's first vertex in the pool)
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = indexArray;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+	if (numVerts < MESH_MAX_16BIT_VERTICES)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		shortIndices.assign(indexArray, indexArray + numIndices);
+		indexData = shortIndices.data();
+		indexFormat = DXGI_FORMAT_R16_UINT;
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	// Positions again, on their own, for depth-only passes
+	std::vector<unsigned char> positions(pool.GetPositionStride() * numVerts);
+	if (!positions.empty())
+		SplitPositionStream(vertexData, numVerts, pool.GetVertexStride(), pool.GetPositionStride(), positions.data());
+
+	geometry = pool.Allocate(vertexData, positions.data(), (unsigned int)numVerts, indexData, (unsigned int)numIndices, indexFormat);
+	vertices.assign(vertArray, vertArray + numVerts);
+	indices.assign(indexArray, indexArray + numIndices);
+
+	if (lodArray && numLODs > 0)
+		lods.assign(lodArray, lodArray + numLODs);
+	else
+		lods.assign(1, { 0, (unsigned int)numIndices, 0.0f });
+
+	if (meshletArray && numMeshlets > 0)
+		meshlets.assign(meshletArray, meshletArray + numMeshlets);
+	else
+		meshlets.clear();
+
+	if (submeshArray && numSubmeshes > 0)
+		submeshes.assign(submeshArray, submeshArray + numSubmeshes);
+	else
+		submeshes.assign(1, CreateWholeSubmesh(lods.data(), lods.size(), numIndices, meshlets.size()));
+
+	// Bounds of all vertices (kept on the CPU for culling, sorting, etc.)
+	bounds = ComputeBounds(vertArray, numVerts);
+}
+
+
+// --------------------------------------------------------
+// Sets the shader variables that map packed vertices back
+// to their ranges.  Call before the shader's data is copied
+// to the GPU.  Does nothing when vertices aren't packed.
+// --------------------------------------------------------
+void Mesh::SetShaderQuantization(std::shared_ptr<SimpleVertexShader> vs)
+{
+#if MESH_PACKED_VERTICES
+	const VertexQuantization& q = quantization;
+	vs->SetFloat4("positionOffset", XMFLOAT4(q.Offset.x, q.Offset.y, q.Offset.z, 0));
+	vs->SetFloat4("positionScale", XMFLOAT4(q.Scale.x, q.Scale.y, q.Scale.z, 0));
+	vs->SetFloat4("uvOffsetScale", XMFLOAT4(q.UVOffset.x, q.UVOffset.y, q.UVScale.x, q.UVScale.y));
+#endif
+}
+
+
+// --------------------------------------------------------
+// Binds the shared buffers (if they aren't already) and
+// issues a draw call for one level of detail.  Note that
+// this method assumes you're drawing the entire mesh (every
+// submesh, with a single material).
+// 
+// lod - Level of detail to draw (clamped to the lowest one)
+// --------------------------------------------------------
+void Mesh::SetBuffersAndDraw(unsigned int lod)
+{
+	SetBuffers();
+
+	// Draw this mesh (every LOD shares the vertices, so they
+	// all use the same base vertex)
+	const MeshLOD& range = GetLOD(lod);
+	Graphics::Context->DrawIndexed(range.IndexCount, geometry.FirstIndex + range.FirstIndex, geometry.BaseVertex);
+}
+
+
+// --------------------------------------------------------
+// Binds the shared buffers this mesh is drawn from, so any
+// number of its submeshes can then be drawn without
+// touching the input assembler again
+// --------------------------------------------------------
+void Mesh::SetBuffers()
+{
+	GeometryPool::Shared().Bind(geometry.IndexFormat);
+}
+
+
+// --------------------------------------------------------
+// Draws one submesh at one level of detail, from buffers
+// already bound by SetBuffers()
+//
+// submesh - Which submesh to draw
+// lod     - Level of detail to draw (clamped to the lowest one)
+// --------------------------------------------------------
+void Mesh::DrawSubmesh(unsigned int submesh, unsigned int lod)
+{
+	lod = std::min(lod, (unsigned int)lods.size() - 1);
+	const MeshSubmesh& part = submeshes[submesh];
+	if (part.IndexCount[lod] > 0)
+		Graphics::Context->DrawIndexed(part.IndexCount[lod], geometry.FirstIndex + part.FirstIndex[lod], geometry.BaseVertex);
+}
+
+
+// --------------------------------------------------------
+// Draws the mesh with just its positions, for depth-only
+// passes (use PositionInputLayout or PackedPositionInputLayout).
+// Without a position-only stream, the full vertices work
+// too, since positions come first in them.
+// --------------------------------------------------------
+void Mesh::SetPositionBuffersAndDraw(unsigned int lod)
+{
+	GeometryPool::Shared().Bind(geometry.IndexFormat, true);
+
+	const MeshLOD& range = GetLOD(lod);
+	Graphics::Context->DrawIndexed(range.IndexCount, geometry.FirstIndex + range.FirstIndex, geometry.BaseVertex);
+}
+
+
+// --------------------------------------------------------
+// Binds the shared buffers and draws the full detail LOD,
+// but only the meshlets that are inside the frustum and
+// facing the camera.  Meshes without meshlets are simply
+// drawn in full.
+//
+// context - The camera & frustum, in this mesh's object space
+//
+// Returns the number of meshlets drawn
+// --------------------------------------------------------
+unsigned int Mesh::SetBuffersAndDrawVisibleMeshlets(const MeshletCullContext& context)
+{
+	if (meshlets.empty())
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		SetBuffersAndDraw(0);
+		return 0;
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+	SetBuffers();
+	return DrawVisibleMeshlets(meshlets.data(), meshlets.size(), context);
+}
 
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+// --------------------------------------------------------
+// Draws the visible meshlets of one submesh's full detail
+// LOD, from buffers already bound by SetBuffers().  A
+// submesh without meshlets is drawn in full.
+//
+// submesh - Which submesh to draw
+// context - The camera & frustum, in this mesh's object space
+//
+// Returns the number of meshlets drawn
+// --------------------------------------------------------
+unsigned int Mesh::DrawVisibleSubmeshMeshlets(unsigned int submesh, const MeshletCullContext& context)
+{
+	const MeshSubmesh& part = submeshes[submesh];
+	if (part.MeshletCount == 0)
+	{
+		DrawSubmesh(submesh, 0);
+		return 0;
 	}
+
+	return DrawVisibleMeshlets(meshlets.data() + part.FirstMeshlet, part.MeshletCount, context);
 }
 
 
 // --------------------------------------------------------
-// Binds the mesh buffers and issues a draw call.  Note that
-// this method assumes you're drawing the entire mesh.
-// 
-// context - D3D context for issuing rendering calls
+// Helper for drawing the visible meshlets in a range of
+// them.  Neighboring meshlets are contiguous in the index
+// buffer, so each run of visible ones is a single draw.
 // --------------------------------------------------------
-void Mesh::SetBuffersAndDraw()
+unsigned int Mesh::DrawVisibleMeshlets(const Meshlet* meshletArray, size_t numMeshlets, const MeshletCullContext& context)
 {
-	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Draw this mesh
-	Graphics::Context->DrawIndexed(this->numIndices, 0, 0);
+	unsigned int visibleCount = 0;
+	unsigned int runStart = 0;
+	unsigned int runCount = 0;
+	for (size_t i = 0; i < numMeshlets; i++)
+	{
+		const Meshlet& meshlet = meshletArray[i];
+		if (!IsMeshletVisible(meshlet, context))
+			continue;
+
+		visibleCount++;
+		if (runCount > 0 && runStart + runCount == meshlet.FirstIndex)
+		{
+			runCount += meshlet.TriangleCount * 3;
+			continue;
+		}
+
+		if (runCount > 0)
+			Graphics::Context->DrawIndexed(runCount, geometry.FirstIndex + runStart, geometry.BaseVertex);
+		runStart = meshlet.FirstIndex;
+		runCount = meshlet.TriangleCount * 3;
+	}
+
+	if (runCount > 0)
+		Graphics::Context->DrawIndexed(runCount, geometry.FirstIndex + runStart, geometry.BaseVertex);
+
+	return visibleCount;
 }
\ No newline at end of file
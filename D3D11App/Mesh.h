@@ -1,10 +1,22 @@
 #pragma once
 
 #include <d3d11.h>
+#include <DirectXMath.h>
 #include <wrl/client.h>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Vertex.h"
+#include "PackedVertex.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshBounds.h"
+#include "MeshBVH.h"
+#include "Primitives.h"
+#include "GeometryPool.h"
+#include "SimpleShader.h"
 
 
 class Mesh
@@ -12,33 +24,128 @@ class Mesh
 public:
 	Mesh(const char* name, Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices);
 	Mesh(const char* name, const std::wstring& objFile);
+	Mesh(const char* name, PrimitiveShape shape, unsigned int detail, unsigned int lodCount = 1);
+	Mesh(const char* name, const MeshData& data);
 	~Mesh();
+	Mesh(const Mesh&) = delete; // Remove copy constructor (the pool range can only be freed once)
+	Mesh& operator=(const Mesh&) = delete; // Remove copy-assignment operator
 
-	// Getters for mesh data
+	// Getters for mesh data (buffers are shared by every mesh, see GeometryPool)
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetPositionBuffer();
 	const char* GetName();
 	unsigned int GetIndexCount();
 	unsigned int GetVertexCount();
+	float GetLoadTime();
+	bool WasLoadedFromCache();
+	bool WasGenerated();
+	MeshOptimizationStats GetOptimizationStats();
 
-	// Basic mesh drawing
-	void SetBuffersAndDraw();
+	// Buffer formats (packed vertices and/or 16-bit indices), and
+	// the stride of the position-only stream (0 when there isn't one)
+	unsigned int GetVertexStride();
+	unsigned int GetPositionStride();
+	DXGI_FORMAT GetIndexFormat();
+	unsigned int GetBufferBytes();
+
+	// Where this mesh's vertices & indices are in the shared buffers
+	const GeometryRange& GetGeometryRange();
+
+	// How packed positions & UVs map back to their ranges, and the
+	// precision lost by packing (both zero when not packed)
+	const VertexQuantization& GetVertexQuantization();
+	const VertexPackingError& GetPackingError();
+
+	// Gives a vertex shader what it needs to unpack vertices
+	void SetShaderQuantization(std::shared_ptr<SimpleVertexShader> vs);
+
+	// The final (unpacked) geometry, kept on the CPU for batching,
+	// picking, etc.  Indices cover every LOD.
+	const std::vector<Vertex>& GetVertices();
+	const std::vector<unsigned int>& GetIndices();
+
+	// Bounds of the vertices (box & sphere), in object space
+	const Bounds& GetBounds();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+
+	// Hierarchy over the full detail LOD's triangles, for raycasts
+	// in object space (built the first time it's asked for)
+	const MeshBVH& GetBVH();
+
+	// Levels of detail (LOD 0 is the full mesh)
+	unsigned int GetLODCount();
+	const MeshLOD& GetLOD(unsigned int lod);
+
+	// Clusters of the full detail LOD (empty for small meshes)
+	unsigned int GetMeshletCount();
+	const Meshlet* GetMeshlets();
+
+	// Parts of the mesh that each use one material (always at least one)
+	unsigned int GetSubmeshCount();
+	const MeshSubmesh& GetSubmesh(unsigned int submesh);
+	int FindSubmesh(const char* name);
+
+	// Basic mesh drawing, at the given level of detail
+	void SetBuffersAndDraw(unsigned int lod = 0);
+
+	// Drawing submeshes one at a time: set the buffers once, then
+	// draw each submesh (with its own material) from them
+	void SetBuffers();
+	void DrawSubmesh(unsigned int submesh, unsigned int lod = 0);
+	unsigned int DrawVisibleSubmeshMeshlets(unsigned int submesh, const MeshletCullContext& context);
+
+	// Draws with positions only, for depth-only passes
+	void SetPositionBuffersAndDraw(unsigned int lod = 0);
+
+	// Draws only the meshlets that pass culling, returning how many
+	unsigned int SetBuffersAndDrawVisibleMeshlets(const MeshletCullContext& context);
 
 private:
-	// D3D buffers
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
+	// Vertices & indices (across all LODs) in the geometry pool,
+	// and a copy of them on the CPU
+	GeometryRange geometry;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	// How vertices were packed
+	VertexQuantization quantization;
+	VertexPackingError packingError;
+
+	// Index range of each level of detail
+	std::vector<MeshLOD> lods;
+
+	// Clusters of LOD 0, for culling
+	std::vector<Meshlet> meshlets;
 
-	// Total indices & vertices in this mesh
-	unsigned int numIndices;
-	unsigned int numVertices;
+	// Per-material ranges of each LOD & of the meshlets
+	std::vector<MeshSubmesh> submeshes;
+
+	// Object space bounds
+	Bounds bounds;
+
+	// Raycast hierarchy over LOD 0 (empty until first needed)
+	MeshBVH bvh;
+	bool bvhBuilt;
 
 	// Name (mostly for UI purposes)
 	const char* name;
 
+	// How long this mesh took to load (in milliseconds), and from where
+	float loadTime;
+	bool loadedFromCache;
+	bool generated;
+
+	// Vertex cache efficiency before & after load-time optimization
+	MeshOptimizationStats optimizationStats;
+
 	// Helper for creating buffers (in the event we add more constructor overloads)
-	void CreateBuffers(Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices);
-	void CalculateTangents(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices);
+	void CreateBuffers(const Vertex* vertArray, size_t numVerts, const unsigned int* indexArray, size_t numIndices, const MeshLOD* lodArray, size_t numLODs,
+		const Meshlet* meshletArray = 0, size_t numMeshlets = 0, const MeshSubmesh* submeshArray = 0, size_t numSubmeshes = 0);
+
+	// Draws runs of visible meshlets from a range of them
+	unsigned int DrawVisibleMeshlets(const Meshlet* meshletArray, size_t numMeshlets, const MeshletCullContext& context);
 };
 
 
@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+#include "MeshBVH.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Past this many levels, splits just halve the items instead of
+	// following the SAH, so lopsided meshes can't make the tree (and
+	// the traversal stack) arbitrarily deep
+	const unsigned int MaxSAHDepth = 48;
+	const int TraversalStackSize = 256;
+
+	float Component(FXMVECTOR v, int axis)
+	{
+		return axis == 0 ? XMVectorGetX(v) : axis == 1 ? XMVectorGetY(v) : XMVectorGetZ(v);
+	}
+
+	// Which SAH bin a centroid falls in, given the lowest centroid
+	// and bins per unit.  Written so that centroids that aren't
+	// finite (from a damaged file) still land in a real bin.
+	int GetBin(float centroid, float low, float scale)
+	{
+		float bin = (centroid - low) * scale;
+		if (!(bin > 0.0f))
+			return 0;
+		return bin < BVH_SAH_BINS - 1 ? (int)bin : BVH_SAH_BINS - 1;
+	}
+
+	// Half the surface area of a box, which is all the SAH needs
+	float HalfArea(FXMVECTOR min, FXMVECTOR max)
+	{
+		XMFLOAT3 size;
+		XMStoreFloat3(&size, XMVectorMax(XMVectorSubtract(max, min), XMVectorZero()));
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	// --------------------------------------------------------
+	// Builds the hierarchy top down: each node splits its items
+	// in two, then splits the larger half (or both) again, for
+	// up to four children
+	// --------------------------------------------------------
+	struct BVHBuilder
+	{
+		const Bounds* ItemBounds;
+		std::vector<XMFLOAT3> Centroids;
+		unsigned int MaxLeafItems;
+		std::vector<BVHNode>& Nodes;
+		std::vector<BVHLeaf>& Leaves;
+		std::vector<unsigned int>& Order;
+
+		void RangeBounds(unsigned int first, unsigned int count, XMVECTOR& min, XMVECTOR& max)
+		{
+			min = XMVectorReplicate(FLT_MAX);
+			max = XMVectorReplicate(-FLT_MAX);
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				min = XMVectorMin(min, XMLoadFloat3(&ItemBounds[Order[i]].Min));
+				max = XMVectorMax(max, XMLoadFloat3(&ItemBounds[Order[i]].Max));
+			}
+		}
+
+		// --------------------------------------------------------
+		// Reorders a range of items into two halves, returning
+		// how many are in the first.  Item centroids are binned
+		// along each axis, and the split between bins with the
+		// lowest SAH cost (area times items, on each side) wins.
+		// --------------------------------------------------------
+		unsigned int Split(unsigned int first, unsigned int count, unsigned int depth)
+		{
+			XMVECTOR centroidMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR centroidMax = XMVectorReplicate(-FLT_MAX);
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				centroidMin = XMVectorMin(centroidMin, XMLoadFloat3(&Centroids[Order[i]]));
+				centroidMax = XMVectorMax(centroidMax, XMLoadFloat3(&Centroids[Order[i]]));
+			}
+
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			int bestSplit = 0;
+			for (int axis = 0; axis < 3 && depth < MaxSAHDepth; axis++)
+			{
+				float low = Component(centroidMin, axis);
+				float extent = Component(centroidMax, axis) - low;
+				if (extent <= 0.0f)
+					continue;
+
+				XMVECTOR binMin[BVH_SAH_BINS];
+				XMVECTOR binMax[BVH_SAH_BINS];
+				unsigned int binCount[BVH_SAH_BINS] = {};
+				for (int b = 0; b < BVH_SAH_BINS; b++)
+				{
+					binMin[b] = XMVectorReplicate(FLT_MAX);
+					binMax[b] = XMVectorReplicate(-FLT_MAX);
+				}
+
+				float scale = BVH_SAH_BINS / extent;
+				for (unsigned int i = first; i < first + count; i++)
+				{
+					unsigned int item = Order[i];
+					int b = GetBin(Component(XMLoadFloat3(&Centroids[item]), axis), low, scale);
+					binMin[b] = XMVectorMin(binMin[b], XMLoadFloat3(&ItemBounds[item].Min));
+					binMax[b] = XMVectorMax(binMax[b], XMLoadFloat3(&ItemBounds[item].Max));
+					binCount[b]++;
+				}
+
+				// Costs of everything right of each split, then sweep from the left
+				float rightCost[BVH_SAH_BINS] = {};
+				unsigned int rightCount[BVH_SAH_BINS] = {};
+				XMVECTOR min = XMVectorReplicate(FLT_MAX);
+				XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+				unsigned int items = 0;
+				for (int b = BVH_SAH_BINS - 1; b > 0; b--)
+				{
+					min = XMVectorMin(min, binMin[b]);
+					max = XMVectorMax(max, binMax[b]);
+					items += binCount[b];
+					rightCount[b] = items;
+					rightCost[b] = items > 0 ? HalfArea(min, max) * items : 0.0f;
+				}
+
+				min = XMVectorReplicate(FLT_MAX);
+				max = XMVectorReplicate(-FLT_MAX);
+				items = 0;
+				for (int b = 0; b < BVH_SAH_BINS - 1; b++)
+				{
+					min = XMVectorMin(min, binMin[b]);
+					max = XMVectorMax(max, binMax[b]);
+					items += binCount[b];
+					if (items == 0 || rightCount[b + 1] == 0)
+						continue;
+
+					float cost = HalfArea(min, max) * items + rightCost[b + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = b;
+					}
+				}
+			}
+
+			// Nothing to split by (every centroid in the same place), or
+			// too deep: an even split by count
+			if (bestAxis < 0)
+				return count / 2;
+
+			float low = Component(centroidMin, bestAxis);
+			float scale = BVH_SAH_BINS / (Component(centroidMax, bestAxis) - low);
+			auto middle = std::partition(Order.begin() + first, Order.begin() + first + count, [&](unsigned int item)
+				{
+					int b = GetBin(Component(XMLoadFloat3(&Centroids[item]), bestAxis), low, scale);
+					return b <= bestSplit;
+				});
+			return (unsigned int)(middle - (Order.begin() + first));
+		}
+
+		// Creates the node over a range of items (and everything under it), returning its index
+		unsigned int BuildNode(unsigned int first, unsigned int count, unsigned int depth)
+		{
+			struct Range { unsigned int First; unsigned int Count; float Area; XMVECTOR Min; XMVECTOR Max; };
+			Range ranges[4];
+			unsigned int rangeCount = 1;
+			ranges[0].First = first;
+			ranges[0].Count = count;
+			RangeBounds(first, count, ranges[0].Min, ranges[0].Max);
+			ranges[0].Area = HalfArea(ranges[0].Min, ranges[0].Max);
+
+			// Keep splitting the largest range that's too big for a leaf
+			while (rangeCount < 4)
+			{
+				int largest = -1;
+				for (unsigned int r = 0; r < rangeCount; r++)
+					if (ranges[r].Count > MaxLeafItems && (largest < 0 || ranges[r].Area > ranges[largest].Area))
+						largest = r;
+				if (largest < 0)
+					break;
+
+				Range& range = ranges[largest];
+				unsigned int leftCount = Split(range.First, range.Count, depth);
+				Range& right = ranges[rangeCount++];
+				right.First = range.First + leftCount;
+				right.Count = range.Count - leftCount;
+				range.Count = leftCount;
+				RangeBounds(range.First, range.Count, range.Min, range.Max);
+				RangeBounds(right.First, right.Count, right.Min, right.Max);
+				range.Area = HalfArea(range.Min, range.Max);
+				right.Area = HalfArea(right.Min, right.Max);
+			}
+
+			unsigned int nodeIndex = (unsigned int)Nodes.size();
+			Nodes.emplace_back();
+
+			XMFLOAT4 minX(0, 0, 0, 0), minY(0, 0, 0, 0), minZ(0, 0, 0, 0);
+			XMFLOAT4 maxX(0, 0, 0, 0), maxY(0, 0, 0, 0), maxZ(0, 0, 0, 0);
+			float* lanes[6] = { &minX.x, &minY.x, &minZ.x, &maxX.x, &maxY.x, &maxZ.x };
+			unsigned int children[4] = { BVH_EMPTY_CHILD, BVH_EMPTY_CHILD, BVH_EMPTY_CHILD, BVH_EMPTY_CHILD };
+			for (unsigned int r = 0; r < rangeCount; r++)
+			{
+				XMFLOAT3 min, max;
+				XMStoreFloat3(&min, ranges[r].Min);
+				XMStoreFloat3(&max, ranges[r].Max);
+				float values[6] = { min.x, min.y, min.z, max.x, max.y, max.z };
+				for (int c = 0; c < 6; c++)
+					lanes[c][r] = values[c];
+
+				if (ranges[r].Count <= MaxLeafItems)
+				{
+					children[r] = BVH_LEAF_FLAG | (unsigned int)Leaves.size();
+					Leaves.push_back({ ranges[r].First, ranges[r].Count });
+				}
+				else
+				{
+					children[r] = BuildNode(ranges[r].First, ranges[r].Count, depth + 1);
+				}
+			}
+
+			BVHNode& node = Nodes[nodeIndex];
+			node.MinX = minX; node.MinY = minY; node.MinZ = minZ;
+			node.MaxX = maxX; node.MaxY = maxY; node.MaxZ = maxZ;
+			std::copy(children, children + 4, node.Children);
+			return nodeIndex;
+		}
+	};
+
+	// A ray replicated across lanes, for testing triangle packets
+	struct PacketRay
+	{
+		XMVECTOR OriginX, OriginY, OriginZ;
+		XMVECTOR DirectionX, DirectionY, DirectionZ;
+	};
+
+	// --------------------------------------------------------
+	// Moller-Trumbore against four triangles at once (from
+	// either side).  Returns the slot of the closest hit nearer
+	// than closest, updating it and the barycentrics, or -1.
+	// --------------------------------------------------------
+	int IntersectPacket(const BVHTrianglePacket& packet, const PacketRay& ray, float& closest, float& u, float& v)
+	{
+		XMVECTOR e1x = XMLoadFloat4(&packet.Edge1X), e1y = XMLoadFloat4(&packet.Edge1Y), e1z = XMLoadFloat4(&packet.Edge1Z);
+		XMVECTOR e2x = XMLoadFloat4(&packet.Edge2X), e2y = XMLoadFloat4(&packet.Edge2Y), e2z = XMLoadFloat4(&packet.Edge2Z);
+
+		// p = direction x edge2, determinant = edge1 . p
+		XMVECTOR px = XMVectorSubtract(XMVectorMultiply(ray.DirectionY, e2z), XMVectorMultiply(ray.DirectionZ, e2y));
+		XMVECTOR py = XMVectorSubtract(XMVectorMultiply(ray.DirectionZ, e2x), XMVectorMultiply(ray.DirectionX, e2z));
+		XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(ray.DirectionX, e2y), XMVectorMultiply(ray.DirectionY, e2x));
+		XMVECTOR det = XMVectorAdd(XMVectorAdd(XMVectorMultiply(e1x, px), XMVectorMultiply(e1y, py)), XMVectorMultiply(e1z, pz));
+		XMVECTOR invDet = XMVectorDivide(XMVectorSplatOne(), det);
+
+		// s = origin - v0, q = s x edge1
+		XMVECTOR sx = XMVectorSubtract(ray.OriginX, XMLoadFloat4(&packet.V0X));
+		XMVECTOR sy = XMVectorSubtract(ray.OriginY, XMLoadFloat4(&packet.V0Y));
+		XMVECTOR sz = XMVectorSubtract(ray.OriginZ, XMLoadFloat4(&packet.V0Z));
+		XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, e1z), XMVectorMultiply(sz, e1y));
+		XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, e1x), XMVectorMultiply(sx, e1z));
+		XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, e1y), XMVectorMultiply(sy, e1x));
+
+		XMVECTOR hitU = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(sx, px), XMVectorMultiply(sy, py)), XMVectorMultiply(sz, pz)), invDet);
+		XMVECTOR hitV = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(ray.DirectionX, qx), XMVectorMultiply(ray.DirectionY, qy)), XMVectorMultiply(ray.DirectionZ, qz)), invDet);
+		XMVECTOR hitT = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(e2x, qx), XMVectorMultiply(e2y, qy)), XMVectorMultiply(e2z, qz)), invDet);
+
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(FLT_MIN));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(hitU, zero));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(hitV, zero));
+		valid = XMVectorAndInt(valid, XMVectorLessOrEqual(XMVectorAdd(hitU, hitV), XMVectorSplatOne()));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(hitT, zero));
+		valid = XMVectorAndInt(valid, XMVectorLess(hitT, XMVectorReplicate(closest)));
+		if (XMVector4EqualInt(valid, XMVectorFalseInt()))
+			return -1;
+
+		uint32_t mask[4];
+		XMFLOAT4 t, us, vs;
+		XMStoreInt4(mask, valid);
+		XMStoreFloat4(&t, hitT);
+		XMStoreFloat4(&us, hitU);
+		XMStoreFloat4(&vs, hitV);
+		const float* ts = &t.x;
+
+		int lane = -1;
+		for (int i = 0; i < 4; i++)
+		{
+			if (mask[i] && ts[i] < closest)
+			{
+				closest = ts[i];
+				lane = i;
+			}
+		}
+		if (lane < 0)
+			return -1;
+
+		u = (&us.x)[lane];
+		v = (&vs.x)[lane];
+		return lane;
+	}
+}
+
+
+// --------------------------------------------------------
+// Builds a 4-wide BVH over item boxes.  Leaves hold up to
+// maxLeafItems items; node children that are leaves are
+// BVH_LEAF_FLAG plus the leaf's index.  Nothing is built
+// when there are no items.
+// --------------------------------------------------------
+void BuildBVH(const Bounds* itemBounds, size_t count, unsigned int maxLeafItems,
+	std::vector<BVHNode>& nodes, std::vector<BVHLeaf>& leaves, std::vector<unsigned int>& order)
+{
+	nodes.clear();
+	leaves.clear();
+	order.resize(count);
+	if (count == 0)
+		return;
+
+	BVHBuilder builder = { itemBounds, std::vector<XMFLOAT3>(count), std::max(maxLeafItems, 1u), nodes, leaves, order };
+	for (size_t i = 0; i < count; i++)
+	{
+		order[i] = (unsigned int)i;
+		XMStoreFloat3(&builder.Centroids[i], XMVectorScale(XMVectorAdd(XMLoadFloat3(&itemBounds[i].Min), XMLoadFloat3(&itemBounds[i].Max)), 0.5f));
+	}
+
+	nodes.reserve(count / 2 + 1);
+	builder.BuildNode(0, (unsigned int)count, 0);
+}
+
+
+// --------------------------------------------------------
+// Replicates the ray's origin and reciprocal direction across
+// lanes.  Zero direction components are nudged, so the box
+// slabs along them give infinities rather than NaNs.
+// --------------------------------------------------------
+BVHRay PrepareBVHRay(const Ray& ray)
+{
+	auto inverse = [](float d) { return 1.0f / (fabsf(d) > 1e-20f ? d : copysignf(1e-20f, d)); };
+
+	BVHRay prepared;
+	prepared.OriginX = XMVectorReplicate(ray.Origin.x);
+	prepared.OriginY = XMVectorReplicate(ray.Origin.y);
+	prepared.OriginZ = XMVectorReplicate(ray.Origin.z);
+	prepared.InvDirectionX = XMVectorReplicate(inverse(ray.Direction.x));
+	prepared.InvDirectionY = XMVectorReplicate(inverse(ray.Direction.y));
+	prepared.InvDirectionZ = XMVectorReplicate(inverse(ray.Direction.z));
+	return prepared;
+}
+
+
+// --------------------------------------------------------
+// Slab test of the ray against all four child boxes at once
+// --------------------------------------------------------
+unsigned int IntersectBVHNode(const BVHNode& node, const BVHRay& ray, float maxDistance, unsigned int* children)
+{
+	XMVECTOR t1x = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MinX), ray.OriginX), ray.InvDirectionX);
+	XMVECTOR t2x = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MaxX), ray.OriginX), ray.InvDirectionX);
+	XMVECTOR t1y = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MinY), ray.OriginY), ray.InvDirectionY);
+	XMVECTOR t2y = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MaxY), ray.OriginY), ray.InvDirectionY);
+	XMVECTOR t1z = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MinZ), ray.OriginZ), ray.InvDirectionZ);
+	XMVECTOR t2z = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&node.MaxZ), ray.OriginZ), ray.InvDirectionZ);
+
+	XMVECTOR tNear = XMVectorMax(
+		XMVectorMax(XMVectorMin(t1x, t2x), XMVectorMin(t1y, t2y)),
+		XMVectorMax(XMVectorMin(t1z, t2z), XMVectorZero()));
+	XMVECTOR tFar = XMVectorMin(
+		XMVectorMin(XMVectorMax(t1x, t2x), XMVectorMax(t1y, t2y)),
+		XMVectorMin(XMVectorMax(t1z, t2z), XMVectorReplicate(maxDistance)));
+
+	XMVECTOR entered = XMVectorLessOrEqual(tNear, tFar);
+	if (XMVector4EqualInt(entered, XMVectorFalseInt()))
+		return 0;
+
+	uint32_t mask[4];
+	XMFLOAT4 nearest;
+	XMStoreInt4(mask, entered);
+	XMStoreFloat4(&nearest, tNear);
+	const float* distances = &nearest.x;
+
+	// Farthest first, so the nearest child comes off the stack next
+	unsigned int count = 0;
+	float childDistances[4];
+	for (int i = 0; i < 4; i++)
+	{
+		if (!mask[i] || node.Children[i] == BVH_EMPTY_CHILD)
+			continue;
+
+		unsigned int slot = count++;
+		while (slot > 0 && childDistances[slot - 1] < distances[i])
+		{
+			children[slot] = children[slot - 1];
+			childDistances[slot] = childDistances[slot - 1];
+			slot--;
+		}
+		children[slot] = node.Children[i];
+		childDistances[slot] = distances[i];
+	}
+	return count;
+}
+
+
+// --------------------------------------------------------
+// Tests the ray against every triangle, one at a time, with
+// the same rules as the BVH (both sides count, and hits
+// must be closer than the ray's max distance)
+// --------------------------------------------------------
+bool RaycastTriangles(const Vertex* verts, const unsigned int* indices, size_t numIndices, const Ray& ray, RayHit& hit)
+{
+	XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+	XMVECTOR direction = XMLoadFloat3(&ray.Direction);
+	float closest = ray.MaxDistance;
+	bool found = false;
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&verts[indices[i]].Position);
+		XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&verts[indices[i + 1]].Position), v0);
+		XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&verts[indices[i + 2]].Position), v0);
+
+		XMVECTOR p = XMVector3Cross(direction, edge2);
+		float det = XMVectorGetX(XMVector3Dot(edge1, p));
+		if (fabsf(det) <= FLT_MIN)
+			continue;
+		float invDet = 1.0f / det;
+
+		XMVECTOR s = XMVectorSubtract(origin, v0);
+		float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+		XMVECTOR q = XMVector3Cross(s, edge1);
+		float v = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+		float t = XMVectorGetX(XMVector3Dot(edge2, q)) * invDet;
+		if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f || t >= closest)
+			continue;
+
+		closest = t;
+		hit = { t, (unsigned int)(i / 3), u, v };
+		found = true;
+	}
+	return found;
+}
+
+
+// --------------------------------------------------------
+// MeshBVH
+// --------------------------------------------------------
+MeshBVH::MeshBVH() :
+	bounds{},
+	triangleCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Builds the hierarchy, then copies each leaf's triangles
+// into a packet (as a corner and two edges, which is what
+// the intersection test wants)
+// --------------------------------------------------------
+void MeshBVH::Build(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	triangleCount = (unsigned int)(numIndices / 3);
+	std::vector<Bounds> triangleBounds(triangleCount);
+	XMVECTOR meshMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR meshMax = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR min = XMVectorReplicate(FLT_MAX);
+		XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int index = indices[t * 3 + c];
+			if (index >= numVerts)
+				throw std::invalid_argument("BVH triangle index out of range");
+			min = XMVectorMin(min, XMLoadFloat3(&verts[index].Position));
+			max = XMVectorMax(max, XMLoadFloat3(&verts[index].Position));
+		}
+		XMStoreFloat3(&triangleBounds[t].Min, min);
+		XMStoreFloat3(&triangleBounds[t].Max, max);
+		meshMin = XMVectorMin(meshMin, min);
+		meshMax = XMVectorMax(meshMax, max);
+	}
+
+	bounds = {};
+	if (triangleCount > 0)
+	{
+		XMStoreFloat3(&bounds.Min, meshMin);
+		XMStoreFloat3(&bounds.Max, meshMax);
+		XMStoreFloat3(&bounds.Center, XMVectorScale(XMVectorAdd(meshMin, meshMax), 0.5f));
+		bounds.Radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(meshMax, meshMin)));
+	}
+
+	std::vector<BVHLeaf> leaves;
+	std::vector<unsigned int> order;
+	BuildBVH(triangleBounds.data(), triangleCount, BVH_MAX_LEAF_TRIANGLES, nodes, leaves, order);
+
+	// Leaf i becomes packet i, so node children need no remapping
+	packets.assign(leaves.size(), BVHTrianglePacket{});
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		BVHTrianglePacket& packet = packets[i];
+		float* lanes[9] = { &packet.V0X.x, &packet.V0Y.x, &packet.V0Z.x, &packet.Edge1X.x, &packet.Edge1Y.x, &packet.Edge1Z.x, &packet.Edge2X.x, &packet.Edge2Y.x, &packet.Edge2Z.x };
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			packet.Triangles[j] = BVH_EMPTY_CHILD;
+			if (j >= leaves[i].Count)
+				continue;
+
+			unsigned int t = order[leaves[i].First + j];
+			const XMFLOAT3& v0 = verts[indices[t * 3]].Position;
+			const XMFLOAT3& v1 = verts[indices[t * 3 + 1]].Position;
+			const XMFLOAT3& v2 = verts[indices[t * 3 + 2]].Position;
+			float values[9] = { v0.x, v0.y, v0.z, v1.x - v0.x, v1.y - v0.y, v1.z - v0.z, v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+			for (int c = 0; c < 9; c++)
+				lanes[c][j] = values[c];
+			packet.Triangles[j] = t;
+		}
+	}
+}
+
+bool MeshBVH::Raycast(const Ray& ray, RayHit& hit) const { return Traverse(ray, hit, false); }
+
+bool MeshBVH::IsOccluded(const Ray& ray) const
+{
+	RayHit hit;
+	return Traverse(ray, hit, true);
+}
+
+const Bounds& MeshBVH::GetBounds() const { return bounds; }
+unsigned int MeshBVH::GetNodeCount() const { return (unsigned int)nodes.size(); }
+unsigned int MeshBVH::GetTriangleCount() const { return triangleCount; }
+
+// --------------------------------------------------------
+// Walks the tree with a stack, nearest children first, so
+// hits found early shrink the distance later boxes are
+// tested against
+// --------------------------------------------------------
+bool MeshBVH::Traverse(const Ray& ray, RayHit& hit, bool anyHit) const
+{
+	if (nodes.empty())
+		return false;
+
+	BVHRay nodeRay = PrepareBVHRay(ray);
+	PacketRay packetRay = {
+		nodeRay.OriginX, nodeRay.OriginY, nodeRay.OriginZ,
+		XMVectorReplicate(ray.Direction.x), XMVectorReplicate(ray.Direction.y), XMVectorReplicate(ray.Direction.z) };
+
+	float closest = ray.MaxDistance;
+	bool found = false;
+	unsigned int stack[TraversalStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		unsigned int child = stack[--top];
+		if (child & BVH_LEAF_FLAG)
+		{
+			const BVHTrianglePacket& packet = packets[child & ~BVH_LEAF_FLAG];
+			float u, v;
+			int lane = IntersectPacket(packet, packetRay, closest, u, v);
+			if (lane >= 0)
+			{
+				hit = { closest, packet.Triangles[lane], u, v };
+				found = true;
+				if (anyHit)
+					return true;
+			}
+			continue;
+		}
+
+		top += IntersectBVHNode(nodes[child], nodeRay, closest, stack + top);
+	}
+	return found;
+}
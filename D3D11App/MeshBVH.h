@@ -0,0 +1,129 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "MeshData.h"
+#include "MeshBounds.h"
+
+// Most items (triangles, instances, etc.) in a leaf.  Mesh leaves
+// are tested as one packet of triangles, so this can't be above 4.
+#define BVH_MAX_LEAF_TRIANGLES 4
+
+// Buckets each axis is split into when looking for the cheapest split
+#define BVH_SAH_BINS 16
+
+// Children of a node that are leaves have this bit set (the rest
+// is the leaf's index), and missing children are all ones
+#define BVH_LEAF_FLAG 0x80000000
+#define BVH_EMPTY_CHILD 0xFFFFFFFF
+
+// --------------------------------------------------------
+// A ray, for picking and line of sight checks.  Distances
+// are in multiples of the direction, so a unit length
+// direction gives distances in world units.
+// --------------------------------------------------------
+struct Ray
+{
+	DirectX::XMFLOAT3 Origin;
+	DirectX::XMFLOAT3 Direction;
+	float MaxDistance;
+};
+
+// Where a ray hit a mesh: the triangle (counting from the start of
+// the indices the BVH was built from) and the barycentric
+// coordinates of the hit on it
+struct RayHit
+{
+	float Distance;
+	unsigned int Triangle;
+	float U;
+	float V;
+};
+
+// --------------------------------------------------------
+// A node of a 4-wide bounding volume hierarchy.  Children's
+// boxes are stored one component at a time, so a ray can be
+// tested against all four of them at once.
+// --------------------------------------------------------
+struct BVHNode
+{
+	DirectX::XMFLOAT4 MinX, MinY, MinZ;
+	DirectX::XMFLOAT4 MaxX, MaxY, MaxZ;
+	unsigned int Children[4];
+};
+
+// A range of the items, in the order the build put them in
+struct BVHLeaf
+{
+	unsigned int First;
+	unsigned int Count;
+};
+
+// A ray, set up for testing against nodes
+struct BVHRay
+{
+	DirectX::XMVECTOR OriginX, OriginY, OriginZ;
+	DirectX::XMVECTOR InvDirectionX, InvDirectionY, InvDirectionZ;
+};
+
+// --------------------------------------------------------
+// Up to four triangles, a component at a time, for testing
+// a ray against all of them at once.  Unused slots are
+// degenerate (which no ray hits) and have no triangle.
+// --------------------------------------------------------
+struct BVHTrianglePacket
+{
+	DirectX::XMFLOAT4 V0X, V0Y, V0Z;
+	DirectX::XMFLOAT4 Edge1X, Edge1Y, Edge1Z;
+	DirectX::XMFLOAT4 Edge2X, Edge2Y, Edge2Z;
+	unsigned int Triangles[4];
+};
+
+// Builds a 4-wide hierarchy over the boxes of some items, binning
+// with the surface area heuristic (SAH).  The items end up in
+// leaves, as ranges of the order array; node 0 is the root.
+void BuildBVH(const Bounds* itemBounds, size_t count, unsigned int maxLeafItems,
+	std::vector<BVHNode>& nodes, std::vector<BVHLeaf>& leaves, std::vector<unsigned int>& order);
+
+// Sets up a ray for IntersectBVHNode()
+BVHRay PrepareBVHRay(const Ray& ray);
+
+// Writes the children whose boxes the ray enters before maxDistance,
+// nearest last (ready to be pushed on a stack), returning how many
+unsigned int IntersectBVHNode(const BVHNode& node, const BVHRay& ray, float maxDistance, unsigned int* children);
+
+// Closest hit by testing every triangle (slow, but simple)
+bool RaycastTriangles(const Vertex* verts, const unsigned int* indices, size_t numIndices, const Ray& ray, RayHit& hit);
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, for
+// raycasts in its object space
+// --------------------------------------------------------
+class MeshBVH
+{
+public:
+	MeshBVH();
+
+	// Builds over the triangles of some indices (like one LOD)
+	void Build(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices);
+
+	// Closest hit within the ray's max distance
+	bool Raycast(const Ray& ray, RayHit& hit) const;
+
+	// Is there any hit within the ray's max distance?  (Stops at the
+	// first one found, so it's quicker than Raycast() for line of sight.)
+	bool IsOccluded(const Ray& ray) const;
+
+	const Bounds& GetBounds() const;
+	unsigned int GetNodeCount() const;
+	unsigned int GetTriangleCount() const;
+
+private:
+	std::vector<BVHNode> nodes;
+	std::vector<BVHTrianglePacket> packets;
+	Bounds bounds;
+	unsigned int triangleCount;
+
+	bool Traverse(const Ray& ray, RayHit& hit, bool anyHit) const;
+};
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "MeshBounds.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Bounding sphere of a set of vertices (Ritter, 1990): start
+// with the most separated pair of extreme points along the
+// axes, then grow the sphere to include any outliers
+//
+// verts       - The vertices
+// vertIndices - Which vertices to bound (null for the first count)
+// count       - How many vertices to bound (must be at least one)
+// center      - Receives the center of the sphere
+// radius      - Receives the radius of the sphere
+// --------------------------------------------------------
+void ComputeBoundingSphere(const Vertex* verts, const unsigned int* vertIndices, size_t count, XMFLOAT3& center, float& radius)
+{
+	auto vertIndex = [vertIndices](size_t i) { return vertIndices ? vertIndices[i] : (unsigned int)i; };
+
+	unsigned int minIndex[3] = { vertIndex(0), vertIndex(0), vertIndex(0) };
+	unsigned int maxIndex[3] = { vertIndex(0), vertIndex(0), vertIndex(0) };
+	for (size_t i = 1; i < count; i++)
+	{
+		const XMFLOAT3& p = verts[vertIndex(i)].Position;
+		const float values[3] = { p.x, p.y, p.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const XMFLOAT3& pMin = verts[minIndex[axis]].Position;
+			const XMFLOAT3& pMax = verts[maxIndex[axis]].Position;
+			if (values[axis] < (&pMin.x)[axis]) minIndex[axis] = vertIndex(i);
+			if (values[axis] > (&pMax.x)[axis]) maxIndex[axis] = vertIndex(i);
+		}
+	}
+
+	XMVECTOR a = XMVectorZero();
+	XMVECTOR b = XMVectorZero();
+	float widest = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		XMVECTOR pMin = XMLoadFloat3(&verts[minIndex[axis]].Position);
+		XMVECTOR pMax = XMLoadFloat3(&verts[maxIndex[axis]].Position);
+		float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(pMax, pMin)));
+		if (distance > widest)
+		{
+			widest = distance;
+			a = pMin;
+			b = pMax;
+		}
+	}
+
+	XMVECTOR c = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+	float r = 0.5f * sqrtf(widest);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[vertIndex(i)].Position);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, c)));
+		if (distance > r)
+		{
+			float newRadius = 0.5f * (r + distance);
+			c = XMVectorAdd(c, XMVectorScale(XMVectorSubtract(p, c), (newRadius - r) / distance));
+			r = newRadius;
+		}
+	}
+
+	XMStoreFloat3(&center, c);
+	radius = r;
+}
+
+
+// --------------------------------------------------------
+// Computes the axis-aligned box and a bounding sphere of a
+// set of vertices.  The sphere is whichever is smaller of
+// Ritter's sphere and the (exact) sphere around the box's
+// center, since Ritter's can be loose on boxy meshes.
+// --------------------------------------------------------
+Bounds ComputeBounds(const Vertex* verts, size_t numVerts)
+{
+	Bounds bounds = {};
+	if (numVerts == 0)
+		return bounds;
+
+	XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		minPos = XMVectorMin(minPos, pos);
+		maxPos = XMVectorMax(maxPos, pos);
+	}
+	XMStoreFloat3(&bounds.Min, minPos);
+	XMStoreFloat3(&bounds.Max, maxPos);
+
+	// Farthest vertex from the center of the box
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f);
+	float boxRadiusSq = 0.0f;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&verts[i].Position), boxCenter);
+		boxRadiusSq = std::max(boxRadiusSq, XMVectorGetX(XMVector3LengthSq(offset)));
+	}
+
+	ComputeBoundingSphere(verts, 0, numVerts, bounds.Center, bounds.Radius);
+	if (sqrtf(boxRadiusSq) < bounds.Radius)
+	{
+		XMStoreFloat3(&bounds.Center, boxCenter);
+		bounds.Radius = sqrtf(boxRadiusSq);
+	}
+	return bounds;
+}
+
+
+// --------------------------------------------------------
+// Transforms bounds by a world matrix, without touching the
+// vertices they came from:
+//  - Box: The center is transformed, and each new half
+//    extent is the sum of the old ones, weighted by the
+//    absolute values of the matrix (Arvo, 1990).  This is
+//    the tightest box around the transformed box.
+//  - Sphere: The center is transformed, and the radius
+//    grows by the largest scale along any axis.
+// --------------------------------------------------------
+Bounds TransformBounds(const Bounds& bounds, const XMFLOAT4X4& world)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMVECTOR minPos = XMLoadFloat3(&bounds.Min);
+	XMVECTOR maxPos = XMLoadFloat3(&bounds.Max);
+	XMVECTOR center = XMVector3Transform(XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f), worldMatrix);
+	XMVECTOR extents = XMVectorScale(XMVectorSubtract(maxPos, minPos), 0.5f);
+
+	XMVECTOR newExtents = XMVectorAdd(XMVectorAdd(
+		XMVectorMultiply(XMVectorAbs(worldMatrix.r[0]), XMVectorSplatX(extents)),
+		XMVectorMultiply(XMVectorAbs(worldMatrix.r[1]), XMVectorSplatY(extents))),
+		XMVectorMultiply(XMVectorAbs(worldMatrix.r[2]), XMVectorSplatZ(extents)));
+
+	float scale = sqrtf(std::max(
+		XMVectorGetX(XMVector3LengthSq(worldMatrix.r[0])), std::max(
+		XMVectorGetX(XMVector3LengthSq(worldMatrix.r[1])),
+		XMVectorGetX(XMVector3LengthSq(worldMatrix.r[2])))));
+
+	Bounds transformed;
+	XMStoreFloat3(&transformed.Min, XMVectorSubtract(center, newExtents));
+	XMStoreFloat3(&transformed.Max, XMVectorAdd(center, newExtents));
+	XMStoreFloat3(&transformed.Center, XMVector3Transform(XMLoadFloat3(&bounds.Center), worldMatrix));
+	transformed.Radius = bounds.Radius * scale;
+	return transformed;
+}
+
+Bounds TransformBounds(const Bounds& bounds, std::shared_ptr<Transform> transform)
+{
+	return TransformBounds(bounds, transform->GetWorldMatrix());
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+
+#include "Vertex.h"
+#include "Transform.h"
+
+// --------------------------------------------------------
+// Bounding volumes of a mesh, in one space or another
+//  - Min/Max: Axis-aligned box
+//  - Center/Radius: Sphere (usually tighter than the
+//    sphere around the box)
+// --------------------------------------------------------
+struct Bounds
+{
+	DirectX::XMFLOAT3 Min;
+	DirectX::XMFLOAT3 Max;
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+};
+
+// Bounding sphere (Ritter) of some of the vertices, or of
+// all of them when vertIndices is null
+void ComputeBoundingSphere(const Vertex* verts, const unsigned int* vertIndices, size_t count, DirectX::XMFLOAT3& center, float& radius);
+
+// Tight box & sphere around the vertices (all zero when there are none)
+Bounds ComputeBounds(const Vertex* verts, size_t numVerts);
+
+// Bounds of the transformed volumes, from the bounds alone (no vertices)
+Bounds TransformBounds(const Bounds& bounds, const DirectX::XMFLOAT4X4& world);
+Bounds TransformBounds(const Bounds& bounds, std::shared_ptr<Transform> transform);
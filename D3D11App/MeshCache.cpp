@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MeshCodec.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Vertex & index data is padded so the arrays after it stay aligned
+	size_t PaddedSize(size_t bytes)
+	{
+		return (bytes + 3) & ~(size_t)3;
+	}
+}
+
+// --------------------------------------------------------
+// Maps the given cache file.  Use IsValid() to determine
+// whether its contents can actually be used.
+// --------------------------------------------------------
+MeshCacheFile::MeshCacheFile(const std::wstring& cacheFile) :
+	file(cacheFile)
+{
+}
+
+// --------------------------------------------------------
+// Verifies the header and overall size of the file, that it
+// was built from a source file with the given size & hash,
+// and that every LOD, meshlet and submesh range in it is in
+// bounds.  These are cheap enough for every load; checking
+// each vertex & index (see HasValidContents()) isn't, so
+// that only happens here in debug builds.
+// --------------------------------------------------------
+bool MeshCacheFile::IsValid(unsigned long long sourceSize, unsigned long long sourceHash)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	const MeshCacheHeader* header = GetHeader();
+	if (memcmp(header->Magic, "MBIN", 4) != 0 ||
+		header->Version != MESH_CACHE_VERSION ||
+		header->VertexStride != sizeof(Vertex) ||
+		header->SourceSize != sourceSize ||
+		header->SourceHash != sourceHash ||
+		header->LODCount == 0 ||
+		header->LODCount > MESH_MAX_LODS ||
+		header->SubmeshCount == 0)
+		return false;
+
+	for (unsigned int i = 0; i < header->LODCount; i++)
+		if ((size_t)header->LODs[i].FirstIndex + header->LODs[i].IndexCount > header->IndexCount)
+			return false;
+
+	// Uncompressed arrays have exactly one size
+	if (!header->Compressed &&
+		(header->VertexBytes != sizeof(Vertex) * (size_t)header->VertexCount ||
+		 header->IndexBytes != sizeof(unsigned int) * (size_t)header->IndexCount))
+		return false;
+
+	// Guard against truncated files
+	size_t expectedSize =
+		sizeof(MeshCacheHeader) +
+		PaddedSize(header->VertexBytes) +
+		PaddedSize(header->IndexBytes) +
+		sizeof(Meshlet) * (size_t)header->MeshletCount +
+		sizeof(MeshSubmesh) * (size_t)header->SubmeshCount;
+	if (file.GetSize() != expectedSize)
+		return false;
+
+	// Decoding fails on anything corrupt, as well as truncated
+	if (header->Compressed)
+	{
+		const unsigned char* vertexData = (const unsigned char*)file.GetData() + sizeof(MeshCacheHeader);
+		decodedVertices.resize(header->VertexCount);
+		decodedIndices.resize(header->IndexCount);
+		if (!DecodeVertexBuffer(vertexData, header->VertexBytes, decodedVertices.data(), header->VertexCount, sizeof(Vertex)) ||
+			!DecodeIndexBuffer((const unsigned char*)GetIndexData(), header->IndexBytes, decodedIndices.data(), header->IndexCount))
+			return false;
+	}
+
+	// Every meshlet must be whole triangles of the full detail LOD
+	const MeshLOD& fullDetail = header->LODs[0];
+	const Meshlet* meshlets = GetMeshlets();
+	for (unsigned int m = 0; m < header->MeshletCount; m++)
+		if (meshlets[m].FirstIndex < fullDetail.FirstIndex ||
+			(size_t)meshlets[m].FirstIndex + meshlets[m].TriangleCount * (size_t)3 > (size_t)fullDetail.FirstIndex + fullDetail.IndexCount)
+			return false;
+
+	// Every submesh must stay inside its LODs & the meshlets
+	const MeshSubmesh* submeshes = GetSubmeshes();
+	for (unsigned int s = 0; s < header->SubmeshCount; s++)
+	{
+		if ((size_t)submeshes[s].FirstMeshlet + submeshes[s].MeshletCount > header->MeshletCount)
+			return false;
+
+		for (unsigned int i = 0; i < header->LODCount; i++)
+			if (submeshes[s].FirstIndex[i] < header->LODs[i].FirstIndex ||
+				(size_t)submeshes[s].FirstIndex[i] + submeshes[s].IndexCount[i] > (size_t)header->LODs[i].FirstIndex + header->LODs[i].IndexCount)
+				return false;
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (!HasValidContents())
+		return false;
+#endif
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Checks every vertex & index of a file that has passed
+// IsValid(): each position must be inside the stored bounds
+// (which also catches damaged positions that aren't numbers
+// at all), and each index must be a real vertex.  Caches
+// are checked this way when they're written (see
+// ConvertOBJToMeshCache()), rather than on every load.
+// --------------------------------------------------------
+bool MeshCacheFile::HasValidContents()
+{
+	const MeshCacheHeader* header = GetHeader();
+	XMVECTOR boundsMin = XMLoadFloat3(&header->BoundsMin);
+	XMVECTOR boundsMax = XMLoadFloat3(&header->BoundsMax);
+	const Vertex* vertices = GetVertices();
+	for (unsigned int i = 0; i < header->VertexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertices[i].Position);
+		if (!XMVector3GreaterOrEqual(position, boundsMin) || !XMVector3LessOrEqual(position, boundsMax))
+			return false;
+	}
+
+	const unsigned int* indices = GetIndices();
+	unsigned int largestIndex = 0;
+	for (unsigned int i = 0; i < header->IndexCount; i++)
+		largestIndex = std::max(largestIndex, indices[i]);
+	return header->IndexCount == 0 || largestIndex < header->VertexCount;
+}
+
+const MeshCacheHeader* MeshCacheFile::GetHeader()
+{
+	return (const MeshCacheHeader*)file.GetData();
+}
+
+const Vertex* MeshCacheFile::GetVertices()
+{
+	if (GetHeader()->Compressed)
+		return decodedVertices.data();
+	return (const Vertex*)(file.GetData() + sizeof(MeshCacheHeader));
+}
+
+const unsigned int* MeshCacheFile::GetIndices()
+{
+	if (GetHeader()->Compressed)
+		return decodedIndices.data();
+	return (const unsigned int*)GetIndexData();
+}
+
+const Meshlet* MeshCacheFile::GetMeshlets()
+{
+	return (const Meshlet*)(GetIndexData() + PaddedSize(GetHeader()->IndexBytes));
+}
+
+const char* MeshCacheFile::GetIndexData()
+{
+	return file.GetData() + sizeof(MeshCacheHeader) + PaddedSize(GetHeader()->VertexBytes);
+}
+
+const MeshSubmesh* MeshCacheFile::GetSubmeshes()
+{
+	return (const MeshSubmesh*)(GetMeshlets() + GetHeader()->MeshletCount);
+}
+
+
+// --------------------------------------------------------
+// Gets the path of the cache file for a given source file,
+// which lives right next to it (sphere.obj -> sphere.meshbin)
+// --------------------------------------------------------
+std::wstring GetMeshCachePath(const std::wstring& sourceFile)
+{
+	return std::filesystem::path(sourceFile).replace_extension(L".meshbin").wstring();
+}
+
+// --------------------------------------------------------
+// A fast 64-bit hash (FNV-1a style, 8 bytes at a time) used
+// to detect when a cache's source file has changed
+// --------------------------------------------------------
+unsigned long long HashBytes(const char* data, size_t size)
+{
+	const unsigned long long prime = 0x100000001B3ull;
+	unsigned long long hash = 0xCBF29CE484222325ull ^ size;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	for (; i < size; i++)
+		hash = (hash ^ (unsigned char)data[i]) * prime;
+
+	return hash;
+}
+
+// --------------------------------------------------------
+// Parses .obj text and runs every load-time processing step,
+// giving the final data that is stored in a .meshbin file
+// --------------------------------------------------------
+MeshData BuildMeshFromOBJ(const char* data, size_t size, MeshOptimizationStats& stats)
+{
+	MeshData mesh = ParseOBJ(data, size);
+	stats = OptimizeMesh(mesh);
+	CalculateTangents(mesh);
+	GenerateLODs(mesh);
+
+	// Meshlets regroup the full detail triangles, so optimize
+	// their order again (within and between meshlets), refresh
+	// the vertex order to match and measure them again
+	BuildMeshlets(mesh);
+	if (!mesh.Meshlets.empty())
+	{
+		OptimizeMeshlets(mesh);
+		OptimizeVertexFetch(mesh);
+
+		size_t count = mesh.LODs[0].IndexCount;
+		stats.After = AnalyzeVertexCache(mesh.Indices.data(), count, mesh.Vertices.size());
+		stats.OverdrawAfter = AnalyzeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), count);
+	}
+	return mesh;
+}
+
+// --------------------------------------------------------
+// Writes final (welded, optimized, tangent-complete) mesh
+// data to a .meshbin file, compressing the vertices & indices
+// when MESH_CACHE_COMPRESSED is on.  Returns false if the file can't be written,
+// which simply means the source will be parsed next time.
+// --------------------------------------------------------
+bool WriteMeshCache(const std::wstring& cacheFile, const MeshData& mesh, const MeshOptimizationStats& stats, unsigned long long sourceSize, unsigned long long sourceHash)
+{
+	MeshCacheHeader header = {};
+	memcpy(header.Magic, "MBIN", 4);
+	header.Version = MESH_CACHE_VERSION;
+	header.VertexStride = sizeof(Vertex);
+	header.VertexCount = (unsigned int)mesh.Vertices.size();
+	header.IndexCount = (unsigned int)mesh.Indices.size();
+	header.SourceSize = sourceSize;
+	header.SourceHash = sourceHash;
+	header.Optimization = stats;
+
+	// A mesh without LODs is a single level covering every index
+	header.LODCount = 1;
+	header.LODs[0] = { 0, header.IndexCount, 0.0f };
+	if (!mesh.LODs.empty())
+	{
+		header.LODCount = (unsigned int)std::min<size_t>(mesh.LODs.size(), MESH_MAX_LODS);
+		for (unsigned int i = 0; i < header.LODCount; i++)
+			header.LODs[i] = mesh.LODs[i];
+	}
+	header.MeshletCount = (unsigned int)mesh.Meshlets.size();
+
+	// A mesh without submeshes is a single one covering everything
+	std::vector<MeshSubmesh> submeshes = mesh.Submeshes;
+	if (submeshes.empty())
+		submeshes.push_back(CreateWholeSubmesh(header.LODs, header.LODCount, header.IndexCount, header.MeshletCount));
+	header.SubmeshCount = (unsigned int)submeshes.size();
+
+	// Bounds of the final vertex positions
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (const Vertex& v : mesh.Vertices)
+	{
+		XMVECTOR pos = XMLoadFloat3(&v.Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	if (mesh.Vertices.empty())
+	{
+		boundsMin = XMVectorZero();
+		boundsMax = XMVectorZero();
+	}
+	XMStoreFloat3(&header.BoundsMin, boundsMin);
+	XMStoreFloat3(&header.BoundsMax, boundsMax);
+
+	// Vertices & indices as they'll be stored
+	const char* vertexData = (const char*)mesh.Vertices.data();
+	const char* indexData = (const char*)mesh.Indices.data();
+	header.VertexBytes = (unsigned int)(sizeof(Vertex) * mesh.Vertices.size());
+	header.IndexBytes = (unsigned int)(sizeof(unsigned int) * mesh.Indices.size());
+	std::vector<unsigned char> encodedVertices;
+	std::vector<unsigned char> encodedIndices;
+#if MESH_CACHE_COMPRESSED
+	EncodeVertexBuffer(mesh.Vertices.data(), mesh.Vertices.size(), sizeof(Vertex), encodedVertices);
+	EncodeIndexBuffer(mesh.Indices.data(), mesh.Indices.size(), encodedIndices);
+	header.Compressed = 1;
+	header.VertexBytes = (unsigned int)encodedVertices.size();
+	header.IndexBytes = (unsigned int)encodedIndices.size();
+	vertexData = (const char*)encodedVertices.data();
+	indexData = (const char*)encodedIndices.data();
+#endif
+
+	std::ofstream out(std::filesystem::path(cacheFile), std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	const char padding[4] = {};
+	out.write((const char*)&header, sizeof(header));
+	out.write(vertexData, header.VertexBytes);
+	out.write(padding, PaddedSize(header.VertexBytes) - header.VertexBytes);
+	out.write(indexData, header.IndexBytes);
+	out.write(padding, PaddedSize(header.IndexBytes) - header.IndexBytes);
+	out.write((const char*)mesh.Meshlets.data(), sizeof(Meshlet) * mesh.Meshlets.size());
+	out.write((const char*)submeshes.data(), sizeof(MeshSubmesh) * submeshes.size());
+	out.close();
+
+	// Don't leave a partial file behind
+	if (out.fail())
+	{
+		std::error_code error;
+		std::filesystem::remove(std::filesystem::path(cacheFile), error);
+		return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Parses the given .obj file and writes its .meshbin next to
+// it.  Can be run as an offline step so that the very first
+// launch doesn't need to parse anything.  The written file
+// is read back and fully checked (every vertex & index,
+// which loading skips), and removed if it doesn't pass.
+// --------------------------------------------------------
+bool ConvertOBJToMeshCache(const std::wstring& objFile)
+{
+	MappedFile source(objFile);
+	if (!source.IsOpen())
+		return false;
+
+	MeshOptimizationStats stats;
+	MeshData data = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+
+	std::wstring cachePath = GetMeshCachePath(objFile);
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	if (!WriteMeshCache(cachePath, data, stats, source.GetSize(), sourceHash))
+		return false;
+
+	bool valid;
+	{
+		MeshCacheFile cache(cachePath);
+		valid = cache.IsValid(source.GetSize(), sourceHash) && cache.HasValidContents();
+	}
+
+	if (!valid)
+	{
+		std::error_code error;
+		std::filesystem::remove(std::filesystem::path(cachePath), error);
+	}
+	return valid;
+}
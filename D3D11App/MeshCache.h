@@ -0,0 +1,92 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MappedFile.h"
+
+// Must be bumped whenever the layout of the file (or of Vertex) changes
+#define MESH_CACHE_VERSION 8
+
+// Should new cache files store compressed vertices & indices (see
+// MeshCodec.h)?  Either kind of file can always be read.
+#define MESH_CACHE_COMPRESSED 1
+
+// --------------------------------------------------------
+// Header at the start of every .meshbin file.  It is followed
+// by VertexBytes of vertices, then IndexBytes of indices
+// (every LOD's, back to back), each padded to 4 bytes, then
+// MeshletCount Meshlet structs, then SubmeshCount
+// MeshSubmesh structs.  Uncompressed vertices & indices are
+// plain Vertex structs and 32-bit indices, used straight from
+// a memory-mapped view of the file; compressed ones are
+// decoded when the file is validated.
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	char Magic[4];						// Always "MBIN"
+	unsigned int Version;				// MESH_CACHE_VERSION when written
+	unsigned int VertexStride;			// sizeof(Vertex) when written
+	unsigned int VertexCount;
+	unsigned int IndexCount;
+	unsigned int LODCount;				// Number of entries used in LODs
+	unsigned long long SourceSize;		// Size of the source file, in bytes
+	unsigned long long SourceHash;		// HashBytes() of the source file
+	DirectX::XMFLOAT3 BoundsMin;		// Axis-aligned bounds of all vertices
+	DirectX::XMFLOAT3 BoundsMax;
+	MeshOptimizationStats Optimization;	// Stats from OptimizeMesh()
+	MeshLOD LODs[MESH_MAX_LODS];		// Index ranges of each level of detail
+	unsigned int MeshletCount;			// Meshlets covering LOD 0 (may be zero)
+	unsigned int SubmeshCount;			// Submeshes (at least one)
+	unsigned int Compressed;			// Are vertices & indices compressed?
+	unsigned int VertexBytes;			// Size of the vertex data in the file
+	unsigned int IndexBytes;			// Size of the index data in the file
+};
+
+// --------------------------------------------------------
+// A memory-mapped .meshbin file.  For uncompressed files
+// nothing is copied; the vertex and index pointers point
+// into the mapped view.  Compressed files are decoded into
+// arrays owned by this object.
+// --------------------------------------------------------
+class MeshCacheFile
+{
+public:
+	MeshCacheFile(const std::wstring& cacheFile);
+
+	// Is the file intact (every range in bounds), and was it built
+	// from this exact source?  (Also decodes compressed vertices &
+	// indices.)
+	bool IsValid(unsigned long long sourceSize, unsigned long long sourceHash);
+
+	// Are all the vertices inside the bounds, and all the indices
+	// real vertices?  (Only checked by IsValid() in debug builds.)
+	bool HasValidContents();
+
+	const MeshCacheHeader* GetHeader();
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	const Meshlet* GetMeshlets();
+	const MeshSubmesh* GetSubmeshes();
+
+private:
+	MappedFile file;
+
+	// Decoded vertices & indices of a compressed file
+	std::vector<Vertex> decodedVertices;
+	std::vector<unsigned int> decodedIndices;
+
+	const char* GetIndexData();
+};
+
+// Helpers for building and locating cache files
+std::wstring GetMeshCachePath(const std::wstring& sourceFile);
+unsigned long long HashBytes(const char* data, size_t size);
+MeshData BuildMeshFromOBJ(const char* data, size_t size, MeshOptimizationStats& stats);
+bool WriteMeshCache(const std::wstring& cacheFile, const MeshData& mesh, const MeshOptimizationStats& stats, unsigned long long sourceSize, unsigned long long sourceHash);
+
+// Offline conversion step: parses the .obj and writes its .meshbin
+bool ConvertOBJToMeshCache(const std::wstring& objFile);
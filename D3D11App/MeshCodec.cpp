@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "MeshCodec.h"
+
+namespace
+{
+	// Bits per byte of each group width code (2 bits in the header)
+	const unsigned int GroupBits[4] = { 0, 2, 4, 8 };
+
+	// Small differences either way become small unsigned values
+	unsigned char ZigzagByte(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (0u - (delta >> 7)));
+	}
+
+#if !defined(_XM_SSE_INTRINSICS_)
+	// (SumDeltas() undoes it 16 at a time with intrinsics)
+	unsigned char UnzigzagByte(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (0u - (value & 1)));
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Appends one group of zigzagged deltas at the narrowest
+	// width that holds all of them, returning its width code
+	// --------------------------------------------------------
+	unsigned int EncodeGroup(const unsigned char* values, std::vector<unsigned char>& out)
+	{
+		unsigned char largest = 0;
+		for (int i = 0; i < MESH_CODEC_GROUP_SIZE; i++)
+			largest = std::max(largest, values[i]);
+
+		unsigned int code = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+		unsigned int bits = GroupBits[code];
+		unsigned int perByte = code == 0 ? 0 : 8 / bits;
+		for (int i = 0; perByte > 0 && i < MESH_CODEC_GROUP_SIZE; i += perByte)
+		{
+			unsigned char packed = 0;
+			for (unsigned int j = 0; j < perByte; j++)
+				packed |= values[i + j] << (8 - bits * (j + 1));
+			out.push_back(packed);
+		}
+		return code;
+	}
+
+	// --------------------------------------------------------
+	// Unpacks one group, returning the bytes it took up (the
+	// caller has already made sure they're there)
+	// --------------------------------------------------------
+	size_t DecodeGroup(const unsigned char* data, unsigned int code, unsigned char* values)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		const __m128i low2 = _mm_set1_epi8(3);
+		const __m128i low4 = _mm_set1_epi8(15);
+		switch (code)
+		{
+		case 0:
+			_mm_storeu_si128((__m128i*)values, _mm_setzero_si128());
+			return 0;
+
+		case 1:
+		{
+			// Split each byte into its four 2-bit values, then
+			// interleave them back into their original order
+			int packed;
+			memcpy(&packed, data, 4);
+			__m128i v = _mm_cvtsi32_si128(packed);
+			__m128i v6 = _mm_and_si128(_mm_srli_epi16(v, 6), low2);
+			__m128i v4 = _mm_and_si128(_mm_srli_epi16(v, 4), low2);
+			__m128i v2 = _mm_and_si128(_mm_srli_epi16(v, 2), low2);
+			__m128i v0 = _mm_and_si128(v, low2);
+			__m128i high = _mm_unpacklo_epi8(v6, v4);
+			__m128i low = _mm_unpacklo_epi8(v2, v0);
+			_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi16(high, low));
+			return MESH_CODEC_GROUP_SIZE / 4;
+		}
+
+		case 2:
+		{
+			__m128i v = _mm_loadl_epi64((const __m128i*)data);
+			__m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), low4);
+			__m128i low = _mm_and_si128(v, low4);
+			_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi8(high, low));
+			return MESH_CODEC_GROUP_SIZE / 2;
+		}
+
+		default:
+			_mm_storeu_si128((__m128i*)values, _mm_loadu_si128((const __m128i*)data));
+			return MESH_CODEC_GROUP_SIZE;
+		}
+#else
+		switch (code)
+		{
+		case 0:
+			memset(values, 0, MESH_CODEC_GROUP_SIZE);
+			return 0;
+
+		case 1:
+			for (int i = 0; i < MESH_CODEC_GROUP_SIZE / 4; i++)
+			{
+				unsigned char packed = data[i];
+				values[i * 4 + 0] = packed >> 6;
+				values[i * 4 + 1] = (packed >> 4) & 3;
+				values[i * 4 + 2] = (packed >> 2) & 3;
+				values[i * 4 + 3] = packed & 3;
+			}
+			return MESH_CODEC_GROUP_SIZE / 4;
+
+		case 2:
+			for (int i = 0; i < MESH_CODEC_GROUP_SIZE / 2; i++)
+			{
+				values[i * 2 + 0] = data[i] >> 4;
+				values[i * 2 + 1] = data[i] & 15;
+			}
+			return MESH_CODEC_GROUP_SIZE / 2;
+
+		default:
+			memcpy(values, data, MESH_CODEC_GROUP_SIZE);
+			return MESH_CODEC_GROUP_SIZE;
+		}
+#endif
+	}
+
+	// --------------------------------------------------------
+	// Turns a plane of zigzagged deltas into the actual bytes,
+	// starting from the previous block's last one
+	// --------------------------------------------------------
+	void SumDeltas(unsigned char* plane, size_t groupCount, unsigned char previous)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i low7 = _mm_set1_epi8(0x7F);
+		__m128i carry = _mm_set1_epi8((char)previous);
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			__m128i* group = (__m128i*)(plane + g * MESH_CODEC_GROUP_SIZE);
+			__m128i v = _mm_loadu_si128(group);
+			v = _mm_xor_si128(
+				_mm_and_si128(_mm_srli_epi16(v, 1), low7),
+				_mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+
+			// Running sum across the lanes in four steps
+			v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+			v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+			v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+			v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+			v = _mm_add_epi8(v, carry);
+			_mm_storeu_si128(group, v);
+
+			carry = _mm_set1_epi8((char)(_mm_extract_epi16(v, 7) >> 8));
+		}
+#else
+		for (size_t i = 0; i < groupCount * MESH_CODEC_GROUP_SIZE; i++)
+		{
+			previous += UnzigzagByte(plane[i]);
+			plane[i] = previous;
+		}
+#endif
+	}
+
+	// --------------------------------------------------------
+	// Interleaves a block's planes back into vertices.  Strides
+	// that are whole 32-bit words are done four planes (one
+	// word of each vertex) and 16 vertices at a time.
+	// --------------------------------------------------------
+	void TransposePlanes(const unsigned char* planes, size_t blockCount, size_t stride, unsigned char* vertices)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		if (stride % 4 == 0)
+		{
+			for (size_t k = 0; k < stride; k += 4)
+			{
+				const unsigned char* plane = planes + k * MESH_CODEC_BLOCK_VERTICES;
+				for (size_t i = 0; i < blockCount; i += MESH_CODEC_GROUP_SIZE)
+				{
+					__m128i a = _mm_loadu_si128((const __m128i*)(plane + i));
+					__m128i b = _mm_loadu_si128((const __m128i*)(plane + MESH_CODEC_BLOCK_VERTICES + i));
+					__m128i c = _mm_loadu_si128((const __m128i*)(plane + MESH_CODEC_BLOCK_VERTICES * 2 + i));
+					__m128i d = _mm_loadu_si128((const __m128i*)(plane + MESH_CODEC_BLOCK_VERTICES * 3 + i));
+					__m128i abLow = _mm_unpacklo_epi8(a, b);
+					__m128i abHigh = _mm_unpackhi_epi8(a, b);
+					__m128i cdLow = _mm_unpacklo_epi8(c, d);
+					__m128i cdHigh = _mm_unpackhi_epi8(c, d);
+					__m128i words[4] = {
+						_mm_unpacklo_epi16(abLow, cdLow),
+						_mm_unpackhi_epi16(abLow, cdLow),
+						_mm_unpacklo_epi16(abHigh, cdHigh),
+						_mm_unpackhi_epi16(abHigh, cdHigh) };
+
+					size_t n = std::min<size_t>(MESH_CODEC_GROUP_SIZE, blockCount - i);
+					for (size_t j = 0; j < n; j++)
+					{
+						int word = _mm_cvtsi128_si32(words[j / 4]);
+						words[j / 4] = _mm_srli_si128(words[j / 4], 4);
+						memcpy(vertices + (i + j) * stride + k, &word, 4);
+					}
+				}
+			}
+			return;
+		}
+#endif
+		for (size_t k = 0; k < stride; k++)
+			for (size_t i = 0; i < blockCount; i++)
+				vertices[i * stride + k] = planes[k * MESH_CODEC_BLOCK_VERTICES + i];
+	}
+}
+
+
+// --------------------------------------------------------
+// Appends the compressed indices to out
+// --------------------------------------------------------
+void EncodeIndexBuffer(const unsigned int* indices, size_t count, std::vector<unsigned char>& out)
+{
+	out.reserve(out.size() + count + count / 4);
+
+	unsigned int previous = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int delta = indices[i] - previous;
+		unsigned int value = (delta << 1) ^ (0u - (delta >> 31));
+		previous = indices[i];
+
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+}
+
+// --------------------------------------------------------
+// Decodes exactly count indices, which must use up exactly
+// size bytes.  Returns false for truncated or corrupt data.
+// --------------------------------------------------------
+bool DecodeIndexBuffer(const unsigned char* data, size_t size, unsigned int* indices, size_t count)
+{
+	const unsigned char* end = data + size;
+	unsigned int previous = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		// Most indices are a single byte
+		unsigned int value;
+		if (data < end && *data < 0x80)
+		{
+			value = *data++;
+		}
+		else
+		{
+			value = 0;
+			for (int shift = 0; ; shift += 7)
+			{
+				if (data == end || shift > 28)
+					return false;
+
+				unsigned char b = *data++;
+				value |= (unsigned int)(b & 0x7F) << shift;
+				if (b < 0x80)
+					break;
+			}
+		}
+
+		previous += (value >> 1) ^ (0u - (value & 1));
+		indices[i] = previous;
+	}
+	return data == end;
+}
+
+
+// --------------------------------------------------------
+// Appends the compressed vertices to out.  Each block of
+// vertices holds, for every byte of the vertex, one 2-bit
+// width per group (four to a byte) and then the groups.
+// Deltas carry on from one block to the next, and the last
+// block is padded out to whole groups with zero deltas.
+// --------------------------------------------------------
+void EncodeVertexBuffer(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out)
+{
+	if (stride == 0 || stride > MESH_CODEC_MAX_STRIDE)
+		throw std::invalid_argument("Vertex stride not supported by the mesh codec");
+
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	unsigned char previous[MESH_CODEC_MAX_STRIDE] = {};
+	unsigned char deltas[MESH_CODEC_BLOCK_VERTICES];
+	out.reserve(out.size() + count * stride / 2);
+
+	for (size_t first = 0; first < count; first += MESH_CODEC_BLOCK_VERTICES)
+	{
+		size_t blockCount = std::min<size_t>(MESH_CODEC_BLOCK_VERTICES, count - first);
+		size_t groupCount = (blockCount + MESH_CODEC_GROUP_SIZE - 1) / MESH_CODEC_GROUP_SIZE;
+		for (size_t k = 0; k < stride; k++)
+		{
+			memset(deltas, 0, sizeof(deltas));
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				unsigned char value = bytes[(first + i) * stride + k];
+				deltas[i] = ZigzagByte((unsigned char)(value - previous[k]));
+				previous[k] = value;
+			}
+
+			size_t header = out.size();
+			out.resize(header + (groupCount + 3) / 4, 0);
+			for (size_t g = 0; g < groupCount; g++)
+			{
+				unsigned int code = EncodeGroup(deltas + g * MESH_CODEC_GROUP_SIZE, out);
+				out[header + g / 4] |= (unsigned char)(code << ((g % 4) * 2));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Decodes exactly count vertices, which must use up exactly
+// size bytes.  A block is decoded one plane at a time into
+// a scratch buffer (unpacking, undoing the zigzag and summing
+// the deltas 16 bytes at a time), and only then transposed
+// back into whole vertices, four planes at a time.
+// --------------------------------------------------------
+bool DecodeVertexBuffer(const unsigned char* data, size_t size, void* vertices, size_t count, size_t stride)
+{
+	if (stride == 0 || stride > MESH_CODEC_MAX_STRIDE)
+		return false;
+
+	const unsigned char* end = data + size;
+	unsigned char* bytes = (unsigned char*)vertices;
+	unsigned char previous[MESH_CODEC_MAX_STRIDE] = {};
+	std::vector<unsigned char> planes(stride * MESH_CODEC_BLOCK_VERTICES);
+
+	for (size_t first = 0; first < count; first += MESH_CODEC_BLOCK_VERTICES)
+	{
+		size_t blockCount = std::min<size_t>(MESH_CODEC_BLOCK_VERTICES, count - first);
+		size_t groupCount = (blockCount + MESH_CODEC_GROUP_SIZE - 1) / MESH_CODEC_GROUP_SIZE;
+		for (size_t k = 0; k < stride; k++)
+		{
+			size_t headerBytes = (groupCount + 3) / 4;
+			if ((size_t)(end - data) < headerBytes)
+				return false;
+			const unsigned char* header = data;
+			data += headerBytes;
+
+			unsigned char* plane = &planes[k * MESH_CODEC_BLOCK_VERTICES];
+			for (size_t g = 0; g < groupCount; g++)
+			{
+				unsigned int code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+				if ((size_t)(end - data) < GroupBits[code] * MESH_CODEC_GROUP_SIZE / 8)
+					return false;
+				data += DecodeGroup(data, code, plane + g * MESH_CODEC_GROUP_SIZE);
+			}
+
+			// Padding past the last vertex has zero deltas, so
+			// the plane's final byte is the last vertex's
+			SumDeltas(plane, groupCount, previous[k]);
+			previous[k] = plane[groupCount * MESH_CODEC_GROUP_SIZE - 1];
+		}
+
+		TransposePlanes(planes.data(), blockCount, stride, bytes + first * stride);
+	}
+	return data == end;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshData.h"
+
+// Vertices encoded together; each block's deltas are packed plane by
+// plane, so a block should fit comfortably in L1 while decoding
+#define MESH_CODEC_BLOCK_VERTICES 256
+
+// Deltas are bit-packed in groups of this many bytes, each group
+// using 0, 2, 4 or 8 bits per byte
+#define MESH_CODEC_GROUP_SIZE 16
+
+// Largest vertex the codec accepts, in bytes
+#define MESH_CODEC_MAX_STRIDE 256
+
+// --------------------------------------------------------
+// Index compression: each index is stored as the difference
+// from the one before it, zigzagged so small negative steps
+// stay small, then written as a variable length integer (7
+// bits per byte).  Optimized index orders mostly step by a
+// few vertices, so most indices take one byte.
+// --------------------------------------------------------
+void EncodeIndexBuffer(const unsigned int* indices, size_t count, std::vector<unsigned char>& out);
+bool DecodeIndexBuffer(const unsigned char* data, size_t size, unsigned int* indices, size_t count);
+
+// --------------------------------------------------------
+// Vertex compression: vertices are split into byte planes
+// (byte 0 of every vertex, then byte 1, ...), and each byte
+// is stored as the zigzagged difference from the same byte
+// of the previous vertex.  Neighboring vertices are alike,
+// so the differences are mostly tiny and are bit-packed in
+// groups with a 2-bit width header per group.  Lossless for
+// any vertex layout (floats included).
+// --------------------------------------------------------
+void EncodeVertexBuffer(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out);
+bool DecodeVertexBuffer(const unsigned char* data, size_t size, void* vertices, size_t count, size_t stride);
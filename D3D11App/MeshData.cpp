@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshData.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Hashing & comparison for finding verts at identical positions
+	struct PositionHash
+	{
+		size_t operator()(const XMFLOAT3& p) const
+		{
+			// Both zeros must hash the same, since they compare equal
+			unsigned int bits[3] = {};
+			if (p.x != 0.0f) memcpy(&bits[0], &p.x, 4);
+			if (p.y != 0.0f) memcpy(&bits[1], &p.y, 4);
+			if (p.z != 0.0f) memcpy(&bits[2], &p.z, 4);
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	// ----------------------------------------------------
+	// Tangents of up to four triangles at once, from their
+	// positions and UVs, returned one triangle per row (rows
+	// past the count repeat the last triangle).  Position and UV
+	// are adjacent in a Vertex, so each corner's x, y, z & u
+	// come from a single unaligned load, and transposing four
+	// corners puts them in separate vectors.  Each lane does
+	// the reference's math in the same order, so the sums
+	// match it exactly.
+	// ----------------------------------------------------
+	XMMATRIX CalculateTriangleTangents4(const Vertex* verts, const unsigned int* indices, size_t firstTri, size_t count)
+	{
+		static_assert(offsetof(Vertex, UV) == offsetof(Vertex, Position) + sizeof(XMFLOAT3), "UV must follow Position");
+
+		// Each corner's x, y, z, u & v, across the four triangles
+		XMVECTOR corners[3][5];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const Vertex* v[4];
+			XMMATRIX rows;
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				v[lane] = &verts[indices[(firstTri + std::min(lane, count - 1)) * 3 + corner]];
+				rows.r[lane] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&v[lane]->Position));
+			}
+
+			XMMATRIX lanes = XMMatrixTranspose(rows);
+			for (int c = 0; c < 4; c++)
+				corners[corner][c] = lanes.r[c];
+			corners[corner][4] = XMVectorSet(v[0]->UV.y, v[1]->UV.y, v[2]->UV.y, v[3]->UV.y);
+		}
+
+		// Vectors relative to the first corner's position & uv
+		XMVECTOR edge1[5];
+		XMVECTOR edge2[5];
+		for (int c = 0; c < 5; c++)
+		{
+			edge1[c] = XMVectorSubtract(corners[1][c], corners[0][c]);
+			edge2[c] = XMVectorSubtract(corners[2][c], corners[0][c]);
+		}
+
+		// r = 1 / (s1 * t2 - s2 * t1), then (t2 * edge1 - t1 * edge2) * r
+		XMVECTOR s1 = edge1[3], t1 = edge1[4];
+		XMVECTOR s2 = edge2[3], t2 = edge2[4];
+		XMVECTOR r = XMVectorDivide(XMVectorReplicate(1.0f), XMVectorSubtract(XMVectorMultiply(s1, t2), XMVectorMultiply(s2, t1)));
+		XMMATRIX tangents;
+		for (int axis = 0; axis < 3; axis++)
+			tangents.r[axis] = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(t2, edge1[axis]), XMVectorMultiply(t1, edge2[axis])), r);
+		tangents.r[3] = XMVectorZero();
+		return XMMatrixTranspose(tangents);
+	}
+
+	// ----------------------------------------------------
+	// Gram-Schmidt orthonormalizes the summed tangents of up
+	// to four vertices (each sum padded to four floats, with
+	// room for four) against their normals at once, so the
+	// normal and tangent are exactly 90 degrees apart, and
+	// stores them in the vertices.  Zero length tangents
+	// stay zero.
+	// ----------------------------------------------------
+	void OrthonormalizeTangents4(Vertex* verts, size_t count, const XMFLOAT4A* sums)
+	{
+		// Gather normals & sums, one vertex per lane (lanes
+		// past the count repeat the last vertex)
+		XMMATRIX normals;
+		XMMATRIX tangents;
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			normals.r[lane] = XMLoadFloat3(&verts[std::min(lane, count - 1)].Normal);
+			tangents.r[lane] = XMLoadFloat4A(&sums[lane]);
+		}
+		normals = XMMatrixTranspose(normals);
+		tangents = XMMatrixTranspose(tangents);
+
+		XMVECTOR n[3] = { normals.r[0], normals.r[1], normals.r[2] };
+		XMVECTOR t[3] = { tangents.r[0], tangents.r[1], tangents.r[2] };
+
+		XMVECTOR dot = XMVectorAdd(XMVectorAdd(
+			XMVectorMultiply(n[0], t[0]),
+			XMVectorMultiply(n[1], t[1])),
+			XMVectorMultiply(n[2], t[2]));
+		for (int axis = 0; axis < 3; axis++)
+			t[axis] = XMVectorSubtract(t[axis], XMVectorMultiply(n[axis], dot));
+
+		XMVECTOR length = XMVectorSqrt(XMVectorAdd(XMVectorAdd(
+			XMVectorMultiply(t[0], t[0]),
+			XMVectorMultiply(t[1], t[1])),
+			XMVectorMultiply(t[2], t[2])));
+		XMVECTOR nonZero = XMVectorGreater(length, XMVectorZero());
+		for (int axis = 0; axis < 3; axis++)
+			tangents.r[axis] = XMVectorSelect(XMVectorZero(), XMVectorDivide(t[axis], length), nonZero);
+		tangents = XMMatrixTranspose(tangents);
+
+		for (size_t lane = 0; lane < count; lane++)
+			XMStoreFloat3(&verts[lane].Tangent, tangents.r[lane]);
+	}
+
+	// ----------------------------------------------------
+	// Adds up to four triangles' tangents (one per row) to
+	// their corners' sums, in triangle order
+	// ----------------------------------------------------
+	void AddTriangleTangents4(const unsigned int* indices, size_t firstTri, size_t count, FXMMATRIX tangents, XMFLOAT4A* sums)
+	{
+		for (size_t lane = 0; lane < count; lane++)
+		{
+			const unsigned int* tri = &indices[(firstTri + lane) * 3];
+			for (int corner = 0; corner < 3; corner++)
+				XMStoreFloat4A(&sums[tri[corner]], XMVectorAdd(XMLoadFloat4A(&sums[tri[corner]]), tangents.r[lane]));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Describes an entire mesh as a single unnamed submesh
+//
+// lods        - Index ranges of each LOD (or null for just one
+//               LOD made of every index)
+// numLODs     - The number of LODs in the LOD array
+// numIndices  - Total indices in the mesh
+// numMeshlets - Total meshlets in the mesh
+// --------------------------------------------------------
+MeshSubmesh CreateWholeSubmesh(const MeshLOD* lods, size_t numLODs, size_t numIndices, size_t numMeshlets)
+{
+	MeshSubmesh submesh = {};
+	if (!lods || numLODs == 0)
+		submesh.IndexCount[0] = (unsigned int)numIndices;
+
+	for (size_t i = 0; lods && i < std::min<size_t>(numLODs, MESH_MAX_LODS); i++)
+	{
+		submesh.FirstIndex[i] = lods[i].FirstIndex;
+		submesh.IndexCount[i] = lods[i].IndexCount;
+	}
+
+	submesh.MeshletCount = (unsigned int)numMeshlets;
+	return submesh;
+}
+
+void AddDefaultSubmesh(MeshData& mesh)
+{
+	if (mesh.Submeshes.empty())
+		mesh.Submeshes.push_back(CreateWholeSubmesh(mesh.LODs.data(), mesh.LODs.size(), mesh.Indices.size(), mesh.Meshlets.size()));
+}
+
+void SetSubmeshName(MeshSubmesh& submesh, const char* name, size_t length)
+{
+	length = std::min<size_t>(length, MESH_MAX_SUBMESH_NAME - 1);
+	memcpy(submesh.Name, name, length);
+	submesh.Name[length] = 0;
+}
+
+// --------------------------------------------------------
+// Maps each vertex to the first vertex with the exact same
+// position, so that vertices split along UV or normal seams
+// can be treated as one point on the surface
+//
+// verts    - The mesh's vertices
+// numVerts - The number of verts in the array
+// remap    - Receives numVerts indices (the first vertex at
+//            each position maps to itself)
+// --------------------------------------------------------
+void RemapSharedPositions(const Vertex* verts, size_t numVerts, unsigned int* remap)
+{
+	std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstAtPosition;
+	firstAtPosition.reserve(numVerts);
+	for (unsigned int v = 0; v < numVerts; v++)
+		remap[v] = firstAtPosition.try_emplace(verts[v].Position, v).first->second;
+}
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh, using
+// the shared thread pool when the mesh is large enough
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// --------------------------------------------------------
+void CalculateTangents(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	if (numIndices / 3 >= TANGENT_PARALLEL_MIN_TRIANGLES && ThreadPool::Shared().GetThreadCount() > 1)
+		CalculateTangentsParallel(verts, numVerts, indices, numIndices, ThreadPool::Shared());
+	else
+		CalculateTangentsSerial(verts, numVerts, indices, numIndices);
+}
+
+
+// --------------------------------------------------------
+// Calculates tangents on the calling thread only, with SIMD
+// math on four triangles, then four vertices, at a time.
+// Tangents are summed in a separate array, a whole vector
+// per vertex, so adding one is a single load & store.
+// --------------------------------------------------------
+void CalculateTangentsSerial(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	std::vector<XMFLOAT4A> sums((numVerts + 3) & ~(size_t)3, XMFLOAT4A(0, 0, 0, 0));
+
+	// Add each triangle's tangent to its vertices, in triangle order
+	size_t numTris = numIndices / 3;
+	for (size_t first = 0; first < numTris; first += 4)
+	{
+		size_t count = std::min((size_t)4, numTris - first);
+		AddTriangleTangents4(indices, first, count, CalculateTriangleTangents4(verts, indices, first, count), sums.data());
+	}
+
+	for (size_t v = 0; v < numVerts; v += 4)
+		OrthonormalizeTangents4(&verts[v], std::min((size_t)4, numVerts - v), &sums[v]);
+}
+
+
+// --------------------------------------------------------
+// Calculates tangents with the triangles' tangents, and
+// then the orthonormalizing, split across the given thread
+// pool.  Only adding the triangles' tangents to their
+// vertices stays on the calling thread, in the same order
+// as CalculateTangentsSerial(), so the results match it
+// exactly (and no two threads write to the same vertex).
+// --------------------------------------------------------
+void CalculateTangentsParallel(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, ThreadPool& pool)
+{
+	// A few blocks per thread, so uneven blocks balance out
+	// (blocks are multiples of 4, so only the last one is partial)
+	size_t blockCount = (size_t)pool.GetThreadCount() * 4;
+
+	// Tangent of every triangle (with room for the last
+	// block's spare rows)
+	size_t numTris = numIndices / 3;
+	std::vector<XMFLOAT4A> triTangents((numTris + 3) & ~(size_t)3);
+	size_t triBlockSize = (numTris / blockCount + 4) & ~(size_t)3;
+	pool.ParallelFor(blockCount, [&](size_t block)
+		{
+			size_t end = std::min(numTris, (block + 1) * triBlockSize);
+			for (size_t first = block * triBlockSize; first < end; first += 4)
+			{
+				XMMATRIX tangents = CalculateTriangleTangents4(verts, indices, first, std::min((size_t)4, end - first));
+				for (size_t lane = 0; lane < 4; lane++)
+					XMStoreFloat4A(&triTangents[first + lane], tangents.r[lane]);
+			}
+		});
+
+	std::vector<XMFLOAT4A> sums((numVerts + 3) & ~(size_t)3, XMFLOAT4A(0, 0, 0, 0));
+	for (size_t tri = 0; tri < numTris; tri++)
+	{
+		XMVECTOR tangent = XMLoadFloat4A(&triTangents[tri]);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			XMFLOAT4A& sum = sums[indices[tri * 3 + corner]];
+			XMStoreFloat4A(&sum, XMVectorAdd(XMLoadFloat4A(&sum), tangent));
+		}
+	}
+
+	size_t vertBlockSize = (numVerts / blockCount + 4) & ~(size_t)3;
+	pool.ParallelFor(blockCount, [&](size_t block)
+		{
+			size_t end = std::min(numVerts, (block + 1) * vertBlockSize);
+			for (size_t first = block * vertBlockSize; first < end; first += 4)
+				OrthonormalizeTangents4(&verts[first], std::min((size_t)4, end - first), &sums[first]);
+		});
+}
+
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh, one
+// triangle at a time (the straightforward version, kept for
+// validating the faster ones)
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+//
+// --------------------------------------------------------
+void CalculateTangentsReference(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	// Reset tangents
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx;
+		v1->Tangent.y += ty;
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx;
+		v2->Tangent.y += ty;
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx;
+		v3->Tangent.y += ty;
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
+
+
+// --------------------------------------------------------
+// Calculates the tangents of all vertices in the given mesh
+// --------------------------------------------------------
+void CalculateTangents(MeshData& mesh)
+{
+	CalculateTangents(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+}
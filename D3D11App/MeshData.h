@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+// Most levels of detail a mesh can have (including the full detail one)
+#define MESH_MAX_LODS 5
+
+// Longest submesh (material) name kept, including the terminator
+#define MESH_MAX_SUBMESH_NAME 64
+
+// Meshes with at least this many triangles get their
+// tangents calculated on the shared thread pool (if it has
+// any workers).  Summing the tangents stays serial, so only
+// meshes well past the bundled ones (5,000 triangles or so)
+// make up for waking the pool twice.
+#define TANGENT_PARALLEL_MIN_TRIANGLES 65536
+
+// --------------------------------------------------------
+// One level of detail: a range of the mesh's index buffer
+// (all levels share the same vertex buffer), and how far its
+// surface may be from the full detail mesh, in object space
+// --------------------------------------------------------
+struct MeshLOD
+{
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+	float Error;
+};
+
+// --------------------------------------------------------
+// A small cluster of neighboring triangles: a contiguous
+// range of the full detail index buffer, with bounds that
+// let it be culled as a whole (see MeshletBuilder.h)
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int FirstIndex;
+	unsigned int TriangleCount;
+	unsigned int VertexCount;		// Unique vertices used by the triangles
+	DirectX::XMFLOAT3 Center;		// Bounding sphere, in object space
+	float Radius;
+	DirectX::XMFLOAT3 ConeApex;		// Normal cone: every triangle faces away
+	DirectX::XMFLOAT3 ConeAxis;		// from the camera when
+	float ConeCutoff;				// dot(normalize(apex - camera), axis) >= cutoff
+};
+
+// --------------------------------------------------------
+// The part of a mesh that uses one material: a contiguous
+// range of each LOD's indices, and of the meshlets.  Each
+// LOD is its submeshes' ranges back to back, in the same
+// order, so a whole LOD is still a single range.  Fixed
+// size, so submeshes can be stored in cache files as-is.
+// --------------------------------------------------------
+struct MeshSubmesh
+{
+	char Name[MESH_MAX_SUBMESH_NAME];		// Material (or group) name, or empty
+	unsigned int FirstIndex[MESH_MAX_LODS];	// Range of each LOD's indices
+	unsigned int IndexCount[MESH_MAX_LODS];
+	unsigned int FirstMeshlet;
+	unsigned int MeshletCount;
+};
+
+// --------------------------------------------------------
+// CPU-side geometry, ready to be turned into a Mesh.  If
+// there are no LODs, all indices make up a single level.
+// Meshlets, if any, cover the full detail level.  If there
+// are no submeshes, the whole mesh is one unnamed submesh.
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+	std::vector<MeshLOD> LODs;
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshSubmesh> Submeshes;
+};
+
+// A single unnamed submesh covering every LOD and meshlet
+MeshSubmesh CreateWholeSubmesh(const MeshLOD* lods, size_t numLODs, size_t numIndices, size_t numMeshlets);
+
+// Gives a mesh without submeshes a whole-mesh one, so that
+// processing steps can always work submesh by submesh
+void AddDefaultSubmesh(MeshData& mesh);
+
+// Copies a name into a submesh (truncated if necessary)
+void SetSubmeshName(MeshSubmesh& submesh, const char* name, size_t length);
+
+// Finds the first vertex with the same position as each vertex
+void RemapSharedPositions(const Vertex* verts, size_t numVerts, unsigned int* remap);
+
+// Fills in the Tangent of each vertex from the triangles' UVs
+// (in parallel, for large enough meshes)
+void CalculateTangents(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices);
+void CalculateTangents(MeshData& mesh);
+
+// Explicitly serial or parallel versions of the above (same results)
+void CalculateTangentsSerial(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices);
+void CalculateTangentsParallel(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, ThreadPool& pool);
+
+// One triangle at a time, for validating the versions above
+void CalculateTangentsReference(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices);
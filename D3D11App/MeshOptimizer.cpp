@@ -0,0 +1,703 @@
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex
+	// Cache Optimisation" (2006)
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Largest remaining-triangle count with its own precomputed score
+	const unsigned int MaxScoredValence = 64;
+
+	// --------------------------------------------------------
+	// Precomputed vertex scores, based on where the vertex is
+	// in the cache and how many triangles still use it
+	// --------------------------------------------------------
+	struct VertexScoreTable
+	{
+		float Cache[VERTEX_CACHE_OPTIMIZE_SIZE + 1]; // [0] is "not in cache"
+		float Valence[MaxScoredValence + 1];
+
+		VertexScoreTable()
+		{
+			Cache[0] = 0.0f;
+			for (unsigned int i = 0; i < VERTEX_CACHE_OPTIMIZE_SIZE; i++)
+			{
+				// The most recent triangle's verts get a fixed score, so
+				// the very next triangle doesn't just reuse its edge
+				if (i < 3)
+					Cache[i + 1] = LastTriangleScore;
+				else
+				{
+					float scaler = 1.0f / (VERTEX_CACHE_OPTIMIZE_SIZE - 3);
+					Cache[i + 1] = powf(1.0f - (i - 3) * scaler, CacheDecayPower);
+				}
+			}
+
+			// Boost verts with few triangles left, to get rid of them
+			Valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= MaxScoredValence; i++)
+				Valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+		}
+
+		// cachePosition is -1 for verts not in the cache
+		float Score(int cachePosition, unsigned int valence) const
+		{
+			if (valence == 0)
+				return -1.0f; // Not needed any more
+
+			return Cache[cachePosition + 1] + Valence[valence < MaxScoredValence ? valence : MaxScoredValence];
+		}
+	};
+
+	// --------------------------------------------------------
+	// A simulated FIFO post-transform cache.  Each vertex
+	// remembers when it entered the cache (counted in misses),
+	// and is still there if fewer than cacheSize misses have
+	// happened since.
+	// --------------------------------------------------------
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t numVerts, unsigned int cacheSize) :
+			cachedAt(numVerts, 0),
+			time(0),
+			cacheSize(cacheSize)
+		{
+		}
+
+		// Returns the number of misses (vertex shader invocations)
+		unsigned int AccessTriangle(const unsigned int* tri)
+		{
+			return Access(tri[0]) + Access(tri[1]) + Access(tri[2]);
+		}
+
+		bool Access(unsigned int v)
+		{
+			if (cachedAt[v] != 0 && time - cachedAt[v] < cacheSize)
+				return false;
+
+			time++;
+			cachedAt[v] = time;
+			return true;
+		}
+
+		// Evicts everything
+		void Flush() { time += cacheSize; }
+
+	private:
+		std::vector<size_t> cachedAt;
+		size_t time;
+		unsigned int cacheSize;
+	};
+
+	// Sort key and range of one cluster of triangles
+	struct TriangleCluster
+	{
+		float SortKey;
+		size_t FirstTriangle;
+		size_t TriangleCount;
+	};
+
+	// --------------------------------------------------------
+	// Scores each cluster by how far its (area-weighted)
+	// average normal points away from the center of all the
+	// given triangles: clusters facing outwards the most tend
+	// to occlude everything else from most directions
+	// --------------------------------------------------------
+	void ScoreClusters(const Vertex* verts, const unsigned int* indices, size_t numTriangles, std::vector<TriangleCluster>& clusters)
+	{
+		// Center of the whole mesh
+		XMVECTOR meshCenter = XMVectorZero();
+		for (size_t i = 0; i < numTriangles * 3; i++)
+			meshCenter = XMVectorAdd(meshCenter, XMLoadFloat3(&verts[indices[i]].Position));
+		meshCenter = XMVectorScale(meshCenter, 1.0f / (numTriangles * 3));
+
+		// Score each cluster using its area-weighted center & normal
+		for (TriangleCluster& cluster : clusters)
+		{
+			XMVECTOR center = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0.0f;
+			for (size_t t = cluster.FirstTriangle; t < cluster.FirstTriangle + cluster.TriangleCount; t++)
+			{
+				XMVECTOR p0 = XMLoadFloat3(&verts[indices[t * 3 + 0]].Position);
+				XMVECTOR p1 = XMLoadFloat3(&verts[indices[t * 3 + 1]].Position);
+				XMVECTOR p2 = XMLoadFloat3(&verts[indices[t * 3 + 2]].Position);
+
+				// Length of the cross product is (twice) the area
+				XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+				float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+				center = XMVectorAdd(center, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+				normal = XMVectorAdd(normal, cross);
+				area += triangleArea;
+			}
+
+			if (area > 0.0f)
+				center = XMVectorScale(center, 1.0f / area);
+
+			cluster.SortKey = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, meshCenter), XMVector3Normalize(normal)));
+		}
+	}
+
+	// Rewrites the triangles so the clusters are in the given order
+	void WriteClusters(unsigned int* indices, size_t numTriangles, const std::vector<TriangleCluster>& clusters)
+	{
+		std::vector<unsigned int> output;
+		output.reserve(numTriangles * 3);
+		for (const TriangleCluster& cluster : clusters)
+		{
+			const unsigned int* first = &indices[cluster.FirstTriangle * 3];
+			output.insert(output.end(), first, first + cluster.TriangleCount * 3);
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+}
+
+
+// --------------------------------------------------------
+// Measures the vertex cache efficiency of the given index
+// buffer by simulating a FIFO cache of the given size.
+//
+// indices    - Triangle list indices
+// numIndices - The number of indices
+// numVerts   - The number of verts the indices refer to
+// cacheSize  - Entries in the simulated cache
+// --------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (numIndices < 3 || numVerts == 0 || cacheSize == 0)
+		return stats;
+
+	FifoCache cache(numVerts, cacheSize);
+	std::vector<bool> used(numVerts, false);
+	size_t misses = 0;
+	size_t uniqueVerts = 0;
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		unsigned int v = indices[i];
+		if (v >= numVerts)
+			continue;
+
+		misses += cache.Access(v);
+		if (!used[v])
+		{
+			used[v] = true;
+			uniqueVerts++;
+		}
+	}
+
+	stats.ACMR = (float)misses / (numIndices / 3);
+	stats.ATVR = uniqueVerts > 0 ? (float)misses / uniqueVerts : 0.0f;
+	return stats;
+}
+
+
+// --------------------------------------------------------
+// Reorders triangles to make the best use of the GPU's
+// post-transform vertex cache, using Forsyth's algorithm:
+// each vertex is scored by its position in a simulated LRU
+// cache and by how many triangles still need it, and the
+// unemitted triangle with the highest total score goes next.
+// Only triangles touching the cache change score after each
+// step, so the whole thing is (roughly) linear.
+//
+// indices    - Triangle list indices, reordered in place
+// numIndices - The number of indices
+// numVerts   - The number of verts the indices refer to
+// --------------------------------------------------------
+void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts)
+{
+	size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0 || numVerts == 0)
+		return;
+
+	static const VertexScoreTable scoreTable;
+
+	// Triangles using each vertex (all in one array, with each
+	// vertex's triangles starting at triangleOffsets[v])
+	std::vector<unsigned int> valence(numVerts, 0);
+	for (size_t i = 0; i < numTriangles * 3; i++)
+		valence[indices[i]]++;
+
+	std::vector<unsigned int> triangleOffsets(numVerts + 1, 0);
+	for (size_t v = 0; v < numVerts; v++)
+		triangleOffsets[v + 1] = triangleOffsets[v] + valence[v];
+
+	std::vector<unsigned int> vertexTriangles(triangleOffsets[numVerts]);
+	std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t i = 0; i < numTriangles * 3; i++)
+		vertexTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	// Initial scores (nothing is in the cache yet)
+	std::vector<float> vertexScores(numVerts);
+	for (size_t v = 0; v < numVerts; v++)
+		vertexScores[v] = scoreTable.Score(-1, valence[v]);
+
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool> emitted(numTriangles, false);
+	unsigned int bestTriangle = 0;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		triangleScores[t] =
+			vertexScores[indices[t * 3 + 0]] +
+			vertexScores[indices[t * 3 + 1]] +
+			vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = (unsigned int)t;
+	}
+
+	// The simulated cache, plus room for a new triangle's verts
+	unsigned int cache[VERTEX_CACHE_OPTIMIZE_SIZE + 3];
+	unsigned int newCache[VERTEX_CACHE_OPTIMIZE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	std::vector<unsigned int> output(numTriangles * 3);
+	size_t nextUnemitted = 0; // For when there's no good triangle nearby
+	for (size_t outTriangle = 0; outTriangle < numTriangles; outTriangle++)
+	{
+		// Nothing in the cache leads anywhere?  Pick up the next
+		// unemitted triangle in the original order.
+		if (emitted[bestTriangle])
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (unsigned int)nextUnemitted;
+		}
+
+		// Emit the triangle and remove it from its verts' lists
+		const unsigned int* tri = &indices[bestTriangle * 3];
+		output[outTriangle * 3 + 0] = tri[0];
+		output[outTriangle * 3 + 1] = tri[1];
+		output[outTriangle * 3 + 2] = tri[2];
+		emitted[bestTriangle] = true;
+
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int i = 0; i < valence[v]; i++)
+			{
+				if (list[i] == bestTriangle)
+				{
+					list[i] = list[valence[v] - 1];
+					valence[v]--;
+					break;
+				}
+			}
+		}
+
+		// The triangle's verts move to the front of the cache,
+		// followed by everything else that was there
+		unsigned int newCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			bool duplicate = false;
+			for (unsigned int i = 0; i < newCount; i++)
+				duplicate |= newCache[i] == tri[c];
+			if (!duplicate)
+				newCache[newCount++] = tri[c];
+		}
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything past the end has been evicted
+		for (unsigned int i = VERTEX_CACHE_OPTIMIZE_SIZE; i < newCount; i++)
+			vertexScores[newCache[i]] = scoreTable.Score(-1, valence[newCache[i]]);
+
+		cacheCount = newCount < VERTEX_CACHE_OPTIMIZE_SIZE ? newCount : VERTEX_CACHE_OPTIMIZE_SIZE;
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cache[i] = v;
+			vertexScores[v] = scoreTable.Score(i, valence[v]);
+		}
+
+		// Rescore triangles touching the cache (or just evicted from
+		// it), keeping track of the best one for next time
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int j = 0; j < valence[v]; j++)
+			{
+				unsigned int t = list[j];
+				triangleScores[t] =
+					vertexScores[indices[t * 3 + 0]] +
+					vertexScores[indices[t * 3 + 1]] +
+					vertexScores[indices[t * 3 + 2]];
+
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+
+// --------------------------------------------------------
+// Reorders triangles to reduce overdraw within the mesh
+// itself, while keeping most of the vertex cache efficiency.
+// Based on "Fast Triangle Reordering for Vertex Locality and
+// Reduced Overdraw" (Sander, Nehab & Barczak, 2007):
+//  - The (already cache-optimized) triangles are split into
+//    clusters, first wherever the cache starts over, then
+//    again wherever a cluster's ACMR is already within
+//    threshold of its full range's ACMR
+//  - Each cluster is scored by how far its average normal
+//    points away from the center of the mesh, and clusters
+//    facing outwards the most are drawn first, since they
+//    tend to occlude everything else from most directions
+//
+// verts      - The mesh's vertices (only positions are used)
+// numVerts   - The number of verts in the array
+// indices    - Triangle list indices, reordered in place
+// numIndices - The number of indices
+// threshold  - How much worse the ACMR is allowed to get (1.05 = 5%)
+// --------------------------------------------------------
+void OptimizeOverdraw(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices, float threshold)
+{
+	size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0 || numVerts == 0)
+		return;
+
+	// Hard boundaries: triangles that miss the cache on all
+	// three verts are (almost always) the start of a new patch
+	std::vector<size_t> hardBoundaries;
+	FifoCache cache(numVerts, VERTEX_CACHE_ANALYZE_SIZE);
+	for (size_t t = 0; t < numTriangles; t++)
+		if (cache.AccessTriangle(&indices[t * 3]) == 3 || t == 0)
+			hardBoundaries.push_back(t);
+	hardBoundaries.push_back(numTriangles);
+
+	// Soft boundaries: split each patch into clusters that
+	// (on their own) are about as cache-efficient as the patch
+	std::vector<size_t> boundaries;
+	for (size_t b = 0; b + 1 < hardBoundaries.size(); b++)
+	{
+		size_t start = hardBoundaries[b];
+		size_t end = hardBoundaries[b + 1];
+
+		cache.Flush();
+		size_t patchMisses = 0;
+		for (size_t t = start; t < end; t++)
+			patchMisses += cache.AccessTriangle(&indices[t * 3]);
+		float targetACMR = threshold * patchMisses / (end - start);
+
+		boundaries.push_back(start);
+		cache.Flush();
+		size_t misses = 0;
+		size_t triangles = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			misses += cache.AccessTriangle(&indices[t * 3]);
+			triangles++;
+
+			// Good enough to stand alone?  Start a new cluster.
+			if ((float)misses / triangles <= targetACMR)
+			{
+				boundaries.push_back(t + 1);
+				cache.Flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+
+		// The leftover triangles at the end rarely make a good
+		// cluster, so merge them into the previous one (this also
+		// removes an empty cluster if the patch ended exactly)
+		if (boundaries.back() != start)
+			boundaries.pop_back();
+	}
+	boundaries.push_back(numTriangles);
+
+	std::vector<TriangleCluster> clusters(boundaries.size() - 1);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		clusters[c].FirstTriangle = boundaries[c];
+		clusters[c].TriangleCount = boundaries[c + 1] - boundaries[c];
+	}
+	ScoreClusters(verts, indices, numTriangles, clusters);
+
+	// Most outward-facing clusters first
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const TriangleCluster& a, const TriangleCluster& b) { return a.SortKey > b.SortKey; });
+	WriteClusters(indices, numTriangles, clusters);
+}
+
+
+// --------------------------------------------------------
+// Estimates how much overdraw the mesh causes by rendering
+// it (depth only, back faces culled, triangles in index
+// buffer order) with a tiny software rasterizer from a set
+// of orthographic views evenly spread around the mesh.
+// Overdraw is then the number of pixels that passed the
+// depth test (and so would have been shaded) divided by the
+// number of pixels covered.
+//
+// verts      - The mesh's vertices (only positions are used)
+// numVerts   - The number of verts in the array
+// indices    - Triangle list indices
+// numIndices - The number of indices
+// viewCount  - The number of directions to render from
+// --------------------------------------------------------
+OverdrawStats AnalyzeOverdraw(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, unsigned int viewCount)
+{
+	OverdrawStats stats = {};
+	if (numIndices < 3 || numVerts == 0 || viewCount == 0)
+		return stats;
+
+	// Bounding sphere (roughly) so every view fits the whole mesh
+	XMVECTOR boundsMin = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (size_t i = 1; i < numVerts; i++)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&verts[i].Position));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&verts[i].Position));
+	}
+	XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+	float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, center)));
+	if (radius <= 0.0f)
+		return stats;
+
+	const int res = OVERDRAW_ANALYZE_RESOLUTION;
+	float toPixels = (res - 1) / (2.0f * radius);
+
+	std::vector<float> depthBuffer(res * res);
+	std::vector<XMFLOAT3> projected(numVerts);
+	for (unsigned int view = 0; view < viewCount; view++)
+	{
+		// Directions spiral evenly over a sphere (a "Fibonacci sphere")
+		float y = 1.0f - 2.0f * (view + 0.5f) / viewCount;
+		float ring = sqrtf(1.0f - y * y);
+		float angle = view * XM_PI * (3.0f - sqrtf(5.0f));
+		XMVECTOR forward = XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0);
+
+		// Left-handed basis for the view (any up vector not parallel to forward)
+		XMVECTOR up = fabsf(y) < 0.99f ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(up, forward));
+		up = XMVector3Cross(forward, right);
+
+		// Project to pixel coordinates (x right, y up) plus depth
+		for (size_t i = 0; i < numVerts; i++)
+		{
+			XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&verts[i].Position), center);
+			projected[i].x = (XMVectorGetX(XMVector3Dot(offset, right)) + radius) * toPixels;
+			projected[i].y = (XMVectorGetX(XMVector3Dot(offset, up)) + radius) * toPixels;
+			projected[i].z = XMVectorGetX(XMVector3Dot(offset, forward));
+		}
+
+		std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+		for (size_t t = 0; t + 2 < numIndices; t += 3)
+		{
+			const XMFLOAT3& a = projected[indices[t + 0]];
+			const XMFLOAT3& b = projected[indices[t + 1]];
+			const XMFLOAT3& c = projected[indices[t + 2]];
+
+			// Front faces are clockwise on screen (negative area)
+			float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+			if (area >= 0.0f)
+				continue;
+
+			int minX = std::max(0, (int)ceilf(std::min(a.x, std::min(b.x, c.x)) - 0.5f));
+			int maxX = std::min(res - 1, (int)floorf(std::max(a.x, std::max(b.x, c.x)) - 0.5f));
+			int minY = std::max(0, (int)ceilf(std::min(a.y, std::min(b.y, c.y)) - 0.5f));
+			int maxY = std::min(res - 1, (int)floorf(std::max(a.y, std::max(b.y, c.y)) - 0.5f));
+
+			// Test each pixel center using barycentric coordinates
+			float invArea = 1.0f / area;
+			for (int py = minY; py <= maxY; py++)
+			{
+				for (int px = minX; px <= maxX; px++)
+				{
+					float x = px + 0.5f;
+					float y = py + 0.5f;
+					float w0 = ((c.x - b.x) * (y - b.y) - (c.y - b.y) * (x - b.x)) * invArea;
+					float w1 = ((a.x - c.x) * (y - c.y) - (a.y - c.y) * (x - c.x)) * invArea;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+
+					float depth = w0 * a.z + w1 * b.z + w2 * c.z;
+					float& stored = depthBuffer[py * res + px];
+					if (depth < stored)
+					{
+						stored = depth;
+						stats.ShadedPixels++;
+					}
+				}
+			}
+		}
+
+		for (float depth : depthBuffer)
+			if (depth != FLT_MAX)
+				stats.CoveredPixels++;
+	}
+
+	stats.Overdraw = stats.CoveredPixels > 0 ? (float)stats.ShadedPixels / stats.CoveredPixels : 0.0f;
+	return stats;
+}
+
+
+// --------------------------------------------------------
+// Reorders vertices so they appear in the same order the
+// index buffer first references them, meaning vertex fetches
+// walk (mostly) linearly through memory.  Should be run after
+// OptimizeVertexCache(), since it depends on triangle order.
+// --------------------------------------------------------
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int Unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(mesh.Vertices.size(), Unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(mesh.Vertices.size());
+
+	for (unsigned int& index : mesh.Indices)
+	{
+		if (remap[index] == Unused)
+		{
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(mesh.Vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.Vertices.swap(reordered);
+}
+
+
+// --------------------------------------------------------
+// Building meshlets regroups the full detail triangles, which
+// would undo OptimizeMesh()'s ordering.  This puts it back
+// without changing any meshlet's set of triangles (so their
+// bounds stay valid):
+//  - Each meshlet's triangles are vertex cache optimized on
+//    their own (at most MESHLET_MAX_VERTICES vertices, so it
+//    runs on local indices, whatever the mesh's size)
+//  - Each submesh's meshlets are then the clusters for the
+//    overdraw ordering: most outward-facing first
+// Meshlets' index ranges are updated to match.
+// --------------------------------------------------------
+void OptimizeMeshlets(MeshData& mesh)
+{
+	std::vector<unsigned int> localIndices;
+	std::vector<unsigned int> localToMesh;
+	std::vector<unsigned int> meshToLocal(mesh.Vertices.size(), UINT_MAX);
+	for (Meshlet& meshlet : mesh.Meshlets)
+	{
+		unsigned int* indices = &mesh.Indices[meshlet.FirstIndex];
+		size_t numIndices = meshlet.TriangleCount * 3;
+
+		localIndices.resize(numIndices);
+		localToMesh.clear();
+		for (size_t i = 0; i < numIndices; i++)
+		{
+			unsigned int& local = meshToLocal[indices[i]];
+			if (local == UINT_MAX)
+			{
+				local = (unsigned int)localToMesh.size();
+				localToMesh.push_back(indices[i]);
+			}
+			localIndices[i] = local;
+		}
+
+		OptimizeVertexCache(localIndices.data(), numIndices, localToMesh.size());
+		for (size_t i = 0; i < numIndices; i++)
+			indices[i] = localToMesh[localIndices[i]];
+		for (unsigned int v : localToMesh)
+			meshToLocal[v] = UINT_MAX;
+	}
+
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		if (submesh.MeshletCount == 0)
+			continue;
+
+		Meshlet* meshlets = &mesh.Meshlets[submesh.FirstMeshlet];
+		unsigned int* indices = &mesh.Indices[submesh.FirstIndex[0]];
+		size_t numTriangles = submesh.IndexCount[0] / 3;
+
+		std::vector<TriangleCluster> clusters(submesh.MeshletCount);
+		for (unsigned int m = 0; m < submesh.MeshletCount; m++)
+		{
+			clusters[m].FirstTriangle = (meshlets[m].FirstIndex - submesh.FirstIndex[0]) / 3;
+			clusters[m].TriangleCount = meshlets[m].TriangleCount;
+		}
+		ScoreClusters(mesh.Vertices.data(), indices, numTriangles, clusters);
+
+		// Sort the meshlets along with their clusters
+		std::vector<unsigned int> order(submesh.MeshletCount);
+		for (unsigned int m = 0; m < submesh.MeshletCount; m++)
+			order[m] = m;
+		std::stable_sort(order.begin(), order.end(),
+			[&](unsigned int a, unsigned int b) { return clusters[a].SortKey > clusters[b].SortKey; });
+
+		std::vector<TriangleCluster> sortedClusters;
+		std::vector<Meshlet> sortedMeshlets;
+		unsigned int firstIndex = submesh.FirstIndex[0];
+		for (unsigned int m : order)
+		{
+			sortedClusters.push_back(clusters[m]);
+			sortedMeshlets.push_back(meshlets[m]);
+			sortedMeshlets.back().FirstIndex = firstIndex;
+			firstIndex += meshlets[m].TriangleCount * 3;
+		}
+
+		WriteClusters(indices, numTriangles, sortedClusters);
+		std::copy(sortedMeshlets.begin(), sortedMeshlets.end(), meshlets);
+	}
+}
+
+
+// --------------------------------------------------------
+// Optimizes a mesh for vertex cache efficiency, overdraw and
+// vertex fetch efficiency (in that order, since each pass
+// builds on the previous one).  Purely CPU-side, so it can
+// run offline.  Triangles are only reordered within their
+// own submesh, so each submesh stays a single range.
+// --------------------------------------------------------
+MeshOptimizationStats OptimizeMesh(MeshData& mesh)
+{
+	MeshOptimizationStats stats = {};
+	stats.Before = AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	stats.OverdrawBefore = AnalyzeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+
+	AddDefaultSubmesh(mesh);
+	for (const MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		unsigned int* indices = mesh.Indices.data() + submesh.FirstIndex[0];
+		OptimizeVertexCache(indices, submesh.IndexCount[0], mesh.Vertices.size());
+		OptimizeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), indices, submesh.IndexCount[0]);
+	}
+	OptimizeVertexFetch(mesh);
+
+	stats.After = AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	stats.OverdrawAfter = AnalyzeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+	return stats;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MeshData.h"
+
+// Size of the (LRU) cache that triangle ordering targets
+#define VERTEX_CACHE_OPTIMIZE_SIZE 32
+
+// Size of the (FIFO) cache used when measuring, which is a
+// reasonable stand-in for the post-transform cache of actual GPUs
+#define VERTEX_CACHE_ANALYZE_SIZE 16
+
+// How much worse the ACMR may get in exchange for less overdraw
+#define OVERDRAW_OPTIMIZE_THRESHOLD 1.05f
+
+// Number of views, and their size in pixels, used to estimate overdraw
+#define OVERDRAW_ANALYZE_VIEWS 16
+#define OVERDRAW_ANALYZE_RESOLUTION 256
+
+// --------------------------------------------------------
+// Post-transform vertex cache efficiency of an index buffer
+//  - ACMR: Vertex shader invocations per triangle (0.5 - 3.0)
+//  - ATVR: Vertex shader invocations per unique vertex (1.0+)
+// Lower is better for both.
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	float ACMR;
+	float ATVR;
+};
+
+// --------------------------------------------------------
+// Overdraw within a single mesh, summed over several views
+//  - Overdraw: Pixels shaded per pixel covered (1.0+)
+// --------------------------------------------------------
+struct OverdrawStats
+{
+	unsigned int CoveredPixels;
+	unsigned int ShadedPixels;
+	float Overdraw;
+};
+
+// Efficiency before and after OptimizeMesh()
+struct MeshOptimizationStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+	OverdrawStats OverdrawBefore;
+	OverdrawStats OverdrawAfter;
+};
+
+// Simulates a FIFO post-transform cache over the given triangles
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts, unsigned int cacheSize = VERTEX_CACHE_ANALYZE_SIZE);
+
+// Reorders triangles (in place) for post-transform cache hits
+void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts);
+
+// Reorders (cache optimized) triangles to reduce overdraw within the mesh
+void OptimizeOverdraw(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices, float threshold = OVERDRAW_OPTIMIZE_THRESHOLD);
+
+// Renders the mesh on the CPU from several directions to measure overdraw
+OverdrawStats AnalyzeOverdraw(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, unsigned int viewCount = OVERDRAW_ANALYZE_VIEWS);
+
+// Reorders vertices into the order they're first used, for
+// memory locality when fetching them.  Unused vertices are removed.
+void OptimizeVertexFetch(MeshData& mesh);
+
+// Restores vertex cache & overdraw ordering after meshlets are
+// built, within each meshlet and then between them
+void OptimizeMeshlets(MeshData& mesh);
+
+// Runs all passes above, returning stats from before & after
+MeshOptimizationStats OptimizeMesh(MeshData& mesh);
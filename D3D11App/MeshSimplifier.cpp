@@ -0,0 +1,698 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int NoVertex = 0xFFFFFFFF;
+
+	// How a vertex is allowed to move, based on the topology around it
+	enum VertexKind
+	{
+		VertexManifold,		// Inside the surface: can collapse onto any neighbor
+		VertexBorder,		// On an open edge: can only slide along it
+		VertexSeam,			// On a UV/normal seam: both copies slide along it together
+		VertexLocked		// Anything more complex: never moves
+	};
+
+	// Can a vertex of one kind (row) collapse onto a vertex of another kind (column)?
+	const bool CanCollapse[4][4] =
+	{
+		{ true,  true,  true,  true  },
+		{ false, true,  false, false },
+		{ false, false, true,  false },
+		{ false, false, false, false },
+	};
+
+	// Extra weight for the planes that keep borders & seams in place
+	const float EdgeWeight = 4.0f;
+
+	// --------------------------------------------------------
+	// The weighted sum of squared distances to a set of planes,
+	// stored as a symmetric 3x3 matrix A, a vector b and a
+	// constant c, so that error(p) = p'Ap + 2b'p + c, along with
+	// the total weight (so the error can be made an average)
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		float A00, A11, A22, A10, A20, A21;
+		float B0, B1, B2;
+		float C;
+		float Weight;
+	};
+
+	void AddPlane(Quadric& q, const XMFLOAT3& n, float d, float weight)
+	{
+		q.A00 += weight * n.x * n.x;
+		q.A11 += weight * n.y * n.y;
+		q.A22 += weight * n.z * n.z;
+		q.A10 += weight * n.y * n.x;
+		q.A20 += weight * n.z * n.x;
+		q.A21 += weight * n.z * n.y;
+		q.B0 += weight * n.x * d;
+		q.B1 += weight * n.y * d;
+		q.B2 += weight * n.z * d;
+		q.C += weight * d * d;
+		q.Weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.A00 += other.A00;
+		q.A11 += other.A11;
+		q.A22 += other.A22;
+		q.A10 += other.A10;
+		q.A20 += other.A20;
+		q.A21 += other.A21;
+		q.B0 += other.B0;
+		q.B1 += other.B1;
+		q.B2 += other.B2;
+		q.C += other.C;
+		q.Weight += other.Weight;
+	}
+
+	// Weighted average of the squared distances from p to the planes
+	float QuadricError(const Quadric& q, const XMFLOAT3& p)
+	{
+		float rx = q.A00 * p.x + q.A10 * p.y + q.A20 * p.z;
+		float ry = q.A10 * p.x + q.A11 * p.y + q.A21 * p.z;
+		float rz = q.A20 * p.x + q.A21 * p.y + q.A22 * p.z;
+		float r = rx * p.x + ry * p.y + rz * p.z + 2.0f * (q.B0 * p.x + q.B1 * p.y + q.B2 * p.z) + q.C;
+		return q.Weight > 0.0f ? fabsf(r) / q.Weight : 0.0f;
+	}
+
+	// Moving one vertex onto another, and the error that causes
+	struct EdgeCollapse
+	{
+		unsigned int From;
+		unsigned int To;
+		float Error;
+	};
+
+	// --------------------------------------------------------
+	// Lists of items (edges or triangles) per vertex, stored
+	// back to back in a single array
+	// --------------------------------------------------------
+	struct VertexAdjacency
+	{
+		std::vector<unsigned int> Offsets;
+		std::vector<unsigned int> Counts;
+		std::vector<unsigned int> Data;
+
+		// Sizes the lists, then returns the (empty) array to fill
+		void Prepare(size_t numVerts)
+		{
+			Offsets.assign(numVerts + 1, 0);
+			for (size_t v = 0; v < numVerts; v++)
+				Offsets[v + 1] = Offsets[v] + Counts[v];
+
+			Data.resize(Offsets[numVerts]);
+			std::fill(Counts.begin(), Counts.end(), 0);
+		}
+
+		void Add(unsigned int v, unsigned int item) { Data[Offsets[v] + Counts[v]++] = item; }
+		const unsigned int* Begin(unsigned int v) const { return &Data[Offsets[v]]; }
+		const unsigned int* End(unsigned int v) const { return &Data[Offsets[v]] + Counts[v]; }
+	};
+
+	// Outgoing edges of each vertex (its next corner in every triangle)
+	void BuildEdgeAdjacency(VertexAdjacency& edges, const unsigned int* indices, size_t numIndices, size_t numVerts)
+	{
+		edges.Counts.assign(numVerts, 0);
+		for (size_t i = 0; i < numIndices; i++)
+			edges.Counts[indices[i]]++;
+
+		edges.Prepare(numVerts);
+		for (size_t t = 0; t < numIndices; t += 3)
+			for (int e = 0; e < 3; e++)
+				edges.Add(indices[t + e], indices[t + (e + 1) % 3]);
+	}
+
+	bool HasEdge(const VertexAdjacency& edges, unsigned int a, unsigned int b)
+	{
+		return std::find(edges.Begin(a), edges.End(a), b) != edges.End(a);
+	}
+
+	// Triangles touching each position (via the canonical vertex there)
+	void BuildTriangleAdjacency(VertexAdjacency& triangles, const unsigned int* indices, size_t numIndices, const std::vector<unsigned int>& remap)
+	{
+		triangles.Counts.assign(remap.size(), 0);
+		for (size_t i = 0; i < numIndices; i++)
+			triangles.Counts[remap[indices[i]]]++;
+
+		triangles.Prepare(remap.size());
+		for (size_t i = 0; i < numIndices; i++)
+			triangles.Add(remap[indices[i]], (unsigned int)(i / 3));
+	}
+
+	// Distance from a point to the closest point on a triangle
+	// (Ericson, Real-Time Collision Detection, 5.1.5)
+	float PointTriangleDistance(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+		XMVECTOR ap = XMVectorSubtract(p, a);
+		XMVECTOR bp = XMVectorSubtract(p, b);
+		XMVECTOR cp = XMVectorSubtract(p, c);
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		float va = d3 * d6 - d5 * d4;
+		float vb = d5 * d2 - d1 * d6;
+		float vc = d1 * d4 - d3 * d2;
+
+		XMVECTOR closest;
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			closest = a;
+		else if (d3 >= 0.0f && d4 <= d3)
+			closest = b;
+		else if (d6 >= 0.0f && d5 <= d6)
+			closest = c;
+		else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			closest = XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+		else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			closest = XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+		else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			closest = XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+		else
+		{
+			float denominator = 1.0f / (va + vb + vc);
+			closest = XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+		}
+
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(p, closest)));
+	}
+}
+
+
+// --------------------------------------------------------
+// Simplifies a mesh using the quadric error metric (Garland
+// & Heckbert, 1997).  Every edge collapse moves one vertex
+// onto another existing vertex, so the result is just a new
+// index buffer for the same vertex buffer.
+//
+// Vertices are classified by the topology around them, so
+// that open borders and UV/normal seams (where the same
+// position appears in multiple vertices) keep their shape:
+// vertices on them can only slide along them, and both
+// sides of a seam are always collapsed together.
+//
+// Collapses happen in passes: all candidate edges are scored,
+// then the cheapest are performed (skipping any that would
+// flip a triangle, or touch a vertex already moved this pass)
+// until the target is reached.
+//
+// verts            - The mesh's vertices (only positions are used)
+// numVerts         - The number of verts in the array
+// indices          - Triangle list indices to simplify
+// numIndices       - The number of indices
+// targetIndexCount - Stop once there are this many indices (or fewer)
+// maxError         - Stop before the estimated (quadric) error exceeds this
+// destination      - Receives the new indices (room for numIndices)
+// resultError      - Receives the measured error, in object space (optional)
+// sourceTriangles  - Receives, for each triangle written, which input
+//                    triangle it came from (optional, room for
+//                    numIndices / 3).  Triangles are never created,
+//                    only removed, and the rest keep their order.
+//
+// Returns the number of indices written to destination
+// --------------------------------------------------------
+size_t SimplifyMesh(
+	const Vertex* verts,
+	size_t numVerts,
+	const unsigned int* indices,
+	size_t numIndices,
+	size_t targetIndexCount,
+	float maxError,
+	unsigned int* destination,
+	float* resultError,
+	unsigned int* sourceTriangles)
+{
+	size_t resultCount = numIndices / 3 * 3;
+	std::copy(indices, indices + resultCount, destination);
+	for (size_t t = 0; sourceTriangles && t < resultCount / 3; t++)
+		sourceTriangles[t] = (unsigned int)t;
+	if (resultError)
+		*resultError = 0.0f;
+	if (numVerts == 0 || resultCount <= targetIndexCount)
+		return resultCount;
+
+	// Work with positions scaled to a unit cube, for precision
+	XMVECTOR boundsMin = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (size_t v = 1; v < numVerts; v++)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&verts[v].Position));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&verts[v].Position));
+	}
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, XMVectorSubtract(boundsMax, boundsMin));
+	float extent = std::max(extents.x, std::max(extents.y, extents.z));
+	if (extent <= 0.0f)
+		return resultCount;
+
+	float scale = 1.0f / extent;
+	std::vector<XMFLOAT3> positions(numVerts);
+	for (size_t v = 0; v < numVerts; v++)
+		XMStoreFloat3(&positions[v], XMVectorScale(XMVectorSubtract(XMLoadFloat3(&verts[v].Position), boundsMin), scale));
+
+	// Verts sharing a position (seams) form a circular list of
+	// "wedges", and one canonical vertex stands in for all of them
+	std::vector<unsigned int> remap(numVerts);
+	std::vector<unsigned int> wedge(numVerts);
+	RemapSharedPositions(verts, numVerts, remap.data());
+	for (unsigned int v = 0; v < numVerts; v++)
+	{
+		unsigned int first = remap[v];
+		wedge[v] = wedge[first];
+		wedge[first] = v;
+	}
+
+	// Find open edges (with no matching edge going the other way),
+	// remembering the open edges leaving & entering each vertex
+	VertexAdjacency edges;
+	BuildEdgeAdjacency(edges, destination, resultCount, numVerts);
+
+	std::vector<unsigned int> loop(numVerts, NoVertex);
+	std::vector<unsigned int> loopback(numVerts, NoVertex);
+	std::vector<unsigned int> openOut(numVerts, 0);
+	std::vector<unsigned int> openIn(numVerts, 0);
+	for (size_t t = 0; t < resultCount; t += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = destination[t + e];
+			unsigned int b = destination[t + (e + 1) % 3];
+			if (!HasEdge(edges, b, a))
+			{
+				loop[a] = b;
+				loopback[b] = a;
+				openOut[a]++;
+				openIn[b]++;
+			}
+		}
+	}
+
+	// Classify each position, and give all of its verts that kind
+	std::vector<unsigned char> kind(numVerts, VertexLocked);
+	for (unsigned int v = 0; v < numVerts; v++)
+	{
+		if (remap[v] != v)
+			continue;
+
+		unsigned int w = wedge[v];
+		VertexKind k = VertexLocked;
+		if (w == v)
+		{
+			// Just one vertex here: either surrounded, or on a single border
+			if (openOut[v] == 0 && openIn[v] == 0)
+				k = VertexManifold;
+			else if (openOut[v] == 1 && openIn[v] == 1)
+				k = VertexBorder;
+		}
+		else if (wedge[w] == v)
+		{
+			// Two verts here: a seam if each has one open edge in and
+			// one out, and they run opposite each other along the seam
+			if (openOut[v] == 1 && openIn[v] == 1 && openOut[w] == 1 && openIn[w] == 1 &&
+				remap[loop[v]] == remap[loopback[w]] &&
+				remap[loopback[v]] == remap[loop[w]])
+				k = VertexSeam;
+		}
+
+		unsigned int u = v;
+		do
+		{
+			kind[u] = (unsigned char)k;
+			u = wedge[u];
+		} while (u != v);
+	}
+
+	// Each position's quadric starts with the planes of its
+	// triangles (weighted by area), plus perpendicular planes
+	// along open edges so that borders & seams resist moving
+	std::vector<Quadric> quadrics(numVerts, Quadric{});
+	for (size_t t = 0; t < resultCount; t += 3)
+	{
+		XMVECTOR p[3];
+		for (int c = 0; c < 3; c++)
+			p[c] = XMLoadFloat3(&positions[destination[t + c]]);
+
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+		float area = 0.5f * XMVectorGetX(XMVector3Length(normal));
+		if (area <= 0.0f)
+			continue;
+		normal = XMVector3Normalize(normal);
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		float d = -XMVectorGetX(XMVector3Dot(normal, p[0]));
+		for (int c = 0; c < 3; c++)
+			AddPlane(quadrics[remap[destination[t + c]]], n, d, area);
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = destination[t + e];
+			unsigned int b = destination[t + (e + 1) % 3];
+			if (HasEdge(edges, b, a))
+				continue;
+
+			XMVECTOR edge = XMVectorSubtract(p[(e + 1) % 3], p[e]);
+			XMVECTOR edgeNormal = XMVector3Normalize(XMVector3Cross(edge, normal));
+			XMFLOAT3 en;
+			XMStoreFloat3(&en, edgeNormal);
+			float ed = -XMVectorGetX(XMVector3Dot(edgeNormal, p[e]));
+			float weight = EdgeWeight * XMVectorGetX(XMVector3LengthSq(edge));
+			AddPlane(quadrics[remap[a]], en, ed, weight);
+			AddPlane(quadrics[remap[b]], en, ed, weight);
+		}
+	}
+
+	// Can this exact edge collapse in this direction?
+	auto canCollapseEdge = [&](unsigned int from, unsigned int to)
+		{
+			if (!CanCollapse[kind[from]][kind[to]])
+				return false;
+
+			// Borders & seams can only slide along their own edges
+			if (kind[from] == VertexBorder || kind[from] == VertexSeam)
+				return loop[from] == to || loopback[from] == to;
+
+			return true;
+		};
+
+	// Error of moving one position onto another
+	auto collapseError = [&](unsigned int from, unsigned int to)
+		{
+			Quadric q = quadrics[remap[from]];
+			AddQuadric(q, quadrics[remap[to]]);
+			return QuadricError(q, positions[to]);
+		};
+
+	// Would moving this position flip (or nearly flip) any of its triangles?
+	VertexAdjacency triangles;
+	std::vector<unsigned int> collapseRemap(numVerts);
+	auto hasTriangleFlips = [&](unsigned int from, unsigned int to, const XMFLOAT3& newPosition)
+		{
+			for (const unsigned int* t = triangles.Begin(from); t != triangles.End(from); t++)
+			{
+				// Neighbors may already have moved earlier in this pass
+				unsigned int corners[3];
+				for (int c = 0; c < 3; c++)
+					corners[c] = remap[collapseRemap[destination[*t * 3 + c]]];
+
+				// Triangles along the collapsing edge (or that already
+				// collapsed this pass) disappear anyway
+				if (corners[0] == to || corners[1] == to || corners[2] == to ||
+					corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2])
+					continue;
+
+				XMVECTOR before[3];
+				XMVECTOR after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = XMLoadFloat3(&positions[corners[c]]);
+					after[c] = corners[c] == from ? XMLoadFloat3(&newPosition) : before[c];
+				}
+
+				XMVECTOR normalBefore = XMVector3Cross(XMVectorSubtract(before[1], before[0]), XMVectorSubtract(before[2], before[0]));
+				XMVECTOR normalAfter = XMVector3Cross(XMVectorSubtract(after[1], after[0]), XMVectorSubtract(after[2], after[0]));
+				float dot = XMVectorGetX(XMVector3Dot(normalBefore, normalAfter));
+				float lengths = XMVectorGetX(XMVector3Length(normalBefore)) * XMVectorGetX(XMVector3Length(normalAfter));
+				if (dot <= 0.25f * lengths)
+					return true;
+			}
+
+			return false;
+		};
+
+	// Where each original vertex has ended up, after all passes so far
+	std::vector<unsigned int> collapsedInto(numVerts);
+	for (unsigned int v = 0; v < numVerts; v++)
+		collapsedInto[v] = v;
+
+	float maxErrorSquared = maxError * scale * maxError * scale;
+	float error = 0.0f;
+	std::vector<EdgeCollapse> collapses;
+	std::vector<bool> collapseLocked(numVerts);
+	while (resultCount > targetIndexCount)
+	{
+		// Score every edge, in its cheapest allowed direction
+		collapses.clear();
+		for (size_t t = 0; t < resultCount; t += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = destination[t + e];
+				unsigned int b = destination[t + (e + 1) % 3];
+				bool aToB = canCollapseEdge(a, b);
+				bool bToA = canCollapseEdge(b, a);
+				if (!aToB && !bToA)
+					continue;
+
+				float errorAToB = aToB ? collapseError(a, b) : FLT_MAX;
+				float errorBToA = bToA ? collapseError(b, a) : FLT_MAX;
+				if (errorAToB <= errorBToA)
+					collapses.push_back({ a, b, errorAToB });
+				else
+					collapses.push_back({ b, a, errorBToA });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const EdgeCollapse& x, const EdgeCollapse& y) { return x.Error < y.Error; });
+
+		BuildTriangleAdjacency(triangles, destination, resultCount, remap);
+
+		// Don't let a single pass get too far ahead of the cheapest
+		// collapses, unless that means nothing can happen at all
+		size_t trianglesToRemove = std::max<size_t>(1, (resultCount - targetIndexCount) / 3);
+		float passLimit = std::min(maxErrorSquared, collapses[std::min(collapses.size() - 1, trianglesToRemove)].Error * 1.5f);
+
+		size_t performed = 0;
+		for (int attempt = 0; attempt < 2 && performed == 0; attempt++)
+		{
+			if (attempt == 1)
+				passLimit = maxErrorSquared;
+
+			for (size_t v = 0; v < numVerts; v++)
+				collapseRemap[v] = (unsigned int)v;
+			std::fill(collapseLocked.begin(), collapseLocked.end(), false);
+
+			size_t removed = 0;
+			for (const EdgeCollapse& c : collapses)
+			{
+				if (c.Error > passLimit || removed >= trianglesToRemove)
+					break;
+
+				unsigned int from = remap[c.From];
+				unsigned int to = remap[c.To];
+				if (collapseLocked[from] || collapseLocked[to])
+					continue;
+
+				// The other side of a seam moves along with this side
+				unsigned int seamFrom = NoVertex;
+				unsigned int seamTo = NoVertex;
+				if (kind[c.From] == VertexSeam)
+				{
+					seamFrom = wedge[c.From];
+					seamTo = loop[c.From] == c.To ? loopback[seamFrom] : loop[seamFrom];
+					if (seamTo == NoVertex || remap[seamTo] != to)
+						continue;
+				}
+
+				if (hasTriangleFlips(from, to, positions[c.To]))
+					continue;
+
+				collapseRemap[c.From] = c.To;
+				if (seamFrom != NoVertex)
+					collapseRemap[seamFrom] = seamTo;
+
+				AddQuadric(quadrics[to], quadrics[from]);
+				collapseLocked[from] = true;
+				collapseLocked[to] = true;
+				error = std::max(error, c.Error);
+				removed += kind[c.From] == VertexBorder ? 1 : 2;
+				performed++;
+			}
+		}
+
+		if (performed == 0)
+			break;
+
+		// Apply the collapses, dropping triangles that no longer have any area
+		size_t writeCount = 0;
+		for (size_t t = 0; t < resultCount; t += 3)
+		{
+			unsigned int a = collapseRemap[destination[t + 0]];
+			unsigned int b = collapseRemap[destination[t + 1]];
+			unsigned int c = collapseRemap[destination[t + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+
+			if (sourceTriangles)
+				sourceTriangles[writeCount / 3] = sourceTriangles[t / 3];
+			destination[writeCount++] = a;
+			destination[writeCount++] = b;
+			destination[writeCount++] = c;
+		}
+		resultCount = writeCount;
+
+		for (unsigned int v = 0; v < numVerts; v++)
+			collapsedInto[v] = collapseRemap[collapsedInto[v]];
+
+		// Keep border & seam loops pointing at verts that still exist
+		// (if the next vertex collapsed onto this one, skip past it)
+		for (unsigned int v = 0; v < numVerts; v++)
+		{
+			if (loop[v] != NoVertex)
+			{
+				unsigned int next = collapseRemap[loop[v]];
+				loop[v] = next == v ? loop[loop[v]] : next;
+			}
+
+			if (loopback[v] != NoVertex)
+			{
+				unsigned int previous = collapseRemap[loopback[v]];
+				loopback[v] = previous == v ? loopback[loopback[v]] : previous;
+			}
+		}
+	}
+
+	// The quadrics only estimate the error (as an average over
+	// many planes), so measure it: the farthest any original
+	// vertex is from the triangles near where it ended up (the
+	// two rings of triangles around that vertex)
+	if (resultError && error > 0.0f)
+	{
+		BuildTriangleAdjacency(triangles, destination, resultCount, remap);
+
+		auto distanceToTriangle = [&](FXMVECTOR p, unsigned int t)
+			{
+				return PointTriangleDistance(p,
+					XMLoadFloat3(&positions[destination[t * 3 + 0]]),
+					XMLoadFloat3(&positions[destination[t * 3 + 1]]),
+					XMLoadFloat3(&positions[destination[t * 3 + 2]]));
+			};
+
+		float maxDistance = 0.0f;
+		for (unsigned int v = 0; v < numVerts; v++)
+		{
+			unsigned int into = remap[collapsedInto[v]];
+			if (triangles.Begin(into) == triangles.End(into))
+				continue;
+
+			float distance = FLT_MAX;
+			XMVECTOR p = XMLoadFloat3(&positions[v]);
+			for (const unsigned int* t = triangles.Begin(into); t != triangles.End(into) && distance > 0.0f; t++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int neighbor = remap[destination[*t * 3 + c]];
+					for (const unsigned int* n = triangles.Begin(neighbor); n != triangles.End(neighbor); n++)
+						distance = std::min(distance, distanceToTriangle(p, *n));
+				}
+			}
+			maxDistance = std::max(maxDistance, distance);
+		}
+
+		*resultError = maxDistance / scale;
+	}
+
+	return resultCount;
+}
+
+
+// --------------------------------------------------------
+// Builds a chain of lower detail versions of the mesh, each
+// with (roughly) half the triangles of the one before.  All
+// of them share the mesh's vertices; their indices are
+// appended to the index buffer and described in mesh.LODs.
+// Stops early once the mesh can't be simplified any further.
+//
+// Submeshes are simplified together, so there are no cracks
+// where they meet, and each simplified triangle stays in the
+// submesh it came from.  Each LOD is then split into the same
+// submeshes, in the same order, as the full detail mesh.
+// --------------------------------------------------------
+void GenerateLODs(MeshData& mesh)
+{
+	size_t baseCount = mesh.Indices.size();
+	mesh.LODs.clear();
+	mesh.LODs.push_back({ 0, (unsigned int)baseCount, 0.0f });
+	AddDefaultSubmesh(mesh);
+
+	// Which submesh each full detail triangle belongs to
+	std::vector<unsigned int> triangleSubmesh(baseCount / 3);
+	for (unsigned int i = 0; i < mesh.Submeshes.size(); i++)
+	{
+		MeshSubmesh& submesh = mesh.Submeshes[i];
+		unsigned int first = submesh.FirstIndex[0] / 3;
+		std::fill(triangleSubmesh.begin() + first, triangleSubmesh.begin() + first + submesh.IndexCount[0] / 3, i);
+		std::fill(submesh.FirstIndex + 1, submesh.FirstIndex + MESH_MAX_LODS, 0);
+		std::fill(submesh.IndexCount + 1, submesh.IndexCount + MESH_MAX_LODS, 0);
+	}
+
+	std::vector<unsigned int> lod(baseCount);
+	std::vector<unsigned int> sourceTriangles(baseCount / 3);
+	size_t previousCount = baseCount;
+	float previousError = 0.0f;
+	while (mesh.LODs.size() < MESH_MAX_LODS)
+	{
+		size_t targetCount = (size_t)(previousCount / 3 * MESH_LOD_REDUCTION) * 3;
+		if (targetCount < MESH_LOD_MIN_TRIANGLES * 3)
+			break;
+
+		// Always simplify the full mesh, so errors don't compound
+		float error = 0.0f;
+		size_t count = SimplifyMesh(
+			mesh.Vertices.data(),
+			mesh.Vertices.size(),
+			mesh.Indices.data(),
+			baseCount,
+			targetCount,
+			FLT_MAX,
+			lod.data(),
+			&error,
+			sourceTriangles.data());
+
+		if (count == 0 || count > previousCount * 9 / 10)
+			break;
+
+		// Surviving triangles keep their order, so they're still
+		// grouped by submesh; optimize each submesh's range
+		unsigned int level = (unsigned int)mesh.LODs.size();
+		unsigned int levelStart = (unsigned int)mesh.Indices.size();
+		size_t t = 0;
+		for (unsigned int i = 0; i < mesh.Submeshes.size(); i++)
+		{
+			size_t first = t;
+			while (t < count / 3 && triangleSubmesh[sourceTriangles[t]] == i)
+				t++;
+
+			MeshSubmesh& submesh = mesh.Submeshes[i];
+			submesh.FirstIndex[level] = levelStart + (unsigned int)first * 3;
+			submesh.IndexCount[level] = (unsigned int)(t - first) * 3;
+			OptimizeVertexCache(lod.data() + first * 3, submesh.IndexCount[level], mesh.Vertices.size());
+			OptimizeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), lod.data() + first * 3, submesh.IndexCount[level]);
+		}
+
+		// Lower detail should never claim to be more accurate
+		previousError = std::max(previousError, error);
+		mesh.LODs.push_back({ levelStart, (unsigned int)count, previousError });
+		mesh.Indices.insert(mesh.Indices.end(), lod.begin(), lod.begin() + count);
+		previousCount = count;
+	}
+}
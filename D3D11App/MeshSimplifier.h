@@ -0,0 +1,26 @@
+#pragma once
+
+#include "MeshData.h"
+
+// Each LOD aims for this fraction of the previous LOD's triangles
+#define MESH_LOD_REDUCTION 0.5f
+
+// LODs aren't generated below this many triangles
+#define MESH_LOD_MIN_TRIANGLES 32
+
+// Simplifies a triangle list by collapsing edges (quadric error metric),
+// writing a new index buffer that uses a subset of the same vertices
+size_t SimplifyMesh(
+	const Vertex* verts,
+	size_t numVerts,
+	const unsigned int* indices,
+	size_t numIndices,
+	size_t targetIndexCount,
+	float maxError,
+	unsigned int* destination,
+	float* resultError,
+	unsigned int* sourceTriangles = 0);
+
+// Appends a chain of simplified LODs to the mesh's index buffer
+// (each one split into the same submeshes as the full mesh)
+void GenerateLODs(MeshData& mesh);
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MeshletBuilder.h"
+#include "MeshBounds.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int NoTriangle = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// Fills in a meshlet's bounding sphere and normal cone.
+	// The cone's apex is pushed back far enough that it lies
+	// behind every triangle's plane, so any camera looking at
+	// the apex from within the cone sees only back faces.
+	// --------------------------------------------------------
+	void ComputeMeshletBounds(const Vertex* verts, const unsigned int* indices, const unsigned int* vertIndices, Meshlet& meshlet)
+	{
+		ComputeBoundingSphere(verts, vertIndices, meshlet.VertexCount, meshlet.Center, meshlet.Radius);
+
+		// Average direction of the triangles' (unit) normals
+		std::vector<XMFLOAT3> normals(meshlet.TriangleCount);
+		std::vector<bool> hasArea(meshlet.TriangleCount);
+		XMVECTOR normalSum = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+		{
+			const unsigned int* tri = &indices[meshlet.FirstIndex + t * 3];
+			XMVECTOR p0 = XMLoadFloat3(&verts[tri[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&verts[tri[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&verts[tri[2]].Position);
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			hasArea[t] = XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f;
+			if (!hasArea[t])
+				continue;
+
+			normal = XMVector3Normalize(normal);
+			XMStoreFloat3(&normals[t], normal);
+			normalSum = XMVectorAdd(normalSum, normal);
+		}
+
+		// By default, the cutoff can never be reached (never backfacing)
+		meshlet.ConeApex = meshlet.Center;
+		meshlet.ConeAxis = XMFLOAT3(0, 0, 0);
+		meshlet.ConeCutoff = 2.0f;
+		if (XMVectorGetX(XMVector3LengthSq(normalSum)) <= 0.0f)
+			return;
+
+		XMVECTOR axis = XMVector3Normalize(normalSum);
+		float minDot = 1.0f;
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+			if (hasArea[t])
+				minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[t]), axis)));
+
+		// Normals spread over (nearly) a hemisphere or more can't be culled
+		if (minDot <= 0.1f)
+			return;
+
+		XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+		float apexDistance = 0.0f;
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+		{
+			if (!hasArea[t])
+				continue;
+
+			XMVECTOR normal = XMLoadFloat3(&normals[t]);
+			XMVECTOR p0 = XMLoadFloat3(&verts[indices[meshlet.FirstIndex + t * 3]].Position);
+			float centerDistance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), normal));
+			float axisDot = XMVectorGetX(XMVector3Dot(axis, normal));
+			apexDistance = std::max(apexDistance, centerDistance / axisDot);
+		}
+
+		XMStoreFloat3(&meshlet.ConeApex, XMVectorSubtract(center, XMVectorScale(axis, apexDistance)));
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+
+// --------------------------------------------------------
+// Splits a triangle list into meshlets of at most
+// MESHLET_MAX_VERTICES unique vertices and
+// MESHLET_MAX_TRIANGLES triangles.  Each meshlet grows from
+// a seed triangle by repeatedly adding the neighboring
+// triangle (sharing a position) that brings in the fewest
+// new vertices (ties go to triangles whose positions have the
+// fewest triangles left, so corners aren't left behind as
+// tiny islands).
+// New meshlets are seeded next to the previous one.
+//
+// verts      - The mesh's vertices
+// numVerts   - The number of verts in the array
+// indices    - Triangle list indices, reordered in place so
+//              each meshlet is a contiguous range
+// numIndices - The number of indices
+// meshlets   - Receives the meshlets, with their bounds
+// --------------------------------------------------------
+void BuildMeshlets(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices, std::vector<Meshlet>& meshlets)
+{
+	size_t triCount = numIndices / 3;
+	meshlets.clear();
+	if (triCount == 0)
+		return;
+
+	// Triangles touching each position (so neighbors are found
+	// across UV & normal seams, where vertices are split)
+	std::vector<unsigned int> remap(numVerts);
+	RemapSharedPositions(verts, numVerts, remap.data());
+
+	std::vector<unsigned int> offsets(numVerts + 1, 0);
+	for (size_t i = 0; i < triCount * 3; i++)
+		offsets[remap[indices[i]] + 1]++;
+	for (size_t v = 0; v < numVerts; v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<unsigned int> adjacency(triCount * 3);
+	std::vector<unsigned int> liveCount(numVerts, 0);
+	for (size_t i = 0; i < triCount * 3; i++)
+	{
+		unsigned int position = remap[indices[i]];
+		adjacency[offsets[position] + liveCount[position]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<bool> emitted(triCount, false);
+	std::vector<unsigned int> vertMeshlet(numVerts, NoTriangle);
+	std::vector<unsigned int> ordered;
+	ordered.reserve(triCount * 3);
+
+	std::vector<unsigned int> meshletVerts;
+	std::vector<unsigned int> previousVerts;
+	size_t seedCursor = 0;
+	while (ordered.size() < triCount * 3)
+	{
+		unsigned int id = (unsigned int)meshlets.size();
+		Meshlet meshlet = {};
+		meshlet.FirstIndex = (unsigned int)ordered.size();
+		meshletVerts.clear();
+
+		auto addTriangle = [&](unsigned int t)
+			{
+				emitted[t] = true;
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int v = indices[t * 3 + c];
+					liveCount[remap[v]]--;
+					if (vertMeshlet[v] != id)
+					{
+						vertMeshlet[v] = id;
+						meshletVerts.push_back(v);
+					}
+					ordered.push_back(v);
+				}
+				meshlet.TriangleCount++;
+			};
+
+		// Finds the best remaining triangle touching the given vertices
+		auto findNeighbor = [&](const std::vector<unsigned int>& around)
+			{
+				unsigned int best = NoTriangle;
+				unsigned int bestNew = 4;
+				unsigned int bestLive = 0xFFFFFFFF;
+				for (unsigned int v : around)
+				{
+					unsigned int position = remap[v];
+					for (unsigned int i = offsets[position]; i < offsets[position + 1]; i++)
+					{
+						unsigned int t = adjacency[i];
+						if (emitted[t])
+							continue;
+
+						unsigned int newVerts = 0;
+						unsigned int live = 0;
+						for (int c = 0; c < 3; c++)
+						{
+							unsigned int corner = indices[t * 3 + c];
+							newVerts += vertMeshlet[corner] != id;
+							live += liveCount[remap[corner]];
+						}
+
+						if (meshletVerts.size() + newVerts > MESHLET_MAX_VERTICES)
+							continue;
+
+						if (newVerts < bestNew || (newVerts == bestNew && live < bestLive))
+						{
+							best = t;
+							bestNew = newVerts;
+							bestLive = live;
+						}
+					}
+				}
+				return best;
+			};
+
+		// Seed next to the previous meshlet if possible, otherwise
+		// with the first triangle that hasn't been used yet
+		unsigned int seed = findNeighbor(previousVerts);
+		if (seed == NoTriangle)
+		{
+			while (emitted[seedCursor])
+				seedCursor++;
+			seed = (unsigned int)seedCursor;
+		}
+		addTriangle(seed);
+
+		while (meshlet.TriangleCount < MESHLET_MAX_TRIANGLES)
+		{
+			unsigned int next = findNeighbor(meshletVerts);
+			if (next == NoTriangle)
+				break;
+			addTriangle(next);
+		}
+
+		meshlet.VertexCount = (unsigned int)meshletVerts.size();
+		ComputeMeshletBounds(verts, ordered.data(), meshletVerts.data(), meshlet);
+		meshlets.push_back(meshlet);
+		previousVerts.swap(meshletVerts);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+
+// --------------------------------------------------------
+// Builds meshlets over the full detail LOD of each submesh
+// that has at least MESHLET_MIN_MESH_TRIANGLES triangles.
+// Meshlets never cross submeshes, and each submesh's are
+// contiguous, so a submesh can cull & draw just its own.
+// --------------------------------------------------------
+void BuildMeshlets(MeshData& mesh)
+{
+	mesh.Meshlets.clear();
+	AddDefaultSubmesh(mesh);
+
+	std::vector<Meshlet> submeshMeshlets;
+	for (MeshSubmesh& submesh : mesh.Submeshes)
+	{
+		submesh.FirstMeshlet = (unsigned int)mesh.Meshlets.size();
+		submesh.MeshletCount = 0;
+		if (submesh.IndexCount[0] / 3 < MESHLET_MIN_MESH_TRIANGLES)
+			continue;
+
+		BuildMeshlets(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data() + submesh.FirstIndex[0], submesh.IndexCount[0], submeshMeshlets);
+		for (Meshlet& meshlet : submeshMeshlets)
+			meshlet.FirstIndex += submesh.FirstIndex[0];
+
+		mesh.Meshlets.insert(mesh.Meshlets.end(), submeshMeshlets.begin(), submeshMeshlets.end());
+		submesh.MeshletCount = (unsigned int)submeshMeshlets.size();
+	}
+}
+
+
+// --------------------------------------------------------
+// Captures the frustum and camera in the object's own space,
+// so meshlet bounds can be tested without transforming them.
+// Frustum planes come straight from the combined
+// world-view-projection matrix (Gribb & Hartmann, 2001).
+//
+// world       - The object's world matrix
+// view        - The camera's view matrix
+// projection  - The camera's projection matrix
+// perspective - Is the projection a perspective one?
+// --------------------------------------------------------
+MeshletCullContext CreateMeshletCullContext(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& projection, bool perspective)
+{
+	XMMATRIX worldView = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&view));
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, XMLoadFloat4x4(&projection)));
+
+	// Columns of the matrix, which give clip space x, y, z & w
+	XMVECTOR x = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR y = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR z = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR w = XMVectorSet(m._14, m._24, m._34, m._44);
+
+	// Left, right, bottom, top, near (z >= 0) and far
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(w, x),
+		XMVectorSubtract(w, x),
+		XMVectorAdd(w, y),
+		XMVectorSubtract(w, y),
+		z,
+		XMVectorSubtract(w, z)
+	};
+
+	MeshletCullContext context = {};
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&context.Planes[i], XMVectorDivide(planes[i], XMVectorReplicate(XMVectorGetX(XMVector3Length(planes[i])))));
+
+	// The camera's position (or view direction) in object space
+	XMMATRIX inverseWorldView = XMMatrixInverse(nullptr, worldView);
+	if (perspective)
+		XMStoreFloat4(&context.Camera, XMVectorSetW(inverseWorldView.r[3], 1.0f));
+	else
+		XMStoreFloat4(&context.Camera, XMVectorSetW(XMVector3Normalize(inverseWorldView.r[2]), 0.0f));
+
+	return context;
+}
+
+// --------------------------------------------------------
+// Tests a meshlet's bounding sphere against the frustum,
+// and its normal cone against the camera
+// --------------------------------------------------------
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullContext& context)
+{
+	XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+	for (int i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&context.Planes[i]);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, center)) < -meshlet.Radius)
+			return false;
+	}
+
+	if (meshlet.ConeCutoff > 1.0f)
+		return true;
+
+	// Direction the camera looks at the apex from
+	XMVECTOR camera = XMLoadFloat4(&context.Camera);
+	XMVECTOR direction = context.Camera.w == 0.0f ?
+		camera :
+		XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.ConeApex), camera));
+
+	return XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&meshlet.ConeAxis))) < meshlet.ConeCutoff;
+}
+
+// --------------------------------------------------------
+// Culls a set of meshlets, writing the indices of those
+// that remain (in order) and returning how many there are
+// --------------------------------------------------------
+size_t CullMeshlets(const Meshlet* meshlets, size_t numMeshlets, const MeshletCullContext& context, unsigned int* visible)
+{
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < numMeshlets; i++)
+		if (IsMeshletVisible(meshlets[i], context))
+			visible[visibleCount++] = (unsigned int)i;
+
+	return visibleCount;
+}
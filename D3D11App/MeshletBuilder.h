@@ -0,0 +1,43 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "MeshData.h"
+
+// Most vertices & triangles in a single meshlet
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Meshes with fewer triangles than this aren't split into meshlets,
+// since the extra draws would cost more than culling would save
+#define MESHLET_MIN_MESH_TRIANGLES 2048
+
+// --------------------------------------------------------
+// The view, in a mesh's object space, for culling meshlets
+//  - Planes: Frustum planes (inside when dot(n, p) + d >= 0)
+//  - Camera: Position (w = 1), or the view direction for
+//    orthographic projections (w = 0)
+// --------------------------------------------------------
+struct MeshletCullContext
+{
+	DirectX::XMFLOAT4 Planes[6];
+	DirectX::XMFLOAT4 Camera;
+};
+
+// Groups triangles into meshlets, reordering the indices (in place)
+// so each meshlet's triangles are contiguous
+void BuildMeshlets(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices, std::vector<Meshlet>& meshlets);
+
+// Builds meshlets for the full detail LOD of a (large enough) mesh
+void BuildMeshlets(MeshData& mesh);
+
+// Captures a view of an object for culling its meshlets
+MeshletCullContext CreateMeshletCullContext(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, bool perspective);
+
+// Is any part of the meshlet both inside the frustum and facing the camera?
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullContext& context);
+
+// Writes the indices of visible meshlets, returning how many there are
+size_t CullMeshlets(const Meshlet* meshlets, size_t numMeshlets, const MeshletCullContext& context, unsigned int* visible);
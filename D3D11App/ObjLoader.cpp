@@ -0,0 +1,742 @@
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <functional>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// A single face corner.  Indices are 0-based, and any
+	// attribute that was missing or invalid is -1.
+	struct ObjCorner
+	{
+		int Position;
+		int UV;
+		int Normal;
+	};
+
+	// A usemtl, o or g statement, which applies to every
+	// corner from FirstCorner until the next one of its kind
+	struct ObjNameChange
+	{
+		size_t FirstCorner;
+		bool Material;		// usemtl (true) or o/g (false)
+		std::string Name;
+	};
+
+	// Spaces and tabs separate tokens; '\r' is treated the same
+	// so that Windows line endings need no special handling
+	bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsSpace(*p) && *p != '\n') p++;
+		return p;
+	}
+
+	const char* SkipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n') p++;
+		return p;
+	}
+
+	// Does the line start with the given keyword (followed by a space or the end of the line)?
+	bool IsKeyword(const char* p, const char* end, const char* keyword)
+	{
+		size_t length = strlen(keyword);
+		return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && (IsSpace(p[length]) || p[length] == '\n');
+	}
+
+	// Reads the rest of the line as a name (which may contain spaces)
+	std::string ParseName(const char* p, const char* end)
+	{
+		p = SkipSpaces(p, end);
+		const char* nameEnd = SkipLine(p, end);
+		while (nameEnd > p && IsSpace(nameEnd[-1])) nameEnd--;
+		return std::string(p, nameEnd);
+	}
+
+	// --------------------------------------------------------
+	// Reads one float token directly from the file's bytes.
+	// Malformed tokens are skipped and read as zero.
+	// --------------------------------------------------------
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+		if (p < end && *p == '+') p++;
+
+		out = 0.0f;
+		std::from_chars_result result = std::from_chars(p, end, out);
+		if (result.ptr == p)
+			return SkipToken(p, end);
+
+		return result.ptr;
+	}
+
+	// --------------------------------------------------------
+	// Reads one (possibly negative) OBJ index and converts it
+	// to a 0-based index.  Negative indices are relative to
+	// the number of elements read so far (count), and are
+	// flagged so the caller can offset them later on if count
+	// is only local to a chunk of the file.
+	// --------------------------------------------------------
+	const char* ParseIndex(const char* p, const char* end, size_t count, int& out, bool& relative)
+	{
+		bool negative = false;
+		if (p < end && *p == '-')
+		{
+			negative = true;
+			p++;
+		}
+
+		// Counted in 64 bits and capped just past what an int holds,
+		// so any number of digits is safe (and too big to be valid)
+		long long value = 0;
+		const char* digits = p;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (value <= INT_MAX)
+				value = value * 10 + (*p - '0');
+			p++;
+		}
+
+		relative = false;
+		if (p == digits || value == 0 || value > INT_MAX)
+			out = -1;
+		else if (negative)
+		{
+			// May be negative until the chunk's offset is known
+			out = (int)((long long)count - value);
+			relative = true;
+		}
+		else
+			out = (int)value - 1;
+
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// An open-addressing hash table mapping a corner's
+	// position/uv/normal triple to its welded vertex index.
+	// All storage is allocated up front, so lookups and
+	// inserts never allocate.
+	// --------------------------------------------------------
+	class CornerWeldTable
+	{
+	public:
+		CornerWeldTable(size_t maxEntries)
+		{
+			// Keep the load factor at or below 50%
+			size_t capacity = 16;
+			while (capacity < maxEntries * 2)
+				capacity *= 2;
+
+			slots.resize(capacity, Slot{ {}, EmptySlot });
+			mask = capacity - 1;
+		}
+
+		// Returns the index already stored for this corner, or
+		// stores and returns newIndex if the corner is new
+		unsigned int FindOrInsert(const ObjCorner& c, unsigned int newIndex)
+		{
+			size_t bucket = Hash(c) & mask;
+			while (true)
+			{
+				Slot& slot = slots[bucket];
+				if (slot.Index == EmptySlot)
+				{
+					slot.Corner = c;
+					slot.Index = newIndex;
+					return newIndex;
+				}
+
+				if (slot.Corner.Position == c.Position &&
+					slot.Corner.UV == c.UV &&
+					slot.Corner.Normal == c.Normal)
+					return slot.Index;
+
+				bucket = (bucket + 1) & mask;
+			}
+		}
+
+		// Splits corners into groups that never share a triple, so
+		// each group can be welded independently.  Uses different
+		// hash bits than the table's buckets do.
+		static size_t GetPartition(const ObjCorner& c, size_t partitionCount)
+		{
+			unsigned long long mixed = (unsigned long long)Hash(c) * 0x9E3779B97F4A7C15ull;
+			return (size_t)(((mixed >> 32) * partitionCount) >> 32);
+		}
+
+	private:
+		static const unsigned int EmptySlot = 0xFFFFFFFF;
+
+		struct Slot
+		{
+			ObjCorner Corner;
+			unsigned int Index;
+		};
+
+		std::vector<Slot> slots;
+		size_t mask;
+
+		static size_t Hash(const ObjCorner& c)
+		{
+			size_t h = (size_t)(unsigned int)c.Position * 73856093u;
+			h ^= (size_t)(unsigned int)c.UV * 19349663u;
+			h ^= (size_t)(unsigned int)c.Normal * 83492791u;
+			return h ^ (h >> 16);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Everything parsed from one range of lines in the file.
+	// Positive face indices are global, so they're stored as-is.
+	// Negative ones are relative to the attributes read so far,
+	// and within a chunk only the chunk's own attributes are
+	// known, so those are stored relative to the start of the
+	// chunk and fixed up once the earlier chunks are counted.
+	// --------------------------------------------------------
+	struct ObjChunk
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> UVs;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<ObjCorner> Corners;
+
+		// Location (corner * 3 + attribute) of each relative index
+		std::vector<size_t> RelativeIndices;
+
+		// Materials & groups, by corner within the chunk
+		std::vector<ObjNameChange> NameChanges;
+	};
+
+	// Attribute of a corner by number (0 = position, 1 = uv, 2 = normal)
+	int& GetCornerAttribute(ObjCorner& c, size_t attribute)
+	{
+		return attribute == 0 ? c.Position : (attribute == 1 ? c.UV : c.Normal);
+	}
+
+	// --------------------------------------------------------
+	// Reads all corners of a single face and triangulates it
+	// as a fan.  The winding order is flipped as each triangle
+	// is emitted, since OBJ files are (most likely) right-handed.
+	// --------------------------------------------------------
+	const char* ParseFace(const char* p, const char* end, ObjChunk& chunk)
+	{
+		ObjCorner first = {};
+		ObjCorner previous = {};
+		unsigned int firstRelative = 0;
+		unsigned int previousRelative = 0;
+		int cornerCount = 0;
+
+		// Adds a corner to the chunk, remembering where any relative indices are
+		auto emit = [&chunk](const ObjCorner& c, unsigned int relativeMask)
+			{
+				size_t location = chunk.Corners.size() * 3;
+				for (size_t a = 0; a < 3; a++)
+					if (relativeMask & (1 << a))
+						chunk.RelativeIndices.push_back(location + a);
+
+				chunk.Corners.push_back(c);
+			};
+
+		while (true)
+		{
+			p = SkipSpaces(p, end);
+			if (p >= end || *p == '\n' || *p == '#')
+				break;
+
+			// Possible formats: v, v/vt, v//vn and v/vt/vn
+			ObjCorner c = { -1, -1, -1 };
+			bool relative[3] = {};
+			const char* start = p;
+			p = ParseIndex(p, end, chunk.Positions.size(), c.Position, relative[0]);
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (p < end && *p != '/')
+					p = ParseIndex(p, end, chunk.UVs.size(), c.UV, relative[1]);
+
+				if (p < end && *p == '/')
+				{
+					p++;
+					p = ParseIndex(p, end, chunk.Normals.size(), c.Normal, relative[2]);
+				}
+			}
+
+			// Skip anything that isn't actually an index
+			if (p == start)
+			{
+				p = SkipToken(p, end);
+				continue;
+			}
+
+			unsigned int relativeMask = (relative[0] ? 1 : 0) | (relative[1] ? 2 : 0) | (relative[2] ? 4 : 0);
+			if (cornerCount == 0)
+			{
+				first = c;
+				firstRelative = relativeMask;
+			}
+			else if (cornerCount >= 2)
+			{
+				emit(first, firstRelative);
+				emit(c, relativeMask);
+				emit(previous, previousRelative);
+			}
+
+			previous = c;
+			previousRelative = relativeMask;
+			cornerCount++;
+		}
+
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// Parses every line in [p, end) into the given chunk.  The
+	// range must start at the beginning of a line.
+	// --------------------------------------------------------
+	void ParseChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		while (p < end)
+		{
+			p = SkipSpaces(p, end);
+			size_t remaining = end - p;
+
+			// Check the type of line
+			if (remaining >= 2 && p[0] == 'v' && IsSpace(p[1]))
+			{
+				XMFLOAT3 pos{};
+				p = ParseFloat(p + 1, end, pos.x);
+				p = ParseFloat(p, end, pos.y);
+				p = ParseFloat(p, end, pos.z);
+				pos.z *= -1.0f; // Flip Z (LH vs. RH)
+				chunk.Positions.push_back(pos);
+			}
+			else if (remaining >= 3 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2]))
+			{
+				XMFLOAT2 uv{};
+				p = ParseFloat(p + 2, end, uv.x);
+				p = ParseFloat(p, end, uv.y);
+				uv.y = 1.0f - uv.y; // Flip the UV since it's probably "upside down"
+				chunk.UVs.push_back(uv);
+			}
+			else if (remaining >= 3 && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2]))
+			{
+				XMFLOAT3 norm{};
+				p = ParseFloat(p + 2, end, norm.x);
+				p = ParseFloat(p, end, norm.y);
+				p = ParseFloat(p, end, norm.z);
+				norm.z *= -1.0f; // Flip normal's Z
+				chunk.Normals.push_back(norm);
+			}
+			else if (remaining >= 2 && p[0] == 'f' && IsSpace(p[1]))
+			{
+				p = ParseFace(p + 1, end, chunk);
+			}
+			else if (IsKeyword(p, end, "usemtl"))
+			{
+				chunk.NameChanges.push_back({ chunk.Corners.size(), true, ParseName(p + 6, end) });
+			}
+			else if (IsKeyword(p, end, "o") || IsKeyword(p, end, "g"))
+			{
+				chunk.NameChanges.push_back({ chunk.Corners.size(), false, ParseName(p + 1, end) });
+			}
+
+			// Move on to the next line (also skips comments & unsupported statements)
+			p = SkipLine(p, end);
+			if (p < end) p++;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Converts a chunk's relative indices to global ones, given
+	// the number of each attribute in all earlier chunks.  Any
+	// that reach back before the start of the file are invalid.
+	// --------------------------------------------------------
+	void ResolveRelativeIndices(ObjChunk& chunk, const int base[3])
+	{
+		for (size_t location : chunk.RelativeIndices)
+		{
+			size_t attribute = location % 3;
+			int& index = GetCornerAttribute(chunk.Corners[location / 3], attribute);
+			index += base[attribute];
+			if (index < 0)
+				index = -1;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Creates the verts by looking up corresponding data from
+	// the attribute arrays.  Missing attributes get defaults
+	// (a UV of (0,0) in the file's space, and a zero normal).
+	// Corners that reference the same position/uv/normal triple
+	// are welded into a single vertex, so the result is a truly
+	// indexed mesh.
+	//
+	// Welding is split across the pool (if any) by hash: the
+	// corners are bucketed by partition first, so each thread
+	// only visits its own.  Vertices are then numbered in order
+	// of each triple's first use, exactly as a single pass over
+	// the corners would.
+	// --------------------------------------------------------
+	MeshData AssembleMesh(
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT2>& uvs,
+		const std::vector<XMFLOAT3>& normals,
+		std::vector<ObjCorner>& corners,
+		ThreadPool* pool)
+	{
+		// Runs func(i) for every i in [0, count), on the pool if there is one
+		auto parallelFor = [pool](size_t count, const std::function<void(size_t)>& func)
+			{
+				if (pool)
+					pool->ParallelFor(count, func);
+				else
+					for (size_t i = 0; i < count; i++)
+						func(i);
+			};
+		size_t threadCount = pool ? pool->GetThreadCount() : 1;
+		size_t blockCount = threadCount * 4;
+		size_t blockSize = corners.size() / blockCount + 1;
+
+		// Treat out-of-range references as missing, so that they weld
+		// together, and hash each corner to its weld partition, counting
+		// how many of each block's corners land in each partition.
+		// (Indices holds each corner's partition until it's welded.)
+		MeshData mesh;
+		mesh.Indices.resize(corners.size());
+		std::vector<size_t> blockOffsets(blockCount * threadCount);
+		parallelFor(blockCount, [&](size_t block)
+			{
+				size_t* counts = &blockOffsets[block * threadCount];
+				size_t end = std::min(corners.size(), (block + 1) * blockSize);
+				for (size_t i = block * blockSize; i < end; i++)
+				{
+					ObjCorner& c = corners[i];
+					if (c.Position >= (int)positions.size()) c.Position = -1;
+					if (c.UV >= (int)uvs.size()) c.UV = -1;
+					if (c.Normal >= (int)normals.size()) c.Normal = -1;
+
+					size_t partition = CornerWeldTable::GetPartition(c, threadCount);
+					mesh.Indices[i] = (unsigned int)partition;
+					counts[partition]++;
+				}
+			});
+
+		// Each partition's corners go together, a block at a time, so
+		// a running total of the counts (partition by partition) gives
+		// where each block's corners of each partition start
+		std::vector<size_t> partitionStarts(threadCount + 1);
+		size_t total = 0;
+		for (size_t partition = 0; partition < threadCount; partition++)
+		{
+			partitionStarts[partition] = total;
+			for (size_t block = 0; block < blockCount; block++)
+			{
+				size_t& offset = blockOffsets[block * threadCount + partition];
+				size_t count = offset;
+				offset = total;
+				total += count;
+			}
+		}
+		partitionStarts[threadCount] = total;
+
+		// Bucket the corners by partition, still in order within each one
+		std::vector<unsigned int> partitionCorners(corners.size());
+		parallelFor(blockCount, [&](size_t block)
+			{
+				size_t* offsets = &blockOffsets[block * threadCount];
+				size_t end = std::min(corners.size(), (block + 1) * blockSize);
+				for (size_t i = block * blockSize; i < end; i++)
+					partitionCorners[offsets[mesh.Indices[i]]++] = (unsigned int)i;
+			});
+
+		// Find the first corner to use each exact combination, each
+		// partition only going through its own bucket
+		parallelFor(threadCount, [&](size_t partition)
+			{
+				size_t first = partitionStarts[partition];
+				size_t end = partitionStarts[partition + 1];
+				CornerWeldTable weldTable(end - first);
+				for (size_t b = first; b < end; b++)
+				{
+					unsigned int i = partitionCorners[b];
+					mesh.Indices[i] = weldTable.FindOrInsert(corners[i], i);
+				}
+			});
+
+		// Each first use becomes the next vertex, and every
+		// later use refers back to it
+		std::vector<unsigned int> vertexCorners;
+		vertexCorners.reserve(corners.size() / 4);
+		for (size_t i = 0; i < corners.size(); i++)
+		{
+			unsigned int firstUse = mesh.Indices[i];
+			if (firstUse == i)
+			{
+				mesh.Indices[i] = (unsigned int)vertexCorners.size();
+				vertexCorners.push_back(firstUse);
+			}
+			else
+				mesh.Indices[i] = mesh.Indices[firstUse];
+		}
+
+		// Fill in the actual vertex data
+		mesh.Vertices.resize(vertexCorners.size());
+		blockSize = vertexCorners.size() / blockCount + 1;
+		parallelFor(blockCount, [&](size_t block)
+			{
+				size_t end = std::min(vertexCorners.size(), (block + 1) * blockSize);
+				for (size_t i = block * blockSize; i < end; i++)
+				{
+					const ObjCorner& c = corners[vertexCorners[i]];
+					Vertex& v = mesh.Vertices[i];
+					v.Position = c.Position >= 0 ? positions[c.Position] : XMFLOAT3(0, 0, 0);
+					v.UV = c.UV >= 0 ? uvs[c.UV] : XMFLOAT2(0, 1);
+					v.Normal = c.Normal >= 0 ? normals[c.Normal] : XMFLOAT3(0, 0, 0);
+					v.Tangent = XMFLOAT3(0, 0, 0);
+				}
+			});
+
+		return mesh;
+	}
+
+	// --------------------------------------------------------
+	// Sorts the mesh's triangles into submeshes, one for each
+	// material, in the order the materials are first used.
+	// Faces before any usemtl go by their o/g name instead, so
+	// parts of models without materials can still be told
+	// apart.  The sort is stable, so each submesh keeps its
+	// triangles in file order.
+	// --------------------------------------------------------
+	void GroupSubmeshes(MeshData& mesh, const std::vector<ObjNameChange>& changes)
+	{
+		size_t triangleCount = mesh.Indices.size() / 3;
+		std::vector<unsigned int> triangleSubmesh(triangleCount);
+		std::unordered_map<std::string, unsigned int> submeshIndices;
+		std::vector<unsigned int> submeshTriangles;
+
+		std::string material;
+		std::string group;
+		size_t firstTriangle = 0;
+		for (size_t i = 0; i <= changes.size(); i++)
+		{
+			// Triangles between this change and the next all use the same name
+			size_t endTriangle = i < changes.size() ? changes[i].FirstCorner / 3 : triangleCount;
+			if (endTriangle > firstTriangle)
+			{
+				const std::string& name = material.empty() ? group : material;
+				auto found = submeshIndices.try_emplace(name.substr(0, MESH_MAX_SUBMESH_NAME - 1), (unsigned int)mesh.Submeshes.size());
+				if (found.second)
+				{
+					MeshSubmesh submesh = {};
+					SetSubmeshName(submesh, name.c_str(), name.size());
+					mesh.Submeshes.push_back(submesh);
+					submeshTriangles.push_back(0);
+				}
+
+				unsigned int submesh = found.first->second;
+				std::fill(triangleSubmesh.begin() + firstTriangle, triangleSubmesh.begin() + endTriangle, submesh);
+				submeshTriangles[submesh] += (unsigned int)(endTriangle - firstTriangle);
+				firstTriangle = endTriangle;
+			}
+
+			if (i < changes.size())
+				(changes[i].Material ? material : group) = changes[i].Name;
+		}
+
+		// Each submesh's range, in order
+		unsigned int nextIndex = 0;
+		for (size_t i = 0; i < mesh.Submeshes.size(); i++)
+		{
+			mesh.Submeshes[i].FirstIndex[0] = nextIndex;
+			mesh.Submeshes[i].IndexCount[0] = submeshTriangles[i] * 3;
+			nextIndex += submeshTriangles[i] * 3;
+		}
+		// Nothing to move when everything is in one submesh
+		if (mesh.Submeshes.size() <= 1)
+		{
+			AddDefaultSubmesh(mesh);
+			return;
+		}
+
+		std::vector<unsigned int> sorted(mesh.Indices.size());
+		std::vector<unsigned int> writeIndex(mesh.Submeshes.size());
+		for (size_t i = 0; i < mesh.Submeshes.size(); i++)
+			writeIndex[i] = mesh.Submeshes[i].FirstIndex[0];
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int& write = writeIndex[triangleSubmesh[t]];
+			std::copy(mesh.Indices.begin() + t * 3, mesh.Indices.begin() + t * 3 + 3, sorted.begin() + write);
+			write += 3;
+		}
+		mesh.Indices.swap(sorted);
+	}
+}
+
+
+// --------------------------------------------------------
+// Loads the given .obj file into CPU-side vertex and index
+// arrays, reading straight from a memory-mapped view of
+// the file so no per-line copies are made.
+//
+// objFile - Path to the .obj 3D model file to load
+// --------------------------------------------------------
+MeshData LoadOBJ(const std::wstring& objFile)
+{
+	MappedFile file(objFile);
+
+	// Check for successful open
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	return ParseOBJ(file.GetData(), file.GetSize());
+}
+
+
+// --------------------------------------------------------
+// Parses .obj text into CPU-side vertex and index arrays,
+// using the shared thread pool for files large enough to
+// benefit from it.  Both paths give identical results.
+//
+// The model is most likely in a right-handed space,
+// especially if it came from Maya.  We want to convert
+// to a left-handed space for DirectX.  This means we
+// need to:
+//  - Invert the Z position
+//  - Invert the normal's Z
+//  - Flip the winding order
+// We also need to flip the UV coordinate since DirectX
+// defines (0,0) as the top left of the texture, and many
+// 3D modeling packages use the bottom left as (0,0)
+//
+// Triangles are grouped into one submesh per material
+// (usemtl), or per object/group (o/g) when there are no
+// materials, so a multi-part model is still one mesh.
+//
+// data - The .obj file's text (need not be null-terminated)
+// size - The number of bytes of text
+// --------------------------------------------------------
+MeshData ParseOBJ(const char* data, size_t size)
+{
+	if (size >= OBJ_PARALLEL_PARSE_MIN_BYTES)
+		return ParseOBJParallel(data, size, ThreadPool::Shared());
+
+	return ParseOBJSerial(data, size);
+}
+
+
+// --------------------------------------------------------
+// Parses .obj text on the calling thread only
+// --------------------------------------------------------
+MeshData ParseOBJSerial(const char* data, size_t size)
+{
+	// The whole file is a single chunk, so nothing
+	// comes before it for relative indices to reach
+	ObjChunk chunk;
+	ParseChunk(data, data + size, chunk);
+
+	const int base[3] = { 0, 0, 0 };
+	ResolveRelativeIndices(chunk, base);
+
+	MeshData mesh = AssembleMesh(chunk.Positions, chunk.UVs, chunk.Normals, chunk.Corners, 0);
+	GroupSubmeshes(mesh, chunk.NameChanges);
+	return mesh;
+}
+
+
+// --------------------------------------------------------
+// Parses .obj text by splitting it at line boundaries and
+// parsing each chunk on the given thread pool.  The chunks'
+// attributes and corners are then concatenated in file order
+// (with relative indices offset by the attribute counts of
+// all earlier chunks) before vertices are welded, so the
+// result is bit-identical to ParseOBJSerial().
+// --------------------------------------------------------
+MeshData ParseOBJParallel(const char* data, size_t size, ThreadPool& pool)
+{
+	// A few chunks per thread, so uneven chunks balance out,
+	// but not so many that each one is tiny
+	size_t chunkCount = (size_t)pool.GetThreadCount() * 4;
+	chunkCount = std::min(chunkCount, size / OBJ_PARALLEL_PARSE_CHUNK_BYTES);
+	if (chunkCount <= 1)
+		return ParseOBJSerial(data, size);
+
+	// Split points, each moved forward to the start of a line
+	const char* end = data + size;
+	std::vector<const char*> splits(chunkCount + 1);
+	splits[0] = data;
+	splits[chunkCount] = end;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* p = std::max(data + size / chunkCount * i, splits[i - 1]);
+		p = SkipLine(p, end);
+		if (p < end) p++;
+		splits[i] = p;
+	}
+
+	// Parse all chunks independently
+	std::vector<ObjChunk> chunks(chunkCount);
+	pool.ParallelFor(chunkCount, [&](size_t i) { ParseChunk(splits[i], splits[i + 1], chunks[i]); });
+
+	// Where each chunk's data goes in the combined arrays
+	struct ChunkOffsets { size_t Position, UV, Normal, Corner; };
+	std::vector<ChunkOffsets> offsets(chunkCount);
+	ChunkOffsets total = {};
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		offsets[i] = total;
+		total.Position += chunks[i].Positions.size();
+		total.UV += chunks[i].UVs.size();
+		total.Normal += chunks[i].Normals.size();
+		total.Corner += chunks[i].Corners.size();
+	}
+
+	// Stitch everything together
+	std::vector<ObjNameChange> nameChanges;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		for (ObjNameChange& change : chunks[i].NameChanges)
+		{
+			change.FirstCorner += offsets[i].Corner;
+			nameChanges.push_back(std::move(change));
+		}
+	}
+
+	std::vector<XMFLOAT3> positions(total.Position);
+	std::vector<XMFLOAT2> uvs(total.UV);
+	std::vector<XMFLOAT3> normals(total.Normal);
+	std::vector<ObjCorner> corners(total.Corner);
+	pool.ParallelFor(chunkCount, [&](size_t i)
+		{
+			ObjChunk& chunk = chunks[i];
+			const int base[3] = { (int)offsets[i].Position, (int)offsets[i].UV, (int)offsets[i].Normal };
+			ResolveRelativeIndices(chunk, base);
+
+			std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + offsets[i].Position);
+			std::copy(chunk.UVs.begin(), chunk.UVs.end(), uvs.begin() + offsets[i].UV);
+			std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + offsets[i].Normal);
+			std::copy(chunk.Corners.begin(), chunk.Corners.end(), corners.begin() + offsets[i].Corner);
+			chunk = ObjChunk();
+		});
+
+	MeshData mesh = AssembleMesh(positions, uvs, normals, corners, &pool);
+	GroupSubmeshes(mesh, nameChanges);
+	return mesh;
+}
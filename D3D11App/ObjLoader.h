@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "MeshData.h"
+#include "ThreadPool.h"
+
+// Files at least this large are parsed on multiple threads
+#define OBJ_PARALLEL_PARSE_MIN_BYTES (1024 * 1024)
+
+// Smallest chunk of a file handed to a single thread
+#define OBJ_PARALLEL_PARSE_CHUNK_BYTES (128 * 1024)
+
+// Loads an entire .obj file through a memory-mapped view
+MeshData LoadOBJ(const std::wstring& objFile);
+
+// Parses .obj text that is already in memory, in parallel if it's large
+MeshData ParseOBJ(const char* data, size_t size);
+
+// Explicitly serial or parallel parsing (both give identical results)
+MeshData ParseOBJSerial(const char* data, size_t size);
+MeshData ParseOBJParallel(const char* data, size_t size, ThreadPool& pool);
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "PackedVertex.h"
+
+using namespace DirectX;
+
+// Position-only streams rely on positions coming first in both formats
+static_assert(offsetof(Vertex, Position) == 0, "Vertex positions must come first");
+static_assert(offsetof(PackedVertex, Position) == 0, "PackedVertex positions must come first");
+
+#ifdef _WIN32
+const D3D11_INPUT_ELEMENT_DESC PackedVertexInputLayout[3] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(PackedVertex, Position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, offsetof(PackedVertex, UV), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, offsetof(PackedVertex, NormalTangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+const D3D11_INPUT_ELEMENT_DESC PositionInputLayout[1] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+const D3D11_INPUT_ELEMENT_DESC PackedPositionInputLayout[1] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+#endif
+
+namespace
+{
+	unsigned short FloatToUnorm16(float v, float offset, float scale)
+	{
+		// Flat ranges have nothing to store
+		float unorm = scale > 0.0f ? (v - offset) / scale : 0.0f;
+		return (unsigned short)lroundf(std::clamp(unorm, 0.0f, 1.0f) * 65535.0f);
+	}
+
+	float Unorm16ToFloat(unsigned short v, float offset, float scale)
+	{
+		return offset + (v / 65535.0f) * scale;
+	}
+
+	short FloatToSnorm16(float v)
+	{
+		return (short)lroundf(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	float Snorm16ToFloat(short v)
+	{
+		// Both -32768 and -32767 mean -1
+		return std::max(v / 32767.0f, -1.0f);
+	}
+
+	float SignNotZero(float v)
+	{
+		return v >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// ----------------------------------------------------
+	// Octahedral encoding: projects a unit vector onto the
+	// octahedron |x| + |y| + |z| = 1, then folds the lower
+	// half over the upper one, so it fits in a [-1, 1] square
+	// ----------------------------------------------------
+	void OctahedralEncode(const XMFLOAT3& v, short* encoded)
+	{
+		float sum = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+		if (sum <= 0.0f)
+		{
+			encoded[0] = 0;
+			encoded[1] = 0;
+			return;
+		}
+
+		float x = v.x / sum;
+		float y = v.y / sum;
+		if (v.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = FloatToSnorm16(x);
+		encoded[1] = FloatToSnorm16(y);
+	}
+
+	XMFLOAT3 OctahedralDecode(const short* encoded)
+	{
+		float x = Snorm16ToFloat(encoded[0]);
+		float y = Snorm16ToFloat(encoded[1]);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		if (z < 0.0f)
+		{
+			float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+
+		XMFLOAT3 v;
+		XMStoreFloat3(&v, XMVector3Normalize(XMVectorSet(x, y, z, 0)));
+		return v;
+	}
+
+	// Angle between two (possibly unnormalized) directions, in degrees.
+	// (Not acos() of their dot product: near zero, a float cosine
+	// can't tell apart angles under 0.02 degrees, which is about
+	// the size of the errors being measured.)
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMLoadFloat3(&a);
+		XMVECTOR vb = XMLoadFloat3(&b);
+		if (XMVectorGetX(XMVector3LengthSq(va)) <= 0.0f || XMVectorGetX(XMVector3LengthSq(vb)) <= 0.0f)
+			return 0.0f;
+
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb)));
+		float cosine = XMVectorGetX(XMVector3Dot(va, vb));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+}
+
+
+// --------------------------------------------------------
+// Fits the position & UV grids to the bounds of the vertices,
+// so each axis gets the full 16 bits of precision.  (Half
+// floats would be the obvious choice for UVs, but they lose
+// too much precision on tiled UVs, far from zero.)
+// --------------------------------------------------------
+VertexQuantization ComputeVertexQuantization(const Vertex* verts, size_t numVerts)
+{
+	XMVECTOR minPos = XMVectorReplicate(numVerts > 0 ? FLT_MAX : 0.0f);
+	XMVECTOR maxPos = XMVectorReplicate(numVerts > 0 ? -FLT_MAX : 0.0f);
+	XMVECTOR minUV = minPos;
+	XMVECTOR maxUV = maxPos;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		minPos = XMVectorMin(minPos, pos);
+		maxPos = XMVectorMax(maxPos, pos);
+
+		XMVECTOR uv = XMLoadFloat2(&verts[i].UV);
+		minUV = XMVectorMin(minUV, uv);
+		maxUV = XMVectorMax(maxUV, uv);
+	}
+
+	VertexQuantization quantization;
+	XMStoreFloat3(&quantization.Offset, minPos);
+	XMStoreFloat3(&quantization.Scale, XMVectorSubtract(maxPos, minPos));
+	XMStoreFloat2(&quantization.UVOffset, minUV);
+	XMStoreFloat2(&quantization.UVScale, XMVectorSubtract(maxUV, minUV));
+	return quantization;
+}
+
+
+// --------------------------------------------------------
+// Compresses vertices into the packed format
+//
+// verts        - The original vertices (tangents included)
+// numVerts     - The number of verts in both arrays
+// quantization - Grids for positions & UVs (which must be inside them)
+// packed       - Receives the compressed vertices
+// --------------------------------------------------------
+void PackVertices(const Vertex* verts, size_t numVerts, const VertexQuantization& quantization, PackedVertex* packed)
+{
+	const float* offset = &quantization.Offset.x;
+	const float* scale = &quantization.Scale.x;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const Vertex& v = verts[i];
+		PackedVertex& p = packed[i];
+
+		const float* pos = &v.Position.x;
+		for (int axis = 0; axis < 3; axis++)
+			p.Position[axis] = FloatToUnorm16(pos[axis], offset[axis], scale[axis]);
+		p.Position[3] = 0;
+
+		p.UV[0] = FloatToUnorm16(v.UV.x, quantization.UVOffset.x, quantization.UVScale.x);
+		p.UV[1] = FloatToUnorm16(v.UV.y, quantization.UVOffset.y, quantization.UVScale.y);
+
+		OctahedralEncode(v.Normal, &p.NormalTangent[0]);
+		OctahedralEncode(v.Tangent, &p.NormalTangent[2]);
+	}
+}
+
+
+// --------------------------------------------------------
+// Decompresses vertices, exactly as the packed vertex
+// shaders do (normals & tangents come back normalized)
+//
+// packed       - The compressed vertices
+// numVerts     - The number of verts in both arrays
+// quantization - Grids the positions & UVs were packed with
+// verts        - Receives the decompressed vertices
+// --------------------------------------------------------
+void UnpackVertices(const PackedVertex* packed, size_t numVerts, const VertexQuantization& quantization, Vertex* verts)
+{
+	const float* offset = &quantization.Offset.x;
+	const float* scale = &quantization.Scale.x;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const PackedVertex& p = packed[i];
+		Vertex& v = verts[i];
+
+		float* pos = &v.Position.x;
+		for (int axis = 0; axis < 3; axis++)
+			pos[axis] = Unorm16ToFloat(p.Position[axis], offset[axis], scale[axis]);
+
+		v.UV.x = Unorm16ToFloat(p.UV[0], quantization.UVOffset.x, quantization.UVScale.x);
+		v.UV.y = Unorm16ToFloat(p.UV[1], quantization.UVOffset.y, quantization.UVScale.y);
+
+		v.Normal = OctahedralDecode(&p.NormalTangent[0]);
+		v.Tangent = OctahedralDecode(&p.NormalTangent[2]);
+	}
+}
+
+
+// --------------------------------------------------------
+// Compares each original vertex to its unpacked version
+// --------------------------------------------------------
+VertexPackingError MeasurePackingError(const Vertex* verts, const PackedVertex* packed, size_t numVerts, const VertexQuantization& quantization)
+{
+	VertexPackingError error = {};
+	double totalPosition = 0;
+	double totalNormal = 0;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		Vertex unpacked;
+		UnpackVertices(&packed[i], 1, quantization, &unpacked);
+
+		XMVECTOR delta = XMVectorSubtract(XMLoadFloat3(&verts[i].Position), XMLoadFloat3(&unpacked.Position));
+		float position = XMVectorGetX(XMVector3Length(delta));
+		float uv = std::max(fabsf(verts[i].UV.x - unpacked.UV.x), fabsf(verts[i].UV.y - unpacked.UV.y));
+		float normal = AngleDegrees(verts[i].Normal, unpacked.Normal);
+		float tangent = AngleDegrees(verts[i].Tangent, unpacked.Tangent);
+
+		error.MaxPosition = std::max(error.MaxPosition, position);
+		error.MaxUV = std::max(error.MaxUV, uv);
+		error.MaxNormalDegrees = std::max(error.MaxNormalDegrees, normal);
+		error.MaxTangentDegrees = std::max(error.MaxTangentDegrees, tangent);
+		totalPosition += position;
+		totalNormal += normal;
+	}
+
+	if (numVerts > 0)
+	{
+		error.MeanPosition = (float)(totalPosition / numVerts);
+		error.MeanNormalDegrees = (float)(totalNormal / numVerts);
+	}
+	return error;
+}
+
+
+// --------------------------------------------------------
+// Splits the positions out of interleaved vertices (of
+// either format), byte for byte, so a depth-only pass
+// produces exactly the same depths as the full one
+//
+// verts        - The interleaved vertices
+// numVerts     - The number of vertices
+// vertexStride - Size of each interleaved vertex, in bytes
+// positionSize - Size of each position, in bytes
+// positions    - Receives numVerts * positionSize bytes
+// --------------------------------------------------------
+void SplitPositionStream(const void* verts, size_t numVerts, unsigned int vertexStride, unsigned int positionSize, void* positions)
+{
+	const unsigned char* source = (const unsigned char*)verts;
+	unsigned char* dest = (unsigned char*)positions;
+	for (size_t i = 0; i < numVerts; i++)
+		memcpy(dest + i * positionSize, source + i * vertexStride, positionSize);
+}
+
+
+// --------------------------------------------------------
+// Checks a position-only stream against the vertices it
+// was split from
+// --------------------------------------------------------
+bool PositionStreamMatches(const void* verts, size_t numVerts, unsigned int vertexStride, const void* positions, unsigned int positionSize)
+{
+	const unsigned char* source = (const unsigned char*)verts;
+	const unsigned char* split = (const unsigned char*)positions;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		if (memcmp(split + i * positionSize, source + i * vertexStride, positionSize) != 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <DirectXMath.h>
+
+// D3D11 is only needed for the input layouts (the rest also
+// builds without Windows, for the headless tests)
+#ifdef _WIN32
+#include <d3d11.h>
+#endif
+
+#include "Vertex.h"
+
+// Should meshes upload packed vertices (and use the packed shaders)?
+#define MESH_PACKED_VERTICES 1
+
+// Should meshes also keep a position-only vertex buffer, for depth-only passes?
+#define MESH_POSITION_STREAM 1
+
+// Fewer vertices than this lets a mesh use 16-bit indices
+#define MESH_MAX_16BIT_VERTICES 65536
+
+// --------------------------------------------------------
+// A compressed vertex (20 bytes, vs. 44 for Vertex)
+//  - Position: 16-bit UNORM, relative to the mesh's bounds
+//    (w is unused, but keeps the element 8 bytes)
+//  - UV: 16-bit UNORM, relative to the mesh's UV bounds
+//  - NormalTangent: Octahedral encodings of the normal (xy)
+//    and tangent (zw), as 16-bit SNORMs
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];
+	unsigned short UV[2];
+	short NormalTangent[4];
+};
+
+// --------------------------------------------------------
+// How packed positions and UVs map back to their ranges:
+//   position = Offset + (unorm / 65535) * Scale
+//   uv = UVOffset + (unorm / 65535) * UVScale
+// --------------------------------------------------------
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 Offset;
+	DirectX::XMFLOAT3 Scale;
+	DirectX::XMFLOAT2 UVOffset;
+	DirectX::XMFLOAT2 UVScale;
+};
+
+// --------------------------------------------------------
+// Worst (and average) differences between the original
+// vertices and their unpacked versions
+//  - Position: Object space distance
+//  - UV: Largest difference in either coordinate
+//  - Normal/Tangent: Angle, in degrees
+// --------------------------------------------------------
+struct VertexPackingError
+{
+	float MaxPosition;
+	float MaxUV;
+	float MaxNormalDegrees;
+	float MaxTangentDegrees;
+	float MeanPosition;
+	float MeanNormalDegrees;
+};
+
+#ifdef _WIN32
+// Input layout matching PackedVertex (and PackedVertexShaderInput in the shaders)
+extern const D3D11_INPUT_ELEMENT_DESC PackedVertexInputLayout[3];
+
+// Input layouts for position-only streams, which hold just the first
+// element of each vertex (a float3 for Vertex, 4 UNORM16s for PackedVertex)
+extern const D3D11_INPUT_ELEMENT_DESC PositionInputLayout[1];
+extern const D3D11_INPUT_ELEMENT_DESC PackedPositionInputLayout[1];
+#endif
+
+// Fits the quantization grids to the bounds of the vertices (and UVs)
+VertexQuantization ComputeVertexQuantization(const Vertex* verts, size_t numVerts);
+
+// Compresses vertices, and decompresses them (for validation)
+void PackVertices(const Vertex* verts, size_t numVerts, const VertexQuantization& quantization, PackedVertex* packed);
+void UnpackVertices(const PackedVertex* packed, size_t numVerts, const VertexQuantization& quantization, Vertex* verts);
+
+// Measures how much precision packing lost
+VertexPackingError MeasurePackingError(const Vertex* verts, const PackedVertex* packed, size_t numVerts, const VertexQuantization& quantization);
+
+// Copies just the positions (the first positionSize bytes of each
+// vertex) into a tightly packed, position-only stream
+void SplitPositionStream(const void* verts, size_t numVerts, unsigned int vertexStride, unsigned int positionSize, void* positions);
+
+// Does a position-only stream hold exactly the same bytes as the full vertices?
+bool PositionStreamMatches(const void* verts, size_t numVerts, unsigned int vertexStride, const void* positions, unsigned int positionSize);
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Primitives.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Proportions of the torus (matching torus.obj): the tube's
+	// radius, and the ring's, so the outer edge sits at 1
+	const float TorusTubeRadius = 2.0f / 7.0f;
+	const float TorusRingRadius = 1.0f - TorusTubeRadius;
+
+	// --------------------------------------------------------
+	// Sine & cosine of a fraction of a full turn, with the end
+	// snapped back to the start so seams line up exactly
+	// --------------------------------------------------------
+	void SinCosTurn(float turn, float& sine, float& cosine)
+	{
+		float angle = (turn >= 1.0f ? 0.0f : turn) * XM_2PI;
+		sine = sinf(angle);
+		cosine = cosf(angle);
+	}
+
+	// How far the middle of a chord strays from a circle, when the
+	// circle is split into the given number of segments
+	float ChordError(float radius, unsigned int segments)
+	{
+		return radius * (1.0f - cosf(XM_PI / segments));
+	}
+
+	// --------------------------------------------------------
+	// Adds a (columns + 1) x (rows + 1) grid of vertices, and
+	// its triangles, to a mesh.  The surface function turns
+	// (u, v) in [0, 1] into a vertex, and must be oriented
+	// like a texture seen from the front: u to the right and
+	// v down.  Triangles that collapse (like those touching
+	// the poles of a sphere) are left out.
+	// --------------------------------------------------------
+	template<typename Surface>
+	void AddGrid(MeshData& mesh, unsigned int columns, unsigned int rows, Surface surface)
+	{
+		unsigned int base = (unsigned int)mesh.Vertices.size();
+		for (unsigned int row = 0; row <= rows; row++)
+			for (unsigned int column = 0; column <= columns; column++)
+				mesh.Vertices.push_back(surface((float)column / columns, (float)row / rows));
+
+		auto samePosition = [&](unsigned int a, unsigned int b)
+			{
+				const XMFLOAT3& pa = mesh.Vertices[a].Position;
+				const XMFLOAT3& pb = mesh.Vertices[b].Position;
+				return pa.x == pb.x && pa.y == pb.y && pa.z == pb.z;
+			};
+		auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c)
+			{
+				if (samePosition(a, b) || samePosition(b, c) || samePosition(c, a))
+					return;
+				mesh.Indices.insert(mesh.Indices.end(), { a, b, c });
+			};
+
+		// Clockwise, as seen from the front
+		for (unsigned int row = 0; row < rows; row++)
+		{
+			for (unsigned int column = 0; column < columns; column++)
+			{
+				unsigned int topLeft = base + row * (columns + 1) + column;
+				unsigned int bottomLeft = topLeft + columns + 1;
+				addTriangle(topLeft, topLeft + 1, bottomLeft);
+				addTriangle(topLeft + 1, bottomLeft + 1, bottomLeft);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// A flat, subdivided square face, 2 units across
+	//
+	// center - Middle of the face
+	// right  - Direction of +u (and the tangent)
+	// down   - Direction of +v
+	// --------------------------------------------------------
+	void AddFace(MeshData& mesh, unsigned int subdivisions, XMFLOAT3 center, XMFLOAT3 right, XMFLOAT3 down)
+	{
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3Cross(XMLoadFloat3(&right), XMLoadFloat3(&down)));
+
+		AddGrid(mesh, subdivisions, subdivisions, [&](float u, float v)
+			{
+				float x = u * 2.0f - 1.0f;
+				float y = v * 2.0f - 1.0f;
+
+				Vertex vert;
+				vert.Position = XMFLOAT3(
+					center.x + right.x * x + down.x * y,
+					center.y + right.y * x + down.y * y,
+					center.z + right.z * x + down.z * y);
+				vert.UV = XMFLOAT2(u, v);
+				vert.Normal = normal;
+				vert.Tangent = right;
+				return vert;
+			});
+	}
+
+	// --------------------------------------------------------
+	// Each shape at a single tessellation, returning how far
+	// its surface is from the ideal one
+	// --------------------------------------------------------
+	float AddCube(MeshData& mesh, unsigned int subdivisions)
+	{
+		AddFace(mesh, subdivisions, XMFLOAT3(0, 0, -1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, -1, 0));
+		AddFace(mesh, subdivisions, XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, -1, 0));
+		AddFace(mesh, subdivisions, XMFLOAT3(0, 0, 1), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, -1, 0));
+		AddFace(mesh, subdivisions, XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(0, -1, 0));
+		AddFace(mesh, subdivisions, XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1));
+		AddFace(mesh, subdivisions, XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1));
+		return 0.0f;
+	}
+
+	float AddQuad(MeshData& mesh, unsigned int subdivisions, bool doubleSided)
+	{
+		AddFace(mesh, subdivisions, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1));
+		if (doubleSided)
+			AddFace(mesh, subdivisions, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1));
+		return 0.0f;
+	}
+
+	float AddSphere(MeshData& mesh, unsigned int segments)
+	{
+		unsigned int rings = std::max(segments / 2, 2u);
+		AddGrid(mesh, segments, rings, [](float u, float v)
+			{
+				float sinPhi, cosPhi;
+				SinCosTurn(u, sinPhi, cosPhi);
+				float theta = v * XM_PI;
+				float sinTheta = (v <= 0.0f || v >= 1.0f) ? 0.0f : sinf(theta);
+
+				Vertex vert;
+				vert.Position = XMFLOAT3(sinTheta * cosPhi, cosf(theta), sinTheta * sinPhi);
+				vert.UV = XMFLOAT2(u, v);
+				vert.Normal = vert.Position;
+				vert.Tangent = XMFLOAT3(-sinPhi, 0, cosPhi);
+				return vert;
+			});
+		return std::max(ChordError(1.0f, segments), ChordError(1.0f, rings * 2));
+	}
+
+	float AddCylinder(MeshData& mesh, unsigned int segments)
+	{
+		// Side, wrapping once around
+		AddGrid(mesh, segments, 1, [](float u, float v)
+			{
+				float sinPhi, cosPhi;
+				SinCosTurn(u, sinPhi, cosPhi);
+
+				Vertex vert;
+				vert.Position = XMFLOAT3(cosPhi, 1.0f - v * 2.0f, sinPhi);
+				vert.UV = XMFLOAT2(u, v);
+				vert.Normal = XMFLOAT3(cosPhi, 0, sinPhi);
+				vert.Tangent = XMFLOAT3(-sinPhi, 0, cosPhi);
+				return vert;
+			});
+
+		// Caps, as single rings around their centers (with UVs
+		// projected straight down, as seen from outside)
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float y = cap == 0 ? 1.0f : -1.0f;
+			AddGrid(mesh, segments, 1, [=](float u, float v)
+				{
+					float sinPhi, cosPhi;
+					SinCosTurn(u, sinPhi, cosPhi);
+					float radius = cap == 0 ? v : 1.0f - v;
+
+					Vertex vert;
+					vert.Position = XMFLOAT3(cosPhi * radius, y, sinPhi * radius);
+					vert.UV = XMFLOAT2(0.5f + 0.5f * vert.Position.x, 0.5f - 0.5f * vert.Position.z * y);
+					vert.Normal = XMFLOAT3(0, y, 0);
+					vert.Tangent = XMFLOAT3(1, 0, 0);
+					return vert;
+				});
+		}
+		return ChordError(1.0f, segments);
+	}
+
+	float AddTorus(MeshData& mesh, unsigned int segments)
+	{
+		unsigned int sides = std::max(segments / 2, 3u);
+		AddGrid(mesh, segments, sides, [](float u, float v)
+			{
+				float sinAlpha, cosAlpha, sinBeta, cosBeta;
+				SinCosTurn(u, sinAlpha, cosAlpha);
+				SinCosTurn(v, sinBeta, cosBeta);
+				float ring = TorusRingRadius + TorusTubeRadius * cosBeta;
+
+				Vertex vert;
+				vert.Position = XMFLOAT3(ring * cosAlpha, -TorusTubeRadius * sinBeta, ring * sinAlpha);
+				vert.UV = XMFLOAT2(u, v);
+				vert.Normal = XMFLOAT3(cosBeta * cosAlpha, -sinBeta, cosBeta * sinAlpha);
+				vert.Tangent = XMFLOAT3(-sinAlpha, 0, cosAlpha);
+				return vert;
+			});
+		return std::max(ChordError(1.0f, segments), ChordError(TorusTubeRadius, sides));
+	}
+
+	float AddShape(MeshData& mesh, PrimitiveShape shape, unsigned int detail)
+	{
+		switch (shape)
+		{
+		case PrimitiveShape::Cube: return AddCube(mesh, detail);
+		case PrimitiveShape::Quad: return AddQuad(mesh, detail, false);
+		case PrimitiveShape::DoubleSidedQuad: return AddQuad(mesh, detail, true);
+		case PrimitiveShape::Sphere: return AddSphere(mesh, detail);
+		case PrimitiveShape::Cylinder: return AddCylinder(mesh, detail);
+		case PrimitiveShape::Torus: return AddTorus(mesh, detail);
+		}
+		return 0.0f;
+	}
+}
+
+
+// --------------------------------------------------------
+// Generates a primitive directly into vertex & index arrays,
+// skipping the file, the parser and the tangent calculation
+// (tangents come straight from the shape's UV directions).
+//
+// Each coarser LOD is the same shape tessellated with half
+// the detail, appended as its own vertices & index range,
+// so every level is an exact version of the shape rather
+// than a simplification.  Its error is how far its flat
+// faces stray from the ideal surface.
+// --------------------------------------------------------
+MeshData GeneratePrimitive(PrimitiveShape shape, unsigned int detail, unsigned int lodCount)
+{
+	bool round = shape == PrimitiveShape::Sphere || shape == PrimitiveShape::Cylinder || shape == PrimitiveShape::Torus;
+	unsigned int minDetail = round ? PRIMITIVE_MIN_SEGMENTS : 1;
+	detail = std::max(detail, minDetail);
+	lodCount = std::clamp(lodCount, 1u, (unsigned int)MESH_MAX_LODS);
+
+	MeshData mesh;
+	for (unsigned int lod = 0; lod < lodCount; lod++)
+	{
+		// Stop once halving can't make the shape any simpler
+		unsigned int levelDetail = std::max(detail >> lod, minDetail);
+		if (lod > 0 && levelDetail == std::max(detail >> (lod - 1), minDetail))
+			break;
+
+		unsigned int firstIndex = (unsigned int)mesh.Indices.size();
+		float error = AddShape(mesh, shape, levelDetail);
+		unsigned int indexCount = (unsigned int)mesh.Indices.size() - firstIndex;
+		OptimizeVertexCache(&mesh.Indices[firstIndex], indexCount, mesh.Vertices.size());
+
+		// Errors are relative to the full detail level
+		mesh.LODs.push_back({ firstIndex, indexCount, lod == 0 ? 0.0f : error });
+	}
+
+	// Large enough primitives get meshlets, like any other mesh
+	BuildMeshlets(mesh);
+	OptimizeVertexFetch(mesh);
+	return mesh;
+}
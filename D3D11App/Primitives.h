@@ -0,0 +1,31 @@
+#pragma once
+
+#include "MeshData.h"
+
+// Fewest segments around a round primitive (at any LOD)
+#define PRIMITIVE_MIN_SEGMENTS 6
+
+// --------------------------------------------------------
+// Shapes that can be generated rather than loaded.  Sizes
+// match the .obj files they replace: everything fits in
+// [-1, 1] on each axis, and quads lie in the XZ plane.
+// --------------------------------------------------------
+enum class PrimitiveShape
+{
+	Cube,
+	Quad,
+	DoubleSidedQuad,
+	Sphere,
+	Cylinder,
+	Torus
+};
+
+// --------------------------------------------------------
+// Generates a finished primitive (tangents included, cache
+// optimized), with up to lodCount levels of detail.
+//
+// detail - Segments around round shapes (rings, sides, etc.
+//          follow from it), or subdivisions along each edge
+//          of flat faces.  Each LOD halves it.
+// --------------------------------------------------------
+MeshData GeneratePrimitive(PrimitiveShape shape, unsigned int detail, unsigned int lodCount = 1);
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "SceneBVH.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const int TraversalStackSize = 256;
+}
+
+// --------------------------------------------------------
+// Builds the top level with one instance per leaf, since
+// each instance's own BVH does the rest of the work
+// --------------------------------------------------------
+void SceneBVH::Build(const SceneBVHInstance* sceneInstances, size_t count)
+{
+	std::vector<Bounds> instanceBounds(count);
+	instances.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		instanceBounds[i] = TransformBounds(sceneInstances[i].BVH->GetBounds(), sceneInstances[i].World);
+		instances[i].BVH = sceneInstances[i].BVH;
+		XMStoreFloat4x4(&instances[i].InverseWorld, XMMatrixInverse(0, XMLoadFloat4x4(&sceneInstances[i].World)));
+	}
+
+	// Leaves hold one instance each, so leaf i is just the i-th in the build order
+	std::vector<BVHLeaf> leaves;
+	std::vector<unsigned int> order;
+	BuildBVH(instanceBounds.data(), count, 1, nodes, leaves, order);
+	instanceIndices.resize(leaves.size());
+	for (size_t i = 0; i < leaves.size(); i++)
+		instanceIndices[i] = order[leaves[i].First];
+
+	// Remember where every box went, for refitting (children
+	// always come after their parents, so the root has none)
+	nodeLanes.assign(nodes.size(), BVH_EMPTY_CHILD);
+	instanceLanes.assign(count, BVH_EMPTY_CHILD);
+	nodesMoved.assign(nodes.size(), 0);
+	for (unsigned int n = 0; n < nodes.size(); n++)
+	{
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			unsigned int child = nodes[n].Children[lane];
+			if (child == BVH_EMPTY_CHILD)
+				continue;
+			if (child & BVH_LEAF_FLAG)
+				instanceLanes[instanceIndices[child & ~BVH_LEAF_FLAG]] = n * 4 + lane;
+			else
+				nodeLanes[child] = n * 4 + lane;
+		}
+	}
+}
+
+void SceneBVH::MoveInstance(unsigned int instance, const XMFLOAT4X4& world)
+{
+	Bounds bounds = TransformBounds(instances[instance].BVH->GetBounds(), world);
+	XMStoreFloat4x4(&instances[instance].InverseWorld, XMMatrixInverse(0, XMLoadFloat4x4(&world)));
+
+	unsigned int nodeLane = instanceLanes[instance];
+	SetLaneBounds(nodeLane, bounds.Min, bounds.Max);
+	nodesMoved[nodeLane / 4] = 1;
+}
+
+// --------------------------------------------------------
+// Works up from the last node to the first, so every node's
+// children are done before its own box (the union of
+// theirs) is written into its parent
+// --------------------------------------------------------
+void SceneBVH::Refit()
+{
+	for (size_t n = nodes.size(); n-- > 1;)
+	{
+		if (!nodesMoved[n])
+			continue;
+		nodesMoved[n] = 0;
+
+		const BVHNode& node = nodes[n];
+		XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (node.Children[lane] == BVH_EMPTY_CHILD)
+				continue;
+			min.x = std::min(min.x, (&node.MinX.x)[lane]);
+			min.y = std::min(min.y, (&node.MinY.x)[lane]);
+			min.z = std::min(min.z, (&node.MinZ.x)[lane]);
+			max.x = std::max(max.x, (&node.MaxX.x)[lane]);
+			max.y = std::max(max.y, (&node.MaxY.x)[lane]);
+			max.z = std::max(max.z, (&node.MaxZ.x)[lane]);
+		}
+
+		SetLaneBounds(nodeLanes[n], min, max);
+		nodesMoved[nodeLanes[n] / 4] = 1;
+	}
+
+	// The root's box isn't kept anywhere
+	if (!nodesMoved.empty())
+		nodesMoved[0] = 0;
+}
+
+bool SceneBVH::Raycast(const Ray& ray, SceneRayHit& hit) const { return Traverse(ray, hit, false); }
+
+bool SceneBVH::IsOccluded(const Ray& ray) const
+{
+	SceneRayHit hit;
+	return Traverse(ray, hit, true);
+}
+
+unsigned int SceneBVH::GetNodeCount() const { return (unsigned int)nodes.size(); }
+
+void SceneBVH::SetLaneBounds(unsigned int nodeLane, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	BVHNode& node = nodes[nodeLane / 4];
+	unsigned int lane = nodeLane % 4;
+	(&node.MinX.x)[lane] = min.x;
+	(&node.MinY.x)[lane] = min.y;
+	(&node.MinZ.x)[lane] = min.z;
+	(&node.MaxX.x)[lane] = max.x;
+	(&node.MaxY.x)[lane] = max.y;
+	(&node.MaxZ.x)[lane] = max.z;
+}
+
+// --------------------------------------------------------
+// Walks the top level like a mesh BVH, casting the ray
+// into each instance it reaches.  The object space ray
+// keeps the world direction's length (untransformed
+// distances), so hits in every instance compare directly.
+// --------------------------------------------------------
+bool SceneBVH::Traverse(const Ray& ray, SceneRayHit& hit, bool anyHit) const
+{
+	if (nodes.empty())
+		return false;
+
+	BVHRay nodeRay = PrepareBVHRay(ray);
+	XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+	XMVECTOR direction = XMLoadFloat3(&ray.Direction);
+
+	Ray objectRay = ray;
+	bool found = false;
+	unsigned int stack[TraversalStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		unsigned int child = stack[--top];
+		if (child & BVH_LEAF_FLAG)
+		{
+			unsigned int instance = instanceIndices[child & ~BVH_LEAF_FLAG];
+			XMMATRIX inverseWorld = XMLoadFloat4x4(&instances[instance].InverseWorld);
+			XMStoreFloat3(&objectRay.Origin, XMVector3Transform(origin, inverseWorld));
+			XMStoreFloat3(&objectRay.Direction, XMVector3TransformNormal(direction, inverseWorld));
+
+			RayHit instanceHit;
+			bool instanceFound = anyHit ?
+				instances[instance].BVH->IsOccluded(objectRay) :
+				instances[instance].BVH->Raycast(objectRay, instanceHit);
+			if (instanceFound)
+			{
+				if (anyHit)
+					return true;
+
+				hit = { instance, instanceHit };
+				objectRay.MaxDistance = instanceHit.Distance;
+				found = true;
+			}
+			continue;
+		}
+
+		top += IntersectBVHNode(nodes[child], nodeRay, objectRay.MaxDistance, stack + top);
+	}
+	return found;
+}
+
+
+// --------------------------------------------------------
+// Unprojects the point at the near and far planes, so it
+// works for both perspective & orthographic cameras
+// --------------------------------------------------------
+Ray CreatePickingRay(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float screenX, float screenY, float screenWidth, float screenHeight)
+{
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection));
+	XMMATRIX invViewProj = XMMatrixInverse(0, viewProj);
+
+	float x = screenX / screenWidth * 2.0f - 1.0f;
+	float y = 1.0f - screenY / screenHeight * 2.0f;
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), invViewProj);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), invViewProj);
+
+	Ray ray;
+	XMStoreFloat3(&ray.Origin, nearPoint);
+	XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSubtract(farPoint, nearPoint)));
+	ray.MaxDistance = FLT_MAX;
+	return ray;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "MeshBVH.h"
+
+// --------------------------------------------------------
+// A placed copy of a mesh's BVH (like an entity), for the
+// top level of a scene's hierarchy
+// --------------------------------------------------------
+struct SceneBVHInstance
+{
+	const MeshBVH* BVH;
+	DirectX::XMFLOAT4X4 World;
+};
+
+// Where a ray hit the scene: which instance, and where on its mesh
+struct SceneRayHit
+{
+	unsigned int Instance;
+	RayHit Hit;
+};
+
+// --------------------------------------------------------
+// Top level BVH over instances of meshes' BVHs.  Rays are
+// moved into each instance's object space rather than
+// transforming any geometry, so rebuilding after things
+// move only costs one box per instance.
+// --------------------------------------------------------
+class SceneBVH
+{
+public:
+	// Builds over the instances' world space boxes (the
+	// mesh BVHs aren't copied, and must outlive this)
+	void Build(const SceneBVHInstance* instances, size_t count);
+
+	// Moves one instance (by its index in the build) without
+	// rebuilding: its box is replaced, and Refit() then fixes
+	// up the boxes above it.  The structure stays as it was
+	// built, so it gets less efficient as things move far.
+	void MoveInstance(unsigned int instance, const DirectX::XMFLOAT4X4& world);
+	void Refit();
+
+	// Closest hit of a world space ray within its max distance
+	bool Raycast(const Ray& ray, SceneRayHit& hit) const;
+
+	// Is there anything within the ray's max distance?
+	bool IsOccluded(const Ray& ray) const;
+
+	unsigned int GetNodeCount() const;
+
+private:
+	// What leaves need: the BVH and the way into its object space
+	struct Instance
+	{
+		const MeshBVH* BVH;
+		DirectX::XMFLOAT4X4 InverseWorld;
+	};
+
+	std::vector<BVHNode> nodes;
+	std::vector<Instance> instances;
+	std::vector<unsigned int> instanceIndices;
+
+	// Where each box lives, as a node's index times four plus its
+	// lane: each node's box (in its parent) and each instance's
+	std::vector<unsigned int> nodeLanes;
+	std::vector<unsigned int> instanceLanes;
+	std::vector<unsigned char> nodesMoved;
+
+	bool Traverse(const Ray& ray, SceneRayHit& hit, bool anyHit) const;
+	void SetLaneBounds(unsigned int nodeLane, const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max);
+};
+
+// The world space ray through a point on the screen (in pixels, from
+// the top left), for picking.  Its direction is normalized, so hit
+// distances are in world units.
+Ray CreatePickingRay(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float screenX, float screenY, float screenWidth, float screenHeight);
@@ -12,7 +12,61 @@ struct VertexShaderInput
 	float3 tangent			: TANGENT;
 };
 
+// Compressed version of the above (see PackedVertex.h)
+struct PackedVertexShaderInput
+{
+	float4 localPosition	: POSITION;	// 0-1 within the mesh's bounds
+	float2 uv				: TEXCOORD;	// 0-1 within the mesh's UV bounds
+	float4 normalTangent	: NORMAL;	// Octahedral normal (xy) & tangent (zw)
+};
+
+// Reverses the octahedral encoding of a unit vector
+float3 OctahedralDecode(float2 e)
+{
+	float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (v.z < 0)
+		v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0 ? 1.0f : -1.0f);
+	return normalize(v);
+}
+
+// Unpacks a compressed position, given the mesh's quantization grid
+float3 UnpackPosition(float4 packedPosition, float4 positionOffset, float4 positionScale)
+{
+	return positionOffset.xyz + packedPosition.xyz * positionScale.xyz;
+}
+
+// Unpacks a compressed vertex, given the mesh's quantization grids
+VertexShaderInput UnpackVertex(PackedVertexShaderInput packed, float4 positionOffset, float4 positionScale, float4 uvOffsetScale)
+{
+	VertexShaderInput input;
+	input.localPosition = UnpackPosition(packed.localPosition, positionOffset, positionScale);
+	input.uv = uvOffsetScale.xy + packed.uv * uvOffsetScale.zw;
+	input.normal = OctahedralDecode(packed.normalTangent.xy);
+	input.tangent = OctahedralDecode(packed.normalTangent.zw);
+	return input;
+}
+
 
+// Position-only VS input, for depth-only passes: either full
+// floats or packed (see PositionInputLayout in PackedVertex.h)
+struct PositionShaderInput
+{
+#ifdef PACKED_VERTICES
+	float4 localPosition	: POSITION;	// 0-1 within the mesh's bounds
+#else
+	float3 localPosition	: POSITION;
+#endif
+};
+
+// Object to screen space.  Depth-only passes must produce the
+// exact same depths as the full passes, so both use this (and
+// precise keeps the compiler from reordering the math).
+float4 LocalToScreen(float3 localPosition, matrix world, matrix view, matrix projection)
+{
+	precise matrix wvp = mul(projection, mul(view, world));
+	precise float4 screenPosition = mul(wvp, float4(localPosition, 1.0f));
+	return screenPosition;
+}
 
 // VS Output / PS Input struct for basic lighting
 struct VertexToPixel
@@ -85,6 +85,7 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	// Give them proper data
 	skyVS->SetMatrix4x4("view", camera->GetView());
 	skyVS->SetMatrix4x4("projection", camera->GetProjection());
+	skyMesh->SetShaderQuantization(skyVS);
 	skyVS->CopyAllBufferData();
 
 	// Send the proper resources to the pixel shader
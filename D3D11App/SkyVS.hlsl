@@ -5,13 +5,25 @@ cbuffer ExternalData : register(b0)
 {
 	matrix view;
 	matrix projection;
+#ifdef PACKED_VERTICES
+	float4 positionOffset;
+	float4 positionScale;
+	float4 uvOffsetScale;
+#endif
 }
 
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // --------------------------------------------------------
+#ifdef PACKED_VERTICES
+VertexToPixel_Sky main(PackedVertexShaderInput packedInput)
+{
+	VertexShaderInput input = UnpackVertex(packedInput, positionOffset, positionScale, uvOffsetScale);
+#else
 VertexToPixel_Sky main(VertexShaderInput input)
 {
+#endif
+
 	// Set up output struct
 	VertexToPixel_Sky output;
 
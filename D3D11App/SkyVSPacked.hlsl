@@ -0,0 +1,3 @@
+// Same as SkyVS.hlsl, but for meshes with packed vertices
+#define PACKED_VERTICES
+#include "SkyVS.hlsl"
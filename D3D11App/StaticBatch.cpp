@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "StaticBatch.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Bakes each instance's world matrix into its vertices and
+// appends them (and their indices) to one mesh:
+//  - Positions are transformed as points
+//  - Normals by the inverse transpose, so they stay
+//    perpendicular to surfaces under non-uniform scale
+//  - Tangents by the world matrix, then made perpendicular
+//    to the new normal again
+// Only the vertices an instance's indices use are copied.
+// Mirroring transforms (negative determinant) turn faces
+// inside out, so their triangles' winding is flipped back.
+//
+// The result is a single LOD, with meshlets if it's big
+// enough, so large batches can still be partly culled.
+// --------------------------------------------------------
+MeshData MergeStaticGeometry(const StaticBatchInstance* instances, size_t count)
+{
+	MeshData merged;
+
+	const unsigned int Unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap;
+	for (size_t i = 0; i < count; i++)
+	{
+		const StaticBatchInstance& instance = instances[i];
+		XMMATRIX world = XMLoadFloat4x4(&instance.World);
+		XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(0, world));
+		bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+
+		remap.assign(instance.VertexCount, Unused);
+		size_t firstIndex = merged.Indices.size();
+		for (size_t j = 0; j < instance.IndexCount; j++)
+		{
+			unsigned int index = instance.Indices[j];
+			if (remap[index] == Unused)
+			{
+				const Vertex& source = instance.Vertices[index];
+				XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&source.Normal), normalMatrix));
+				XMVECTOR tangent = XMVector3TransformNormal(XMLoadFloat3(&source.Tangent), world);
+				tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(tangent, normal))));
+
+				Vertex vert;
+				XMStoreFloat3(&vert.Position, XMVector3Transform(XMLoadFloat3(&source.Position), world));
+				XMStoreFloat3(&vert.Normal, normal);
+				XMStoreFloat3(&vert.Tangent, tangent);
+				vert.UV = source.UV;
+
+				remap[index] = (unsigned int)merged.Vertices.size();
+				merged.Vertices.push_back(vert);
+			}
+			merged.Indices.push_back(remap[index]);
+		}
+
+		if (mirrored)
+			for (size_t t = firstIndex; t + 2 < merged.Indices.size(); t += 3)
+				std::swap(merged.Indices[t + 1], merged.Indices[t + 2]);
+	}
+
+	merged.LODs.push_back({ 0, (unsigned int)merged.Indices.size(), 0.0f });
+	BuildMeshlets(merged);
+	OptimizeVertexFetch(merged);
+	return merged;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// One placed copy of (part of) a mesh to bake into a batch:
+// a range of its indices, drawn with the given world matrix
+// --------------------------------------------------------
+struct StaticBatchInstance
+{
+	const Vertex* Vertices;
+	size_t VertexCount;
+	const unsigned int* Indices;
+	size_t IndexCount;
+	DirectX::XMFLOAT4X4 World;
+};
+
+// --------------------------------------------------------
+// Merges instances into a single mesh in world space, so
+// that things which never move (and share a material) can
+// be drawn with one draw call and an identity world matrix.
+// Purely CPU-side, so it can be tested (or run offline)
+// without a device.
+// --------------------------------------------------------
+MeshData MergeStaticGeometry(const StaticBatchInstance* instances, size_t count);
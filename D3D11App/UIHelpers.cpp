@@ -1,5 +1,6 @@
 
 #include <DirectXMath.h>
+#include <algorithm>
 
 #include "UIHelpers.h"
 #include "Window.h"
@@ -45,13 +46,16 @@ void BuildUI(
 	std::vector<std::shared_ptr<Material>>& materials,
 	std::vector<Light>& lights,
 	DemoLightingOptions& lightOptions,
+	LODSelector& lodSelector,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneColors,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneNormal,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneDepth,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ambient,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ssaoResult,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blurSSAO,
-	int* ssaoSamples, float* ssaoRadius, bool* ssaoOn, bool* ssaoOnly)
+	int* ssaoSamples, float* ssaoRadius, bool* ssaoOn, bool* ssaoOnly, bool* depthPrepass,
+	bool* staticBatching, int drawCount,
+	std::shared_ptr<GameEntity> pickedEntity, float pickedDistance)
 {
 	// A static variable to track whether or not the demo window should be shown.  
 	//  - Static in this context means that the variable is created once 
@@ -94,6 +98,7 @@ void BuildUI(
 			ImGui::Spacing();
 			ImGui::Text("(WASD, X, Space)");    ImGui::SameLine(175); ImGui::Text("Move camera");
 			ImGui::Text("(Left Click & Drag)"); ImGui::SameLine(175); ImGui::Text("Rotate camera");
+			ImGui::Text("(Right Click)");		ImGui::SameLine(175); ImGui::Text("Pick an entity");
 			ImGui::Text("(Left Shift)");        ImGui::SameLine(175); ImGui::Text("Hold to speed up camera");
 			ImGui::Text("(Left Ctrl)");         ImGui::SameLine(175); ImGui::Text("Hold to slow down camera");
 
@@ -132,6 +137,14 @@ void BuildUI(
 		// === Meshes ===
 		if (ImGui::TreeNode("Meshes"))
 		{
+			// Shared buffers behind every mesh
+			GeometryPool& pool = GeometryPool::Shared();
+			ImGui::Spacing();
+			ImGui::Text("Geometry pool: %.1f KB used (of %.1f KB), %u meshes",
+				pool.GetUsedBytes() / 1024.0f, pool.GetCapacityBytes() / 1024.0f, pool.GetRangeCount());
+			ImGui::Text("Buffer binds:  %u (last frame)", pool.GetBindCount());
+			ImGui::Spacing();
+
 			// Loop and show the details for each mesh
 			for (int i = 0; i < meshes.size(); i++)
 			{
@@ -153,6 +166,37 @@ void BuildUI(
 			ImGui::TreePop();
 		}
 
+		// === Level of detail ===
+		if (ImGui::TreeNode("Level of Detail"))
+		{
+			ImGui::Spacing();
+			bool enabled = lodSelector.GetEnabled();
+			if (ImGui::Checkbox("Enabled", &enabled))
+				lodSelector.SetEnabled(enabled);
+
+			float maxPixelError = lodSelector.GetMaxPixelError();
+			if (ImGui::SliderFloat("Max Pixel Error", &maxPixelError, 0.1f, 16.0f))
+				lodSelector.SetMaxPixelError(maxPixelError);
+
+			float hysteresis = lodSelector.GetHysteresis();
+			if (ImGui::SliderFloat("Hysteresis", &hysteresis, 0.0f, 0.9f))
+				lodSelector.SetHysteresis(hysteresis);
+
+			// Stats from the last frame drawn
+			const LODFrameStats& stats = lodSelector.GetFrameStats();
+			ImGui::Spacing();
+			ImGui::Text("Draws:           %u", stats.Draws);
+			ImGui::Text("Full triangles:  %u", stats.FullTriangles);
+			ImGui::Text("Drawn triangles: %u", stats.DrawnTriangles);
+			ImGui::Text("Saved:           %u (%.1f%%)", stats.TrianglesSaved,
+				stats.FullTriangles > 0 ? 100.0f * stats.TrianglesSaved / stats.FullTriangles : 0.0f);
+			for (unsigned int i = 0; i < MESH_MAX_LODS; i++)
+				ImGui::Text("LOD %u draws:     %u", i, stats.DrawsPerLOD[i]);
+
+			ImGui::TreePop();
+			ImGui::Spacing();
+		}
+
 		// === Entities ===
 		if (ImGui::TreeNode("Scene Entities"))
 		{
@@ -171,6 +215,24 @@ void BuildUI(
 			ImGui::TreePop();
 		}
 
+		// === Picking ===
+		if (ImGui::TreeNode("Picked Entity"))
+		{
+			if (pickedEntity)
+			{
+				int index = (int)(std::find(entities.begin(), entities.end(), pickedEntity) - entities.begin());
+				ImGui::Text("Entity %d, hit %.2f units away", index, pickedDistance);
+				ImGui::Text("Mesh BVH:  %u nodes over %u triangles",
+					pickedEntity->GetMesh()->GetBVH().GetNodeCount(), pickedEntity->GetMesh()->GetBVH().GetTriangleCount());
+				UIEntity(pickedEntity);
+			}
+			else
+			{
+				ImGui::Text("Nothing picked (right click an entity)");
+			}
+			ImGui::TreePop();
+		}
+
 		// === Global Material Controls ===
 		if (ImGui::TreeNode("Global Material Controls"))
 		{
@@ -280,6 +342,24 @@ void BuildUI(
 			ImGui::TreePop();
 		}
 
+		// === Depth prepass ===
+		if (ImGui::TreeNode("Depth Prepass"))
+		{
+			ImGui::Checkbox("Enabled", depthPrepass);
+			ImGui::TextWrapped("Draws depth first, from position-only vertex streams, so the full pass only shades visible pixels");
+			ImGui::TreePop();
+		}
+
+		// === Static batching ===
+		if (ImGui::TreeNode("Static Batching"))
+		{
+			ImGui::Checkbox("Enabled", staticBatching);
+			ImGui::Text("Entities in scene: %d", (int)entities.size());
+			ImGui::Text("Entities drawn:    %d", drawCount);
+			ImGui::TextWrapped("Merges static entities that share a material into one world space mesh (except those whose meshes have LODs, which keep their own LOD selection); moving a batched entity rebuilds the batches");
+			ImGui::TreePop();
+		}
+
 		// === Post processes ===
 		if (ImGui::TreeNode("SSAO"))
 		{
@@ -323,6 +403,59 @@ void UIMesh(std::shared_ptr<Mesh> mesh)
 	ImGui::Text("Triangles: %d", mesh->GetIndexCount() / 3);
 	ImGui::Text("Vertices:  %d", mesh->GetVertexCount());
 	ImGui::Text("Indices:   %d", mesh->GetIndexCount());
+	ImGui::Text("Meshlets:  %u", mesh->GetMeshletCount());
+	ImGui::Text("Submeshes: %u", mesh->GetSubmeshCount());
+
+	const Bounds& bounds = mesh->GetBounds();
+	ImGui::Text("Size:      %.2f x %.2f x %.2f", bounds.Max.x - bounds.Min.x, bounds.Max.y - bounds.Min.y, bounds.Max.z - bounds.Min.z);
+	ImGui::Text("Radius:    %.2f", bounds.Radius);
+	ImGui::Text("Load time: %.3fms (%s)", mesh->GetLoadTime(), mesh->WasGenerated() ? "generated" : mesh->WasLoadedFromCache() ? ".meshbin" : ".obj");
+
+	MeshOptimizationStats stats = mesh->GetOptimizationStats();
+	ImGui::Text("ACMR:      %.3f -> %.3f", stats.Before.ACMR, stats.After.ACMR);
+	ImGui::Text("ATVR:      %.3f -> %.3f", stats.Before.ATVR, stats.After.ATVR);
+	if (stats.OverdrawBefore.CoveredPixels > 0)
+		ImGui::Text("Overdraw:  %.3f -> %.3f", stats.OverdrawBefore.Overdraw, stats.OverdrawAfter.Overdraw);
+
+	// GPU memory, compared to full floats & 32-bit indices
+	unsigned int indexSize = mesh->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? 2 : 4;
+	unsigned int vertexBytes = mesh->GetVertexCount() * (mesh->GetVertexStride() + mesh->GetPositionStride());
+	unsigned int indexBytes = mesh->GetBufferBytes() - vertexBytes;
+	unsigned int unpackedBytes = mesh->GetVertexCount() * (unsigned int)sizeof(Vertex) + indexBytes / indexSize * 4;
+	ImGui::Text("Buffers:   %.1f KB (of %.1f KB unpacked)", mesh->GetBufferBytes() / 1024.0f, unpackedBytes / 1024.0f);
+	ImGui::Text("Formats:   %u B/vertex, %u-bit indices", mesh->GetVertexStride(), indexSize * 8);
+	if (mesh->GetPositionStride() > 0)
+		ImGui::Text("Depth:     %u B/vertex (position-only stream)", mesh->GetPositionStride());
+
+	if (mesh->GetVertexStride() == sizeof(PackedVertex) && ImGui::TreeNode("Packing Error"))
+	{
+		const VertexPackingError& error = mesh->GetPackingError();
+		ImGui::Text("Position: %.6f max, %.6f mean", error.MaxPosition, error.MeanPosition);
+		ImGui::Text("UV:       %.6f max", error.MaxUV);
+		ImGui::Text("Normal:   %.4f max, %.4f mean (degrees)", error.MaxNormalDegrees, error.MeanNormalDegrees);
+		ImGui::Text("Tangent:  %.4f max (degrees)", error.MaxTangentDegrees);
+		ImGui::TreePop();
+	}
+
+	if (mesh->GetSubmeshCount() > 1 && ImGui::TreeNode("Submeshes"))
+	{
+		for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+		{
+			const MeshSubmesh& submesh = mesh->GetSubmesh(i);
+			ImGui::Text("%u: %s (%u triangles)", i, submesh.Name[0] ? submesh.Name : "(unnamed)", submesh.IndexCount[0] / 3);
+		}
+		ImGui::TreePop();
+	}
+
+	if (mesh->GetLODCount() > 1 && ImGui::TreeNode("LODs"))
+	{
+		for (unsigned int i = 0; i < mesh->GetLODCount(); i++)
+		{
+			const MeshLOD& lod = mesh->GetLOD(i);
+			ImGui::Text("LOD %u: %u triangles, error %.4f", i, lod.IndexCount / 3, lod.Error);
+		}
+		ImGui::TreePop();
+	}
 	ImGui::Spacing();
 }
 
@@ -335,6 +468,10 @@ void UIEntity(std::shared_ptr<GameEntity> entity)
 	ImGui::Spacing();
 	ImGui::Text("Mesh: %s", entity->GetMesh()->GetName());
 	ImGui::Text("Material: %s", entity->GetMaterial()->GetName());
+	for (unsigned int i = 0; i < entity->GetMesh()->GetSubmeshCount(); i++)
+		if (entity->GetSubmeshMaterial(i) != entity->GetMaterial())
+			ImGui::Text("  %s: %s", entity->GetMesh()->GetSubmesh(i).Name, entity->GetSubmeshMaterial(i)->GetName());
+	ImGui::Text("LOD: %u (of %u)", entity->GetLOD(), entity->GetMesh()->GetLODCount());
 	ImGui::Spacing();
 
 	// Transform details
@@ -9,6 +9,7 @@
 #include "GameEntity.h"
 #include "Material.h"
 #include "Lights.h"
+#include "LODSelector.h"
 
 // Informing IMGUI about the new frame
 void UINewFrame(float deltaTime);
@@ -21,13 +22,16 @@ void BuildUI(
 	std::vector<std::shared_ptr<Material>>& materials,
 	std::vector<Light>& lights,
 	DemoLightingOptions& lightOptions,
+	LODSelector& lodSelector,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneColors,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneNormal,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneDepth,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ambient,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ssaoResult,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blurSSAO,
-	int* ssaoSamples, float* ssaoRadius, bool* ssaoOn, bool* ssaoOnly);
+	int* ssaoSamples, float* ssaoRadius, bool* ssaoOn, bool* ssaoOnly, bool* depthPrepass,
+	bool* staticBatching, int drawCount,
+	std::shared_ptr<GameEntity> pickedEntity, float pickedDistance);
 
 // Helpers for individual scene elements
 void UIMesh(std::shared_ptr<Mesh> mesh);
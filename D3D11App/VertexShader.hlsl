@@ -8,20 +8,31 @@ cbuffer ExternalData : register(b0)
 	matrix worldInvTrans;
 	matrix view;
 	matrix projection;
+#ifdef PACKED_VERTICES
+	float4 positionOffset;
+	float4 positionScale;
+	float4 uvOffsetScale;
+#endif
 }
 
 
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // --------------------------------------------------------
+#ifdef PACKED_VERTICES
+VertexToPixel main(PackedVertexShaderInput packedInput)
+{
+	VertexShaderInput input = UnpackVertex(packedInput, positionOffset, positionScale, uvOffsetScale);
+#else
 VertexToPixel main(VertexShaderInput input)
 {
+#endif
+
 	// Set up output struct
 	VertexToPixel output;
 
 	// Calculate screen position of this vertex
-	matrix wvp = mul(projection, mul(view, world));
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	output.screenPosition = LocalToScreen(input.localPosition, world, view, projection);
 
 	// Pass other data through (for now)
 	output.uv = input.uv;
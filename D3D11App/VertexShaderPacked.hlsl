@@ -0,0 +1,3 @@
+// Same as VertexShader.hlsl, but for meshes with packed vertices
+#define PACKED_VERTICES
+#include "VertexShader.hlsl"
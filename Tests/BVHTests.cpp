@@ -0,0 +1,224 @@
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "ObjLoader.h"
+#include "MeshBVH.h"
+#include "SceneBVH.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// A mesh with its BVH over every triangle
+	struct TestMesh
+	{
+		MeshData Data;
+		MeshBVH BVH;
+	};
+
+	std::shared_ptr<TestMesh> LoadTestMesh(const std::wstring& file)
+	{
+		std::shared_ptr<TestMesh> mesh = std::make_shared<TestMesh>();
+		mesh->Data = LoadOBJ(TestMeshPath(file));
+		mesh->BVH.Build(mesh->Data.Vertices.data(), mesh->Data.Vertices.size(), mesh->Data.Indices.data(), mesh->Data.Indices.size());
+		return mesh;
+	}
+
+	bool SameDistance(float a, float b)
+	{
+		return fabsf(a - b) <= 1e-4f * std::max(1.0f, fabsf(b));
+	}
+
+	// --------------------------------------------------------
+	// Rays from a sphere around every bundled mesh, to random
+	// points in its box, hit exactly what testing every triangle
+	// hits, and short rays from inside agree on line of sight too
+	// --------------------------------------------------------
+	void TestMeshRaycasts()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MeshData mesh = LoadOBJ(file);
+			MeshBVH bvh;
+			bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+
+			const Bounds& bounds = bvh.GetBounds();
+			std::mt19937 random(12345);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			unsigned int mismatches = 0;
+			unsigned int hitCount = 0;
+			for (int i = 0; i < 2000; i++)
+			{
+				float y = unit(random) * 2.0f - 1.0f;
+				float angle = unit(random) * XM_2PI;
+				float ring = sqrtf(1.0f - y * y);
+				XMVECTOR origin = XMVectorAdd(XMLoadFloat3(&bounds.Center),
+					XMVectorScale(XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0), std::max(bounds.Radius, 0.001f) * 2.0f));
+				XMVECTOR target = XMVectorSet(
+					bounds.Min.x + (bounds.Max.x - bounds.Min.x) * unit(random),
+					bounds.Min.y + (bounds.Max.y - bounds.Min.y) * unit(random),
+					bounds.Min.z + (bounds.Max.z - bounds.Min.z) * unit(random), 0);
+
+				Ray ray;
+				XMStoreFloat3(&ray.Origin, origin);
+				XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSubtract(target, origin)));
+				ray.MaxDistance = FLT_MAX;
+
+				RayHit hit;
+				RayHit bruteHit;
+				bool found = bvh.Raycast(ray, hit);
+				bool bruteFound = RaycastTriangles(mesh.Vertices.data(), mesh.Indices.data(), mesh.Indices.size(), ray, bruteHit);
+				if (found != bruteFound || (found && !SameDistance(hit.Distance, bruteHit.Distance)))
+					mismatches++;
+				hitCount += bruteFound ? 1 : 0;
+			}
+
+			if (mismatches != 0)
+				std::printf("%ls: %u of 2000 rays disagree with brute force\n", file.c_str(), mismatches);
+			CHECK(mismatches == 0);
+			CHECK(hitCount > 0);
+		}
+
+		std::shared_ptr<TestMesh> container = LoadTestMesh(L"container.obj");
+		const Bounds& bounds = container->BVH.GetBounds();
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (int i = 0; i < 2000; i++)
+		{
+			// Short rays from inside the box, so some stop before a hit
+			Ray ray;
+			ray.Origin = XMFLOAT3(
+				bounds.Center.x + unit(random) * (bounds.Max.x - bounds.Min.x) * 0.5f,
+				bounds.Center.y + unit(random) * (bounds.Max.y - bounds.Min.y) * 0.5f,
+				bounds.Center.z + unit(random) * (bounds.Max.z - bounds.Min.z) * 0.5f);
+			XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0)));
+			ray.MaxDistance = bounds.Radius * (unit(random) + 1.0f) * 0.5f;
+
+			RayHit hit;
+			RayHit bruteHit;
+			bool found = container->BVH.Raycast(ray, hit);
+			bool bruteFound = RaycastTriangles(container->Data.Vertices.data(), container->Data.Indices.data(), container->Data.Indices.size(), ray, bruteHit);
+			CHECK(found == bruteFound);
+			CHECK(container->BVH.IsOccluded(ray) == bruteFound);
+			if (found && bruteFound)
+				CHECK(SameDistance(hit.Distance, bruteHit.Distance));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Closest hit in a scene by casting into every instance
+	// --------------------------------------------------------
+	bool RaycastInstances(const std::vector<SceneBVHInstance>& instances, const Ray& ray, SceneRayHit& hit)
+	{
+		bool found = false;
+		hit.Hit.Distance = ray.MaxDistance;
+		for (unsigned int i = 0; i < instances.size(); i++)
+		{
+			XMMATRIX inverseWorld = XMMatrixInverse(0, XMLoadFloat4x4(&instances[i].World));
+			Ray objectRay = ray;
+			objectRay.MaxDistance = hit.Hit.Distance;
+			XMStoreFloat3(&objectRay.Origin, XMVector3TransformCoord(XMLoadFloat3(&ray.Origin), inverseWorld));
+			XMStoreFloat3(&objectRay.Direction, XMVector3TransformNormal(XMLoadFloat3(&ray.Direction), inverseWorld));
+
+			RayHit instanceHit;
+			if (instances[i].BVH->Raycast(objectRay, instanceHit) && instanceHit.Distance < hit.Hit.Distance)
+			{
+				hit.Instance = i;
+				hit.Hit = instanceHit;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	XMFLOAT4X4 RandomWorld(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		XMMATRIX world =
+			XMMatrixScalingFromVector(XMVectorReplicate(0.25f + unit(random))) *
+			XMMatrixRotationRollPitchYaw(unit(random) * XM_2PI, unit(random) * XM_2PI, unit(random) * XM_2PI) *
+			XMMatrixTranslationFromVector(XMVectorSet(unit(random) * 40 - 20, unit(random) * 10 - 5, unit(random) * 40 - 20, 0));
+
+		XMFLOAT4X4 stored;
+		XMStoreFloat4x4(&stored, world);
+		return stored;
+	}
+
+	// --------------------------------------------------------
+	// Moving instances and refitting gives the same answers as
+	// building the scene again from scratch, and as casting
+	// into every instance, even after many rounds of moves
+	// --------------------------------------------------------
+	void TestSceneRefit()
+	{
+		std::vector<std::shared_ptr<TestMesh>> meshes =
+		{
+			LoadTestMesh(L"container.obj"),
+			LoadTestMesh(L"sphere.obj"),
+			LoadTestMesh(L"torus.obj"),
+			LoadTestMesh(L"cube.obj"),
+		};
+
+		std::mt19937 random(18);
+		std::vector<SceneBVHInstance> instances(120);
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			instances[i].BVH = &meshes[i % meshes.size()]->BVH;
+			instances[i].World = RandomWorld(random);
+		}
+
+		SceneBVH refitted;
+		refitted.Build(instances.data(), instances.size());
+
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (int round = 0; round < 8; round++)
+		{
+			// Move a different handful (more each round), far enough
+			// that boxes both grow and shrink
+			for (int move = 0; move < 5 + round * 5; move++)
+			{
+				unsigned int instance = random() % instances.size();
+				instances[instance].World = RandomWorld(random);
+				refitted.MoveInstance(instance, instances[instance].World);
+			}
+			refitted.Refit();
+
+			SceneBVH rebuilt;
+			rebuilt.Build(instances.data(), instances.size());
+
+			for (int i = 0; i < 500; i++)
+			{
+				Ray ray;
+				ray.Origin = XMFLOAT3(unit(random) * 30, unit(random) * 30, unit(random) * 30);
+				XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSet(unit(random), unit(random) * 0.3f, unit(random), 0)));
+				ray.MaxDistance = i % 4 == 0 ? 10.0f : FLT_MAX;
+
+				SceneRayHit refitHit, rebuiltHit, bruteHit;
+				bool refitFound = refitted.Raycast(ray, refitHit);
+				bool rebuiltFound = rebuilt.Raycast(ray, rebuiltHit);
+				bool bruteFound = RaycastInstances(instances, ray, bruteHit);
+
+				CHECK(refitFound == bruteFound);
+				CHECK(rebuiltFound == bruteFound);
+				CHECK(refitted.IsOccluded(ray) == bruteFound);
+				if (refitFound && rebuiltFound && bruteFound)
+				{
+					CHECK(refitHit.Instance == rebuiltHit.Instance);
+					CHECK(refitHit.Hit.Triangle == rebuiltHit.Hit.Triangle);
+					CHECK(SameDistance(refitHit.Hit.Distance, bruteHit.Hit.Distance));
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestMeshRaycasts();
+	TestSceneRefit();
+	return TestResult();
+}
@@ -0,0 +1,28 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "TestHelpers.h"
+#include "Benchmarks.h"
+
+// --------------------------------------------------------
+// Runs every benchmark and prints its results: the
+// transform & animation ones first, then the mesh ones on
+// each bundled mesh.  Not a test (nothing here fails), so
+// it isn't registered with ctest.  The number of iterations
+// can be given on the command line.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+	if (iterations < 1)
+		iterations = 1;
+
+	RunTransformBenchmarks(iterations);
+	for (const std::wstring& file : TestMeshFiles())
+		RunMeshBenchmarks(file, iterations);
+
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::temp_directory_path() / "Benchmarks", error);
+	return 0;
+}
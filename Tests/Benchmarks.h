@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// --------------------------------------------------------
+// Timings of the engine's CPU-side code, for the Benchmarks
+// runner.  Each benchmark prints one line of results, and
+// checks what it can (checksums, errors against a slower
+// reference) so a broken fast path shows up as a number.
+// --------------------------------------------------------
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+inline double MillisecondsSince(BenchmarkClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+// Transforms, their batch kernels and animation (TransformBenchmarks.cpp)
+void RunTransformBenchmarks(int iterations);
+
+// Loading, meshlets, tangents, raycasts and compression of one
+// mesh (MeshBenchmarks.cpp)
+void RunMeshBenchmarks(const std::wstring& objFile, int iterations);
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "MappedFile.h"
+#include "MeshBVH.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshletBuilder.h"
+#include "ObjLoader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Indices of the full detail LOD (which is what most of the
+	// mesh code works on)
+	size_t GetFullDetailIndexCount(const MeshData& mesh)
+	{
+		return mesh.LODs.empty() ? mesh.Indices.size() : mesh.LODs[0].IndexCount;
+	}
+
+	// --------------------------------------------------------
+	// Times both loading paths for a copy of an .obj (outside
+	// the assets, since converting writes a .meshbin next to
+	// it).  The .obj path includes parsing, optimization and
+	// tangent generation; the cache path includes validating
+	// against the source (and decoding, if compressed) and
+	// copying the arrays (standing in for the upload to the GPU).
+	// --------------------------------------------------------
+	void BenchmarkMeshLoad(const std::wstring& objFile, int iterations)
+	{
+		std::filesystem::path folder = std::filesystem::temp_directory_path() / "Benchmarks";
+		std::filesystem::create_directories(folder);
+		std::filesystem::path copy = folder / std::filesystem::path(objFile).filename();
+		std::filesystem::copy_file(objFile, copy, std::filesystem::copy_options::overwrite_existing);
+		if (!ConvertOBJToMeshCache(copy.wstring()))
+		{
+			std::printf("  Load: conversion failed\n");
+			return;
+		}
+		std::wstring cachePath = GetMeshCachePath(copy.wstring());
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			MappedFile source(copy.wstring());
+			HashBytes(source.GetData(), source.GetSize());
+			MeshOptimizationStats stats;
+			BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+		}
+		double objMilliseconds = MillisecondsSince(start) / iterations;
+
+		start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			MappedFile source(copy.wstring());
+			MeshCacheFile cache(cachePath);
+			if (!cache.IsValid(source.GetSize(), HashBytes(source.GetData(), source.GetSize())))
+				continue;
+
+			const MeshCacheHeader* header = cache.GetHeader();
+			std::vector<Vertex> verts(cache.GetVertices(), cache.GetVertices() + header->VertexCount);
+			std::vector<unsigned int> indices(cache.GetIndices(), cache.GetIndices() + header->IndexCount);
+		}
+		double cacheMilliseconds = MillisecondsSince(start) / iterations;
+
+		// What the file would be with plain arrays (each padded to 4 bytes)
+		MappedFile cacheFile(cachePath);
+		size_t uncompressedBytes = 0;
+		if (cacheFile.GetSize() >= sizeof(MeshCacheHeader))
+		{
+			const MeshCacheHeader* header = (const MeshCacheHeader*)cacheFile.GetData();
+			uncompressedBytes = cacheFile.GetSize() - ((header->VertexBytes + 3) & ~3u) - ((header->IndexBytes + 3) & ~3u) +
+				sizeof(Vertex) * (size_t)header->VertexCount + sizeof(unsigned int) * (size_t)header->IndexCount;
+		}
+
+		std::printf("  Load: OBJ %.3f ms, cache %.3f ms (%zu bytes, %zu uncompressed)\n",
+			objMilliseconds, cacheMilliseconds, cacheFile.GetSize(), uncompressedBytes);
+	}
+
+	// --------------------------------------------------------
+	// Times building meshlets for the full detail LOD of the
+	// mesh (regardless of its size), then culling them from
+	// views spread evenly around the mesh, looking at its center
+	// --------------------------------------------------------
+	void BenchmarkMeshlets(const MeshData& mesh, int iterations)
+	{
+		const int viewCount = 32;
+		size_t count = GetFullDetailIndexCount(mesh);
+		std::vector<unsigned int> indices(count);
+		std::vector<Meshlet> meshlets;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			std::copy(mesh.Indices.begin(), mesh.Indices.begin() + count, indices.begin());
+			BuildMeshlets(mesh.Vertices.data(), mesh.Vertices.size(), indices.data(), count, meshlets);
+		}
+		double buildMilliseconds = MillisecondsSince(start) / iterations;
+
+		// Views from a sphere around the mesh, close enough that
+		// some of it is outside the frustum
+		XMVECTOR boundsMin = XMLoadFloat3(&mesh.Vertices[0].Position);
+		XMVECTOR boundsMax = boundsMin;
+		for (const Vertex& v : mesh.Vertices)
+		{
+			boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&v.Position));
+			boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&v.Position));
+		}
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+		float radius = std::max(0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin))), 0.001f);
+
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, radius * 0.01f, radius * 10.0f));
+
+		std::vector<MeshletCullContext> contexts(viewCount);
+		for (int i = 0; i < viewCount; i++)
+		{
+			// Fibonacci sphere
+			float y = 1.0f - 2.0f * (i + 0.5f) / viewCount;
+			float ring = sqrtf(1.0f - y * y);
+			float angle = i * XM_PI * (3.0f - sqrtf(5.0f));
+			XMVECTOR direction = XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0.0f);
+			XMVECTOR up = fabsf(y) < 0.99f ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0);
+
+			XMFLOAT4X4 view;
+			XMStoreFloat4x4(&view, XMMatrixLookAtLH(XMVectorAdd(center, XMVectorScale(direction, radius * 1.5f)), center, up));
+			contexts[i] = CreateMeshletCullContext(world, view, projection, true);
+		}
+
+		std::vector<unsigned int> visible(meshlets.size());
+		size_t visibleTotal = 0;
+		start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+			for (const MeshletCullContext& context : contexts)
+				visibleTotal += CullMeshlets(meshlets.data(), meshlets.size(), context, visible.data());
+		double cullMilliseconds = MillisecondsSince(start) / ((double)iterations * viewCount);
+
+		float culledFraction = meshlets.empty() ? 0.0f : 1.0f - (float)visibleTotal / ((float)meshlets.size() * viewCount * iterations);
+		std::printf("  Meshlets: %zu built in %.3f ms, culled in %.3f ms (%.1f%% culled)\n",
+			meshlets.size(), buildMilliseconds, cullMilliseconds, culledFraction * 100.0f);
+	}
+
+	// --------------------------------------------------------
+	// Times the reference, serial and parallel tangent
+	// calculations on copies of the mesh's vertices, and how
+	// far (in degrees) the fast ones stray from the reference
+	// --------------------------------------------------------
+	void BenchmarkTangents(const MeshData& mesh, int iterations)
+	{
+		size_t numIndices = GetFullDetailIndexCount(mesh);
+		std::vector<Vertex> reference = mesh.Vertices;
+		std::vector<Vertex> fast = mesh.Vertices;
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+			CalculateTangentsReference(reference.data(), reference.size(), mesh.Indices.data(), numIndices);
+		double referenceMilliseconds = MillisecondsSince(start) / iterations;
+
+		start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+			CalculateTangentsSerial(fast.data(), fast.size(), mesh.Indices.data(), numIndices);
+		double serialMilliseconds = MillisecondsSince(start) / iterations;
+
+		start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+			CalculateTangentsParallel(fast.data(), fast.size(), mesh.Indices.data(), numIndices, ThreadPool::Shared());
+		double parallelMilliseconds = MillisecondsSince(start) / iterations;
+
+		float maxDegrees = 0.0f;
+		for (size_t i = 0; i < fast.size(); i++)
+		{
+			// (atan2 stays accurate for tiny angles, unlike acos)
+			XMVECTOR a = XMLoadFloat3(&reference[i].Tangent);
+			XMVECTOR b = XMLoadFloat3(&fast[i].Tangent);
+			float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+			float cosine = XMVectorGetX(XMVector3Dot(a, b));
+			float degrees = XMConvertToDegrees(atan2f(sine, cosine));
+			if (degrees == degrees) // Skip NaN tangents from the reference
+				maxDegrees = std::max(maxDegrees, degrees);
+		}
+
+		std::printf("  Tangents: reference %.3f ms, serial %.3f ms, parallel %.3f ms, max difference %g degrees\n",
+			referenceMilliseconds, serialMilliseconds, parallelMilliseconds, maxDegrees);
+	}
+
+	// --------------------------------------------------------
+	// Times building a BVH over the full detail LOD, then rays
+	// from a sphere around the mesh to random points in its
+	// box, through the BVH and by brute force.  Rays the two
+	// disagree on (whether they hit, or how far) are counted.
+	// --------------------------------------------------------
+	void BenchmarkRaycasts(const MeshData& mesh, int rayCount)
+	{
+		size_t first = mesh.LODs.empty() ? 0 : mesh.LODs[0].FirstIndex;
+		size_t count = GetFullDetailIndexCount(mesh);
+
+		MeshBVH bvh;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), &mesh.Indices[first], count);
+		double buildMilliseconds = MillisecondsSince(start);
+
+		const Bounds& bounds = bvh.GetBounds();
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Ray> rays(rayCount);
+		for (Ray& ray : rays)
+		{
+			// Uniform point on a sphere, aimed at a point in the box
+			float y = unit(random) * 2.0f - 1.0f;
+			float angle = unit(random) * XM_2PI;
+			float ring = sqrtf(1.0f - y * y);
+			XMVECTOR origin = XMVectorAdd(XMLoadFloat3(&bounds.Center),
+				XMVectorScale(XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0), std::max(bounds.Radius, 0.001f) * 2.0f));
+			XMVECTOR target = XMVectorSet(
+				bounds.Min.x + (bounds.Max.x - bounds.Min.x) * unit(random),
+				bounds.Min.y + (bounds.Max.y - bounds.Min.y) * unit(random),
+				bounds.Min.z + (bounds.Max.z - bounds.Min.z) * unit(random), 0);
+
+			XMStoreFloat3(&ray.Origin, origin);
+			XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSubtract(target, origin)));
+			ray.MaxDistance = FLT_MAX;
+		}
+
+		std::vector<RayHit> hits(rayCount);
+		std::vector<bool> hitSomething(rayCount);
+		start = BenchmarkClock::now();
+		for (int i = 0; i < rayCount; i++)
+			hitSomething[i] = bvh.Raycast(rays[i], hits[i]);
+		double bvhMilliseconds = MillisecondsSince(start);
+
+		unsigned int hitCount = 0;
+		unsigned int mismatches = 0;
+		start = BenchmarkClock::now();
+		for (int i = 0; i < rayCount; i++)
+		{
+			RayHit bruteHit;
+			bool bruteFound = RaycastTriangles(mesh.Vertices.data(), &mesh.Indices[first], count, rays[i], bruteHit);
+			if (bruteFound != hitSomething[i] ||
+				(bruteFound && fabsf(bruteHit.Distance - hits[i].Distance) > 1e-4f * std::max(1.0f, bruteHit.Distance)))
+				mismatches++;
+			hitCount += bruteFound ? 1 : 0;
+		}
+		double bruteMilliseconds = MillisecondsSince(start);
+
+		std::printf("  Raycasts: %u nodes built in %.3f ms, %.0f rays/s (brute force %.0f), %.1f%% hit, %u mismatch(es)\n",
+			bvh.GetNodeCount(), buildMilliseconds, rayCount * 1000.0 / bvhMilliseconds, rayCount * 1000.0 / bruteMilliseconds,
+			100.0f * hitCount / rayCount, mismatches);
+	}
+
+	// --------------------------------------------------------
+	// Times encoding once, then decoding the given number of
+	// times.  Decode speed is measured in output bytes, which
+	// is what has to beat reading the raw arrays from disk.
+	// --------------------------------------------------------
+	void BenchmarkMeshCodec(const MeshData& mesh, int iterations)
+	{
+		size_t vertexBytes = mesh.Vertices.size() * sizeof(Vertex);
+		size_t indexBytes = mesh.Indices.size() * sizeof(unsigned int);
+
+		std::vector<unsigned char> encodedVertices;
+		std::vector<unsigned char> encodedIndices;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		EncodeVertexBuffer(mesh.Vertices.data(), mesh.Vertices.size(), sizeof(Vertex), encodedVertices);
+		EncodeIndexBuffer(mesh.Indices.data(), mesh.Indices.size(), encodedIndices);
+		double encodeMilliseconds = MillisecondsSince(start);
+
+		std::vector<Vertex> vertices(mesh.Vertices.size());
+		std::vector<unsigned int> indices(mesh.Indices.size());
+		bool decoded = true;
+		start = BenchmarkClock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			decoded &= DecodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			decoded &= DecodeIndexBuffer(encodedIndices.data(), encodedIndices.size(), indices.data(), indices.size());
+		}
+		double decodeMilliseconds = MillisecondsSince(start) / iterations;
+
+		bool exact = decoded &&
+			memcmp(vertices.data(), mesh.Vertices.data(), vertexBytes) == 0 &&
+			memcmp(indices.data(), mesh.Indices.data(), indexBytes) == 0;
+		std::printf("  Codec: %zu -> %zu bytes, encode %.3f ms, decode %.3f ms (%.2f GB/s), %s\n",
+			vertexBytes + indexBytes, encodedVertices.size() + encodedIndices.size(), encodeMilliseconds, decodeMilliseconds,
+			decodeMilliseconds > 0.0 ? (vertexBytes + indexBytes) / decodeMilliseconds / 1e6 : 0.0, exact ? "exact" : "NOT exact");
+	}
+}
+
+void RunMeshBenchmarks(const std::wstring& objFile, int iterations)
+{
+	std::printf("%s\n", std::filesystem::path(objFile).filename().string().c_str());
+	BenchmarkMeshLoad(objFile, iterations);
+
+	MeshData mesh = LoadOBJ(objFile);
+	if (GetFullDetailIndexCount(mesh) < 3 || mesh.Vertices.empty())
+		return;
+
+	BenchmarkMeshlets(mesh, iterations);
+	BenchmarkTangents(mesh, iterations);
+	BenchmarkRaycasts(mesh, 10000);
+	BenchmarkMeshCodec(mesh, iterations);
+}
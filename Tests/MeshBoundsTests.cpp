@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MeshBounds.h"
+#include "ObjLoader.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Is a point inside a sphere, allowing for float rounding?
+	bool SphereContains(FXMVECTOR center, float radius, FXMVECTOR p)
+	{
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, center)));
+		return distance <= radius * 1.00001f + 1e-5f;
+	}
+
+	bool Near(const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+	}
+
+	// --------------------------------------------------------
+	// Every bundled mesh: the box is exactly the smallest one
+	// around the vertices, and the sphere contains them all
+	// (as does Ritter's sphere of any subset, on its own)
+	// --------------------------------------------------------
+	void TestContainment()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MeshData mesh = LoadOBJ(file);
+			Bounds bounds = ComputeBounds(mesh.Vertices.data(), mesh.Vertices.size());
+
+			XMVECTOR minPos = XMLoadFloat3(&mesh.Vertices[0].Position);
+			XMVECTOR maxPos = minPos;
+			XMVECTOR center = XMLoadFloat3(&bounds.Center);
+			unsigned int outside = 0;
+			for (const Vertex& v : mesh.Vertices)
+			{
+				XMVECTOR p = XMLoadFloat3(&v.Position);
+				minPos = XMVectorMin(minPos, p);
+				maxPos = XMVectorMax(maxPos, p);
+				if (!SphereContains(center, bounds.Radius, p))
+					outside++;
+			}
+
+			XMFLOAT3 expectedMin;
+			XMFLOAT3 expectedMax;
+			XMStoreFloat3(&expectedMin, minPos);
+			XMStoreFloat3(&expectedMax, maxPos);
+			CHECK(Near(bounds.Min, expectedMin, 0.0f));
+			CHECK(Near(bounds.Max, expectedMax, 0.0f));
+			CHECK(outside == 0);
+
+			// No bigger than the sphere around the box
+			float boxRadius = XMVectorGetX(XMVector3Length(XMVectorSubtract(maxPos, minPos))) * 0.5f;
+			CHECK(bounds.Radius <= boxRadius * 1.00001f + 1e-5f);
+
+			// Every third vertex, by index
+			std::vector<unsigned int> subset;
+			for (unsigned int i = 0; i < mesh.Vertices.size(); i += 3)
+				subset.push_back(i);
+			XMFLOAT3 subsetCenter;
+			float subsetRadius;
+			ComputeBoundingSphere(mesh.Vertices.data(), subset.data(), subset.size(), subsetCenter, subsetRadius);
+			unsigned int subsetOutside = 0;
+			for (unsigned int i : subset)
+				if (!SphereContains(XMLoadFloat3(&subsetCenter), subsetRadius, XMLoadFloat3(&mesh.Vertices[i].Position)))
+					subsetOutside++;
+			CHECK(subsetOutside == 0);
+
+			std::printf("%ls: radius %g (box %g)\n", file.c_str(), bounds.Radius, boxRadius);
+		}
+
+		// Nothing to bound
+		Bounds empty = ComputeBounds(0, 0);
+		CHECK(empty.Radius == 0.0f && Near(empty.Min, XMFLOAT3(0, 0, 0), 0.0f) && Near(empty.Max, XMFLOAT3(0, 0, 0), 0.0f));
+	}
+
+	// --------------------------------------------------------
+	// Random rotations & non-uniform scales (some mirrored) of
+	// each bundled mesh's bounds: the box matches the box
+	// around the eight transformed corners, worked out one by
+	// one, and the sphere still contains every transformed
+	// vertex.  The Transform overload gives the same result
+	// (once its world matrix has been resolved).
+	// --------------------------------------------------------
+	void TestTransformBounds()
+	{
+		std::mt19937 random(12);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MeshData mesh = LoadOBJ(file);
+			Bounds bounds = ComputeBounds(mesh.Vertices.data(), mesh.Vertices.size());
+
+			for (int i = 0; i < 16; i++)
+			{
+				XMFLOAT3 scale(1.0f + unit(random) * 0.9f, 1.0f + unit(random) * 0.9f, 1.0f + unit(random) * 0.9f);
+				if (i % 4 == 3)
+					scale.y = -scale.y;
+				XMFLOAT3 rotation(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI);
+				XMFLOAT3 position(unit(random) * 20.0f, unit(random) * 20.0f, unit(random) * 20.0f);
+
+				XMMATRIX worldMatrix =
+					XMMatrixScaling(scale.x, scale.y, scale.z) *
+					XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) *
+					XMMatrixTranslation(position.x, position.y, position.z);
+				XMFLOAT4X4 world;
+				XMStoreFloat4x4(&world, worldMatrix);
+				Bounds transformed = TransformBounds(bounds, world);
+
+				XMVECTOR minCorner = XMVectorReplicate(FLT_MAX);
+				XMVECTOR maxCorner = XMVectorReplicate(-FLT_MAX);
+				for (int corner = 0; corner < 8; corner++)
+				{
+					XMVECTOR p = XMVectorSet(
+						corner & 1 ? bounds.Max.x : bounds.Min.x,
+						corner & 2 ? bounds.Max.y : bounds.Min.y,
+						corner & 4 ? bounds.Max.z : bounds.Min.z, 1.0f);
+					p = XMVector3Transform(p, worldMatrix);
+					minCorner = XMVectorMin(minCorner, p);
+					maxCorner = XMVectorMax(maxCorner, p);
+				}
+
+				XMFLOAT3 expectedMin;
+				XMFLOAT3 expectedMax;
+				XMStoreFloat3(&expectedMin, minCorner);
+				XMStoreFloat3(&expectedMax, maxCorner);
+				float tolerance = 1e-4f * (1.0f + XMVectorGetX(XMVector3Length(XMVectorSubtract(maxCorner, minCorner))) + 20.0f);
+				CHECK(Near(transformed.Min, expectedMin, tolerance));
+				CHECK(Near(transformed.Max, expectedMax, tolerance));
+
+				unsigned int outside = 0;
+				XMVECTOR center = XMLoadFloat3(&transformed.Center);
+				for (const Vertex& v : mesh.Vertices)
+				{
+					XMVECTOR p = XMVector3Transform(XMLoadFloat3(&v.Position), worldMatrix);
+					if (!SphereContains(center, transformed.Radius, p))
+						outside++;
+				}
+				CHECK(outside == 0);
+
+				std::shared_ptr<Transform> transform = std::make_shared<Transform>();
+				transform->SetScale(scale);
+				transform->SetRotation(rotation);
+				transform->SetPosition(position);
+				TransformSystem::Shared().UpdateWorldMatrices();
+				Bounds fromTransform = TransformBounds(bounds, transform);
+				CHECK(Near(fromTransform.Min, transformed.Min, tolerance));
+				CHECK(Near(fromTransform.Max, transformed.Max, tolerance));
+				CHECK(Near(fromTransform.Center, transformed.Center, tolerance));
+				CHECK(fabsf(fromTransform.Radius - transformed.Radius) <= tolerance);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestContainment();
+	TestTransformBounds();
+	return TestResult();
+}
@@ -0,0 +1,263 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MeshCache.h"
+#include "MeshBVH.h"
+
+namespace
+{
+	// Where the tests' source & cache files go (not next to the assets)
+	std::filesystem::path GetTestFolder()
+	{
+		std::filesystem::path folder = std::filesystem::temp_directory_path() / "MeshCacheTests";
+		std::filesystem::create_directories(folder);
+		return folder;
+	}
+
+	std::vector<char> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	void WriteFile(const std::filesystem::path& path, const std::vector<char>& bytes)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size());
+	}
+
+	// --------------------------------------------------------
+	// A cache file that's been through IsValid(), and the size
+	// & hash of the source it's checked against
+	// --------------------------------------------------------
+	struct TestSource
+	{
+		std::filesystem::path ObjFile;
+		unsigned long long Size;
+		unsigned long long Hash;
+	};
+
+	TestSource CopySource(const std::wstring& meshFile)
+	{
+		TestSource source;
+		source.ObjFile = GetTestFolder() / std::filesystem::path(meshFile).filename();
+		std::filesystem::copy_file(meshFile, source.ObjFile, std::filesystem::copy_options::overwrite_existing);
+
+		std::vector<char> bytes = ReadFile(source.ObjFile);
+		source.Size = bytes.size();
+		source.Hash = HashBytes(bytes.data(), bytes.size());
+		return source;
+	}
+
+	// --------------------------------------------------------
+	// Everything a cache is checked for when it's written:
+	// IsValid() on load, plus the per-element checks it only
+	// makes in debug builds
+	// --------------------------------------------------------
+	bool IsFullyValid(MeshCacheFile& cache, const TestSource& source)
+	{
+		return cache.IsValid(source.Size, source.Hash) && cache.HasValidContents();
+	}
+
+	// --------------------------------------------------------
+	// If a cache passes IsFullyValid(), everything in it can be used
+	// as-is: indices name real vertices, and meshlets & submeshes
+	// stay inside their LODs (so a BVH can be built over them)
+	// --------------------------------------------------------
+	bool IsSafeToUse(MeshCacheFile& cache)
+	{
+		const MeshCacheHeader* header = cache.GetHeader();
+		const unsigned int* indices = cache.GetIndices();
+		for (unsigned int i = 0; i < header->IndexCount; i++)
+			if (indices[i] >= header->VertexCount)
+				return false;
+
+		const MeshLOD& fullDetail = header->LODs[0];
+		for (unsigned int m = 0; m < header->MeshletCount; m++)
+		{
+			const Meshlet& meshlet = cache.GetMeshlets()[m];
+			if (meshlet.FirstIndex < fullDetail.FirstIndex ||
+				meshlet.FirstIndex + meshlet.TriangleCount * 3ull > fullDetail.FirstIndex + (unsigned long long)fullDetail.IndexCount)
+				return false;
+		}
+
+		try
+		{
+			MeshBVH bvh;
+			bvh.Build(cache.GetVertices(), header->VertexCount, indices + fullDetail.FirstIndex, fullDetail.IndexCount);
+		}
+		catch (...)
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Rewrites a (valid) cache file with plain vertices and
+	// indices, the way it's stored when compression is off
+	// --------------------------------------------------------
+	std::vector<char> CreateUncompressedCopy(MeshCacheFile& cache)
+	{
+		MeshCacheHeader header = *cache.GetHeader();
+		header.Compressed = 0;
+		header.VertexBytes = (unsigned int)(sizeof(Vertex) * header.VertexCount);
+		header.IndexBytes = (unsigned int)(sizeof(unsigned int) * header.IndexCount);
+
+		std::vector<char> bytes((const char*)&header, (const char*)(&header + 1));
+		bytes.insert(bytes.end(), (const char*)cache.GetVertices(), (const char*)(cache.GetVertices() + header.VertexCount));
+		bytes.insert(bytes.end(), (const char*)cache.GetIndices(), (const char*)(cache.GetIndices() + header.IndexCount));
+		bytes.insert(bytes.end(), (const char*)cache.GetMeshlets(), (const char*)(cache.GetMeshlets() + header.MeshletCount));
+		bytes.insert(bytes.end(), (const char*)cache.GetSubmeshes(), (const char*)(cache.GetSubmeshes() + header.SubmeshCount));
+		return bytes;
+	}
+
+	// --------------------------------------------------------
+	// A freshly written cache is valid, and holds exactly what
+	// parsing the .obj gives
+	// --------------------------------------------------------
+	void TestRoundTrip(const TestSource& source)
+	{
+		CHECK(ConvertOBJToMeshCache(source.ObjFile.wstring()));
+
+		MeshCacheFile cache(GetMeshCachePath(source.ObjFile.wstring()));
+		CHECK(cache.IsValid(source.Size, source.Hash));
+		CHECK(cache.HasValidContents());
+		CHECK(IsSafeToUse(cache));
+		CHECK(!cache.IsValid(source.Size + 1, source.Hash));
+
+		std::vector<char> text = ReadFile(source.ObjFile);
+		MeshOptimizationStats stats;
+		MeshData mesh = BuildMeshFromOBJ(text.data(), text.size(), stats);
+		const MeshCacheHeader* header = cache.GetHeader();
+		CHECK(header->VertexCount == mesh.Vertices.size());
+		CHECK(header->IndexCount == mesh.Indices.size());
+		CHECK(header->MeshletCount == mesh.Meshlets.size());
+		CHECK(memcmp(cache.GetVertices(), mesh.Vertices.data(), sizeof(Vertex) * mesh.Vertices.size()) == 0);
+		CHECK(memcmp(cache.GetIndices(), mesh.Indices.data(), sizeof(unsigned int) * mesh.Indices.size()) == 0);
+	}
+
+	// --------------------------------------------------------
+	// Caches with an index past the last vertex, or a meshlet
+	// past the end of LOD 0, are rejected (compressed or not):
+	// meshlets by IsValid(), and indices by the full checks
+	// --------------------------------------------------------
+	void TestOutOfRange(const TestSource& source)
+	{
+		std::vector<char> text = ReadFile(source.ObjFile);
+		MeshOptimizationStats stats;
+		MeshData mesh = BuildMeshFromOBJ(text.data(), text.size(), stats);
+		CHECK(!mesh.Meshlets.empty());
+		if (mesh.Meshlets.empty())
+			return;
+
+		std::wstring cachePath = (GetTestFolder() / "OutOfRange.meshbin").wstring();
+
+		MeshData badIndex = mesh;
+		badIndex.Indices[badIndex.Indices.size() / 2] = (unsigned int)badIndex.Vertices.size();
+		CHECK(WriteMeshCache(cachePath, badIndex, stats, source.Size, source.Hash));
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(!IsFullyValid(cache, source));
+		}
+
+		MeshData badMeshlet = mesh;
+		badMeshlet.Meshlets.back().TriangleCount += 1;
+		CHECK(WriteMeshCache(cachePath, badMeshlet, stats, source.Size, source.Hash));
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(!cache.IsValid(source.Size, source.Hash));
+		}
+
+		// The same, stored uncompressed
+		CHECK(WriteMeshCache(cachePath, mesh, stats, source.Size, source.Hash));
+		std::vector<char> uncompressed;
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(cache.IsValid(source.Size, source.Hash));
+			uncompressed = CreateUncompressedCopy(cache);
+		}
+		WriteFile(cachePath, uncompressed);
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(cache.IsValid(source.Size, source.Hash));
+		}
+
+		size_t indexOffset = sizeof(MeshCacheHeader) + sizeof(Vertex) * mesh.Vertices.size();
+		std::vector<char> bytes = uncompressed;
+		unsigned int pastEnd = (unsigned int)mesh.Vertices.size();
+		memcpy(&bytes[indexOffset + sizeof(unsigned int) * 7], &pastEnd, sizeof(pastEnd));
+		WriteFile(cachePath, bytes);
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(!IsFullyValid(cache, source));
+		}
+
+		size_t meshletOffset = indexOffset + sizeof(unsigned int) * mesh.Indices.size();
+		bytes = uncompressed;
+		unsigned int firstIndex = mesh.LODs[0].IndexCount;
+		memcpy(&bytes[meshletOffset + offsetof(Meshlet, FirstIndex)], &firstIndex, sizeof(firstIndex));
+		WriteFile(cachePath, bytes);
+		{
+			MeshCacheFile cache(cachePath);
+			CHECK(!cache.IsValid(source.Size, source.Hash));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Truncated files are rejected, and no damage to any byte
+	// of a file can get a cache that isn't safe to use past
+	// the full checks (most are rejected; some just change
+	// vertices)
+	// --------------------------------------------------------
+	void TestDamagedFiles(const TestSource& source)
+	{
+		std::wstring cachePath = GetMeshCachePath(source.ObjFile.wstring());
+		CHECK(ConvertOBJToMeshCache(source.ObjFile.wstring()));
+		std::vector<char> original = ReadFile(cachePath);
+		std::wstring damagedPath = (GetTestFolder() / "Damaged.meshbin").wstring();
+
+		for (size_t size : { (size_t)0, sizeof(MeshCacheHeader) - 1, sizeof(MeshCacheHeader), original.size() / 2, original.size() - 1 })
+		{
+			WriteFile(damagedPath, std::vector<char>(original.begin(), original.begin() + size));
+			MeshCacheFile cache(damagedPath);
+			CHECK(!cache.IsValid(source.Size, source.Hash));
+		}
+
+		std::mt19937 random(29);
+		int rejected = 0;
+		const int damageCount = 400;
+		for (int i = 0; i < damageCount; i++)
+		{
+			std::vector<char> bytes = original;
+			size_t offset = random() % bytes.size();
+			bytes[offset] ^= (char)(1 + random() % 255);
+			WriteFile(damagedPath, bytes);
+
+			MeshCacheFile cache(damagedPath);
+			if (IsFullyValid(cache, source))
+				CHECK(IsSafeToUse(cache));
+			else
+				rejected++;
+		}
+		CHECK(rejected > 0);
+		std::printf("Rejected %d of %d damaged caches\n", rejected, damageCount);
+	}
+}
+
+int main()
+{
+	TestSource source = CopySource(TestMeshPath(L"container.obj"));
+	TestRoundTrip(source);
+	TestOutOfRange(source);
+	TestDamagedFiles(source);
+
+	std::error_code error;
+	std::filesystem::remove_all(GetTestFolder(), error);
+	return TestResult();
+}
@@ -0,0 +1,165 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MeshCodec.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+namespace
+{
+	// Copies part of an encoding into a buffer of exactly that size,
+	// so reading past its end is caught by address sanitizers
+	std::vector<unsigned char> Prefix(const std::vector<unsigned char>& bytes, size_t size)
+	{
+		return std::vector<unsigned char>(bytes.begin(), bytes.begin() + size);
+	}
+
+	bool DecodeVertices(const std::vector<unsigned char>& encoded, std::vector<unsigned char>& out, size_t count, size_t stride)
+	{
+		out.assign(count * stride, 0);
+		return DecodeVertexBuffer(encoded.data(), encoded.size(), out.data(), count, stride);
+	}
+
+	bool DecodeIndices(const std::vector<unsigned char>& encoded, std::vector<unsigned int>& out, size_t count)
+	{
+		out.assign(count, 0);
+		return DecodeIndexBuffer(encoded.data(), encoded.size(), out.data(), count);
+	}
+
+	// --------------------------------------------------------
+	// Every bundled mesh, as it's stored in a cache (optimized,
+	// with LODs and meshlets), round trips exactly and takes up
+	// less space than the raw arrays
+	// --------------------------------------------------------
+	void TestBundledMeshes()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData mesh = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+
+			std::vector<unsigned char> encodedVertices;
+			EncodeVertexBuffer(mesh.Vertices.data(), mesh.Vertices.size(), sizeof(Vertex), encodedVertices);
+			std::vector<Vertex> vertices(mesh.Vertices.size());
+			CHECK(DecodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), vertices.data(), vertices.size(), sizeof(Vertex)));
+			CHECK(memcmp(vertices.data(), mesh.Vertices.data(), sizeof(Vertex) * vertices.size()) == 0);
+
+			std::vector<unsigned char> encodedIndices;
+			EncodeIndexBuffer(mesh.Indices.data(), mesh.Indices.size(), encodedIndices);
+			std::vector<unsigned int> indices;
+			CHECK(DecodeIndices(encodedIndices, indices, mesh.Indices.size()));
+			CHECK(indices == mesh.Indices);
+
+			if (mesh.Vertices.size() >= MESH_CODEC_BLOCK_VERTICES)
+				CHECK(encodedVertices.size() + encodedIndices.size() < sizeof(Vertex) * vertices.size() + sizeof(unsigned int) * indices.size());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Odd sizes and strides (partial groups and blocks), random
+	// bytes (the widest deltas), and indices that jump all over
+	// --------------------------------------------------------
+	void TestUnusualData()
+	{
+		std::mt19937 random(19);
+		for (size_t stride : { (size_t)1, (size_t)3, (size_t)12, sizeof(Vertex), (size_t)MESH_CODEC_MAX_STRIDE })
+		{
+			for (size_t count : { (size_t)0, (size_t)1, (size_t)15, (size_t)17, (size_t)255, (size_t)257, (size_t)1000 })
+			{
+				std::vector<unsigned char> vertices(count * stride);
+				for (size_t i = 0; i < vertices.size(); i++)
+					vertices[i] = i % 3 == 0 ? (unsigned char)random() : (unsigned char)(i / stride);
+
+				std::vector<unsigned char> encoded;
+				std::vector<unsigned char> decoded;
+				EncodeVertexBuffer(vertices.data(), count, stride, encoded);
+				CHECK(DecodeVertices(encoded, decoded, count, stride));
+				CHECK(decoded == vertices);
+			}
+		}
+
+		std::vector<unsigned int> indices = { 0, 0xFFFFFFFF, 0, 0x80000000, 0x7FFFFFFF, 1, 127, 128, 16383, 16384 };
+		for (int i = 0; i < 1000; i++)
+			indices.push_back(random() >> (random() % 32));
+
+		std::vector<unsigned char> encoded;
+		std::vector<unsigned int> decoded;
+		EncodeIndexBuffer(indices.data(), indices.size(), encoded);
+		CHECK(DecodeIndices(encoded, decoded, indices.size()));
+		CHECK(decoded == indices);
+	}
+
+	// --------------------------------------------------------
+	// Decoding never reads past the data it's given, and fails
+	// on anything cut short, with bytes left over, for the wrong
+	// count (vertices are padded to whole groups, so off by a
+	// group), or with a stride the codec doesn't take.  Damaged
+	// bytes either fail or decode into something (there's no
+	// checksum), but never go out of bounds.
+	// --------------------------------------------------------
+	void TestBadInput()
+	{
+		std::mt19937 random(20);
+		const size_t count = 700;
+		const size_t stride = sizeof(Vertex);
+		std::vector<unsigned char> vertices(count * stride);
+		for (size_t i = 0; i < vertices.size(); i++)
+			vertices[i] = (unsigned char)(random() % (i % 5 + 1));
+
+		std::vector<unsigned int> indices(count * 3);
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = (unsigned int)(i / 3 + random() % 40) * (i % 97 == 0 ? 100000 : 1);
+
+		std::vector<unsigned char> encodedVertices;
+		std::vector<unsigned char> encodedIndices;
+		EncodeVertexBuffer(vertices.data(), count, stride, encodedVertices);
+		EncodeIndexBuffer(indices.data(), indices.size(), encodedIndices);
+
+		std::vector<unsigned char> decodedVertices;
+		std::vector<unsigned int> decodedIndices;
+		for (size_t size = 0; size < encodedVertices.size(); size++)
+			CHECK(!DecodeVertices(Prefix(encodedVertices, size), decodedVertices, count, stride));
+		for (size_t size = 0; size < encodedIndices.size(); size++)
+			CHECK(!DecodeIndices(Prefix(encodedIndices, size), decodedIndices, indices.size()));
+
+		std::vector<unsigned char> longer = encodedVertices;
+		longer.push_back(0);
+		CHECK(!DecodeVertices(longer, decodedVertices, count, stride));
+		longer = encodedIndices;
+		longer.push_back(0);
+		CHECK(!DecodeIndices(longer, decodedIndices, indices.size()));
+
+		CHECK(!DecodeVertices(encodedVertices, decodedVertices, count - MESH_CODEC_GROUP_SIZE, stride));
+		CHECK(!DecodeVertices(encodedVertices, decodedVertices, count + MESH_CODEC_GROUP_SIZE, stride));
+		CHECK(!DecodeIndices(encodedIndices, decodedIndices, indices.size() - 1));
+		CHECK(!DecodeIndices(encodedIndices, decodedIndices, indices.size() + 1));
+		CHECK(!DecodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), decodedVertices.data(), count, 0));
+		CHECK(!DecodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), decodedVertices.data(), count, MESH_CODEC_MAX_STRIDE + 1));
+
+		// An index that never ends, or runs past 32 bits
+		std::vector<unsigned char> endless(8, 0xFF);
+		CHECK(!DecodeIndices(endless, decodedIndices, 1));
+
+		for (int i = 0; i < 2000; i++)
+		{
+			std::vector<unsigned char> damaged = i % 2 ? encodedVertices : encodedIndices;
+			for (int flips = 1 + i % 3; flips > 0; flips--)
+				damaged[random() % damaged.size()] ^= (unsigned char)(1 + random() % 255);
+			if (i % 2)
+				DecodeVertices(damaged, decodedVertices, count, stride);
+			else
+				DecodeIndices(damaged, decodedIndices, indices.size());
+		}
+	}
+}
+
+int main()
+{
+	TestBundledMeshes();
+	TestUnusualData();
+	TestBadInput();
+	return TestResult();
+}
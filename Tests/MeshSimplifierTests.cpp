@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// How far each LOD's triangle count may be from the target
+	// (MESH_LOD_REDUCTION of the level before it), as a ratio
+	const float MinReduction = MESH_LOD_REDUCTION * 0.5f;
+	const float MaxReduction = MESH_LOD_REDUCTION * 1.5f;
+
+	// --------------------------------------------------------
+	// Groups the vertices into charts: sets connected by the
+	// triangles that use them.  Vertices at a UV or normal
+	// seam are split, so the two sides of a seam end up in
+	// different charts, and a triangle whose corners come from
+	// different charts has merged across a seam.
+	// --------------------------------------------------------
+	std::vector<unsigned int> FindCharts(const MeshData& mesh, unsigned int indexCount)
+	{
+		std::vector<unsigned int> chart(mesh.Vertices.size());
+		std::iota(chart.begin(), chart.end(), 0);
+		auto find = [&](unsigned int v)
+			{
+				while (chart[v] != v)
+					v = chart[v] = chart[chart[v]];
+				return v;
+			};
+
+		for (unsigned int i = 0; i < indexCount; i += 3)
+		{
+			unsigned int a = find(mesh.Indices[i]);
+			chart[find(mesh.Indices[i + 1])] = a;
+			chart[find(mesh.Indices[i + 2])] = a;
+		}
+
+		for (unsigned int v = 0; v < chart.size(); v++)
+			chart[v] = find(v);
+		return chart;
+	}
+
+	// Vertices that share a position with a vertex in another chart
+	unsigned int CountSeamVertices(const MeshData& mesh, const std::vector<unsigned int>& charts)
+	{
+		std::vector<unsigned int> order(mesh.Vertices.size());
+		std::iota(order.begin(), order.end(), 0);
+		auto position = [&](unsigned int v) { const XMFLOAT3& p = mesh.Vertices[v].Position; return std::make_tuple(p.x, p.y, p.z); };
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return position(a) < position(b); });
+
+		unsigned int seams = 0;
+		for (size_t first = 0, last = 0; first < order.size(); first = last)
+		{
+			bool split = false;
+			for (last = first + 1; last < order.size() && position(order[last]) == position(order[first]); last++)
+				split = split || charts[order[last]] != charts[order[first]];
+			if (split)
+				seams += (unsigned int)(last - first);
+		}
+		return seams;
+	}
+
+	// --------------------------------------------------------
+	// Every bundled mesh, as it's stored in a cache: each LOD
+	// has roughly the target fraction of the triangles of the
+	// one before, and no smaller error; every submesh's range
+	// of every LOD is inside that LOD (and together they cover
+	// it); and no simplified triangle joins vertices from
+	// different charts, so nothing merged across a seam
+	// --------------------------------------------------------
+	void TestGenerateLODs()
+	{
+		unsigned int totalSeams = 0;
+		unsigned int totalLODs = 0;
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData mesh = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+			CHECK(!mesh.LODs.empty() && mesh.LODs.size() <= MESH_MAX_LODS);
+			if (mesh.LODs.empty())
+				continue;
+
+			const MeshLOD& full = mesh.LODs[0];
+			CHECK(full.FirstIndex == 0 && full.Error == 0.0f);
+			std::vector<unsigned int> charts = FindCharts(mesh, full.IndexCount);
+			unsigned int seams = CountSeamVertices(mesh, charts);
+			totalSeams += seams;
+
+			std::printf("%ls: %zu LOD(s), %u seam vertices\n", file.c_str(), mesh.LODs.size(), seams);
+			for (size_t l = 0; l < mesh.LODs.size(); l++)
+			{
+				const MeshLOD& lod = mesh.LODs[l];
+				std::printf("  %u triangles, error %g\n", lod.IndexCount / 3, lod.Error);
+				CHECK(lod.IndexCount > 0 && lod.IndexCount % 3 == 0);
+				CHECK(lod.FirstIndex + (size_t)lod.IndexCount <= mesh.Indices.size());
+
+				if (l > 0)
+				{
+					const MeshLOD& previous = mesh.LODs[l - 1];
+					float reduction = (float)lod.IndexCount / previous.IndexCount;
+					CHECK(reduction >= MinReduction && reduction <= MaxReduction);
+					CHECK(lod.Error >= previous.Error);
+					CHECK(lod.FirstIndex >= previous.FirstIndex + previous.IndexCount);
+					CHECK(lod.IndexCount >= MESH_LOD_MIN_TRIANGLES * 3);
+					totalLODs++;
+				}
+
+				unsigned int covered = 0;
+				for (const MeshSubmesh& submesh : mesh.Submeshes)
+				{
+					CHECK(submesh.FirstIndex[l] >= lod.FirstIndex);
+					CHECK(submesh.FirstIndex[l] + submesh.IndexCount[l] <= lod.FirstIndex + lod.IndexCount);
+					CHECK(submesh.IndexCount[l] % 3 == 0);
+					covered += submesh.IndexCount[l];
+				}
+				CHECK(covered == lod.IndexCount);
+
+				unsigned int end = std::min(lod.FirstIndex + lod.IndexCount, (unsigned int)mesh.Indices.size());
+				for (unsigned int i = lod.FirstIndex; i + 2 < end; i += 3)
+				{
+					const unsigned int* tri = &mesh.Indices[i];
+					CHECK(tri[0] < mesh.Vertices.size() && tri[1] < mesh.Vertices.size() && tri[2] < mesh.Vertices.size());
+					if (tri[0] < mesh.Vertices.size() && tri[1] < mesh.Vertices.size() && tri[2] < mesh.Vertices.size())
+						CHECK(charts[tri[0]] == charts[tri[1]] && charts[tri[0]] == charts[tri[2]]);
+				}
+			}
+		}
+
+		// (Otherwise there was nothing to check)
+		CHECK(totalLODs > 0);
+		CHECK(totalSeams > 0);
+	}
+
+	// --------------------------------------------------------
+	// Straight from SimplifyMesh(): each triangle it keeps is
+	// still in the same chart as the triangle it came from,
+	// which catches a whole chart collapsing onto another
+	// --------------------------------------------------------
+	void TestSourceTriangles()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MeshData mesh = LoadOBJ(file);
+			OptimizeMesh(mesh);
+			std::vector<unsigned int> charts = FindCharts(mesh, (unsigned int)mesh.Indices.size());
+
+			std::vector<unsigned int> destination(mesh.Indices.size());
+			std::vector<unsigned int> sourceTriangles(mesh.Indices.size() / 3);
+			float error = 0.0f;
+			size_t count = SimplifyMesh(
+				mesh.Vertices.data(),
+				mesh.Vertices.size(),
+				mesh.Indices.data(),
+				mesh.Indices.size(),
+				mesh.Indices.size() / 4 / 3 * 3,
+				FLT_MAX,
+				destination.data(),
+				&error,
+				sourceTriangles.data());
+			CHECK(count <= mesh.Indices.size() && count % 3 == 0);
+
+			for (size_t t = 0; t < count / 3; t++)
+			{
+				unsigned int chart = charts[mesh.Indices[sourceTriangles[t] * 3]];
+				CHECK(sourceTriangles[t] < mesh.Indices.size() / 3);
+				CHECK(t == 0 || sourceTriangles[t] > sourceTriangles[t - 1]);
+				for (int c = 0; c < 3; c++)
+					CHECK(charts[destination[t * 3 + c]] == chart);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestGenerateLODs();
+	TestSourceTriangles();
+	return TestResult();
+}
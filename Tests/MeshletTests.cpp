@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::array<unsigned int, 3> Triangle;
+
+	// A triangle's indices rotated so the smallest is first,
+	// which keeps its winding but makes equal triangles match
+	Triangle CanonicalTriangle(const unsigned int* tri)
+	{
+		int first = tri[0] <= tri[1] && tri[0] <= tri[2] ? 0 : (tri[1] <= tri[2] ? 1 : 2);
+		return { tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3] };
+	}
+
+	std::vector<Triangle> SortedTriangles(const unsigned int* indices, size_t numIndices)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < numIndices; i += 3)
+			triangles.push_back(CanonicalTriangle(&indices[i]));
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// --------------------------------------------------------
+	// Each submesh's meshlets exactly tile its full detail
+	// range, with no more than the maximum vertices (which
+	// are counted here) or triangles, and each bounding
+	// sphere contains its meshlet's vertices
+	// --------------------------------------------------------
+	void CheckMeshlets(const MeshData& mesh)
+	{
+		for (const MeshSubmesh& submesh : mesh.Submeshes)
+		{
+			unsigned int next = submesh.FirstIndex[0];
+			for (unsigned int m = submesh.FirstMeshlet; m < submesh.FirstMeshlet + submesh.MeshletCount; m++)
+			{
+				const Meshlet& meshlet = mesh.Meshlets[m];
+				CHECK(meshlet.FirstIndex == next);
+				CHECK(meshlet.TriangleCount > 0 && meshlet.TriangleCount <= MESHLET_MAX_TRIANGLES);
+				next = meshlet.FirstIndex + meshlet.TriangleCount * 3;
+
+				std::vector<unsigned int> verts(&mesh.Indices[meshlet.FirstIndex], &mesh.Indices[next]);
+				std::sort(verts.begin(), verts.end());
+				verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+				CHECK(verts.size() == meshlet.VertexCount);
+				CHECK(meshlet.VertexCount <= MESHLET_MAX_VERTICES);
+
+				XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+				for (unsigned int v : verts)
+				{
+					float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&mesh.Vertices[v].Position), center)));
+					CHECK(distance <= meshlet.Radius * 1.0001f + 1e-6f);
+				}
+			}
+
+			if (submesh.MeshletCount > 0)
+				CHECK(next == submesh.FirstIndex[0] + submesh.IndexCount[0]);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Every bundled mesh, as it's stored in a cache: meshlets
+	// are valid, and building them (and reordering them again)
+	// keeps every triangle exactly once, winding included
+	// --------------------------------------------------------
+	void TestBundledMeshes()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData cached = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+			CheckMeshlets(cached);
+
+			// The same steps without LODs or vertex reordering, so
+			// triangles can be compared by their indices
+			MeshData mesh = ParseOBJ(source.GetData(), source.GetSize());
+			OptimizeMesh(mesh);
+			std::vector<Triangle> before = SortedTriangles(mesh.Indices.data(), mesh.Indices.size());
+			BuildMeshlets(mesh);
+			OptimizeMeshlets(mesh);
+			CheckMeshlets(mesh);
+			CHECK(SortedTriangles(mesh.Indices.data(), mesh.Indices.size()) == before);
+
+			std::printf("%ls: %zu meshlets\n", file.c_str(), cached.Meshlets.size());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Cameras all around each mesh (far enough away, and with
+	// a wide enough view, that the whole mesh is in the
+	// frustum) never cull a meshlet with a triangle facing
+	// them, perspective or orthographic.  Facing follows the
+	// cone's convention: the camera is in front of the plane
+	// that cross(p1 - p0, p2 - p0) is the normal of.
+	// --------------------------------------------------------
+	void TestConeCulling()
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+		unsigned int culled = 0;
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData mesh = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+			if (mesh.Meshlets.empty())
+				continue;
+
+			XMVECTOR min = XMLoadFloat3(&mesh.Vertices[0].Position);
+			XMVECTOR max = min;
+			for (const Vertex& v : mesh.Vertices)
+			{
+				min = XMVectorMin(min, XMLoadFloat3(&v.Position));
+				max = XMVectorMax(max, XMLoadFloat3(&v.Position));
+			}
+			XMVECTOR center = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+			float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(max, center)));
+
+			for (int view = 0; view < 64; view++)
+			{
+				XMVECTOR direction;
+				do
+					direction = XMVectorSet(unit(random), unit(random), unit(random), 0);
+				while (XMVectorGetX(XMVector3LengthSq(direction)) < 0.01f);
+				direction = XMVector3Normalize(direction);
+
+				bool perspective = view % 2 == 0;
+				XMVECTOR eye = XMVectorAdd(center, XMVectorScale(direction, radius * 3.0f));
+				XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+				XMFLOAT4X4 viewMatrix;
+				XMFLOAT4X4 projection;
+				XMStoreFloat4x4(&viewMatrix, XMMatrixLookAtLH(eye, center, up));
+				XMStoreFloat4x4(&projection, perspective ?
+					XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, radius * 0.01f, radius * 10.0f) :
+					XMMatrixOrthographicLH(radius * 3.0f, radius * 3.0f, radius * 0.01f, radius * 10.0f));
+				MeshletCullContext context = CreateMeshletCullContext(world, viewMatrix, projection, perspective);
+
+				for (const Meshlet& meshlet : mesh.Meshlets)
+				{
+					if (IsMeshletVisible(meshlet, context))
+						continue;
+
+					culled++;
+					for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+					{
+						const unsigned int* tri = &mesh.Indices[meshlet.FirstIndex + t * 3];
+						XMVECTOR p0 = XMLoadFloat3(&mesh.Vertices[tri[0]].Position);
+						XMVECTOR p1 = XMLoadFloat3(&mesh.Vertices[tri[1]].Position);
+						XMVECTOR p2 = XMLoadFloat3(&mesh.Vertices[tri[2]].Position);
+						XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+
+						// Towards the camera, from the triangle
+						XMVECTOR toCamera = perspective ? XMVectorSubtract(eye, p0) : direction;
+						float facing = XMVectorGetX(XMVector3Dot(XMVector3Normalize(normal), XMVector3Normalize(toCamera)));
+						CHECK(facing <= 1e-4f);
+					}
+				}
+			}
+		}
+
+		// (Otherwise there was nothing to check)
+		std::printf("%u meshlet(s) culled\n", culled);
+		CHECK(culled > 0);
+	}
+}
+
+int main()
+{
+	TestBundledMeshes();
+	TestConeCulling();
+	return TestResult();
+}
@@ -0,0 +1,189 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Is the mesh usable: whole triangles, every index a real vertex?
+	bool IsWellFormed(const MeshData& mesh)
+	{
+		if (mesh.Vertices.empty() || mesh.Indices.empty() || mesh.Indices.size() % 3 != 0)
+			return false;
+
+		for (unsigned int index : mesh.Indices)
+			if (index >= mesh.Vertices.size())
+				return false;
+
+		return true;
+	}
+
+	MeshData ParseText(const char* text)
+	{
+		return ParseOBJSerial(text, strlen(text));
+	}
+
+	// Are two meshes the same, byte for byte?
+	bool AreIdentical(const MeshData& a, const MeshData& b)
+	{
+		return
+			a.Vertices.size() == b.Vertices.size() &&
+			a.Indices == b.Indices &&
+			a.Submeshes.size() == b.Submeshes.size() &&
+			memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(Vertex)) == 0 &&
+			memcmp(a.Submeshes.data(), b.Submeshes.data(), a.Submeshes.size() * sizeof(MeshSubmesh)) == 0;
+	}
+
+	// --------------------------------------------------------
+	// A grid of quads, big enough to be split into many chunks,
+	// with shared and relative indices, a few materials, and
+	// some references past the end of the attributes
+	// --------------------------------------------------------
+	std::string CreateGridOBJ(int size)
+	{
+		std::string text;
+		char line[128];
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				snprintf(line, sizeof(line), "v %d %d %d\nvt %g %g\n", x, y, (x * y) % 7, x / (float)size, y / (float)size);
+				text += line;
+			}
+		}
+		text += "vn 0 0 1\nvn 0 1 0\n";
+
+		for (int y = 0; y < size; y++)
+		{
+			if (y % 50 == 0)
+			{
+				snprintf(line, sizeof(line), "usemtl material%d\n", y / 50 % 3);
+				text += line;
+			}
+
+			for (int x = 0; x < size; x++)
+			{
+				int a = y * (size + 1) + x + 1;
+				int b = a + size + 1;
+				int normal = (x + y) % 2 + 1;
+				if (x % 13 == 0)
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/9\n", a, a, normal, a + 1, a + 1, normal, b + 1, b + 1, normal, b, b);
+				else if (x % 5 == 0)
+					snprintf(line, sizeof(line), "f %d/%d/-%d %d/%d/-1 %d/%d/-1\n", a, a, normal, a + 1, a + 1, b, b);
+				else
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, normal, a + 1, a + 1, normal, b + 1, b + 1, normal, b, b, normal);
+				text += line;
+			}
+		}
+
+		return text;
+	}
+
+	// --------------------------------------------------------
+	// Every bundled mesh loads into a well formed mesh
+	// --------------------------------------------------------
+	void TestBundledMeshes()
+	{
+		std::vector<std::wstring> files = TestMeshFiles();
+		CHECK(!files.empty());
+
+		for (const std::wstring& file : files)
+		{
+			MeshData mesh = LoadOBJ(file);
+			bool wellFormed = IsWellFormed(mesh);
+			if (!wellFormed)
+				std::printf("Badly formed mesh: %ls\n", file.c_str());
+			CHECK(wellFormed);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Parsing (and welding) in parallel gives exactly the same
+	// mesh as parsing serially, however many threads there are
+	// --------------------------------------------------------
+	void TestParallelMatchesSerial()
+	{
+		std::vector<std::string> texts;
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile mapped(file);
+			if (mapped.IsOpen())
+				texts.emplace_back(mapped.GetData(), mapped.GetSize());
+		}
+		texts.push_back(CreateGridOBJ(400));
+
+		for (unsigned int workers : { 1u, 2u, 5u })
+		{
+			ThreadPool pool(workers);
+			for (const std::string& text : texts)
+			{
+				MeshData serial = ParseOBJSerial(text.data(), text.size());
+				MeshData parallel = ParseOBJParallel(text.data(), text.size(), pool);
+				CHECK(IsWellFormed(parallel));
+				CHECK(AreIdentical(serial, parallel));
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Indices too big for an int (or with far too many digits)
+	// are treated as missing, not wrapped around into range
+	// --------------------------------------------------------
+	void TestOverlongIndices()
+	{
+		MeshData mesh = ParseText(
+			"v 1 2 3\n"
+			"v 4 5 6\n"
+			"v 7 8 9\n"
+			"vn 0 1 0\n"
+			"f 1//1 2//1 99999999999//1\n"
+			"f 1//1 2//1 -99999999999//1\n"
+			"f 1//1 2//1 2147483648//1\n"
+			"f 1//1 2//1 4294967299//1\n"
+			"f 1//1 2//1 000000000000000000000000000003//1\n"
+			"f 1//1 2//1 3//99999999999999999999999999999999\n");
+
+		CHECK(IsWellFormed(mesh));
+		CHECK(mesh.Indices.size() == 18);
+		if (mesh.Indices.size() != 18)
+			return;
+
+		// (Corners are in any order, since faces' windings are flipped)
+		auto countCorners = [&mesh](int face, bool (*test)(const Vertex&))
+			{
+				int count = 0;
+				for (int corner = 0; corner < 3; corner++)
+					count += test(mesh.Vertices[mesh.Indices[face * 3 + corner]]) ? 1 : 0;
+				return count;
+			};
+		auto noPosition = [](const Vertex& v) { return v.Position.x == 0 && v.Position.y == 0 && v.Position.z == 0; };
+		auto noNormal = [](const Vertex& v) { return v.Normal.x == 0 && v.Normal.y == 0 && v.Normal.z == 0; };
+		auto isThird = [](const Vertex& v) { return v.Position.x == 7 && v.Position.y == 8; };
+
+		// The first four faces' last corners have no position
+		for (int face = 0; face < 4; face++)
+			CHECK(countCorners(face, noPosition) == 1);
+
+		// Leading zeros aren't an overflow, so the fifth face is whole
+		CHECK(countCorners(4, noPosition) == 0);
+		CHECK(countCorners(4, isThird) == 1);
+
+		// And the last one only loses a normal
+		CHECK(countCorners(5, noPosition) == 0);
+		CHECK(countCorners(5, isThird) == 1);
+		CHECK(countCorners(5, noNormal) == 1);
+	}
+}
+
+int main()
+{
+	TestBundledMeshes();
+	TestParallelMatchesSerial();
+	TestOverlongIndices();
+	return TestResult();
+}
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "PackedVertex.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Largest angle allowed between a unit normal or tangent and
+	// its octahedral SNORM16 encoding, decoded (in degrees)
+	const float MaxDirectionDegrees = 0.005f;
+
+	// Half a step of a 16-bit grid over the given range, plus what
+	// float math loses unpacking (offset + unorm * scale)
+	float Unorm16Tolerance(float offset, float scale)
+	{
+		return scale * 0.5f / 65535.0f + (fabsf(offset) + fabsf(scale)) * 2e-7f;
+	}
+
+	// --------------------------------------------------------
+	// Angle between two directions, in degrees, or zero if
+	// either has no length (nothing to encode).  Measured with
+	// atan2(), as acos() of a float can't resolve angles this
+	// small (it jumps from 0 to 0.02 degrees).
+	// --------------------------------------------------------
+	float AngleDegrees(FXMVECTOR a, FXMVECTOR b)
+	{
+		if (XMVectorGetX(XMVector3LengthSq(a)) <= 0.0f || XMVectorGetX(XMVector3LengthSq(b)) <= 0.0f)
+			return 0.0f;
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+
+	// --------------------------------------------------------
+	// Packs and unpacks vertices, checking every one against
+	// the bounds of its encoding: positions & UVs within half
+	// a step of their grids (per axis), and normals & tangents
+	// within MaxDirectionDegrees.  There's no stored tangent
+	// w: the shaders build the bitangent as cross(T, N), so
+	// that must keep pointing the same way (the handedness
+	// can't flip).  MeasurePackingError() must agree.
+	// --------------------------------------------------------
+	void CheckRoundTrip(const std::vector<Vertex>& verts)
+	{
+		VertexQuantization quantization = ComputeVertexQuantization(verts.data(), verts.size());
+		std::vector<PackedVertex> packed(verts.size());
+		std::vector<Vertex> unpacked(verts.size());
+		PackVertices(verts.data(), verts.size(), quantization, packed.data());
+		UnpackVertices(packed.data(), packed.size(), quantization, unpacked.data());
+
+		const float* offset = &quantization.Offset.x;
+		const float* scale = &quantization.Scale.x;
+		float maxPosition = 0.0f;
+		float maxUV = 0.0f;
+		float maxNormal = 0.0f;
+		float maxTangent = 0.0f;
+		unsigned int outOfBounds = 0;
+		unsigned int flipped = 0;
+		for (size_t i = 0; i < verts.size(); i++)
+		{
+			const Vertex& v = verts[i];
+			const Vertex& u = unpacked[i];
+			CHECK(packed[i].Position[3] == 0);
+
+			for (int axis = 0; axis < 3; axis++)
+				if (fabsf((&v.Position.x)[axis] - (&u.Position.x)[axis]) > Unorm16Tolerance(offset[axis], scale[axis]))
+					outOfBounds++;
+			if (fabsf(v.UV.x - u.UV.x) > Unorm16Tolerance(quantization.UVOffset.x, quantization.UVScale.x) ||
+				fabsf(v.UV.y - u.UV.y) > Unorm16Tolerance(quantization.UVOffset.y, quantization.UVScale.y))
+				outOfBounds++;
+			maxPosition = std::max(maxPosition, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&v.Position), XMLoadFloat3(&u.Position)))));
+			maxUV = std::max(maxUV, std::max(fabsf(v.UV.x - u.UV.x), fabsf(v.UV.y - u.UV.y)));
+
+			// Decoded directions always come back unit length
+			XMVECTOR normal = XMLoadFloat3(&v.Normal);
+			XMVECTOR tangent = XMLoadFloat3(&v.Tangent);
+			XMVECTOR unpackedNormal = XMLoadFloat3(&u.Normal);
+			XMVECTOR unpackedTangent = XMLoadFloat3(&u.Tangent);
+			CHECK(fabsf(XMVectorGetX(XMVector3Length(unpackedNormal)) - 1.0f) < 1e-5f);
+			CHECK(fabsf(XMVectorGetX(XMVector3Length(unpackedTangent)) - 1.0f) < 1e-5f);
+			maxNormal = std::max(maxNormal, AngleDegrees(normal, unpackedNormal));
+			maxTangent = std::max(maxTangent, AngleDegrees(tangent, unpackedTangent));
+
+			// Only meaningful if the tangent isn't (nearly) along the normal
+			XMVECTOR bitangent = XMVector3Cross(tangent, normal);
+			if (XMVectorGetX(XMVector3Length(bitangent)) > 0.1f &&
+				XMVectorGetX(XMVector3Dot(bitangent, XMVector3Cross(unpackedTangent, unpackedNormal))) <= 0.0f)
+				flipped++;
+		}
+
+		std::printf("  %zu vertices: position %g, UV %g, normal %g deg, tangent %g deg\n",
+			verts.size(), maxPosition, maxUV, maxNormal, maxTangent);
+		CHECK(outOfBounds == 0);
+		CHECK(flipped == 0);
+		CHECK(maxNormal <= MaxDirectionDegrees);
+		CHECK(maxTangent <= MaxDirectionDegrees);
+
+		VertexPackingError error = MeasurePackingError(verts.data(), packed.data(), verts.size(), quantization);
+		CHECK(fabsf(error.MaxPosition - maxPosition) <= maxPosition * 1e-3f + 1e-7f);
+		CHECK(fabsf(error.MaxUV - maxUV) <= maxUV * 1e-3f + 1e-7f);
+		CHECK(fabsf(error.MaxNormalDegrees - maxNormal) <= maxNormal * 1e-3f + 1e-7f);
+		CHECK(fabsf(error.MaxTangentDegrees - maxTangent) <= maxTangent * 1e-3f + 1e-7f);
+	}
+
+	// Every bundled mesh, as it's stored in a cache
+	void TestBundledMeshes()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			std::printf("%ls\n", file.c_str());
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData mesh = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+			CheckRoundTrip(mesh.Vertices);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Random vertices far from the origin (so offsets matter),
+	// with random unit directions, plus the directions the
+	// octahedral encoding treats specially: the axes, where
+	// its folds meet, and the edges of the lower half's fold
+	// --------------------------------------------------------
+	void TestRandomVertices()
+	{
+		std::mt19937 random(10);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		auto randomDirection = [&]()
+			{
+				XMVECTOR d;
+				do
+					d = XMVectorSet(unit(random), unit(random), unit(random), 0);
+				while (XMVectorGetX(XMVector3LengthSq(d)) < 0.01f);
+				return XMVector3Normalize(d);
+			};
+
+		std::vector<XMFLOAT3> directions;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (float sign : { 1.0f, -1.0f })
+			{
+				XMFLOAT3 d(0, 0, 0);
+				(&d.x)[axis] = sign;
+				directions.push_back(d);
+			}
+		}
+		for (float x : { -0.5f, 0.5f })
+			for (float y : { -0.5f, 0.5f })
+				for (float z : { -1e-6f, 0.0f, 1e-6f })
+					directions.push_back(XMFLOAT3(x, y, z));
+
+		std::vector<Vertex> verts;
+		for (int i = 0; i < 20000; i++)
+		{
+			Vertex v;
+			v.Position = XMFLOAT3(1000.0f + unit(random) * 3.0f, -50.0f + unit(random) * 0.01f, unit(random) * 200.0f);
+			v.UV = XMFLOAT2(7.0f + unit(random) * 8.0f, unit(random));
+
+			XMVECTOR normal = randomDirection();
+			if (i < (int)directions.size())
+				normal = XMVector3Normalize(XMLoadFloat3(&directions[i]));
+			XMVECTOR tangent = randomDirection();
+			if (i >= (int)directions.size() && i < 2 * (int)directions.size())
+				tangent = XMVector3Normalize(XMLoadFloat3(&directions[i - directions.size()]));
+			tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(tangent, normal))));
+			XMStoreFloat3(&v.Normal, normal);
+			XMStoreFloat3(&v.Tangent, tangent);
+			verts.push_back(v);
+		}
+
+		std::printf("Random\n");
+		CheckRoundTrip(verts);
+	}
+
+	// The ends of each range come back exactly, and flat ranges (nothing to store) do too
+	void TestRangeEnds()
+	{
+		std::vector<Vertex> verts(2);
+		verts[0].Position = XMFLOAT3(-3.5f, 2.0f, 0.25f);
+		verts[1].Position = XMFLOAT3(12.0f, 2.0f, 0.75f);
+		verts[0].UV = XMFLOAT2(0.0f, 4.0f);
+		verts[1].UV = XMFLOAT2(1.0f, 4.0f);
+		for (Vertex& v : verts)
+		{
+			v.Normal = XMFLOAT3(0, 1, 0);
+			v.Tangent = XMFLOAT3(1, 0, 0);
+		}
+
+		VertexQuantization quantization = ComputeVertexQuantization(verts.data(), verts.size());
+		std::vector<PackedVertex> packed(verts.size());
+		std::vector<Vertex> unpacked(verts.size());
+		PackVertices(verts.data(), verts.size(), quantization, packed.data());
+		UnpackVertices(packed.data(), packed.size(), quantization, unpacked.data());
+
+		CHECK(packed[0].Position[0] == 0 && packed[1].Position[0] == 65535);
+		CHECK(packed[0].Position[1] == 0 && packed[1].Position[1] == 0);
+		CHECK(packed[0].UV[1] == 0 && packed[1].UV[1] == 0);
+		for (size_t i = 0; i < verts.size(); i++)
+		{
+			CHECK(memcmp(&unpacked[i].Position, &verts[i].Position, sizeof(XMFLOAT3)) == 0);
+			CHECK(memcmp(&unpacked[i].UV, &verts[i].UV, sizeof(XMFLOAT2)) == 0);
+			CHECK(memcmp(&unpacked[i].Normal, &verts[i].Normal, sizeof(XMFLOAT3)) == 0);
+			CHECK(memcmp(&unpacked[i].Tangent, &verts[i].Tangent, sizeof(XMFLOAT3)) == 0);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Splits a position-only stream out of some vertices (of
+	// either format) the way meshes do, and checks it against
+	// them; then damages one byte of one position, which must
+	// no longer match
+	// --------------------------------------------------------
+	template <typename VertexType, typename PositionType>
+	void CheckPositionStream(const std::vector<VertexType>& verts)
+	{
+		std::vector<unsigned char> positions(sizeof(PositionType) * verts.size());
+		SplitPositionStream(verts.data(), verts.size(), sizeof(VertexType), sizeof(PositionType), positions.data());
+		CHECK(PositionStreamMatches(verts.data(), verts.size(), sizeof(VertexType), positions.data(), sizeof(PositionType)));
+
+		// Byte for byte, each position is the first thing in its vertex
+		bool same = true;
+		for (size_t i = 0; i < verts.size(); i++)
+			same = same && memcmp(&positions[i * sizeof(PositionType)], &verts[i].Position, sizeof(PositionType)) == 0;
+		CHECK(same);
+
+		positions[positions.size() / 2] ^= 1;
+		CHECK(!PositionStreamMatches(verts.data(), verts.size(), sizeof(VertexType), positions.data(), sizeof(PositionType)));
+	}
+
+	// Both the full and packed vertices of every bundled mesh
+	void TestPositionStreams()
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			MappedFile source(file);
+			MeshOptimizationStats stats;
+			MeshData mesh = BuildMeshFromOBJ(source.GetData(), source.GetSize(), stats);
+
+			std::vector<PackedVertex> packed(mesh.Vertices.size());
+			VertexQuantization quantization = ComputeVertexQuantization(mesh.Vertices.data(), mesh.Vertices.size());
+			PackVertices(mesh.Vertices.data(), mesh.Vertices.size(), quantization, packed.data());
+
+			CheckPositionStream<Vertex, XMFLOAT3>(mesh.Vertices);
+			CheckPositionStream<PackedVertex, decltype(PackedVertex::Position)>(packed);
+		}
+	}
+}
+
+int main()
+{
+	TestBundledMeshes();
+	TestRandomVertices();
+	TestRangeEnds();
+	TestPositionStreams();
+	return TestResult();
+}
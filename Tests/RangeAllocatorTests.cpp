@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "RangeAllocator.h"
+
+namespace
+{
+	// --------------------------------------------------------
+	// Allocations pack from the start, zero sized ones still
+	// get a unit of their own, and freeing only accepts
+	// offsets that were allocated (once)
+	// --------------------------------------------------------
+	void TestAllocateAndFree()
+	{
+		RangeAllocator allocator(100);
+		CHECK(allocator.GetCapacity() == 100);
+		CHECK(allocator.GetLargestFreeRange() == 100);
+
+		unsigned int a = allocator.Allocate(10);
+		unsigned int b = allocator.Allocate(20);
+		unsigned int c = allocator.Allocate(0);
+		CHECK(a == 0 && b == 10 && c == 30);
+		CHECK(allocator.GetUsed() == 31);
+		CHECK(allocator.GetAllocationCount() == 3);
+		CHECK(allocator.GetLargestFreeRange() == 69);
+
+		// First fit: the hole left by a is reused for something smaller
+		allocator.Free(a);
+		CHECK(allocator.GetUsed() == 21);
+		CHECK(allocator.Allocate(4) == 0);
+		CHECK(allocator.Allocate(8) == 31);
+		CHECK(allocator.Allocate(6) == 4);
+
+		bool threw = false;
+		try { allocator.Free(1); }
+		catch (const std::invalid_argument&) { threw = true; }
+		CHECK(threw);
+
+		allocator.Free(b);
+		threw = false;
+		try { allocator.Free(b); }
+		catch (const std::invalid_argument&) { threw = true; }
+		CHECK(threw);
+		CHECK(allocator.GetAllocationCount() == 4);
+	}
+
+	// --------------------------------------------------------
+	// A freed range merges with free neighbors on either side
+	// (and both at once), so the whole space comes back as one
+	// range, whatever order things are freed in
+	// --------------------------------------------------------
+	void TestCoalescing()
+	{
+		RangeAllocator allocator(40);
+		unsigned int a = allocator.Allocate(10);
+		unsigned int b = allocator.Allocate(10);
+		unsigned int c = allocator.Allocate(10);
+		unsigned int d = allocator.Allocate(10);
+		CHECK(allocator.GetLargestFreeRange() == 0);
+
+		// Not adjacent: two separate holes
+		allocator.Free(a);
+		allocator.Free(c);
+		CHECK(allocator.GetLargestFreeRange() == 10);
+		CHECK(allocator.Allocate(15) == RangeAllocator::InvalidOffset);
+
+		// Between both holes: all three merge
+		allocator.Free(b);
+		CHECK(allocator.GetLargestFreeRange() == 30);
+		CHECK(allocator.Allocate(30) == 0);
+		allocator.Free(0);
+
+		// Merges with the free range before it
+		allocator.Free(d);
+		CHECK(allocator.GetLargestFreeRange() == 40);
+		CHECK(allocator.GetUsed() == 0);
+
+		// Random sizes & order: once everything is freed, one range is left
+		std::mt19937 random(15);
+		std::vector<unsigned int> offsets;
+		RangeAllocator shuffled(1000);
+		for (;;)
+		{
+			unsigned int offset = shuffled.Allocate(1 + random() % 30);
+			if (offset == RangeAllocator::InvalidOffset)
+				break;
+			offsets.push_back(offset);
+		}
+		std::shuffle(offsets.begin(), offsets.end(), random);
+		for (unsigned int offset : offsets)
+			shuffled.Free(offset);
+		CHECK(shuffled.GetAllocationCount() == 0);
+		CHECK(shuffled.GetUsed() == 0);
+		CHECK(shuffled.GetLargestFreeRange() == 1000);
+	}
+
+	// --------------------------------------------------------
+	// Running out returns InvalidOffset (and changes nothing);
+	// growing adds space at the end, merged with any free range
+	// that already ends there, and never shrinks
+	// --------------------------------------------------------
+	void TestGrow()
+	{
+		RangeAllocator empty;
+		CHECK(empty.GetCapacity() == 0);
+		CHECK(empty.Allocate(1) == RangeAllocator::InvalidOffset);
+
+		RangeAllocator allocator(16);
+		CHECK(allocator.Allocate(12) == 0);
+		CHECK(allocator.Allocate(8) == RangeAllocator::InvalidOffset);
+		CHECK(allocator.GetUsed() == 12);
+		CHECK(allocator.GetAllocationCount() == 1);
+
+		// The 4 free at the end join the new 16
+		allocator.Grow(32);
+		CHECK(allocator.GetCapacity() == 32);
+		CHECK(allocator.GetLargestFreeRange() == 20);
+		CHECK(allocator.Allocate(20) == 12);
+		CHECK(allocator.Allocate(1) == RangeAllocator::InvalidOffset);
+
+		allocator.Grow(8);
+		CHECK(allocator.GetCapacity() == 32);
+
+		// Nothing free at the end this time
+		allocator.Free(0);
+		allocator.Grow(40);
+		CHECK(allocator.GetLargestFreeRange() == 12);
+		CHECK(allocator.Allocate(8) == 0);
+		CHECK(allocator.Allocate(8) == 32);
+	}
+}
+
+int main()
+{
+	TestAllocateAndFree();
+	TestCoalescing();
+	TestGrow();
+	return TestResult();
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "ObjLoader.h"
+#include "StaticBatch.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Largest difference allowed in any component
+	const float PositionTolerance = 1e-4f;
+	const float DirectionTolerance = 1e-4f;
+
+	// --------------------------------------------------------
+	// How one instance is placed: scaled, rotated, then moved
+	// (each written out separately, so the expected vertices
+	// can be worked out without the world matrix)
+	// --------------------------------------------------------
+	struct Placement
+	{
+		XMFLOAT3 Scale;
+		XMFLOAT3 Rotation;	// Pitch, yaw & roll
+		XMFLOAT3 Position;
+	};
+
+	XMFLOAT4X4 WorldMatrix(const Placement& placement)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world,
+			XMMatrixScaling(placement.Scale.x, placement.Scale.y, placement.Scale.z) *
+			XMMatrixRotationRollPitchYaw(placement.Rotation.x, placement.Rotation.y, placement.Rotation.z) *
+			XMMatrixTranslation(placement.Position.x, placement.Position.y, placement.Position.z));
+		return world;
+	}
+
+	// --------------------------------------------------------
+	// A source vertex as it should end up in the batch.  Under
+	// a scale s, a surface's tangents scale by s and its normal
+	// by 1/s (so it stays perpendicular), then both rotate; the
+	// tangent is made perpendicular to the normal again.
+	// --------------------------------------------------------
+	Vertex ExpectedVertex(const Vertex& source, const Placement& placement)
+	{
+		XMVECTOR scale = XMLoadFloat3(&placement.Scale);
+		XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(placement.Rotation.x, placement.Rotation.y, placement.Rotation.z);
+		XMVECTOR position = XMVectorAdd(XMVector3Rotate(XMVectorMultiply(XMLoadFloat3(&source.Position), scale), rotation), XMLoadFloat3(&placement.Position));
+		XMVECTOR normal = XMVector3Normalize(XMVector3Rotate(XMVectorDivide(XMLoadFloat3(&source.Normal), scale), rotation));
+		XMVECTOR tangent = XMVector3Rotate(XMVectorMultiply(XMLoadFloat3(&source.Tangent), scale), rotation);
+		tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(tangent, normal)))));
+
+		Vertex expected;
+		XMStoreFloat3(&expected.Position, position);
+		XMStoreFloat3(&expected.Normal, normal);
+		XMStoreFloat3(&expected.Tangent, tangent);
+		expected.UV = source.UV;
+		return expected;
+	}
+
+	bool Near(const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+	}
+
+	bool SameVertex(const Vertex& a, const Vertex& b)
+	{
+		return Near(a.Position, b.Position, PositionTolerance) &&
+			Near(a.Normal, b.Normal, DirectionTolerance) &&
+			Near(a.Tangent, b.Tangent, DirectionTolerance) &&
+			a.UV.x == b.UV.x && a.UV.y == b.UV.y;
+	}
+
+	// Is triangle b triangle a (starting at any corner, same winding)?
+	bool SameTriangle(const Vertex* a, const Vertex* b)
+	{
+		for (int first = 0; first < 3; first++)
+			if (SameVertex(a[0], b[first]) && SameVertex(a[1], b[(first + 1) % 3]) && SameVertex(a[2], b[(first + 2) % 3]))
+				return true;
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Two copies of a bundled mesh, under non-uniform scales:
+	// the whole mesh, and the second half of its triangles
+	// (so its indices start partway through the buffer) under
+	// a mirroring scale.  Every merged triangle matches exactly
+	// one source triangle with its vertices transformed, and
+	// mirrored triangles are wound back the other way.  Each
+	// copy's indices are rebased onto only the vertices it
+	// uses, after the copies before it.
+	// --------------------------------------------------------
+	void TestMerge()
+	{
+		MeshData mesh = LoadOBJ(TestMeshPath(L"crate_wood.obj"));
+		size_t half = mesh.Indices.size() / 6 * 3;
+
+		const Placement placements[2] =
+		{
+			{ XMFLOAT3(2.0f, 0.5f, 3.0f), XMFLOAT3(0.3f, 1.1f, -0.7f), XMFLOAT3(10, 0, 0) },
+			{ XMFLOAT3(-1.5f, 1.0f, 2.0f), XMFLOAT3(-0.9f, 0.2f, 2.4f), XMFLOAT3(-10, 5, 0) },
+		};
+
+		StaticBatchInstance instances[2] = {};
+		instances[0].Vertices = mesh.Vertices.data();
+		instances[0].VertexCount = mesh.Vertices.size();
+		instances[0].Indices = mesh.Indices.data();
+		instances[0].IndexCount = mesh.Indices.size();
+		instances[0].World = WorldMatrix(placements[0]);
+		instances[1] = instances[0];
+		instances[1].Indices = mesh.Indices.data() + half;
+		instances[1].IndexCount = mesh.Indices.size() - half;
+		instances[1].World = WorldMatrix(placements[1]);
+
+		// What each instance's triangles should turn into
+		std::vector<Vertex> expected;
+		size_t expectedVertexCount = 0;
+		for (int i = 0; i < 2; i++)
+		{
+			bool mirrored = placements[i].Scale.x * placements[i].Scale.y * placements[i].Scale.z < 0.0f;
+			std::vector<bool> used(mesh.Vertices.size(), false);
+			for (size_t j = 0; j < instances[i].IndexCount; j += 3)
+			{
+				const unsigned int* tri = &instances[i].Indices[j];
+				expected.push_back(ExpectedVertex(mesh.Vertices[tri[0]], placements[i]));
+				expected.push_back(ExpectedVertex(mesh.Vertices[tri[mirrored ? 2 : 1]], placements[i]));
+				expected.push_back(ExpectedVertex(mesh.Vertices[tri[mirrored ? 1 : 2]], placements[i]));
+				for (int c = 0; c < 3; c++)
+					used[tri[c]] = true;
+			}
+			expectedVertexCount += std::count(used.begin(), used.end(), true);
+		}
+
+		MeshData merged = MergeStaticGeometry(instances, 2);
+		CHECK(merged.Vertices.size() == expectedVertexCount);
+		CHECK(merged.Indices.size() == expected.size());
+		CHECK(merged.LODs.size() == 1);
+		if (merged.LODs.size() == 1)
+			CHECK(merged.LODs[0].FirstIndex == 0 && merged.LODs[0].IndexCount == merged.Indices.size());
+
+		// Triangles may have been reordered (for meshlets), so match them up
+		std::vector<bool> matched(expected.size() / 3, false);
+		unsigned int unmatched = 0;
+		for (size_t i = 0; i + 2 < merged.Indices.size(); i += 3)
+		{
+			const unsigned int* tri = &merged.Indices[i];
+			CHECK(tri[0] < merged.Vertices.size() && tri[1] < merged.Vertices.size() && tri[2] < merged.Vertices.size());
+			if (tri[0] >= merged.Vertices.size() || tri[1] >= merged.Vertices.size() || tri[2] >= merged.Vertices.size())
+				continue;
+
+			Vertex corners[3] = { merged.Vertices[tri[0]], merged.Vertices[tri[1]], merged.Vertices[tri[2]] };
+			size_t t = 0;
+			while (t < matched.size() && (matched[t] || !SameTriangle(&expected[t * 3], corners)))
+				t++;
+
+			if (t == matched.size())
+				unmatched++;
+			else
+				matched[t] = true;
+		}
+
+		std::printf("%zu triangles merged, %zu vertices, %u unmatched\n", merged.Indices.size() / 3, merged.Vertices.size(), unmatched);
+		CHECK(unmatched == 0);
+		CHECK(std::count(matched.begin(), matched.end(), false) == 0);
+	}
+
+	// --------------------------------------------------------
+	// Two copies of a quad whose indices point at the back half
+	// of an eight vertex buffer (the front half is unused): only
+	// the quad's vertices are copied, once per copy, and each
+	// copy's triangles only use its own vertices
+	// --------------------------------------------------------
+	void TestRebasing()
+	{
+		std::vector<Vertex> verts(8);
+		for (unsigned int v = 0; v < verts.size(); v++)
+		{
+			verts[v].Position = XMFLOAT3((float)(v & 1), (float)((v >> 1) & 1), (float)(v >> 2));
+			verts[v].Normal = XMFLOAT3(0, 0, -1);
+			verts[v].Tangent = XMFLOAT3(1, 0, 0);
+		}
+		const unsigned int indices[] = { 4, 6, 5, 5, 6, 7 };
+
+		StaticBatchInstance instances[2] = {};
+		for (int i = 0; i < 2; i++)
+		{
+			instances[i].Vertices = verts.data();
+			instances[i].VertexCount = verts.size();
+			instances[i].Indices = indices;
+			instances[i].IndexCount = 6;
+			XMStoreFloat4x4(&instances[i].World, XMMatrixTranslation(i * 10.0f, 0, 0));
+		}
+
+		MeshData merged = MergeStaticGeometry(instances, 2);
+		CHECK(merged.Vertices.size() == 8);
+		CHECK(merged.Indices.size() == 12);
+
+		unsigned int trianglesPerCopy[2] = {};
+		for (size_t i = 0; i + 2 < merged.Indices.size(); i += 3)
+		{
+			const unsigned int* tri = &merged.Indices[i];
+			CHECK(tri[0] < merged.Vertices.size() && tri[1] < merged.Vertices.size() && tri[2] < merged.Vertices.size());
+			if (tri[0] >= merged.Vertices.size() || tri[1] >= merged.Vertices.size() || tri[2] >= merged.Vertices.size())
+				continue;
+
+			// Which copy each corner came from (by where it was moved to)
+			int copy = merged.Vertices[tri[0]].Position.x >= 5.0f ? 1 : 0;
+			for (int c = 0; c < 3; c++)
+			{
+				CHECK((merged.Vertices[tri[c]].Position.x >= 5.0f ? 1 : 0) == copy);
+				CHECK(merged.Vertices[tri[c]].Position.z == 1.0f);
+			}
+			trianglesPerCopy[copy]++;
+		}
+		CHECK(trianglesPerCopy[0] == 2 && trianglesPerCopy[1] == 2);
+	}
+}
+
+int main()
+{
+	TestMerge();
+	TestRebasing();
+	return TestResult();
+}
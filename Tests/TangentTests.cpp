@@ -0,0 +1,120 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "MeshData.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Largest difference in any component allowed between the
+	// (unit length) tangents of the fast versions & the reference
+	const float Tolerance = 1e-4f;
+
+	// --------------------------------------------------------
+	// Runs the reference, serial and parallel versions (and
+	// CalculateTangents() itself) on copies of the vertices,
+	// and checks that they all agree: serial and parallel
+	// exactly, everything else within the tolerance.  Where
+	// the reference divides by a zero UV area it ends up with
+	// NaNs, which the others turn into zero, so those are
+	// skipped.
+	// --------------------------------------------------------
+	void CheckAgainstReference(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, ThreadPool& pool)
+	{
+		std::vector<Vertex> reference = verts;
+		std::vector<Vertex> serial = verts;
+		std::vector<Vertex> parallel = verts;
+		std::vector<Vertex> dispatched = verts;
+		CalculateTangentsReference(reference.data(), reference.size(), indices.data(), indices.size());
+		CalculateTangentsSerial(serial.data(), serial.size(), indices.data(), indices.size());
+		CalculateTangentsParallel(parallel.data(), parallel.size(), indices.data(), indices.size(), pool);
+		CalculateTangents(dispatched.data(), dispatched.size(), indices.data(), indices.size());
+
+		CHECK(memcmp(serial.data(), parallel.data(), sizeof(Vertex) * serial.size()) == 0);
+		CHECK(memcmp(serial.data(), dispatched.data(), sizeof(Vertex) * serial.size()) == 0);
+
+		unsigned int compared = 0;
+		float maxError = 0.0f;
+		for (size_t v = 0; v < verts.size(); v++)
+		{
+			const XMFLOAT3& want = reference[v].Tangent;
+			if (!std::isfinite(want.x) || !std::isfinite(want.y) || !std::isfinite(want.z))
+				continue;
+
+			const XMFLOAT3& got = serial[v].Tangent;
+			maxError = std::max(maxError, std::max(fabsf(got.x - want.x), std::max(fabsf(got.y - want.y), fabsf(got.z - want.z))));
+			compared++;
+		}
+
+		std::printf("  %zu vertices (%u compared), max error %g\n", verts.size(), compared, maxError);
+		CHECK(compared > 0);
+		CHECK(maxError <= Tolerance);
+	}
+
+	// Every bundled mesh, as loaded
+	void TestBundledMeshes(ThreadPool& pool)
+	{
+		for (const std::wstring& file : TestMeshFiles())
+		{
+			std::printf("%ls\n", file.c_str());
+			MeshData mesh = LoadOBJ(file);
+			CheckAgainstReference(mesh.Vertices, mesh.Indices, pool);
+		}
+	}
+
+	// --------------------------------------------------------
+	// A wavy grid big enough for CalculateTangents() to use
+	// the thread pool, with a partial last block of triangles
+	// --------------------------------------------------------
+	void TestLargeGrid(ThreadPool& pool)
+	{
+		const unsigned int size = 183;
+		std::vector<Vertex> verts;
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				float u = (float)x / size;
+				float v = (float)y / size;
+				Vertex vert = {};
+				vert.Position = XMFLOAT3(u * 10.0f, sinf(u * 17.0f) * cosf(v * 11.0f), v * 10.0f);
+				vert.UV = XMFLOAT2(u * 3.0f, v);
+				vert.Normal = XMFLOAT3(0, 1, 0);
+				verts.push_back(vert);
+			}
+		}
+
+		std::vector<unsigned int> indices;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int corner = y * (size + 1) + x;
+				indices.insert(indices.end(), { corner, corner + size + 1, corner + 1 });
+				indices.insert(indices.end(), { corner + 1, corner + size + 1, corner + size + 2 });
+			}
+		}
+
+		// Drop one triangle, so the count isn't a multiple of 4
+		indices.resize(indices.size() - 3);
+		CHECK(indices.size() / 3 >= TANGENT_PARALLEL_MIN_TRIANGLES);
+
+		std::printf("Grid\n");
+		CheckAgainstReference(verts, indices, pool);
+	}
+}
+
+int main()
+{
+	// A pool of its own, so the parallel version really is
+	// split up, however many cores there are
+	ThreadPool pool(3);
+	TestBundledMeshes(pool);
+	TestLargeGrid(pool);
+	return TestResult();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Where the repo's Assets folder is (set by CMakeLists.txt)
+#ifndef TEST_ASSET_PATH
+#define TEST_ASSET_PATH "../Assets/"
+#endif
+
+// --------------------------------------------------------
+// Minimal checks for the headless tests: a failed CHECK()
+// prints where it was and is counted, and each test's
+// main() returns TestResult(), so ctest sees any failure
+// --------------------------------------------------------
+inline int& TestFailureCount()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			TestFailureCount()++; \
+		} \
+	} while (0)
+
+inline int TestResult()
+{
+	if (TestFailureCount() == 0)
+	{
+		std::printf("All checks passed\n");
+		return 0;
+	}
+
+	std::printf("%d check(s) failed\n", TestFailureCount());
+	return 1;
+}
+
+// Full path of one of the bundled meshes
+inline std::wstring TestMeshPath(const std::wstring& file)
+{
+	return std::wstring(L"" TEST_ASSET_PATH L"Meshes/") + file;
+}
+
+// Every bundled .obj file, in name order
+inline std::vector<std::wstring> TestMeshFiles()
+{
+	std::vector<std::wstring> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(TestMeshPath(L"")))
+		if (entry.path().extension() == ".obj")
+			files.push_back(entry.path().wstring());
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Animation.h"
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// A transform as its own heap object (with parent & child
+	// pointers, a dirty flag and lazily rebuilt matrices), the
+	// way Transform used to work
+	// --------------------------------------------------------
+	struct ObjectTransform
+	{
+		XMFLOAT3 Position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 PitchYawRoll = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 Scale = XMFLOAT3(1, 1, 1);
+		ObjectTransform* Parent = 0;
+		std::vector<ObjectTransform*> Children;
+		bool MatricesDirty = true;
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 WorldInverseTranspose;
+
+		void SetPosition(XMFLOAT3 position)
+		{
+			Position = position;
+			MatricesDirty = true;
+			MarkChildrenDirty();
+		}
+
+		void MarkChildrenDirty()
+		{
+			for (ObjectTransform* c : Children)
+			{
+				c->MatricesDirty = true;
+				c->MarkChildrenDirty();
+			}
+		}
+
+		const XMFLOAT4X4& GetWorldMatrix()
+		{
+			if (!MatricesDirty)
+				return World;
+
+			XMMATRIX wm =
+				XMMatrixScalingFromVector(XMLoadFloat3(&Scale)) *
+				XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&PitchYawRoll)) *
+				XMMatrixTranslationFromVector(XMLoadFloat3(&Position));
+			if (Parent)
+				wm *= XMLoadFloat4x4(&Parent->GetWorldMatrix());
+
+			XMStoreFloat4x4(&World, wm);
+			XMStoreFloat4x4(&WorldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(wm)));
+			MatricesDirty = false;
+			return World;
+		}
+	};
+
+	XMFLOAT4 EulerToQuaternion(XMFLOAT3 pitchYawRoll)
+	{
+		XMFLOAT4 quaternion;
+		XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
+		return quaternion;
+	}
+
+	// Largest difference between two sets of matrices, relative to
+	// the size of each value (once it's over one)
+	float MaxMatrixError(const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+	{
+		float error = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+			for (int e = 0; e < 16; e++)
+			{
+				float expected = (&b[i]._11)[e];
+				error = std::max(error, fabsf((&a[i]._11)[e] - expected) / std::max(1.0f, fabsf(expected)));
+			}
+		return error;
+	}
+
+	// --------------------------------------------------------
+	// Groups of ten transforms (a root with three children,
+	// which have two children each) with assorted rotations,
+	// and mostly uniform scales (every fourth root is stretched,
+	// so its whole group takes the full inverse).  Each
+	// iteration rebuilds every matrix with each kernel, one
+	// depth at a time, as an update with everything dirty
+	// would, and checks them against the scalar kernel.
+	// --------------------------------------------------------
+	void BenchmarkTransformKernels(unsigned int transformCount, int iterations)
+	{
+		unsigned int rootCount = transformCount / 10;
+		unsigned int count = rootCount * 10;
+		std::vector<XMFLOAT3> positions(count);
+		std::vector<XMFLOAT4> rotations(count);
+		std::vector<XMFLOAT3> scales(count, XMFLOAT3(1, 1, 1));
+		std::vector<unsigned int> parents(count, TRANSFORM_NO_PARENT);
+		std::vector<unsigned int> levels[3];
+		for (unsigned int r = 0; r < rootCount; r++)
+		{
+			unsigned int root = r * 10;
+			levels[0].push_back(root);
+			scales[root] = r % 4 == 3 ? XMFLOAT3(2.0f, 1.0f, 0.5f) : XMFLOAT3(1.5f, 1.5f, 1.5f);
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				unsigned int child = root + 1 + c * 3;
+				parents[child] = root;
+				parents[child + 1] = child;
+				parents[child + 2] = child;
+				levels[1].push_back(child);
+				levels[2].push_back(child + 1);
+				levels[2].push_back(child + 2);
+			}
+		}
+		for (unsigned int i = 0; i < count; i++)
+		{
+			positions[i] = XMFLOAT3((float)(i % 17) - 8.0f, (float)(i % 5), (float)(i % 11) * 0.5f);
+			XMStoreFloat4(&rotations[i], XMQuaternionRotationRollPitchYaw(0.37f * i, -0.11f * i, 0.05f * (i % 63)));
+		}
+
+		auto run = [&](TransformKernel kernel, std::vector<XMFLOAT4X4>& world, std::vector<XMFLOAT4X4>& inverse)
+		{
+			std::vector<unsigned char> uniformScales(count);
+			world.resize(count);
+			inverse.resize(count);
+			TransformBatchData data = { positions.data(), rotations.data(), scales.data(), parents.data(), uniformScales.data(), world.data(), inverse.data() };
+
+			BenchmarkClock::time_point start = BenchmarkClock::now();
+			for (int it = 0; it < iterations; it++)
+				for (const std::vector<unsigned int>& level : levels)
+					ComputeTransformMatrices(data, level.data(), level.size(), kernel);
+			return MillisecondsSince(start) / iterations;
+		};
+
+		std::vector<XMFLOAT4X4> scalarWorld, scalarInverse, world, inverse;
+		double scalarMilliseconds = run(TransformKernel::Scalar, scalarWorld, scalarInverse);
+		double sseMilliseconds = run(TransformKernel::SSE, world, inverse);
+		float maxError = std::max(MaxMatrixError(world, scalarWorld), MaxMatrixError(inverse, scalarInverse));
+		double avx2Milliseconds = 0;
+		if (IsTransformKernelSupported(TransformKernel::AVX2))
+		{
+			avx2Milliseconds = run(TransformKernel::AVX2, world, inverse);
+			maxError = std::max(maxError, std::max(MaxMatrixError(world, scalarWorld), MaxMatrixError(inverse, scalarInverse)));
+		}
+
+		std::printf("  Kernels, %u transforms: scalar %.3f ms, SSE %.3f ms, AVX2 %.3f ms, max error %g\n",
+			count, scalarMilliseconds, sseMilliseconds, avx2Milliseconds, maxError);
+	}
+
+	// --------------------------------------------------------
+	// The same hierarchy per-object and in a TransformSystem:
+	// every tenth transform is a root with three children,
+	// which have two children each.  Each iteration moves every
+	// root, then reads every world matrix (as drawing would).
+	// Summing the matrices' translations keeps the reads from
+	// being optimized away, and checks that both ways agree.
+	// --------------------------------------------------------
+	void BenchmarkTransforms(unsigned int transformCount, int iterations)
+	{
+		unsigned int rootCount = transformCount / 10;
+		unsigned int count = rootCount * 10;
+
+		// Parent of each transform, by creation order
+		std::vector<unsigned int> parentOf(count, TRANSFORM_NO_PARENT);
+		std::vector<unsigned int> roots;
+		for (unsigned int r = 0; r < rootCount; r++)
+		{
+			unsigned int root = r * 10;
+			roots.push_back(root);
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				unsigned int child = root + 1 + c * 3;
+				parentOf[child] = root;
+				parentOf[child + 1] = child;
+				parentOf[child + 2] = child;
+			}
+		}
+
+		std::vector<std::unique_ptr<ObjectTransform>> objects(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			objects[i] = std::make_unique<ObjectTransform>();
+			objects[i]->Scale = XMFLOAT3(1.01f, 1.01f, 1.01f);
+			objects[i]->PitchYawRoll = XMFLOAT3(0.01f * i, 0.02f, 0.0f);
+			if (parentOf[i] != TRANSFORM_NO_PARENT)
+			{
+				objects[i]->Parent = objects[parentOf[i]].get();
+				objects[parentOf[i]]->Children.push_back(objects[i].get());
+			}
+		}
+
+		double objectChecksum = 0;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (unsigned int root : roots)
+				objects[root]->SetPosition(XMFLOAT3((float)it, (float)root, 0.0f));
+			for (auto& o : objects)
+				objectChecksum += o->GetWorldMatrix()._41;
+		}
+		double objectMilliseconds = MillisecondsSince(start) / iterations;
+
+		TransformSystem system;
+		std::vector<unsigned int> handles(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			handles[i] = system.Create();
+			system.SetScale(handles[i], XMFLOAT3(1.01f, 1.01f, 1.01f));
+			system.SetRotation(handles[i], EulerToQuaternion(objects[i]->PitchYawRoll));
+			if (parentOf[i] != TRANSFORM_NO_PARENT)
+				system.SetParent(handles[i], handles[parentOf[i]]);
+		}
+		system.UpdateWorldMatrices();
+
+		double systemChecksum = 0;
+		start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (unsigned int root : roots)
+				system.SetPosition(handles[root], XMFLOAT3((float)it, (float)root, 0.0f));
+			system.UpdateWorldMatrices();
+			for (unsigned int handle : handles)
+				systemChecksum += system.GetWorldMatrix(handle)._41;
+		}
+		double systemMilliseconds = MillisecondsSince(start) / iterations;
+
+		std::printf("  Flat, %u transforms: objects %.3f ms, system %.3f ms (checksums %g / %g)\n",
+			count, objectMilliseconds, systemMilliseconds, objectChecksum, systemChecksum);
+	}
+
+	// --------------------------------------------------------
+	// Chains of transforms, each one the child of the one
+	// before.  Each frame moves every chain's root several
+	// times, then reads every world matrix.  Per-object, each
+	// move walks its whole chain marking it dirty; in the
+	// system a move is one version bump, and the chain is
+	// rebuilt once.
+	// --------------------------------------------------------
+	void BenchmarkDeepTransforms(unsigned int chainCount, unsigned int depth, int movesPerFrame, int iterations)
+	{
+		unsigned int count = chainCount * depth;
+		std::vector<std::unique_ptr<ObjectTransform>> objects(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			objects[i] = std::make_unique<ObjectTransform>();
+			objects[i]->Position = XMFLOAT3(0.0f, 0.1f, 0.0f);
+			objects[i]->PitchYawRoll = XMFLOAT3(0.0f, 0.01f, 0.0f);
+			if (i % depth != 0)
+			{
+				objects[i]->Parent = objects[i - 1].get();
+				objects[i - 1]->Children.push_back(objects[i].get());
+			}
+		}
+
+		double objectChecksum = 0;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (int move = 0; move < movesPerFrame; move++)
+				for (unsigned int root = 0; root < count; root += depth)
+					objects[root]->SetPosition(XMFLOAT3((float)it, (float)move, (float)root));
+			for (auto& o : objects)
+				objectChecksum += o->GetWorldMatrix()._41;
+		}
+		double objectMilliseconds = MillisecondsSince(start) / iterations;
+
+		TransformSystem system;
+		std::vector<unsigned int> handles(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			handles[i] = system.Create();
+			system.SetPosition(handles[i], XMFLOAT3(0.0f, 0.1f, 0.0f));
+			system.SetRotation(handles[i], EulerToQuaternion(objects[i]->PitchYawRoll));
+			if (i % depth != 0)
+				system.SetParent(handles[i], handles[i - 1]);
+		}
+		system.UpdateWorldMatrices();
+
+		double systemChecksum = 0;
+		start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (int move = 0; move < movesPerFrame; move++)
+				for (unsigned int root = 0; root < count; root += depth)
+					system.SetPosition(handles[root], XMFLOAT3((float)it, (float)move, (float)root));
+			system.UpdateWorldMatrices();
+			for (unsigned int handle : handles)
+				systemChecksum += system.GetWorldMatrix(handle)._41;
+		}
+		double systemMilliseconds = MillisecondsSince(start) / iterations;
+
+		std::printf("  Deep, %u transforms: objects %.3f ms, system %.3f ms (checksums %g / %g)\n",
+			count, objectMilliseconds, systemMilliseconds, objectChecksum, systemChecksum);
+	}
+
+	// --------------------------------------------------------
+	// Each transform turns around the world's up a bit each
+	// iteration (the same turn either way, so the results can
+	// be compared), then gets its forward vector and rotation
+	// matrix.  Stored as angles, each use rebuilds them (the
+	// forward vector through a quaternion, as MoveRelative()
+	// did), which is twelve sines & cosines; a quaternion just
+	// multiplies and normalizes.
+	// --------------------------------------------------------
+	void BenchmarkRotations(unsigned int transformCount, int iterations)
+	{
+		std::vector<XMFLOAT3> angles(transformCount);
+		std::vector<XMFLOAT4> quaternions(transformCount);
+		std::vector<XMFLOAT4> turns(transformCount);
+		std::vector<float> turnAngles(transformCount);
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			angles[i] = XMFLOAT3(0.001f * (i % 1000), 0.002f * i, 0.0f);
+			quaternions[i] = EulerToQuaternion(angles[i]);
+			turnAngles[i] = 0.0001f * (i % 100);
+			XMStoreFloat4(&turns[i], XMQuaternionRotationRollPitchYaw(0.0f, turnAngles[i], 0.0f));
+		}
+
+		std::vector<XMFLOAT4X4> eulerMatrices(transformCount);
+		std::vector<XMFLOAT4X4> quaternionMatrices(transformCount);
+		std::vector<XMFLOAT3> eulerForwards(transformCount);
+		std::vector<XMFLOAT3> quaternionForwards(transformCount);
+		XMVECTOR unitZ = XMVectorSet(0, 0, 1, 0);
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (unsigned int i = 0; i < transformCount; i++)
+			{
+				angles[i].y += turnAngles[i];
+				XMVECTOR angleVector = XMLoadFloat3(&angles[i]);
+				XMStoreFloat3(&eulerForwards[i], XMVector3Rotate(unitZ, XMQuaternionRotationRollPitchYawFromVector(angleVector)));
+				XMStoreFloat4x4(&eulerMatrices[i], XMMatrixRotationRollPitchYawFromVector(angleVector));
+			}
+		}
+		double eulerMilliseconds = MillisecondsSince(start) / iterations;
+
+		start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (unsigned int i = 0; i < transformCount; i++)
+			{
+				// The existing rotation, then the turn (around the world's up)
+				XMVECTOR q = XMQuaternionNormalize(XMQuaternionMultiply(XMLoadFloat4(&quaternions[i]), XMLoadFloat4(&turns[i])));
+				XMStoreFloat4(&quaternions[i], q);
+				XMStoreFloat3(&quaternionForwards[i], XMVector3Rotate(unitZ, q));
+				XMStoreFloat4x4(&quaternionMatrices[i], XMMatrixRotationQuaternion(q));
+			}
+		}
+		double quaternionMilliseconds = MillisecondsSince(start) / iterations;
+
+		float maxError = MaxMatrixError(eulerMatrices, quaternionMatrices);
+		for (unsigned int i = 0; i < transformCount; i++)
+			for (int e = 0; e < 3; e++)
+				maxError = std::max(maxError, fabsf((&eulerForwards[i].x)[e] - (&quaternionForwards[i].x)[e]));
+
+		std::printf("  Rotations, %u transforms: Euler %.3f ms, quaternion %.3f ms, max error %g\n",
+			transformCount, eulerMilliseconds, quaternionMilliseconds, maxError);
+	}
+
+	// Flips a quaternion to the same side as another, if need be
+	XMVECTOR AlignQuaternion(FXMVECTOR q, FXMVECTOR reference)
+	{
+		return XMVectorGetX(XMVector4Dot(q, reference)) < 0 ? XMVectorNegate(q) : q;
+	}
+
+	// --------------------------------------------------------
+	// One part of a clip sampled the straightforward way: a
+	// binary search every time, then DirectXMath's own
+	// interpolation
+	// --------------------------------------------------------
+	XMVECTOR SearchAndInterpolate(const AnimationClip& clip, AnimationTarget target, float time)
+	{
+		const std::vector<float>& times = clip.GetKeyTimes(target);
+		const std::vector<XMFLOAT4>& values = clip.GetKeyValues(target);
+		size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+		if (next == 0 || next == times.size())
+			return XMLoadFloat4(&values[next == 0 ? 0 : next - 1]);
+
+		size_t key = next - 1;
+		size_t last = times.size() - 1;
+		float u = (time - times[key]) / (times[next] - times[key]);
+		XMVECTOR a = XMLoadFloat4(&values[key]);
+		XMVECTOR b = XMLoadFloat4(&values[next]);
+		if (clip.GetInterpolation() == AnimationInterpolation::Linear)
+			return XMVectorLerp(a, b, u);
+
+		size_t before = key > 0 ? key - 1 : (clip.IsLooping() ? last - 1 : 0);
+		size_t after = next < last ? next + 1 : (clip.IsLooping() ? 1 : last);
+		XMVECTOR beforeValue = XMLoadFloat4(&values[before]);
+		XMVECTOR afterValue = XMLoadFloat4(&values[after]);
+		if (target == AnimationTarget::Rotation)
+		{
+			beforeValue = AlignQuaternion(beforeValue, a);
+			afterValue = AlignQuaternion(afterValue, b);
+		}
+		return XMVectorCatmullRom(beforeValue, a, b, afterValue, u);
+	}
+
+	// --------------------------------------------------------
+	// Sixteen looping clips of random keys (half straight lines,
+	// half curves), shared by the entities, which each start at
+	// a random time and play at a random speed, a sixtieth of a
+	// second a frame.  Sampled with binary searches, each
+	// entity setting its transform a part at a time, against an
+	// AnimationSystem; both should end with the same local data.
+	// --------------------------------------------------------
+	void BenchmarkAnimation(unsigned int entityCount, unsigned int keyCount, int iterations)
+	{
+		std::mt19937 rng(542);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const float clipLength = 4.0f;
+		const float frameTime = 1.0f / 60.0f;
+
+		std::vector<std::shared_ptr<AnimationClip>> clips;
+		for (int c = 0; c < 16; c++)
+		{
+			std::shared_ptr<AnimationClip> clip = std::make_shared<AnimationClip>(
+				c % 2 == 0 ? AnimationInterpolation::Linear : AnimationInterpolation::Cubic, true);
+
+			// Looping, so the last key repeats the first
+			float spacing = clipLength / (keyCount - 1);
+			XMFLOAT3 firstPosition(0, 0, 0);
+			XMFLOAT4 firstRotation(0, 0, 0, 1);
+			float firstScale = 1;
+			for (unsigned int k = 0; k < keyCount; k++)
+			{
+				float time = k == keyCount - 1 ? clipLength : k * spacing + (k == 0 ? 0.0f : unit(rng) * 0.25f * spacing);
+				XMFLOAT3 position(unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f);
+				XMFLOAT4 rotation;
+				XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(unit(rng) * XM_PI, unit(rng) * XM_PI, unit(rng) * XM_PI));
+				float scale = 1.0f + unit(rng) * 0.25f;
+				if (k == 0)
+				{
+					firstPosition = position;
+					firstRotation = rotation;
+					firstScale = scale;
+				}
+				else if (k == keyCount - 1)
+				{
+					position = firstPosition;
+					rotation = firstRotation;
+					scale = firstScale;
+				}
+
+				clip->AddPositionKey(time, position);
+				clip->AddRotationKey(time, rotation);
+				clip->AddScaleKey(time, XMFLOAT3(scale, scale, scale));
+			}
+			clips.push_back(clip);
+		}
+
+		std::vector<float> startTimes(entityCount);
+		std::vector<float> speeds(entityCount);
+		for (unsigned int i = 0; i < entityCount; i++)
+		{
+			startTimes[i] = (unit(rng) + 1.0f) * 0.5f * clipLength;
+			speeds[i] = 1.0f + unit(rng) * 0.5f;
+		}
+
+		// Each entity on its own
+		TransformSystem searchTransforms;
+		std::vector<unsigned int> searchHandles(entityCount);
+		for (unsigned int i = 0; i < entityCount; i++)
+			searchHandles[i] = searchTransforms.Create();
+		std::vector<float> searchTimes = startTimes;
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (unsigned int i = 0; i < entityCount; i++)
+			{
+				const AnimationClip& clip = *clips[i % clips.size()];
+				float time = searchTimes[i] = clip.WrapTime(searchTimes[i] + frameTime * speeds[i]);
+
+				XMFLOAT3 position;
+				XMFLOAT4 rotation;
+				XMFLOAT3 scale;
+				XMStoreFloat3(&position, SearchAndInterpolate(clip, AnimationTarget::Position, time));
+				XMStoreFloat4(&rotation, XMQuaternionNormalize(SearchAndInterpolate(clip, AnimationTarget::Rotation, time)));
+				XMStoreFloat3(&scale, SearchAndInterpolate(clip, AnimationTarget::Scale, time));
+				searchTransforms.SetPosition(searchHandles[i], position);
+				searchTransforms.SetRotation(searchHandles[i], rotation);
+				searchTransforms.SetScale(searchHandles[i], scale);
+			}
+		}
+		double searchMilliseconds = MillisecondsSince(start) / iterations;
+
+		// The same, all at once
+		TransformSystem batchTransforms;
+		AnimationSystem animations(batchTransforms);
+		std::vector<unsigned int> batchHandles(entityCount);
+		for (unsigned int i = 0; i < entityCount; i++)
+		{
+			batchHandles[i] = batchTransforms.Create();
+			animations.Play(clips[i % clips.size()], batchHandles[i], speeds[i], startTimes[i]);
+		}
+
+		start = BenchmarkClock::now();
+		for (int it = 0; it < iterations; it++)
+			animations.Update(frameTime);
+		double batchMilliseconds = MillisecondsSince(start) / iterations;
+
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < entityCount; i++)
+		{
+			XMFLOAT3 searchParts[2] = { searchTransforms.GetPosition(searchHandles[i]), searchTransforms.GetScale(searchHandles[i]) };
+			XMFLOAT3 batchParts[2] = { batchTransforms.GetPosition(batchHandles[i]), batchTransforms.GetScale(batchHandles[i]) };
+			for (int p = 0; p < 2; p++)
+				for (int e = 0; e < 3; e++)
+					maxError = std::max(maxError, fabsf((&searchParts[p].x)[e] - (&batchParts[p].x)[e]));
+
+			// Either sign is the same rotation
+			XMFLOAT4 searchRotation = searchTransforms.GetRotation(searchHandles[i]);
+			XMFLOAT4 batchRotation = batchTransforms.GetRotation(batchHandles[i]);
+			float dot = fabsf(XMVectorGetX(XMVector4Dot(XMLoadFloat4(&searchRotation), XMLoadFloat4(&batchRotation))));
+			maxError = std::max(maxError, 1.0f - std::min(1.0f, dot));
+		}
+
+		std::printf("  Animation, %u entities x %u keys on %u thread(s): search %.3f ms, batch %.3f ms, max error %g\n",
+			entityCount, keyCount, ThreadPool::Shared().GetThreadCount(), searchMilliseconds, batchMilliseconds, maxError);
+	}
+}
+
+void RunTransformBenchmarks(int iterations)
+{
+	std::printf("Transforms\n");
+	BenchmarkTransformKernels(100000, iterations);
+	BenchmarkTransforms(100000, iterations);
+	BenchmarkDeepTransforms(1000, 32, 100, iterations);
+	BenchmarkRotations(100000, iterations);
+	BenchmarkAnimation(10000, 64, iterations);
+}
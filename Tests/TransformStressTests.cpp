@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "ThreadPool.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Transforms each reader checks per job
+	const unsigned int ReaderChunkSize = 1024;
+
+	// --------------------------------------------------------
+	// A random hierarchy (every transform's parent was created
+	// before it, so reparenting can't make loops).  Each frame
+	// changes a twentieth of the transforms, reparents a few,
+	// and destroys & recreates one, then resolves.  Then a
+	// pool of readers (a pool of its own, so there are always
+	// several, however many cores there are) reads every world
+	// matrix at once, comparing each against its chain of
+	// local matrices, worked out here from scratch, and against
+	// ComputeWorldMatrix(), which should have nothing left to
+	// compute.  Meant to be run under ThreadSanitizer too.
+	// --------------------------------------------------------
+	void TestConcurrentReads(unsigned int transformCount, int frames)
+	{
+		ThreadPool readers(3);
+		std::mt19937 rng(542);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		auto randomIndex = [&](unsigned int count) { return (unsigned int)(rng() % count); };
+
+		TransformSystem system;
+		std::vector<unsigned int> transformHandles(transformCount);
+		std::vector<unsigned int> parentOf(transformCount, TRANSFORM_NO_PARENT);
+		auto randomize = [&](unsigned int i)
+		{
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(unit(rng) * XM_PI, unit(rng) * XM_PI, unit(rng) * XM_PI));
+			float scale = 1.0f + unit(rng) * 0.25f;
+			system.SetPosition(transformHandles[i], XMFLOAT3(unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f));
+			system.SetRotation(transformHandles[i], rotation);
+			system.SetScale(transformHandles[i], rng() % 4 == 0 ?
+				XMFLOAT3(scale, 1.0f + unit(rng) * 0.25f, 1.0f + unit(rng) * 0.25f) :
+				XMFLOAT3(scale, scale, scale));
+		};
+		auto reparent = [&](unsigned int i, unsigned int parent)
+		{
+			parentOf[i] = parent;
+			system.SetParent(transformHandles[i], parent == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : transformHandles[parent]);
+		};
+
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			transformHandles[i] = system.Create();
+			randomize(i);
+			if (i > 0 && rng() % 4 != 0)
+				reparent(i, randomIndex(i));
+		}
+
+		// What each chunk of readers found
+		struct ReaderResults
+		{
+			unsigned int Mismatches;
+			float MaxError;
+		};
+		std::vector<ReaderResults> readerResults((transformCount + ReaderChunkSize - 1) / ReaderChunkSize);
+
+		unsigned int mismatches = 0;
+		float maxError = 0.0f;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			for (unsigned int c = 0; c < transformCount / 20 + 1; c++)
+				randomize(randomIndex(transformCount));
+			for (unsigned int c = 0; c < transformCount / 1000 + 1; c++)
+			{
+				unsigned int i = 1 + randomIndex(transformCount - 1);
+				reparent(i, rng() % 4 == 0 ? TRANSFORM_NO_PARENT : randomIndex(i));
+			}
+
+			// Destroying orphans the children, and the new one starts as a root
+			unsigned int destroyed = randomIndex(transformCount);
+			system.Destroy(transformHandles[destroyed]);
+			for (unsigned int& parent : parentOf)
+				if (parent == destroyed)
+					parent = TRANSFORM_NO_PARENT;
+			parentOf[destroyed] = TRANSFORM_NO_PARENT;
+			transformHandles[destroyed] = system.Create();
+			randomize(destroyed);
+
+			system.UpdateWorldMatrices();
+
+			const TransformSystem& readOnly = system;
+			readers.ParallelFor(readerResults.size(), [&](size_t chunk)
+				{
+					ReaderResults reader = {};
+					unsigned int end = std::min(transformCount, (unsigned int)(chunk + 1) * ReaderChunkSize);
+					for (unsigned int i = (unsigned int)chunk * ReaderChunkSize; i < end; i++)
+					{
+						XMMATRIX expected = XMMatrixIdentity();
+						for (unsigned int a = i; a != TRANSFORM_NO_PARENT; a = parentOf[a])
+						{
+							XMFLOAT3 position = readOnly.GetPosition(transformHandles[a]);
+							XMFLOAT4 rotation = readOnly.GetRotation(transformHandles[a]);
+							XMFLOAT3 scale = readOnly.GetScale(transformHandles[a]);
+							expected *=
+								XMMatrixScalingFromVector(XMLoadFloat3(&scale)) *
+								XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) *
+								XMMatrixTranslationFromVector(XMLoadFloat3(&position));
+						}
+
+						XMFLOAT4X4 expectedWorld;
+						XMStoreFloat4x4(&expectedWorld, expected);
+						const XMFLOAT4X4& world = readOnly.GetWorldMatrix(transformHandles[i]);
+						XMFLOAT4X4 computed = readOnly.ComputeWorldMatrix(transformHandles[i]);
+
+						bool mismatch = memcmp(&world, &computed, sizeof(XMFLOAT4X4)) != 0;
+						for (int e = 0; e < 16; e++)
+						{
+							float want = (&expectedWorld._11)[e];
+							float error = fabsf((&world._11)[e] - want) / std::max(1.0f, fabsf(want));
+							reader.MaxError = std::max(reader.MaxError, error);
+							mismatch = mismatch || error > 1e-3f;
+						}
+						if (mismatch)
+							reader.Mismatches++;
+					}
+					readerResults[chunk] = reader;
+				});
+
+			for (const ReaderResults& reader : readerResults)
+			{
+				mismatches += reader.Mismatches;
+				maxError = std::max(maxError, reader.MaxError);
+			}
+		}
+
+		std::printf("%u transforms, %d frames, %u readers: %u mismatch(es), max error %g\n",
+			transformCount, frames, readers.GetThreadCount(), mismatches, maxError);
+		CHECK(mismatches == 0);
+	}
+}
+
+// The transform count and frame count can be given on the
+// command line, for longer runs
+int main(int argc, char* argv[])
+{
+	unsigned int transformCount = argc > 1 ? (unsigned int)std::strtoul(argv[1], 0, 10) : 20000;
+	int frames = argc > 2 ? std::atoi(argv[2]) : 30;
+	TestConcurrentReads(std::max(transformCount, 2u), frames);
+	return TestResult();
+}